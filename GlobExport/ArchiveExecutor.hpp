@@ -0,0 +1,74 @@
+#ifndef _ARCHIVEEXECUTOR_HPP_
+#define _ARCHIVEEXECUTOR_HPP_
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+namespace Archiving
+{
+	/**
+	 * Pool of worker threads that archives split the items of large arrays across,
+	 * see IDeserializer::getArrayParallel() and ISerializer::setArrayParallel().
+	 * The threads are started once and wait between batches. The calling thread works on a slice of
+	 * every batch as well, so a pool of n slices starts n - 1 threads.
+	 * One pool can be shared by several archives; batches given from different threads run one after another.
+	 */
+	class ARCHIVEUTIL_API ArchiveExecutor
+	{
+	public:
+		/** Work on the items [0, ulCount) of a batch, split into contiguous slices. */
+		class ITask
+		{
+		public:
+			virtual ~ITask() {;}
+
+			/** Called once per slice, with nSlice in [0, getSliceCount()), on one of the threads. */
+			virtual void run(unsigned nSlice, unsigned long ulBegin, unsigned long ulEnd) = 0;
+		};
+
+		/**
+		 * Starts the worker threads.
+		 * @param The number of slices per batch, 0 for one per hardware thread.
+		 */
+		ArchiveExecutor(unsigned nSlices = 0);
+
+		/** Stops and joins the worker threads. */
+		~ArchiveExecutor();
+
+		/** The number of slices each batch is split into, the worker threads plus the calling thread. */
+		unsigned getSliceCount() const {return m_nSlices;}
+
+		/**
+		 * Runs the task on the items [0, ulCount) and returns when all slices are done.
+		 * Slice i covers the items [ulCount * i / n, ulCount * (i + 1) / n), the last slice runs on the calling thread.
+		 * If a slice throws, the other slices still finish, then the first exception is rethrown.
+		 * A task that calls execute() again, as getArrayParallel() of an item does with the same pool, runs all
+		 * slices of the nested batch one after another on its own thread, since the other threads are busy with its batch.
+		 */
+		void execute(ITask& aTask, unsigned long ulCount);
+
+	protected:
+		struct State;
+
+		unsigned m_nSlices;
+		State *m_pState;     /** Threads and synchronization, kept out of the header. */
+
+		void work(unsigned nSlice);
+		void runSlice(unsigned nSlice);
+
+		/** True on the threads of the batch that is running, where execute() must not wait for the pool. */
+		bool isBatchThread();
+
+		/** Runs all slices of a nested batch on the calling thread. */
+		void executeInline(ITask& aTask, unsigned long ulCount);
+
+	private:
+		ArchiveExecutor(const ArchiveExecutor&);
+		ArchiveExecutor& operator=(const ArchiveExecutor&);
+	};
+}
+
+#endif
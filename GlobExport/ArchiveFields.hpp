@@ -0,0 +1,298 @@
+#ifndef _ARCHIVEFIELDS_HPP_
+#define _ARCHIVEFIELDS_HPP_
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+#include <string>
+#include <vector>
+#include "../include/ArchiveUtil.h"
+#include "IArchivableObject.hpp"
+#include "ISerializer.hpp"
+#include "IDeserializer.hpp"
+
+/**
+ * Declares the fields of a class derived from Archiving::ArchivedFields, in the order they are written:
+ *
+ * class Point : public Archiving::ArchivedFields<Point>
+ * {
+ * public:
+ *     int x;
+ *     std::string name;
+ *     std::vector<double> values;
+ *     Point *next;
+ *
+ *     ARCHIVE_FIELDS_BEGIN()
+ *         ARCHIVE_FIELD(x)
+ *         ARCHIVE_FIELD_KEY(name, "label")
+ *         ARCHIVE_FIELD(values)
+ *         ARCHIVE_FIELD(next)
+ *     ARCHIVE_FIELDS_END()
+ * };
+ *
+ * The macros expand to visitFields(), a template that the readers and writers below instantiate, so each field
+ * becomes a call chosen at compile time by its type. The keys are string literals whose length is known at compile
+ * time. Fields can be bool, char, short, int, long, float, double, std::string, std::vector of int, long, float
+ * or double (stored as packed arrays), and pointers to archivable objects (stored as objects, NULL is not stored).
+ *
+ * Pointer fields do not own their objects: reading one stores the object that is read in the field, which must be
+ * NULL before, and does not release what was there. The caller owns the object read. Since NULL is not stored,
+ * a field whose key is not in the archive keeps its value, NULL for an object that is read once.
+ */
+#define ARCHIVE_FIELDS_BEGIN() \
+	public: \
+		template <class T_Visitor> void visitFields(T_Visitor& aVisitor) \
+		{
+
+#define ARCHIVE_FIELD_KEY(Member, Key) \
+			aVisitor.visit(Member, Archiving::FieldKey(Key, sizeof(Key) - 1));
+
+#define ARCHIVE_FIELD(Member) ARCHIVE_FIELD_KEY(Member, #Member)
+
+#define ARCHIVE_FIELDS_END() \
+		}
+
+namespace Archiving
+{
+	/** The key of a field, a string literal and its length. */
+	struct FieldKey
+	{
+		const char *pName;
+		size_t nLength;
+
+		FieldKey(const char *pName, size_t nLength) : pName(pName), nLength(nLength) {;}
+	};
+
+	/** Base of the classes with declared fields, which FieldWriter and FieldReader tell from other objects. */
+	class ArchivedFieldsBase : public IArchivableObject
+	{
+	};
+
+	/**
+	 * Implements IArchivableObject for a class T_Object that declares its fields with ARCHIVE_FIELDS_BEGIN(),
+	 * so it can be set and read through any ISerializer and IDeserializer like other objects.
+	 * A KeyValueArchive writes and reads it without virtual calls, see KeyValueArchive::setFields().
+	 * A class that stores more than its fields overrides serialize() and deserialize() and calls these first.
+	 */
+	template <class T_Object>
+	class ArchivedFields : public ArchivedFieldsBase
+	{
+	public:
+		virtual void serialize(ISerializer *encoder);
+		virtual void deserialize(IDeserializer *decoder);
+	};
+
+	/**
+	 * Writes the fields of an object into the current scope of T_Archive, a KeyValueArchive.
+	 * The setters are called qualified with the archive's class, which the compiler binds without the virtual
+	 * call and can inline. The key is copied into a buffer that is reused for every field.
+	 */
+	template <class T_Archive>
+	class FieldWriter
+	{
+	public:
+		FieldWriter(T_Archive& aArchive) : m_aArchive(aArchive) {;}
+
+		void visit(bool bValue, const FieldKey& aKey)           {m_aArchive.T_Archive::setBool(bValue, key(aKey));}
+		void visit(char cValue, const FieldKey& aKey)           {m_aArchive.T_Archive::setChar(cValue, key(aKey));}
+		void visit(short sValue, const FieldKey& aKey)          {m_aArchive.T_Archive::setShort(sValue, key(aKey));}
+		void visit(int iValue, const FieldKey& aKey)            {m_aArchive.T_Archive::setInt(iValue, key(aKey));}
+		void visit(long lValue, const FieldKey& aKey)           {m_aArchive.T_Archive::setLong(lValue, key(aKey));}
+		void visit(float fValue, const FieldKey& aKey)          {m_aArchive.T_Archive::setFloat(fValue, key(aKey));}
+		void visit(double dValue, const FieldKey& aKey)         {m_aArchive.T_Archive::setDouble(dValue, key(aKey));}
+		void visit(const std::string& sValue, const FieldKey& aKey) {m_aArchive.T_Archive::setString(sValue, key(aKey));}
+		void visit(const std::vector<int>& lValues, const FieldKey& aKey)    {m_aArchive.T_Archive::setIntArray(data(lValues), (unsigned long)lValues.size(), key(aKey));}
+		void visit(const std::vector<long>& lValues, const FieldKey& aKey)   {m_aArchive.T_Archive::setLongArray(data(lValues), (unsigned long)lValues.size(), key(aKey));}
+		void visit(const std::vector<float>& lValues, const FieldKey& aKey)  {m_aArchive.T_Archive::setFloatArray(data(lValues), (unsigned long)lValues.size(), key(aKey));}
+		void visit(const std::vector<double>& lValues, const FieldKey& aKey) {m_aArchive.T_Archive::setDoubleArray(data(lValues), (unsigned long)lValues.size(), key(aKey));}
+
+		template <class T_Object> void visit(T_Object *pObject, const FieldKey& aKey)
+		{
+			if (pObject)
+				setObject(pObject, key(aKey), pObject);
+		}
+
+	protected:
+		T_Archive& m_aArchive;
+		std::string m_sKey;
+
+		const std::string& key(const FieldKey& aKey) {return m_sKey.assign(aKey.pName, aKey.nLength);}
+		template <class T_Value> static const T_Value* data(const std::vector<T_Value>& lValues) {return lValues.empty() ? NULL : &lValues[0];}
+
+		/** Objects with declared fields are written statically as well, others by their serialize(). */
+		template <class T_Object> void setObject(T_Object *pObject, const std::string& sKey, const ArchivedFieldsBase*) {m_aArchive.setFields(*pObject, sKey);}
+		void setObject(IArchivableObject *pObject, const std::string& sKey, const void*) {m_aArchive.T_Archive::setObject(pObject, sKey);}
+	};
+
+	/** Same as above through the virtual interface, used by ArchivedFields::serialize(). */
+	template <>
+	class FieldWriter<ISerializer>
+	{
+	public:
+		FieldWriter(ISerializer& aArchive) : m_aArchive(aArchive) {;}
+
+		void visit(bool bValue, const FieldKey& aKey)           {m_aArchive.setBool(bValue, key(aKey));}
+		void visit(char cValue, const FieldKey& aKey)           {m_aArchive.setChar(cValue, key(aKey));}
+		void visit(short sValue, const FieldKey& aKey)          {m_aArchive.setShort(sValue, key(aKey));}
+		void visit(int iValue, const FieldKey& aKey)            {m_aArchive.setInt(iValue, key(aKey));}
+		void visit(long lValue, const FieldKey& aKey)           {m_aArchive.setLong(lValue, key(aKey));}
+		void visit(float fValue, const FieldKey& aKey)          {m_aArchive.setFloat(fValue, key(aKey));}
+		void visit(double dValue, const FieldKey& aKey)         {m_aArchive.setDouble(dValue, key(aKey));}
+		void visit(const std::string& sValue, const FieldKey& aKey) {m_aArchive.setString(sValue, key(aKey));}
+		void visit(const std::vector<int>& lValues, const FieldKey& aKey)    {m_aArchive.setIntArray(lValues, key(aKey));}
+		void visit(const std::vector<long>& lValues, const FieldKey& aKey)   {m_aArchive.setLongArray(lValues, key(aKey));}
+		void visit(const std::vector<float>& lValues, const FieldKey& aKey)  {m_aArchive.setFloatArray(lValues, key(aKey));}
+		void visit(const std::vector<double>& lValues, const FieldKey& aKey) {m_aArchive.setDoubleArray(lValues, key(aKey));}
+
+		template <class T_Object> void visit(T_Object *pObject, const FieldKey& aKey)
+		{
+			if (pObject)
+				m_aArchive.setObject(pObject, key(aKey));
+		}
+
+	protected:
+		ISerializer& m_aArchive;
+		std::string m_sKey;
+
+		const std::string& key(const FieldKey& aKey) {return m_sKey.assign(aKey.pName, aKey.nLength);}
+	};
+
+	/**
+	 * Reads the fields of an object from the current scope of T_Archive, a KeyValueArchive, calling the getters
+	 * like FieldWriter calls the setters. A field that is not found, or has another type, keeps its value, so
+	 * fields added to a class later keep the defaults of its constructor when older archives are read.
+	 */
+	template <class T_Archive>
+	class FieldReader
+	{
+	public:
+		FieldReader(T_Archive& aArchive) : m_aArchive(aArchive) {;}
+
+		void visit(bool& bValue, const FieldKey& aKey)   {bool bRead = m_aArchive.T_Archive::getBool(key(aKey), &m_nRead); if (found()) bValue = bRead;}
+		void visit(char& cValue, const FieldKey& aKey)   {char cRead = m_aArchive.T_Archive::getChar(key(aKey), &m_nRead); if (found()) cValue = cRead;}
+		void visit(short& sValue, const FieldKey& aKey)  {short sRead = m_aArchive.T_Archive::getShort(key(aKey), &m_nRead); if (found()) sValue = sRead;}
+		void visit(int& iValue, const FieldKey& aKey)    {int iRead = m_aArchive.T_Archive::getInt(key(aKey), &m_nRead); if (found()) iValue = iRead;}
+		void visit(long& lValue, const FieldKey& aKey)   {long lRead = m_aArchive.T_Archive::getLong(key(aKey), &m_nRead); if (found()) lValue = lRead;}
+		void visit(float& fValue, const FieldKey& aKey)  {float fRead = m_aArchive.T_Archive::getFloat(key(aKey), &m_nRead); if (found()) fValue = fRead;}
+		void visit(double& dValue, const FieldKey& aKey) {double dRead = m_aArchive.T_Archive::getDouble(key(aKey), &m_nRead); if (found()) dValue = dRead;}
+		void visit(std::string& sValue, const FieldKey& aKey)
+		{
+			std::string sRead = m_aArchive.T_Archive::getString(key(aKey), &m_nRead);
+			if (found())
+				sValue.swap(sRead);
+		}
+
+		void visit(std::vector<int>& lValues, const FieldKey& aKey)    {getVector(lValues, key(aKey));}
+		void visit(std::vector<long>& lValues, const FieldKey& aKey)   {getVector(lValues, key(aKey));}
+		void visit(std::vector<float>& lValues, const FieldKey& aKey)  {getVector(lValues, key(aKey));}
+		void visit(std::vector<double>& lValues, const FieldKey& aKey) {getVector(lValues, key(aKey));}
+
+		template <class T_Object> void visit(T_Object*& pObject, const FieldKey& aKey)
+		{
+			T_Object *pRead = getObject(key(aKey), (T_Object *)NULL, (T_Object *)NULL);
+			if (found())
+			{
+				assert(!pObject && "Pointer fields do not own their objects and must be NULL before they are read!");
+				pObject = pRead;
+			}
+		}
+
+	protected:
+		T_Archive& m_aArchive;
+		std::string m_sKey;
+		ArchivingResult m_nRead;              /** The result of the field read last. */
+
+		const std::string& key(const FieldKey& aKey) {return m_sKey.assign(aKey.pName, aKey.nLength);}
+
+		bool found() const {return m_nRead == Found;}
+
+		/** Reads the packed array into a vector of its size, with a single lookup of the key. */
+		template <class T_Value> void getVector(std::vector<T_Value>& lValues, const std::string& sKey)
+		{
+			std::vector<T_Value> lRead;
+			getArray(sKey, lRead);
+			if (found())
+				lValues.swap(lRead);
+		}
+
+		void getArray(const std::string& sKey, std::vector<int>& lValues)    {m_aArchive.T_Archive::getIntArray(sKey, lValues, &m_nRead);}
+		void getArray(const std::string& sKey, std::vector<long>& lValues)   {m_aArchive.T_Archive::getLongArray(sKey, lValues, &m_nRead);}
+		void getArray(const std::string& sKey, std::vector<float>& lValues)  {m_aArchive.T_Archive::getFloatArray(sKey, lValues, &m_nRead);}
+		void getArray(const std::string& sKey, std::vector<double>& lValues) {m_aArchive.T_Archive::getDoubleArray(sKey, lValues, &m_nRead);}
+
+		/** Objects with declared fields are read statically as well, others by their deserialize(). */
+		template <class T_Object> T_Object* getObject(const std::string& sKey, T_Object*, const ArchivedFieldsBase*)
+		{
+			return m_aArchive.template getFields<T_Object>(sKey, &m_nRead);
+		}
+		template <class T_Object> T_Object* getObject(const std::string& sKey, T_Object*, const void*)
+		{
+			return m_aArchive.template getObject<T_Object>(sKey, &m_nRead);
+		}
+	};
+
+	/** Same as above through the virtual interface, used by ArchivedFields::deserialize(). */
+	template <>
+	class FieldReader<IDeserializer>
+	{
+	public:
+		FieldReader(IDeserializer& aArchive) : m_aArchive(aArchive) {;}
+
+		void visit(bool& bValue, const FieldKey& aKey)   {bool bRead = m_aArchive.getBool(key(aKey), &m_nRead); if (found()) bValue = bRead;}
+		void visit(char& cValue, const FieldKey& aKey)   {char cRead = m_aArchive.getChar(key(aKey), &m_nRead); if (found()) cValue = cRead;}
+		void visit(short& sValue, const FieldKey& aKey)  {short sRead = m_aArchive.getShort(key(aKey), &m_nRead); if (found()) sValue = sRead;}
+		void visit(int& iValue, const FieldKey& aKey)    {int iRead = m_aArchive.getInt(key(aKey), &m_nRead); if (found()) iValue = iRead;}
+		void visit(long& lValue, const FieldKey& aKey)   {long lRead = m_aArchive.getLong(key(aKey), &m_nRead); if (found()) lValue = lRead;}
+		void visit(float& fValue, const FieldKey& aKey)  {float fRead = m_aArchive.getFloat(key(aKey), &m_nRead); if (found()) fValue = fRead;}
+		void visit(double& dValue, const FieldKey& aKey) {double dRead = m_aArchive.getDouble(key(aKey), &m_nRead); if (found()) dValue = dRead;}
+		void visit(std::string& sValue, const FieldKey& aKey)
+		{
+			std::string sRead = m_aArchive.getString(key(aKey), &m_nRead);
+			if (found())
+				sValue.swap(sRead);
+		}
+
+		void visit(std::vector<int>& lValues, const FieldKey& aKey)    {std::vector<int> lRead; m_aArchive.getIntArray(key(aKey), lRead, &m_nRead); if (found()) lValues.swap(lRead);}
+		void visit(std::vector<long>& lValues, const FieldKey& aKey)   {std::vector<long> lRead; m_aArchive.getLongArray(key(aKey), lRead, &m_nRead); if (found()) lValues.swap(lRead);}
+		void visit(std::vector<float>& lValues, const FieldKey& aKey)  {std::vector<float> lRead; m_aArchive.getFloatArray(key(aKey), lRead, &m_nRead); if (found()) lValues.swap(lRead);}
+		void visit(std::vector<double>& lValues, const FieldKey& aKey) {std::vector<double> lRead; m_aArchive.getDoubleArray(key(aKey), lRead, &m_nRead); if (found()) lValues.swap(lRead);}
+
+		template <class T_Object> void visit(T_Object*& pObject, const FieldKey& aKey)
+		{
+			T_Object *pRead = m_aArchive.getObject<T_Object>(key(aKey), &m_nRead);
+			if (found())
+			{
+				assert(!pObject && "Pointer fields do not own their objects and must be NULL before they are read!");
+				pObject = pRead;
+			}
+		}
+
+	protected:
+		IDeserializer& m_aArchive;
+		std::string m_sKey;
+		ArchivingResult m_nRead;              /** The result of the field read last. */
+
+		const std::string& key(const FieldKey& aKey) {return m_sKey.assign(aKey.pName, aKey.nLength);}
+
+		bool found() const {return m_nRead == Found;}
+	};
+
+	template <class T_Object>
+	void ArchivedFields<T_Object>::serialize(ISerializer *encoder)
+	{
+		FieldWriter<ISerializer> aWriter(*encoder);
+		static_cast<T_Object*>(this)->visitFields(aWriter);
+	}
+
+	template <class T_Object>
+	void ArchivedFields<T_Object>::deserialize(IDeserializer *decoder)
+	{
+		FieldReader<IDeserializer> aReader(*decoder);
+		static_cast<T_Object*>(this)->visitFields(aReader);
+	}
+}
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef _ARCHIVESTATS_HPP_
+#define _ARCHIVESTATS_HPP_
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "../include/ArchiveUtil.h"
+#include "SymbolTable.hpp"
+
+namespace boost
+{
+	class mutex;
+}
+
+namespace Archiving
+{
+	/**
+	 * Performance statistics of a KeyValueArchive, see KeyValueArchive::enableStats().
+	 * Counts nodes, bytes and lookups, and measures the time spent in the phases of loading and saving,
+	 * with the time in serialize(), deserialize() and the delegate callbacks broken down per class.
+	 * The phases overlap with the class times: a lookup inside deserialize() counts for both.
+	 *
+	 * An archive without stats only tests for them. With stats, a counter costs an increment and a timed
+	 * call two reads of the performance counter.
+	 * The stats belong to the thread that uses the archive. The cursors and fragments of the parallel array
+	 * methods keep stats of their own, which are added to those of their archive when they are deleted.
+	 */
+	class ARCHIVEUTIL_API ArchiveStats
+	{
+	public:
+		enum Counter
+		{
+			kNodesCreated,      /** Nodes added by the setters. */
+			kBytesRead,         /** Size of the loaded files and strings. */
+			kBytesWritten,      /** Size of the saved files and archive strings. */
+			kLookups,           /** Child lookups by key and type. */
+			kLookupMisses,      /** Lookups that found no child of the type. */
+			kBadType,           /** Results of verifyNode(). */
+			kNotFound,
+			kOrderedHits,       /** Reads found by the ordered-read cursor of KeyValueArchive, without a keyed lookup. */
+			kOrderedMisses,     /** Reads that fell back to the keyed lookup. */
+			kCounterCount
+		};
+
+		enum Phase
+		{
+			kParse,             /** Loading files and strings. */
+			kWrite,             /** Saving files and formatting archive strings. */
+			kLookup,            /** Child lookups, with the nodes they materialize. Streamed input is parsed here. */
+			kValue,             /** Reading, writing and converting values. */
+			kPhaseCount
+		};
+
+		/** The times of one class, in milliseconds. */
+		struct ClassStats
+		{
+			std::string sName;
+			unsigned long ulSerialized;
+			unsigned long ulDeserialized;
+			unsigned long ulDelegateCalls;
+			double dSerializeMs;        /** Time in serialize(), with the nested objects. */
+			double dSerializeSelfMs;    /** The same, without the nested objects and their delegate calls. */
+			double dDeserializeMs;
+			double dDeserializeSelfMs;
+			double dDelegateMs;
+		};
+
+		/**
+		 * @param The symbols of the archive, which the classes are kept by.
+		 * @param Stats that these are added to when they are deleted, or NULL.
+		 */
+		ArchiveStats(SymbolTable& aSymbols, ArchiveStats *pParent = NULL);
+		~ArchiveStats();
+
+		void reset();
+
+		/** Results */
+		unsigned long long getCounter(Counter nCounter) const {return m_aCounters[nCounter];}
+		double getMilliseconds(Phase nPhase) const {return toMilliseconds(m_aTicks[nPhase]);}
+
+		/** The share of reads found by the ordered-read cursor, 0 without reads. */
+		double getOrderedHitRate() const
+		{
+			unsigned long long ullReads = m_aCounters[kOrderedHits] + m_aCounters[kOrderedMisses];
+			return ullReads ? (double)m_aCounters[kOrderedHits] / ullReads : 0.0;
+		}
+		std::vector<ClassStats> getClasses() const;
+
+		/**
+		 * All results as name/value pairs for export, e.g. "lookups", "parse_ms"
+		 * or "class.<name>.deserialize_ms".
+		 */
+		std::vector<std::pair<std::string, double> > getValues() const;
+
+		/** The results as text, the counters and phases followed by a line per class. */
+		std::string getReport() const;
+
+		/** Recording, used by KeyValueArchive */
+		static unsigned long long now();
+		static unsigned long long getFileSize(const std::string& sPath);
+
+		void count(Counter nCounter, unsigned long long ullAmount = 1) {m_aCounters[nCounter] += ullAmount;}
+		void countResult(ArchivingResult nResult);
+		void addTime(Phase nPhase, unsigned long long ullStart) {m_aTicks[nPhase] += now() - ullStart;}
+
+		/** Times a phase while in scope. Does nothing without stats. */
+		class PhaseTimer
+		{
+		public:
+			PhaseTimer(ArchiveStats *pStats, Phase nPhase) : m_pStats(pStats), m_nPhase(nPhase), m_ullStart(pStats ? now() : 0) {;}
+			~PhaseTimer() {if (m_pStats) m_pStats->addTime(m_nPhase, m_ullStart);}
+
+		protected:
+			ArchiveStats *m_pStats;
+			Phase m_nPhase;
+			unsigned long long m_ullStart;
+		};
+
+		/**
+		 * Times a call of serialize() or deserialize(). The time of the objects nested in it is left out
+		 * of its self time.
+		 */
+		struct ObjectTimer
+		{
+			unsigned long long ullStart;
+			unsigned long long ullOuterNested;
+		};
+		void beginObject(ObjectTimer& aTimer);
+		void endObject(ObjectTimer& aTimer, Symbol ulClass, bool bSerialize);
+
+		/** Adds the time of a delegate callback for an object of the class, which started at ullStart. */
+		void addDelegateTime(Symbol ulClass, unsigned long long ullStart);
+
+	protected:
+		struct ClassTicks
+		{
+			unsigned long ulSerialized;
+			unsigned long ulDeserialized;
+			unsigned long ulDelegateCalls;
+			unsigned long long ullSerialize;
+			unsigned long long ullSerializeSelf;
+			unsigned long long ullDeserialize;
+			unsigned long long ullDeserializeSelf;
+			unsigned long long ullDelegate;
+		};
+
+		SymbolTable& m_aSymbols;
+		ArchiveStats *m_pParent;
+		boost::mutex *m_pMutex;                  /** Guards merge() into these stats. */
+		unsigned long long m_aCounters[kCounterCount];
+		unsigned long long m_aTicks[kPhaseCount];
+		unsigned long long m_ullNested;          /** Time of the objects finished inside the current one. */
+		std::vector<ClassTicks> m_lsClasses;     /** Indexed by the class symbol. */
+
+		ClassTicks& getClass(Symbol ulClass);
+		void merge(const ArchiveStats& aOther);
+		static double toMilliseconds(unsigned long long ullTicks);
+
+	private:
+		ArchiveStats(const ArchiveStats&);
+		ArchiveStats& operator=(const ArchiveStats&);
+	};
+}
+
+#endif
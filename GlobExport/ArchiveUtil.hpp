@@ -15,6 +15,16 @@
 #include "KeyValueArchive.hpp"
 #include "XercesNode.hpp"
 #include "XercesDriver.hpp"
+#include "XercesSAXNode.hpp"
+#include "XercesSAXDriver.hpp"
+#include "XercesWriteNode.hpp"
+#include "XercesWriteDriver.hpp"
+#include "BinaryNode.hpp"
+#include "BinaryDriver.hpp"
+#include "BinaryMappedNode.hpp"
+#include "BinaryMappedDriver.hpp"
+#include "CompressedDriver.hpp"
+#include "ObjectPool.hpp"
 
 namespace Archiving
 {
@@ -30,7 +40,15 @@ namespace Archiving
 	 * @see ArchivingResult
 	 * @return Returns true if the node and the expected type or class are valid. Otherwise false.
 	 */
-	ARCHIVEUTIL_API_FUNCTION (bool) verifyNode(string sString, INode *pNode, ArchivingResult *pResult);
+	ARCHIVEUTIL_API_FUNCTION (bool) verifyNode(const string& sString, INode *pNode, ArchivingResult *pResult);
+
+	/** Verifies a INode like above, comparing the type by symbol.
+	 * @param The symbol of the type or classname in the SymbolTable of the node's driver.
+	 * @param The node itself.
+	 * @param The result.
+	 * @see SymbolTable
+	 */
+	ARCHIVEUTIL_API_FUNCTION (bool) verifyNode(Symbol ulType, INode *pNode, ArchivingResult *pResult);
 
 	/**
 	 * XML file based archive. Version 1.0
@@ -39,12 +57,44 @@ namespace Archiving
 	 */
 	typedef KeyValueArchive<Archiving::Xerces::Driver> XMLArchive;
 
+	/**
+	 * Read-only XML archive that streams the file instead of building a DOM.
+	 * Using the Xerces SAX driver and node. Keys should be read in the order they were written.
+	 */
+	typedef KeyValueArchive<Archiving::Xerces::SAXDriver> StreamingXMLArchive;
+
+	/**
+	 * Write-only XML archive that streams the XML to a file while serializing, without building a DOM.
+	 * Using the Xerces write driver and node. openOutput() opens the file the XML is written to.
+	 */
+	typedef KeyValueArchive<Archiving::Xerces::WriteDriver> StreamingXMLWriter;
+
 	/**
 	 * XML file based archive. Version 2.0
 	 * Using the Xerces driver and node.
 	 * @version 2.0
 	 */
 	//typedef KeyValueArchive<Archiving::Xerces::Driver_2> XMLArchive2;
+
+	/**
+	 * Binary file based archive.
+	 * Using the binary driver and node, stores the same tree as XMLArchive in a compact binary format.
+	 */
+	typedef KeyValueArchive<Archiving::Binary::Driver> BinaryArchive;
+
+	/**
+	 * Read-only binary archive.
+	 * Maps a file written by BinaryArchive into memory and reads it in place, without building a node tree.
+	 */
+	typedef KeyValueArchive<Archiving::Binary::MappedDriver> MappedBinaryArchive;
+
+	/**
+	 * The archives above with zlib compressed files, see CompressedDriver.
+	 * They load plain and gzip files as well, so they can replace the plain archives without converting existing files.
+	 */
+	typedef KeyValueArchive<Archiving::CompressedDriver<Archiving::Xerces::Driver> > CompressedXMLArchive;
+	typedef KeyValueArchive<Archiving::CompressedDriver<Archiving::Xerces::SAXDriver> > CompressedStreamingXMLArchive;
+	typedef KeyValueArchive<Archiving::CompressedDriver<Archiving::Binary::Driver> > CompressedBinaryArchive;
 }
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef _ASYNCSAVE_HPP_
+#define _ASYNCSAVE_HPP_
+
+#include <string>
+#include "IArchivingDriver.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+namespace Archiving
+{
+	/**
+	 * Saves a snapshot of an archive on a thread of its own, see KeyValueArchive::saveAsync().
+	 * The thread is started with the save and ends once the file is written. Deleting the save waits for it.
+	 */
+	class ARCHIVEUTIL_API AsyncSave
+	{
+	public:
+		/** Told on the saving thread when the save is done. It must not wait for the save or delete it. */
+		class IListener
+		{
+		public:
+			virtual ~IListener() {;}
+
+			/** bSaved is false if the file was not written or the save threw. */
+			virtual void saveFinished(AsyncSave& aSave, bool bSaved) = 0;
+		};
+
+		/** Starts saving the snapshot, which the save deletes. */
+		AsyncSave(IArchivingDriver::Snapshot *pSnapshot, IListener *pListener = NULL);
+		~AsyncSave();
+
+		/** True once the save is done. */
+		bool isDone();
+
+		/**
+		 * Waits for the save.
+		 * @return True if the file was written. What the save threw is rethrown here.
+		 */
+		bool wait();
+
+		/** The file the snapshot is saved to. */
+		const std::string& getFile() const;
+
+	protected:
+		struct State;
+
+		IArchivingDriver::Snapshot *m_pSnapshot;
+		IListener *m_pListener;
+		State *m_pState;     /** Thread and synchronization, kept out of the header. */
+
+		void run();
+
+	private:
+		AsyncSave(const AsyncSave&);
+		AsyncSave& operator=(const AsyncSave&);
+	};
+}
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef _BINARYDRIVER_HPP_
+#define _BINARYDRIVER_HPP_
+
+#include <vector>
+#include "IArchivingDriver.hpp"
+#include "DriverTraits.hpp"
+#include "BinaryNode.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+class KeyValueArchive;
+class INode;
+
+namespace Archiving
+{
+	namespace Binary
+	{
+		class Node;
+		class TreeSnapshot;
+		class BackgroundLoad;
+
+		/**
+		 * Archiving driver that stores the key/type/value tree in a compact, tagged and length-prefixed
+		 * binary format instead of XML (see include/BinaryFormat.h for the layout).
+		 * It can be used as a drop-in replacement for Xerces::Driver: KeyValueArchive<Binary::Driver>
+		 * works with unchanged IArchivableObject::serialize/deserialize code.
+		 * getString() returns the binary image, not human readable text.
+		 *
+		 * The driver keeps track of the nodes changed since the archive was loaded from or saved to a file,
+		 * so saveChanges() can append just those to the file instead of writing it again.
+		 *
+		 * loadFromFileAsync() parses the nodes below the root on a thread of its own. A node is linked to its parent
+		 * once its fields are read, lookups among the children of a node that is still parsed wait for the child
+		 * or the end of the node. Of two children with the same key, such a lookup may find the first, a synchronous load finds the last.
+		 */
+		class ARCHIVEUTIL_API Driver : public IArchivingDriver
+		{
+			friend class Node;
+			friend class TreeSnapshot;
+			friend class BackgroundLoad;
+
+		public:
+			Driver();
+			virtual ~Driver();
+
+		protected:
+			Node *m_pRootNode;
+			std::string m_sPath;           /** The file last loaded, used by save() if no path is given. */
+			unsigned long m_ulErrorCount;
+			bool m_bIsLoad;
+
+			/** The file the nodes with an id are stored in, see saveChanges() */
+			std::vector<Node*> m_lsChanged;         /** Stored nodes changed since the last save, and nodes added to stored nodes. */
+			std::string m_sBasePath;                /** Empty if the nodes are not stored in a file. */
+			unsigned long long m_ullFileSize;       /** The size of the file as the driver left it. */
+			unsigned long long m_ullBaseSize;       /** The size without the segments. */
+			unsigned long m_ulNextId;               /** The id of the next node stored. */
+
+			/** Snapshots that may still copy the nodes, see createSnapshot() */
+			std::vector<TreeSnapshot*> m_lsSnapshots;
+			unsigned long m_ulGeneration;           /** Counts the snapshots taken. */
+
+			BackgroundLoad *m_pLoad;                /** The parse of an asynchronous load until waitForLoad(), NULL otherwise. */
+
+		public:
+			/** Init */
+			virtual void init();
+
+			/** Load/Write */
+			virtual bool save(std::string sFile = "");
+
+			/**
+			 * Appends the nodes changed since the archive was loaded from or saved to sFile as a segment
+			 * (see include/BinaryFormat.h), which takes time in the size of the changes instead of the archive.
+			 * Saves the whole archive if it was loaded from somewhere else or the file was changed by someone else,
+			 * and once the segments have grown larger than the rest of the file, which drops them again.
+			 * Files with segments load with Driver, MappedDriver reads them after the next full save().
+			 */
+			virtual bool saveChanges(std::string sFile = "");
+
+			/**
+			 * Takes the snapshot without copying or formatting the nodes: the saving thread copies them, and until
+			 * it is done, the nodes the snapshot holds hand it their fields before they change (see Node::preserve()).
+			 * The copy shares the strings of the arena, which are never changed in place.
+			 * The next saveChanges() saves the whole archive.
+			 */
+			virtual Snapshot* createSnapshot(std::string sFile);
+			virtual bool loadFromFile(const std::string& sFile);
+			virtual bool loadFromString(const std::string& sData);
+
+			/**
+			 * Parses the string table and the root on the calling thread, and the rest on a thread of its own.
+			 * Files with segments are loaded synchronously, since the segments change nodes that would already be read.
+			 */
+			virtual bool loadFromFileAsync(const std::string& sFile);
+			virtual bool loadFromStringAsync(const std::string& sData);
+			virtual bool waitForLoad();
+			virtual void reset();
+
+			virtual std::string getString();
+
+			/** Accessors */
+			virtual INode* getRootNode();
+			virtual unsigned long getErrorCount();
+			virtual bool getIsLoad();
+
+			/** The nodes are plain memory once their type symbols are resolved, which this does for the subtree. */
+			virtual bool prepareConcurrentReads(INode *pNode);
+
+			/** Fragments are drivers of their own, their nodes and arena are adopted when the fragment is appended. */
+			virtual IArchivingDriver* createFragment(INode *pParent);
+			virtual void appendFragment(INode *pParent, IArchivingDriver *pFragment);
+
+		protected:
+			/** Indexes the children in the subtree of pNode again, with the symbols of this driver. */
+			void reindex(Node *pNode);
+
+			/** Gives the nodes of the subtree the next ids, in the order the file stores them. */
+			void number(Node *pNode);
+
+			/** Takes the nodes as stored in sPath, which now has the given size. */
+			void setBase(const std::string& sPath, unsigned long long ullFileSize, unsigned long long ullBaseSize);
+
+			virtual void dropChanges();
+
+			/** Hands the fields of a node that is about to change to the snapshots that still copy the nodes. */
+			void preserve(Node *pNode);
+
+			/** Starts the parse of sData, which is taken over. sFile is the file it was read from, if any. */
+			bool startLoad(std::string& sData, const std::string& sFile);
+
+			/** True if the load has parsed all children of pNode, as far as the lookups know. */
+			bool isParsed(Node *pNode);
+
+			/**
+			 * The lookups of Node while the load parses. getChildWhileLoading() waits until the node is complete, so that of
+			 * children with the same key it finds the last as after the load. The others wait until the next child is parsed.
+			 */
+			INode* getChildWhileLoading(Node *pNode, const std::string& sKey, Symbol ulType);
+			INode* getNextChildWhileLoading(Node *pNode, INode *pChild, const std::string& sKey);
+			bool hasChildrenWhileLoading(Node *pNode);
+		};
+	}
+
+	namespace Binary
+	{
+		inline INode* Node::getNextChild(INode *pChild, const std::string& sKey)
+		{
+			Driver *pDriver = (Driver *)getDriver();
+			if (pDriver->m_pLoad && !pDriver->isParsed(this))
+				return pDriver->getNextChildWhileLoading(this, pChild, sKey);
+
+			Node *pNext = pChild ? ((Node *)pChild)->m_pNextSibling : m_pFirstChild;
+			return pNext && pNext->m_aName == sKey ? pNext : NULL;
+		}
+
+		inline bool Node::hasChildren()
+		{
+			Driver *pDriver = (Driver *)getDriver();
+			if (pDriver->m_pLoad && !pDriver->isParsed(this))
+				return pDriver->hasChildrenWhileLoading(this);
+			return m_ulChildren != 0;
+		}
+	}
+
+	/** All nodes of the driver are Binary::Node, so KeyValueArchive calls them statically. */
+	template <> struct DriverTraits<Binary::Driver> {typedef StaticNodeCalls<Binary::Node> NodeCalls;};
+}
+
+#endif
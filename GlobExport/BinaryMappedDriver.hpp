@@ -0,0 +1,98 @@
+#ifndef _BINARYMAPPEDDRIVER_HPP_
+#define _BINARYMAPPEDDRIVER_HPP_
+
+#include "IArchivingDriver.hpp"
+#include "DriverTraits.hpp"
+#include "BinaryMappedNode.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+namespace boost
+{
+	namespace interprocess
+	{
+		class file_mapping;
+		class mapped_region;
+	}
+}
+
+class KeyValueArchive;
+class INode;
+
+namespace Archiving
+{
+	namespace Binary
+	{
+		class MappedNode;
+
+		namespace Format
+		{
+			class StringTableView;
+		}
+
+		/**
+		 * Read-only driver for binary archives written by Binary::Driver.
+		 * loadFromFile() maps the file into memory instead of reading it. Opening only checks the header and
+		 * locates the string table, so the time to open does not depend on the size of the archive, and the
+		 * mapped pages are shared with other processes reading the same file through the page cache.
+		 * The nodes are views into the mapped bytes, see MappedNode. No node tree is built.
+		 *
+		 * The setters of the archive throw, since the nodes can not be modified.
+		 * save() and getString() write or return an unmodified copy of the loaded archive.
+ * Archives with segments (see Driver::saveChanges()) do not load until they are saved as a whole.
+		 */
+		class ARCHIVEUTIL_API MappedDriver : public IArchivingDriver
+		{
+			friend class MappedNode;
+
+		public:
+			MappedDriver();
+			virtual ~MappedDriver();
+
+		protected:
+			boost::interprocess::file_mapping *m_pMapping;
+			boost::interprocess::mapped_region *m_pRegion;
+			std::string m_sData;                  /** Copy of the data given to loadFromString(). */
+			const char *m_pData;                  /** The archive bytes, either mapped or in m_sData. */
+			size_t m_nSize;
+			Format::StringTableView *m_pStrings;
+			MappedNode *m_pRootNode;
+			std::string m_sPath;
+			unsigned long m_ulErrorCount;
+			bool m_bIsLoad;
+
+			/** Opens the archive in m_pData/m_nSize. */
+			bool open();
+
+			/** Unmaps the file and drops the root node. */
+			void close();
+
+		public:
+			/** Init */
+			virtual void init();
+
+			/** Load/Write */
+			virtual bool save(std::string sFile = "");
+			virtual bool loadFromFile(const std::string& sFile);
+			virtual bool loadFromString(const std::string& sData);
+			virtual void reset();
+
+			virtual std::string getString();
+
+			/** Accessors */
+			virtual INode* getRootNode();
+			virtual unsigned long getErrorCount();
+			virtual bool getIsLoad();
+			virtual bool keepsNodes() {return false;}
+		};
+	}
+
+	/** The child views of the nodes are MappedNode as well. */
+	template <> struct DriverTraits<Binary::MappedDriver> {typedef StaticNodeCalls<Binary::MappedNode> NodeCalls;};
+}
+
+#endif
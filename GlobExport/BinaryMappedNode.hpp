@@ -0,0 +1,81 @@
+#ifndef _BINARYMAPPEDNODE_HPP_
+#define _BINARYMAPPEDNODE_HPP_
+
+#include <string>
+#include "INode.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+#include "IInstanceCounter.hpp"
+
+namespace Archiving
+{
+	namespace Binary
+	{
+		class MappedDriver;
+
+		/**
+		 * Read-only view of a node record inside a mapped binary archive.
+		 * The node does not copy anything: tag name, type, attributes, value and children are decoded
+		 * from the mapped bytes when they are accessed.
+		 *
+		 * Every node owns a single child view that getChild() repositions and returns, so a returned child
+		 * stays valid until the next getChild() call on the same parent. This matches the scope discipline of
+		 * KeyValueArchive and keeps the number of node objects bounded by the nesting depth.
+		 * Consecutive lookups continue scanning behind the last child found, so reading keys in the
+		 * order they were written does not rescan the siblings.
+		 */
+		class ARCHIVEUTIL_API MappedNode : public INode, public IInstanceCounter<MappedNode>
+		{
+			friend class MappedDriver;
+
+		protected:
+			/** Con/Destructor */
+			MappedNode(MappedDriver *pDriver, MappedNode *pParentNode);
+			virtual ~MappedNode();
+
+			/**
+			 * Positions the view on the node record starting at pRecord (the record tag).
+			 * @return False if the record is not a valid node record.
+			 */
+			bool setRecord(const char *pRecord, const char *pEnd);
+
+		public:
+			/** Interface methods */
+			virtual std::string getTagName();
+			virtual std::string getAttribute(const std::string& sKey);
+			virtual void setAttribute(const std::string& sKey, const std::string& sValue);
+			virtual std::string getValue();
+			virtual void getValue(std::string& sValue);
+			virtual void setValue(const std::string& sValue);
+			virtual void setPackedValue(Symbol ulElementType, const void *pValues, unsigned long ulCount);
+			virtual bool getPackedValue(Symbol ulElementType, void *pValues, unsigned long ulCount);
+			using INode::getChild;
+			virtual INode* getChild(const std::string& sKey, const std::string& sType="*");
+			virtual INode* addChild(const std::string& sKey);
+
+		protected:
+			/** Checks the name and the type of the child record at pRecord and moves pRecord behind it. */
+			bool matchChild(const char*& pRecord, const std::string& sKey, const std::string& sType, const char*& pMatch);
+
+			MappedDriver *m_pMappedDriver;
+			const char *m_pRecordEnd;      /** End of the record body. */
+			unsigned long m_ulName;        /** String index of the tag name. */
+			unsigned long m_ulType;        /** String index of the type + 1, 0 if there is none. */
+			const char *m_pAttributes;     /** First key/value pair of the further attributes. */
+			unsigned long m_ulAttributes;
+			const char *m_pValue;
+			unsigned long m_ulValueLength;
+			const char *m_pChildren;       /** First child record. */
+			unsigned long m_ulChildren;
+			const char *m_pCursor;         /** Child record behind the last one found, where the next lookup starts. */
+			MappedNode *m_pChildView;      /** The view returned by getChild(), created on first use. */
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef _BINARYNODE_HPP_
+#define _BINARYNODE_HPP_
+
+#include <string>
+#include "INode.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+#include "IInstanceCounter.hpp"
+
+namespace Archiving
+{
+	namespace Binary
+	{
+		/**
+		 * Node of the binary archive driver.
+		 * Holds tag name, attributes and value in memory, together with the children in the order
+		 * they were added, which is the order Binary::Driver writes them in.
+		 * The child index is filled by the first keyed lookup, so an archive read in order never builds it.
+		 * Nodes, attributes and strings are allocated from the arena of the driver, so the whole tree is
+		 * freed at once when the driver releases its nodes.
+		 * Nodes that are stored in the file of the driver report their changes to it, see Driver::saveChanges().
+		 */
+		class ARCHIVEUTIL_API Node : public INode, public IInstanceCounter<Node>
+		{
+			friend class Driver;
+			friend class NodeCodec;
+			friend class TreeSnapshot;
+			friend class BackgroundLoad;
+			friend class IArchivingDriver;
+
+			static const std::string kType;
+
+		protected:
+			/** Con/Destructor */
+			Node(IArchivingDriver *pDriver, Node *pParentNode, const ArenaString& aName);
+			virtual ~Node();
+
+		public:
+			/** Interface methods */
+			virtual std::string getTagName();
+			virtual std::string getAttribute(const std::string& sKey);
+			virtual void setAttribute(const std::string& sKey, const std::string& sValue);
+			virtual std::string getValue();
+			virtual void getValue(std::string& sValue) {sValue.assign(m_aValue.data(), m_aValue.length());}
+			virtual void setValue(const std::string& sValue);
+			virtual void setPackedValue(Symbol ulElementType, const void *pValues, unsigned long ulCount);
+			virtual bool getPackedValue(Symbol ulElementType, void *pValues, unsigned long ulCount);
+			using INode::getChild;
+			virtual INode* getChild(const std::string& sKey, Symbol ulType);
+			virtual INode* addChild(const std::string& sKey);
+
+			/** Inline, defined behind Driver in BinaryDriver.hpp since they look at its asynchronous load. */
+			virtual INode* getNextChild(INode *pChild, const std::string& sKey);
+			virtual bool hasChildren();
+
+		protected:
+			struct Attribute
+			{
+				ArenaString aKey;
+				ArenaString aValue;
+				Attribute *pNext;
+			};
+
+			/** Returns the attribute with the given key or NULL. */
+			Attribute* findAttribute(const char *pKey, size_t nLength);
+
+			/** Appends an attribute allocated from aArena without checking for an existing one. The strings must live in the arena. */
+			void addAttribute(NodeArena& aArena, const ArenaString& aKey, const ArenaString& aValue);
+
+			/** Appends pChild to the children. */
+			void linkChild(Node *pChild);
+
+			/** Adds the children behind m_pLastIndexed to the child index. */
+			void indexChildren();
+
+			/** Reports a change of type, attributes or value to the driver, once until it is saved. */
+			void markChanged();
+
+			/** Hands the fields to the snapshots of the driver that may still copy them, before they change. See Driver::createSnapshot(). */
+			void preserve();
+
+			/** Waits for an asynchronous load of the driver before the node changes, see Driver::loadFromStringAsync(). */
+			void waitForLoad();
+
+			enum {kNoId = 0xffffffff};
+
+			ArenaString m_aName;
+			ArenaString m_aValue;
+			Attribute *m_pFirstAttribute;   /** Attributes in the order they were set, "type" usually first. */
+			Attribute *m_pLastAttribute;
+			Node *m_pFirstChild;            /** Children in the order they were added. */
+			Node *m_pLastChild;
+			Node *m_pNextSibling;
+			Node *m_pLastIndexed;           /** The last child in the child index. Children are only appended, the index continues behind it. */
+			unsigned long m_ulChildren;
+			unsigned long m_ulId;           /** The number of the node in the file of the driver, kNoId if it is not stored yet. */
+			bool m_bChanged;                /** Reported by markChanged() since the last save. */
+			unsigned long m_ulGeneration;   /** The generation of the driver when the node was created or last preserved. */
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef _CLASSREGISTRY_HPP_
+#define _CLASSREGISTRY_HPP_
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+#include <string>
+#include <boost/type_traits/is_abstract.hpp>
+
+/**
+ * Registers an archivable class with the ClassRegistry when the module is loaded, usually placed in
+ * the source file of the class. The class is registered under the getClassName() of a default
+ * constructed instance, and must therefore be default constructible.
+ */
+#define ARCHIVE_REGISTER_CLASS(Class) ARCHIVE_REGISTER_CLASS_AT(Class, __LINE__)
+#define ARCHIVE_REGISTER_CLASS_AT(Class, Line) ARCHIVE_REGISTER_CLASS_LINE(Class, Line)
+#define ARCHIVE_REGISTER_CLASS_LINE(Class, Line) static const bool s_bArchiveClass##Line = Archiving::ClassRegistry::registerClass<Class>();
+
+namespace Archiving
+{
+	class IArchivableObject;
+
+	/**
+	 * Process wide registry of archivable classes by the name their getClassName() returns, which
+	 * is the type archives store the objects with.
+	 * IDeserializer::getObject<T>() and getArray<T>() construct the registered class of the stored
+	 * type if it is a T, so the items of an array of mixed subclasses are read back as the classes they
+	 * were written as. Classes that are not registered are read into a T, as before.
+	 *
+	 * A class may also be registered with create and destroy functions of its own, as ObjectPool does.
+	 * Classes should be registered while the modules are loaded. Each archive looks a stored type up once
+	 * and keeps the result until getGeneration() tells that the registry changed.
+	 */
+	class ARCHIVEUTIL_API ClassRegistry
+	{
+	public:
+		typedef IArchivableObject* (*CreateFunction)();
+		typedef void (*DestroyFunction)(IArchivableObject *pObject);
+		typedef bool (*AcceptFunction)(IArchivableObject *pObject);
+
+		/** How the instances of a registered class are created, and destroyed if the archive does not return them. */
+		struct Factory
+		{
+			CreateFunction pCreate;     /** NULL if the class is not registered. */
+			DestroyFunction pDestroy;   /** NULL for delete. */
+		};
+
+		/** The class getObject<T>() is called with: how to create a T, and which instances are a T. */
+		struct Class
+		{
+			CreateFunction pCreate;   /** NULL instances for an abstract T. */
+			AcceptFunction pAccepts;
+		};
+
+		/** Registers the functions of the class name. A name registered again is replaced. */
+		static void registerClass(const std::string& sName, CreateFunction pCreate, DestroyFunction pDestroy = NULL);
+
+		/** Registers T_Class under the getClassName() of a default constructed instance. Returns true for ARCHIVE_REGISTER_CLASS(). */
+		template <class T_Class> static bool registerClass()
+		{
+			T_Class aPrototype;
+			registerClass(aPrototype.getClassName(), &create<T_Class>);
+			return true;
+		}
+
+		static void unregisterClass(const std::string& sName);
+
+		/** The functions registered for the class name, see Factory. */
+		static Factory find(const std::string& sName);
+
+		/** Changes with every registration, so results of find() can be kept until it does. */
+		static long getGeneration();
+
+		/** Destroys an instance of the factory. */
+		static void destroy(IArchivableObject *pObject, DestroyFunction pDestroy);
+
+		template <class T_Class> static const Class& getClass()
+		{
+			static const Class aClass = {&create<T_Class>, &accepts<T_Class>};
+			return aClass;
+		}
+
+		template <class T_Class> static IArchivableObject* create() {return Constructor<T_Class, boost::is_abstract<T_Class>::value>::create();}
+		template <class T_Class> static bool accepts(IArchivableObject *pObject) {return dynamic_cast<T_Class*>(pObject) != NULL;}
+
+	private:
+		template <class T_Class, bool bAbstract> struct Constructor
+		{
+			static IArchivableObject* create() {return new T_Class();}
+		};
+
+		template <class T_Class> struct Constructor<T_Class, true>
+		{
+			static IArchivableObject* create() {return NULL;}
+		};
+	};
+}
+
+#endif
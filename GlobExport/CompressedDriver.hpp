@@ -0,0 +1,127 @@
+#ifndef _COMPRESSEDDRIVER_HPP_
+#define _COMPRESSEDDRIVER_HPP_
+
+#include <string>
+#include <stdexcept>
+#include "IArchivingDriver.hpp"
+#include "DriverTraits.hpp"
+#include "CompressionCodec.hpp"
+
+namespace Archiving
+{
+	/**
+	 * Driver that saves the files of T_Driver compressed, see CompressionCodec.
+	 * Loading detects the format: compressed files and strings are inflated in memory and handed to
+	 * T_Driver::loadFromString(), everything else goes to T_Driver unchanged, so existing plain archives still load.
+	 * getString() returns the plain document.
+	 *
+	 * T_Driver must load and save whole documents, which rules out the streaming Xerces::WriteDriver.
+	 * A compressed file read by Binary::MappedDriver is inflated into memory instead of being mapped.
+	 */
+	template <class T_Driver>
+	class CompressedDriver : public T_Driver
+	{
+	public:
+		CompressedDriver() : m_nLevel(CompressionCodec::kDefaultLevel) {;}
+
+		/** The zlib level of save(), 1 is the fastest, 9 the smallest. */
+		void setLevel(int nLevel) {m_nLevel = nLevel;}
+		int getLevel() const {return m_nLevel;}
+
+		virtual bool save(std::string sFile = "")
+		{
+			if (sFile.length() == 0)
+				sFile = m_sFile;
+			if (sFile.length() == 0)
+				throw(std::runtime_error("invalid path!"));
+
+			std::string sData;
+			CompressionCodec::compress(T_Driver::getString(), sData, m_nLevel);
+			bool bResult = CompressionCodec::writeFile(sFile, sData);
+
+			// T_Driver::save() is bypassed, the changes it tracks for saveChanges() have to go as well
+			T_Driver::dropChanges();
+			return bResult;
+		}
+
+		/** A compressed file can not be appended to, it is saved as a whole. */
+		virtual bool saveChanges(std::string sFile = "")
+		{
+			return save(sFile);
+		}
+
+		/** The snapshot of T_Driver, compressed on the saving thread. */
+		virtual IArchivingDriver::Snapshot* createSnapshot(std::string sFile)
+		{
+			if (sFile.length() == 0)
+				sFile = m_sFile;
+			if (sFile.length() == 0)
+				throw(std::runtime_error("invalid path!"));
+
+			return new CompressedSnapshot(T_Driver::createSnapshot(sFile), m_nLevel);
+		}
+
+		virtual bool loadFromFile(const std::string& sFile) {return loadFile(sFile, false);}
+		virtual bool loadFromString(const std::string& sData) {return loadString(sData, false);}
+
+		/** The file is inflated on the calling thread, T_Driver parses the plain document asynchronously. */
+		virtual bool loadFromFileAsync(const std::string& sFile) {return loadFile(sFile, true);}
+		virtual bool loadFromStringAsync(const std::string& sData) {return loadString(sData, true);}
+
+	protected:
+		bool loadFile(const std::string& sFile, bool bAsync)
+		{
+			m_sFile = sFile;
+			if (!CompressionCodec::isCompressedFile(sFile))
+				return bAsync ? T_Driver::loadFromFileAsync(sFile) : T_Driver::loadFromFile(sFile);
+
+			std::string sData;
+			if (!CompressionCodec::readFile(sFile, sData))
+				return false;
+			return loadString(sData, bAsync);
+		}
+
+		bool loadString(const std::string& sData, bool bAsync)
+		{
+			if (!CompressionCodec::isCompressed(sData.data(), sData.size()))
+				return bAsync ? T_Driver::loadFromStringAsync(sData) : T_Driver::loadFromString(sData);
+
+			std::string sPlain;
+			if (!CompressionCodec::decompress(sData, sPlain))
+			{
+				T_Driver::reset();
+				return false;
+			}
+			return bAsync ? T_Driver::loadFromStringAsync(sPlain) : T_Driver::loadFromString(sPlain);
+		}
+
+		/** Writes the plain snapshot compressed. getString() still returns the plain document. */
+		class CompressedSnapshot : public IArchivingDriver::Snapshot
+		{
+		public:
+			CompressedSnapshot(IArchivingDriver::Snapshot *pPlain, int nLevel) : IArchivingDriver::Snapshot(pPlain->getFile()), m_pPlain(pPlain), m_nLevel(nLevel) {;}
+			virtual ~CompressedSnapshot() {delete m_pPlain;}
+
+			virtual std::string getString() {return m_pPlain->getString();}
+
+			virtual bool save()
+			{
+				std::string sData;
+				CompressionCodec::compress(m_pPlain->getString(), sData, m_nLevel);
+				return CompressionCodec::writeFile(m_sFile, sData);
+			}
+
+		protected:
+			IArchivingDriver::Snapshot *m_pPlain;
+			int m_nLevel;
+		};
+
+		std::string m_sFile;   /** The file last loaded, used by save() if no path is given. */
+		int m_nLevel;
+	};
+
+	/** Compression only wraps the file, the nodes are those of T_Driver. */
+	template <class T_Driver> struct DriverTraits<CompressedDriver<T_Driver> > : DriverTraits<T_Driver> {;};
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _COMPRESSIONCODEC_HPP_
+#define _COMPRESSIONCODEC_HPP_
+
+#include <string>
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+namespace Archiving
+{
+	class ArchiveExecutor;
+
+	/**
+	 * Compression of whole archive files with zlib, used by CompressedDriver.
+	 *
+	 * The data is cut into chunks that are deflated independently, so that they can be compressed and
+	 * inflated on the threads of an ArchiveExecutor, see setExecutor(). The layout, integers little endian:
+	 *
+	 * container := 'K' 'V' 'A' 'Z' version:u8 level:u8 chunkcount:u32 (rawsize:u32 packedsize:u32)[chunkcount] chunk*
+	 * chunk     := a zlib stream of packedsize bytes that inflates to rawsize bytes
+	 *
+	 * decompress() reads this container and gzip files, so archives compressed with gzip outside the library load as well.
+	 */
+	class ARCHIVEUTIL_API CompressionCodec
+	{
+	public:
+		enum
+		{
+			kDefaultLevel = 6,               /** zlib level, 1 is the fastest, 9 the smallest. */
+			kChunkSize = 1024 * 1024         /** Raw bytes per chunk. */
+		};
+
+		/**
+		 * Sets the pool that compress() and decompress() split their chunks across, NULL to work on the calling
+		 * thread (the default). Set it once at startup, the pool must outlive all archives. As with every batch of
+		 * an ArchiveExecutor, archives must not be saved or loaded from inside one of its tasks.
+		 */
+		static void setExecutor(ArchiveExecutor *pExecutor);
+		static ArchiveExecutor* getExecutor();
+
+		/** Compresses sData into the container. sResult is replaced. */
+		static void compress(const std::string& sData, std::string& sResult, int nLevel = kDefaultLevel, size_t nChunkSize = kChunkSize);
+
+		/**
+		 * Inflates a container or a gzip file. sResult is replaced.
+		 * @return False if the data is neither, or is truncated or corrupt.
+		 */
+		static bool decompress(const char *pData, size_t nLength, std::string& sResult);
+		static bool decompress(const std::string& sData, std::string& sResult) {return decompress(sData.data(), sData.size(), sResult);}
+
+		/** True if the data starts like a container or a gzip file. */
+		static bool isCompressed(const char *pData, size_t nLength);
+
+		/** Same as above for the first bytes of a file, false if it can not be read. */
+		static bool isCompressedFile(const std::string& sPath);
+
+		/** Reads or writes a whole file. */
+		static bool readFile(const std::string& sPath, std::string& sData);
+		static bool writeFile(const std::string& sPath, const std::string& sData);
+	};
+}
+
+#endif
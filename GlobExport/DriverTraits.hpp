@@ -0,0 +1,68 @@
+#ifndef _DRIVERTRAITS_HPP_
+#define _DRIVERTRAITS_HPP_
+
+#include <string>
+#include "INode.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+namespace Archiving
+{
+	/**
+	 * The node calls of KeyValueArchive for a driver whose node type is unknown: virtual calls through INode.
+	 */
+	struct VirtualNodeCalls
+	{
+		static INode* getChild(INode *pNode, const std::string& sKey, Symbol ulType) {return pNode->getChild(sKey, ulType);}
+		static INode* getNextChild(INode *pNode, INode *pChild, const std::string& sKey) {return pNode->getNextChild(pChild, sKey);}
+		static INode* addChild(INode *pNode, const std::string& sKey) {return pNode->addChild(sKey);}
+		static bool hasChildren(INode *pNode) {return pNode->hasChildren();}
+		static std::string getAttribute(INode *pNode, const std::string& sKey) {return pNode->getAttribute(sKey);}
+		static void setAttribute(INode *pNode, const std::string& sKey, const std::string& sValue) {pNode->setAttribute(sKey, sValue);}
+		static void getValue(INode *pNode, std::string& sValue) {pNode->getValue(sValue);}
+		static void setValue(INode *pNode, const std::string& sValue) {pNode->setValue(sValue);}
+		static void setPackedValue(INode *pNode, Symbol ulElementType, const void *pValues, unsigned long ulCount) {pNode->setPackedValue(ulElementType, pValues, ulCount);}
+		static bool getPackedValue(INode *pNode, Symbol ulElementType, void *pValues, unsigned long ulCount) {return pNode->getPackedValue(ulElementType, pValues, ulCount);}
+	};
+
+	/**
+	 * The node calls of KeyValueArchive for a driver that only creates nodes of type T_Node.
+	 * The calls are qualified, so they bind to T_Node at compile time instead of going through the vtable,
+	 * and the ones T_Node defines in its header can be inlined.
+	 * T_Node must declare every overload it inherits from INode visible, see Binary::Node.
+	 */
+	template <class T_Node>
+	struct StaticNodeCalls
+	{
+		static INode* getChild(INode *pNode, const std::string& sKey, Symbol ulType) {return static_cast<T_Node*>(pNode)->T_Node::getChild(sKey, ulType);}
+		static INode* getNextChild(INode *pNode, INode *pChild, const std::string& sKey) {return static_cast<T_Node*>(pNode)->T_Node::getNextChild(pChild, sKey);}
+		static INode* addChild(INode *pNode, const std::string& sKey) {return static_cast<T_Node*>(pNode)->T_Node::addChild(sKey);}
+		static bool hasChildren(INode *pNode) {return static_cast<T_Node*>(pNode)->T_Node::hasChildren();}
+		static std::string getAttribute(INode *pNode, const std::string& sKey) {return static_cast<T_Node*>(pNode)->T_Node::getAttribute(sKey);}
+		static void setAttribute(INode *pNode, const std::string& sKey, const std::string& sValue) {static_cast<T_Node*>(pNode)->T_Node::setAttribute(sKey, sValue);}
+		static void getValue(INode *pNode, std::string& sValue) {static_cast<T_Node*>(pNode)->T_Node::getValue(sValue);}
+		static void setValue(INode *pNode, const std::string& sValue) {static_cast<T_Node*>(pNode)->T_Node::setValue(sValue);}
+		static void setPackedValue(INode *pNode, Symbol ulElementType, const void *pValues, unsigned long ulCount) {static_cast<T_Node*>(pNode)->T_Node::setPackedValue(ulElementType, pValues, ulCount);}
+		static bool getPackedValue(INode *pNode, Symbol ulElementType, void *pValues, unsigned long ulCount) {return static_cast<T_Node*>(pNode)->T_Node::getPackedValue(ulElementType, pValues, ulCount);}
+	};
+
+	/**
+	 * Compile time description of an archiving driver, used by KeyValueArchive<T_Driver>.
+	 * NodeCalls is the set of node calls above that the archive uses in its getters and setters.
+	 * A driver that creates nodes of exactly one type, fragments included, specializes the traits with
+	 * StaticNodeCalls of that type next to its declaration, see Binary::Driver.
+	 * Subclasses of a driver are not covered by its specialization and keep the virtual calls,
+	 * since they may create other nodes.
+	 */
+	template <class T_Driver>
+	struct DriverTraits
+	{
+		typedef VirtualNodeCalls NodeCalls;
+	};
+}
+
+#endif
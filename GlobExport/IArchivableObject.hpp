@@ -15,9 +15,12 @@ namespace Archiving
 	class IDeserializer;
 
 	/* @brief   IArchivableObject interface class.
+	 *          All archivable objects are counted under IArchivableObject, at the size of the interface.
+	 *          A subclass that wants its own live, peak and byte counts derives from IInstanceCounter<Subclass>
+	 *          as well, as the node classes do: class MyObject : public IArchivableObject, public IInstanceCounter<MyObject>.
 	 * @author  jbi, jwl
 	 * @version 1.1
-	 * @see     ISerializer, IDeserializer
+	 * @see     ISerializer, IDeserializer, InstanceMetrics
 	 */
 	class ARCHIVEUTIL_API IArchivableObject : public IInstanceCounter<IArchivableObject>
 	{
@@ -37,6 +40,8 @@ namespace Archiving
 		/* @brief   Get the class name under which this class instaces should be serialized.
 		 *          The default implementation returns the original class name (example: "class MyObject").
 		 *          Note that this classname is also used for deserializing. If youn change it your old archive files might not work correctly.
+		 *          The name must depend on the dynamic class alone, not on the state of the instance: the archives ask
+		 *          one instance per class and keep the answer for all others, see SymbolTable::getClassSymbol().
 		 * @return  The class that should be used for serializing instance of this class.
 		 * @see     setObject(), serialize() and deserialize()
 		 */
@@ -3,8 +3,11 @@
 
 /** includes */
 #include <string>
+#include <stdexcept>
 #include <atlstr.h>
 #include <atlconv.h>
+#include "NodeArena.hpp"
+#include "SymbolTable.hpp"
 
 #ifdef ARCHIVEUTIL_EXPORTS
 #define ARCHIVEUTIL_API __declspec(dllexport)
@@ -23,10 +26,38 @@ namespace Archiving
 	private:
 		friend class INode;
 		
-		std::list<INode*> m_lsNodes;
-		void addNode(INode* pNode) {m_lsNodes.push_back(pNode);}
+		INode* m_pFirstNode;   /** The nodes registered with the driver, linked through INode::m_pNextNode. */
+		NodeArena m_aArena;
+		SymbolTable m_aSymbols;
+
+		/**
+		 * Registers a node, called by INode::setDriver(). Not locked: while the thread of an asynchronous
+		 * load creates nodes, the owning thread must not, see Binary::BackgroundLoad.
+		 */
+		void addNode(INode* pNode);
 	
 	public:
+		/**
+		 * An image of the archive taken by createSnapshot(), which save() writes on another thread while the driver goes on.
+		 */
+		class ARCHIVEUTIL_API Snapshot
+		{
+		public:
+			Snapshot(const std::string& sFile) : m_sFile(sFile) {;}
+			virtual ~Snapshot() {;}
+
+			/** The archive as getString() of the driver returned it when the snapshot was taken. Called once, by save() or instead of it. */
+			virtual std::string getString() = 0;
+
+			/** Writes getString() to the file of the snapshot. */
+			virtual bool save();
+
+			const std::string& getFile() const {return m_sFile;}
+
+		protected:
+			std::string m_sFile;
+		};
+
 		/** 
 		 * Creates a new ArchivingDriver from the template class with a file loaded.
 		 * @param The file path to load.
@@ -81,6 +112,21 @@ namespace Archiving
 		 * @return If saving was succesfull.
 		 */
 		virtual bool save(std::string sFile = "") = 0;
+
+		/**
+		 * Saves the changes since the archive was loaded from or saved to the file, see KeyValueArchive::saveChanges().
+		 * The default saves the whole archive.
+		 */
+		virtual bool saveChanges(std::string sFile = "") {return save(sFile);}
+
+		/**
+		 * Takes a snapshot of the archive as it is now, to be saved to sFile on another thread while the driver
+		 * is changed, see KeyValueArchive::saveAsync(). The driver must not be loaded or reset while the snapshot
+		 * is saved, and the snapshot must be deleted before the driver.
+		 * The default formats the archive with getString() right away, so only the file is written later, and
+		 * needs the path. Drivers override this to take the snapshot without formatting.
+		 */
+		virtual Snapshot* createSnapshot(std::string sFile);
 		
 		/** 
 		 * Loads the archive from a file.
@@ -95,6 +141,30 @@ namespace Archiving
 		 * @return If loading was succesfull.
 		 */
 		virtual bool loadFromString(const std::string& sData) = 0;
+
+		/**
+		 * Loads like loadFromFile() and loadFromString(), but may return once the start of the archive is parsed and
+		 * parse the rest on a thread of its own, while the archive is read. Lookups of nodes that are not parsed yet
+		 * wait for them, anything that changes or writes the archive waits for the whole parse.
+		 * Errors found by the parse thread are reported by waitForLoad(), which must be called for them.
+		 * The default loads synchronously.
+		 * @see KeyValueArchive::loadFromFileAsync()
+		 */
+		virtual bool loadFromFileAsync(const std::string& sFile) {return loadFromFile(sFile);}
+		virtual bool loadFromStringAsync(const std::string& sData) {return loadFromString(sData);}
+
+		/**
+		 * Waits until the parse of an asynchronous load is done.
+		 * @return getIsLoad(): false if the rest of the archive could not be parsed. The nodes parsed up to the error remain.
+		 */
+		virtual bool waitForLoad() {return getIsLoad();}
+
+		/**
+		 * Makes sFile the output of a driver that writes the archive while it is serialized, see Xerces::WriteDriver.
+		 * The archive starts empty and an existing file is replaced. Other drivers write their files on save(),
+		 * the default returns false.
+		 */
+		virtual bool openOutput(const std::string& sFile) {return false;}
 		
 		/** 
 		 * Get the archives XML string.
@@ -121,6 +191,13 @@ namespace Archiving
 		 * @return True if a document has been loaded, false if otherwise.
 		 */
 		virtual bool getIsLoad() = 0;
+
+		/**
+		 * True if the nodes stay in memory once they are written or read, so they can still be found and changed
+		 * while others are added, or looked up again from the root. Drivers that stream their nodes or hand out
+		 * views that the next lookup repositions, reusing or dropping the node objects, return false.
+		 */
+		virtual bool keepsNodes() {return true;}
 		
 		/* @brief  Reset
 		 * @params 
@@ -128,6 +205,62 @@ namespace Archiving
 		 * @see    
 		 */
 		virtual void reset() = 0;
+
+		/**
+		 * Get the symbols of the archive's keys, type and class names.
+		 * They outlive reset() and loading, so symbols taken once stay valid for the driver's lifetime.
+		 * @see SymbolTable
+		 */
+		SymbolTable& getSymbols() {return m_aSymbols;}
+
+		/**
+		 * Prepares the subtree of pNode to be read by several threads at once, while the SymbolTable is in
+		 * concurrent mode and nothing modifies the archive. Drivers whose nodes keep no state between reads
+		 * resolve what their nodes would otherwise compute and cache on first access.
+		 * The default returns false: the nodes of the driver must be read by one thread at a time.
+		 * @return True if the subtree may be read concurrently.
+		 * @see IDeserializer::getArrayParallel()
+		 */
+		virtual bool prepareConcurrentReads(INode *pNode) {return false;}
+
+		/**
+		 * Parallel writes, see KeyValueArchive::setArrayParallel().
+		 * createFragment() returns a new driver whose root node stands in for pParent, the node the archive is
+		 * currently adding children to. Each fragment can be filled by a thread of its own. appendFragment()
+		 * then moves the children of the fragment's root behind the children of pParent, with the same result
+		 * as if they had been added to pParent directly. The caller deletes the fragment afterwards.
+		 * The default returns NULL: the nodes of the driver must be added by one thread, in order.
+		 */
+		virtual IArchivingDriver* createFragment(INode *pParent) {return NULL;}
+		virtual void appendFragment(INode *pParent, IArchivingDriver *pFragment) {throw(std::runtime_error("the driver does not support fragments!"));}
+
+	protected:
+		IArchivingDriver();
+
+		/**
+		 * Forgets which nodes changed since the file was loaded or saved, after the file was written by other means
+		 * than save() of this driver, see CompressedDriver. The next saveChanges() saves the whole archive.
+		 * The default does nothing, for drivers that do not track changes.
+		 */
+		virtual void dropChanges() {;}
+
+		/**
+		 * Deletes all nodes registered with the driver and releases the arena in one go.
+		 * Drivers that drop their node tree on reset or load call this to avoid keeping the old nodes until destruction.
+		 */
+		void releaseNodes();
+
+		/**
+		 * Moves the nodes registered with aSource, and the arena they live in, to this driver.
+		 * Used by appendFragment(): the nodes still have to be indexed with the symbols of this driver.
+		 */
+		void adoptNodes(IArchivingDriver& aSource);
+
+		/**
+		 * The allocator for the nodes of this driver and their strings.
+		 * Nodes are allocated with new (pDriver) Node(...), see INode.
+		 */
+		NodeArena& getArena() {return m_aArena;}
 	};
 }
 
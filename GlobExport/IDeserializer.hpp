@@ -8,9 +8,16 @@
 #endif
 
 /** includes */
+#include <map>
+#include <new>
 #include <string>
+#include <vector>
 #include "../include/ArchiveUtil.h"
 #include "ArchiveUtil.hpp"
+#include "NumericCodec.hpp"
+#include "ArchiveExecutor.hpp"
+#include "ClassRegistry.hpp"
+#include <boost/lexical_cast.hpp>
 
 /** declarations */
 class Archiving::IArchivableObject;
@@ -20,6 +27,8 @@ namespace Archiving
 	class ARCHIVEUTIL_API IDeserializer
 	{
 	public:
+		virtual ~IDeserializer() {;}
+
 		/** Standardtype Deserialization */
 		virtual bool	getBool(const std::string& sKey, ArchivingResult *bStatus) = 0;
 		virtual char	getChar(const std::string& sKey, ArchivingResult *bStatus) = 0;
@@ -29,84 +38,314 @@ namespace Archiving
 		virtual float getFloat(const std::string& sKey, ArchivingResult *bStatus) = 0;
 		virtual double getDouble(const std::string& sKey, ArchivingResult *bStatus) = 0;
 		virtual std::string getString(const std::string& sKey, ArchivingResult *bStatus = 0) = 0;
+
+		/**
+		 * Packed Primitive Arrays, see ISerializer::setIntArray()
+		 * Reads the array into pValues, which holds ulCapacity values. The values are only read if they all fit,
+		 * so a call with a capacity of 0 returns the size to allocate.
+		 * @return The number of values in the archive, 0 if the key is not found.
+		 */
+		virtual unsigned long getIntArray(const std::string& sKey, int *pValues, unsigned long ulCapacity, ArchivingResult *bStatus) = 0;
+		virtual unsigned long getLongArray(const std::string& sKey, long *pValues, unsigned long ulCapacity, ArchivingResult *bStatus) = 0;
+		virtual unsigned long getFloatArray(const std::string& sKey, float *pValues, unsigned long ulCapacity, ArchivingResult *bStatus) = 0;
+		virtual unsigned long getDoubleArray(const std::string& sKey, double *pValues, unsigned long ulCapacity, ArchivingResult *bStatus) = 0;
+
+		/** Same as above, reading into a vector that is resized to the array. */
+		bool getIntArray(const std::string& sKey, std::vector<int>& lValues, ArchivingResult *bStatus) {return getVector(sKey, lValues, SymbolTable::kIntArray, SymbolTable::kInt, bStatus);}
+		bool getLongArray(const std::string& sKey, std::vector<long>& lValues, ArchivingResult *bStatus) {return getVector(sKey, lValues, SymbolTable::kLongArray, SymbolTable::kLong, bStatus);}
+		bool getFloatArray(const std::string& sKey, std::vector<float>& lValues, ArchivingResult *bStatus) {return getVector(sKey, lValues, SymbolTable::kFloatArray, SymbolTable::kFloat, bStatus);}
+		bool getDoubleArray(const std::string& sKey, std::vector<double>& lValues, ArchivingResult *bStatus) {return getVector(sKey, lValues, SymbolTable::kDoubleArray, SymbolTable::kDouble, bStatus);}
 		
-		/** Object Deserialization */
-		template<class T_ObjectClass> T_ObjectClass* getObject(const std::string& sKey, ArchivingResult *bStatus)
+		/**
+		 * Object Deserialization
+		 * The object is an instance of the class stored at the key if that class is registered with the
+		 * ClassRegistry and derives from T_ObjectClass, otherwise of T_ObjectClass itself.
+		 * pDestroy is set to the function that destroys the object, see ClassRegistry::destroy(). It is NULL
+		 * for delete, and for objects not created by this call (read before or handed over by the delegate).
+		 */
+		template<class T_ObjectClass> T_ObjectClass* getObject(const std::string& sKey, ArchivingResult *bStatus, ClassRegistry::DestroyFunction *pDestroy = NULL)
 		{
-			T_ObjectClass* object = new T_ObjectClass();
-			T_ObjectClass* orig = object;
-			IArchivableObject* refvar = object;
+			IArchivableObject* refvar = NULL;
 
-			if (fillObject(sKey, refvar, bStatus))
+			if (createObject(sKey, refvar, ClassRegistry::getClass<T_ObjectClass>(), bStatus, pDestroy))
 			{
 				/* Through the handleInstance() method of the IArchiveDelegate,
 				 * the object pointer might change. Thats why we must ensure, that
 				 * object remains of a class related to T_ObjectClass,
 				 * for the returned pointer to be valid.
 				 */
-				if (refvar != orig)
-				{
-					delete orig;
-					object = dynamic_cast<T_ObjectClass*>(refvar);
-					assert( object && "IArchiveDelegate::handleInstance() returned an unrelated object!");
-				}
-
+				T_ObjectClass* object = dynamic_cast<T_ObjectClass*>(refvar);
+				assert( object && "IArchiveDelegate::handleInstance() returned an unrelated object!");
 				return object;
 			}
 			else
-			{
-				delete object;
 				return NULL;
+		}
+
+		/**
+		 * Reads the object at the key into aObject, which the caller owns, instead of a new instance.
+		 * The delegate's handleInstance() is not asked, and since the caller's object can not be shared, a
+		 * reference at the key is read as a copy of its target, also with trackReferences().
+		 * @return True if the object was found and read.
+		 */
+		virtual bool getObjectInto(const std::string& sKey, IArchivableObject& aObject, ArchivingResult *bStatus = NULL) = 0;
+
+		/**
+		 * Same as above, with the object constructed in pStorage, which must hold a T_ObjectClass.
+		 * @return The object, NULL if it was not read. The object is destroyed again then.
+		 */
+		template<class T_ObjectClass> T_ObjectClass* getObjectAt(const std::string& sKey, void *pStorage, ArchivingResult *bStatus)
+		{
+			T_ObjectClass* object = new (pStorage) T_ObjectClass();
+			try
+			{
+				if (getObjectInto(sKey, *object, bStatus))
+					return object;
+			}
+			catch (...)
+			{
+				object->~T_ObjectClass();
+				throw;
 			}
+
+			object->~T_ObjectClass();
+			return NULL;
 		}
 
 		template<class T_ListClass> unsigned long getArrayCount(const std::string& sKey, ArchivingResult *bStatus)
 		{
-			INode *pTempNode = getScope()->getChild(sKey, "array");
-			if (verifyNode("array", pTempNode, bStatus)) 
-				return static_cast<unsigned long>(boost::lexical_cast<long>(pTempNode->getAttribute("count").c_str()));
+			INode *pTempNode = lookupChild(sKey, SymbolTable::kArray);
+			if (verifyChild(SymbolTable::kArray, pTempNode, bStatus)) 
+				return getArrayCount(pTempNode);
 
 			return 0;
 		}
 
 		template<class T_ListClass> std::list<T_ListClass*>* getArray(const std::string& sKey, ArchivingResult *bStatus)
 		{
-			INode *pTempNode = getScope()->getChild(sKey, "array");
-			if (verifyNode("array", pTempNode, bStatus)) 
+			INode *pTempNode = lookupChild(sKey, SymbolTable::kArray);
+			if (verifyChild(SymbolTable::kArray, pTempNode, bStatus)) 
 			{
 				std::list<T_ListClass*>* pNodeList = new std::list<T_ListClass*>;
-				unsigned long arrayCount = getArrayCount<T_ListClass>(sKey, bStatus);
-				
-				pushScope(pTempNode);
-				
-				if (arrayCount && *bStatus == Archiving::Found)
+				getArrayItems<T_ListClass>(pTempNode, *pNodeList, bStatus);
+				return pNodeList;
+			}
+
+			return NULL;
+		}
+
+		/**
+		 * Same as above, appending the objects to lsObjects, a std::list or std::vector of T_ListClass*.
+		 * A vector that is kept across the reads keeps its capacity.
+		 * @return False if the array is not found.
+		 */
+		template<class T_ListClass, class T_Container> bool getArray(const std::string& sKey, T_Container& lsObjects, ArchivingResult *bStatus)
+		{
+			INode *pTempNode = lookupChild(sKey, SymbolTable::kArray);
+			if (!verifyChild(SymbolTable::kArray, pTempNode, bStatus))
+				return false;
+
+			getArrayItems<T_ListClass>(pTempNode, lsObjects, bStatus);
+			return true;
+		}
+
+		/**
+		 * Same as getArray(), with the items split across the slices of aExecutor.
+		 * Each slice reads its items through a cursor of its own, a copy of the archive with its own scope,
+		 * and the objects are returned in the order of the array.
+		 * The delegate is called from all threads of the executor and must be thread-safe.
+		 * Drivers that do not support concurrent reads (see IArchivingDriver::prepareConcurrentReads()),
+		 * and arrays of less than two items, are read by getArray() on the calling thread.
+		 */
+		template<class T_ListClass> std::list<T_ListClass*>* getArrayParallel(const std::string& sKey, ArchivingResult *bStatus, ArchiveExecutor& aExecutor)
+		{
+			INode *pTempNode = lookupChild(sKey, SymbolTable::kArray);
+			ArchivingResult nStatus = Undefined;
+			unsigned long arrayCount = verifyChild(SymbolTable::kArray, pTempNode, &nStatus) ? getArrayCount(pTempNode) : 0;
+			if (nStatus != Found || arrayCount < 2 || aExecutor.getSliceCount() < 2 || !beginConcurrentRead(pTempNode))
+			{
+				// The node is already found, getArray() would look it up again
+				if (bStatus)
+					*bStatus = nStatus;
+				if (nStatus != Found)
+					return NULL;
+				std::list<T_ListClass*>* pNodeList = new std::list<T_ListClass*>;
+				getArrayItems<T_ListClass>(pTempNode, *pNodeList, bStatus);
+				return pNodeList;
+			}
+
+			std::vector<T_ListClass*> lsObjects(arrayCount, (T_ListClass*)NULL);
+			std::vector<ClassRegistry::DestroyFunction> lsDestroy(arrayCount, (ClassRegistry::DestroyFunction)NULL);
+			std::vector<ArchivingResult> lsStatus(aExecutor.getSliceCount(), Found);
+			ArrayReadTask<T_ListClass> aTask(this, pTempNode, lsObjects, lsDestroy, lsStatus);
+			try
+			{
+				aExecutor.execute(aTask, arrayCount);
+			}
+			catch (...)
+			{
+				endConcurrentRead();
+
+				// With trackReferences() several items may be the same object, which is destroyed once, as it was created
+				std::map<T_ListClass*, ClassRegistry::DestroyFunction> mapObjects;
+				for (size_t i = 0; i < lsObjects.size(); ++i)
 				{
-					for (unsigned long i = 0; i < arrayCount; ++i)
+					if (!lsObjects[i])
+						continue;
+					ClassRegistry::DestroyFunction& pDestroy = mapObjects.insert(std::make_pair(lsObjects[i], lsDestroy[i])).first->second;
+					if (!pDestroy)
+						pDestroy = lsDestroy[i];
+				}
+				for (typename std::map<T_ListClass*, ClassRegistry::DestroyFunction>::iterator it = mapObjects.begin(); it != mapObjects.end(); ++it)
+					ClassRegistry::destroy(it->first, it->second);
+				throw;
+			}
+			endConcurrentRead();
+
+			std::list<T_ListClass*>* pNodeList = new std::list<T_ListClass*>;
+			for (size_t i = 0; i < lsObjects.size(); ++i)
+				if (lsObjects[i])
+					pNodeList->push_back(lsObjects[i]);
+
+			if (bStatus)
+			{
+				*bStatus = Found;
+				for (size_t i = 0; i < lsStatus.size(); ++i)
+					if (*bStatus < lsStatus[i])
+						*bStatus = lsStatus[i];
+			}
+			return pNodeList;
+		}
+		
+	protected:
+		/** Reads the items of the array node into lsObjects, see getArray(). */
+		template<class T_ListClass, class T_Container> void getArrayItems(INode *pArrayNode, T_Container& lsObjects, ArchivingResult *bStatus)
+		{
+			unsigned long arrayCount = getArrayCount(pArrayNode);
+
+			pushScope(pArrayNode);
+
+			ArrayItemKey aKey;
+			for (unsigned long i = 0; i < arrayCount; ++i)
+			{
+				const std::string& sKey = aKey.get(i);
+				ArchivingResult nObjectStatus;
+				T_ListClass* pObject = this->getObject<T_ListClass>(sKey, &nObjectStatus);
+
+				if (nObjectStatus == Found || nObjectStatus == Undefined /*ist nie undefined*/)
+					lsObjects.push_back(pObject);
+				else if(bStatus && *bStatus < nObjectStatus && nObjectStatus!=NotFound)
+					*bStatus = nObjectStatus;
+			}
+			popScope();
+		}
+
+		/** The "count" attribute of an array node. */
+		static unsigned long getArrayCount(INode *pArrayNode)
+		{
+			unsigned long ulCount;
+			if (!NumericCodec::parse(pArrayNode->getAttribute("count"), ulCount))
+				throw boost::bad_lexical_cast();
+			return ulCount;
+		}
+
+		/** Reads the items of one slice of getArrayParallel() through a cursor on the array node. */
+		template<class T_ListClass> class ArrayReadTask : public ArchiveExecutor::ITask
+		{
+		public:
+			ArrayReadTask(IDeserializer *pArchive, INode *pArrayNode, std::vector<T_ListClass*>& lsObjects, std::vector<ClassRegistry::DestroyFunction>& lsDestroy, std::vector<ArchivingResult>& lsStatus)
+				: m_pArchive(pArchive), m_pArrayNode(pArrayNode), m_lsObjects(lsObjects), m_lsDestroy(lsDestroy), m_lsStatus(lsStatus) {;}
+
+			virtual void run(unsigned nSlice, unsigned long ulBegin, unsigned long ulEnd)
+			{
+				IDeserializer *pCursor = m_pArchive->createCursor(m_pArrayNode);
+				try
+				{
+					ArrayItemKey aKey;
+					for (unsigned long i = ulBegin; i < ulEnd; ++i)
 					{
-						char tempKey[64];
-						sprintf(tempKey, "item%lu", i);
+						const std::string& sKey = aKey.get(i);
 						ArchivingResult nObjectStatus;
-						T_ListClass* pObject = this->getObject<T_ListClass>(std::string(tempKey), &nObjectStatus);
+						ClassRegistry::DestroyFunction pDestroy = NULL;
+						T_ListClass* pObject = pCursor->getObject<T_ListClass>(sKey, &nObjectStatus, &pDestroy);
 
-						if (nObjectStatus == Found || nObjectStatus == Undefined /*ist nie undefined*/)
-							pNodeList->push_back(pObject);
-						else if(bStatus && *bStatus < nObjectStatus && nObjectStatus!=NotFound)
-							*bStatus = nObjectStatus;
+						if (nObjectStatus == Found || nObjectStatus == Undefined)
+						{
+							m_lsObjects[i] = pObject;
+							m_lsDestroy[i] = pDestroy;
+						}
+						else if (m_lsStatus[nSlice] < nObjectStatus && nObjectStatus != NotFound)
+							m_lsStatus[nSlice] = nObjectStatus;
 					}
 				}
-				popScope();
-				return pNodeList;
+				catch (...)
+				{
+					delete pCursor;
+					throw;
+				}
+				delete pCursor;
 			}
 
-			return NULL;
-		}
-		
-	protected:
+		protected:
+			IDeserializer *m_pArchive;
+			INode *m_pArrayNode;
+			std::vector<T_ListClass*>& m_lsObjects;
+			std::vector<ClassRegistry::DestroyFunction>& m_lsDestroy;
+			std::vector<ArchivingResult>& m_lsStatus;
+		};
+
+		/**
+		 * Concurrent reads, see getArrayParallel().
+		 * beginConcurrentRead() prepares the subtree of pNode to be read by several cursors at once,
+		 * false if the driver does not support it. endConcurrentRead() must follow once the cursors are deleted.
+		 */
+		virtual bool beginConcurrentRead(INode *pNode) = 0;
+		virtual void endConcurrentRead() = 0;
+		virtual IDeserializer* createCursor(INode *pScope) = 0;
+
+		/** Looks the key up in the current scope, and verifies the node like verifyNode(). */
+		virtual INode *lookupChild(const std::string& sKey, Symbol ulType) = 0;
+		virtual bool verifyChild(Symbol ulType, INode *pNode, ArchivingResult *bStatus) = 0;
+
 		/** Scope */
 		virtual INode *pushScope(INode *pNode) = 0;
 		virtual INode *popScope() = 0;
 		virtual INode *getScope() = 0;
 		virtual bool fillObject(const std::string& sKey, IArchivableObject*& pObject, ArchivingResult *bStatus = NULL) = 0;
+
+		/**
+		 * Creates the object at the key, see getObject(), and reads it like fillObject().
+		 * Only the instance that is read is allocated. It is deleted again if the object can not be read,
+		 * and pObject is NULL then. pDestroy, if given, is set as by getObject().
+		 */
+		virtual bool createObject(const std::string& sKey, IArchivableObject*& pObject, const ClassRegistry::Class& aClass, ArchivingResult *bStatus, ClassRegistry::DestroyFunction *pDestroy = NULL) = 0;
+
+		/**
+		 * Reads the packed array of the node that was looked up, like getIntArray() does with the key.
+		 * @return The "count" attribute of the node. The values are only read if they fit into ulCapacity.
+		 */
+		virtual unsigned long getPackedArray(INode *pArrayNode, Symbol ulElementType, void *pValues, unsigned long ulCapacity) = 0;
+
+		/** Looks the packed array up once, then reads it into the vector resized to its count. */
+		template <class T_Value> bool getVector(const std::string& sKey, std::vector<T_Value>& lValues, Symbol ulArrayType, Symbol ulElementType, ArchivingResult *bStatus)
+		{
+			ArchivingResult nStatus = Undefined;
+			INode *pTempNode = lookupChild(sKey, ulArrayType);
+			if (verifyChild(ulArrayType, pTempNode, &nStatus))
+			{
+				lValues.resize(getPackedArray(pTempNode, ulElementType, NULL, 0));
+				if (!lValues.empty())
+					getPackedArray(pTempNode, ulElementType, &lValues[0], (unsigned long)lValues.size());
+			}
+			else
+			{
+				lValues.clear();
+			}
+
+			if (bStatus)
+				*bStatus = nStatus;
+			return nStatus == Found;
+		}
 	};
 }
 
@@ -1,50 +1,43 @@
 #ifndef _INSTANCECOUNTER_HPP_
 #define _INSTANCECOUNTER_HPP_
 
-#include <iostream>
+#include "InstanceMetrics.hpp"
 
+/**
+ * Counts the instances of T_Observee, and the memory they take, in the InstanceMetrics of the process.
+ * Query the counts with getInstanceMetrics() or Archiving::InstanceMetrics::getSnapshot().
+ * A subclass of a counted class is counted with the base only, at the size of the base, unless it derives
+ * from IInstanceCounter<Subclass> too. Query such a class through IInstanceCounter<Subclass>::, since the
+ * static members of both counters are visible in it.
+ */
 template<class T_Observee> class IInstanceCounter
 {
 public:
-	static unsigned long s_ulInstanceCount;
-	static FILE* s_pLog;
-	
+	static Archiving::InstanceMetrics::Counter s_aCounter;
+
 	IInstanceCounter()
 	{
-		s_ulInstanceCount++;
+		Archiving::InstanceMetrics::add(s_aCounter, typeid(T_Observee), sizeof(T_Observee));
+	}
+
+	IInstanceCounter(const IInstanceCounter&)
+	{
+		Archiving::InstanceMetrics::add(s_aCounter, typeid(T_Observee), sizeof(T_Observee));
 	}
-	
+
 	virtual ~IInstanceCounter()
 	{
-		s_ulInstanceCount--;
-		// open the report log
-		//if(!s_pLog)
-		//{
-		//	std::string sLogFile = typeid(this).name();
-		//	for each(const char& ch in sLogFile)
-		//	{
-		//		switch(ch)
-		//		{
-		//		case '<':
-		//		case '>':
-		//		case ':':
-		//		case ' ':
-		//		case '*':
-		//			const_cast<char&>(ch) = '_';
-		//		}
-		//	}
-		//	sLogFile = "E:\\InstanceCounter\\" + sLogFile + ".txt";
-		//	s_pLog = fopen(sLogFile.c_str(), "a");
-		//}
-		//std::stringstream ss;
-		//ss << s_ulInstanceCount << "\r\n";
-		//fputs(ss.str().c_str(), s_pLog);
-		//fclose(s_pLog);
-		//s_pLog = NULL;
+		Archiving::InstanceMetrics::remove(s_aCounter, sizeof(T_Observee));
 	}
+
+	IInstanceCounter& operator=(const IInstanceCounter&) {return *this;}
+
+	/** The number of live instances. */
+	static unsigned long getInstanceCount() {return (unsigned long)Archiving::InstanceMetrics::get(typeid(T_Observee)).ullLive;}
+
+	static Archiving::InstanceMetrics::Snapshot getInstanceMetrics() {return Archiving::InstanceMetrics::get(typeid(T_Observee));}
 };
 
-template<class T_Observee> unsigned long IInstanceCounter<T_Observee>::s_ulInstanceCount = 0;
-template<class T_Observee> FILE* IInstanceCounter<T_Observee>::s_pLog = NULL;
+template<class T_Observee> Archiving::InstanceMetrics::Counter IInstanceCounter<T_Observee>::s_aCounter = {0};
 
-#endif
\ No newline at end of file
+#endif
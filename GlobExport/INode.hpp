@@ -9,9 +9,15 @@
 
 #include "IInstanceCounter.hpp"
 #include "IArchivingDriver.hpp"
+#include "NumericCodec.hpp"
 
 namespace Archiving
 {
+	/**
+	 * Nodes that are registered with a driver should be allocated from the driver's arena with
+	 * new (pDriver) MyNode(...). They are deleted like other nodes, but their memory is only given back
+	 * when the driver releases its nodes, in one go.
+	 */
 	class ARCHIVEUTIL_API INode : public IInstanceCounter<INode>
 	{
 		friend class IArchivingDriver;
@@ -20,18 +26,24 @@ namespace Archiving
 	private:
 		INode* m_pParent;
 		IArchivingDriver* m_pDriver;
-		std::map<std::string, INode*> m_mapChildNodeNames;
+		INode* m_pNextNode;            /** Next node registered with the same driver. */
+		ChildIndex m_aChildIndex;
+		Symbol m_ulTypeSymbol;         /** Cached symbol of the "type" attribute, SymbolTable::kNone until resolved. */
 		
-		void addChild(INode* pNode) {m_mapChildNodeNames[pNode->getTagName()] = pNode; pNode->setDriver(m_pDriver);}
+		void addChild(INode* pNode)
+		{
+			indexChild(pNode, getSymbols().intern(pNode->getTagName()));
+			pNode->setDriver(m_pDriver);
+		}
+
+		/** Every allocation is preceded by a header that tells arena memory from heap memory. */
+		enum {kAllocationHeader = 8};
 		
 	public:
-		INode() : m_pParent(NULL), m_pDriver(NULL) {;}
+		INode() : m_pParent(NULL), m_pDriver(NULL), m_pNextNode(NULL), m_ulTypeSymbol(SymbolTable::kNone) {;}
 	
 		virtual ~INode()
 		{
-			//for each(const std::pair<std::string, INode*>& pairNodeName in m_mapChildNodeNames)
-			//	if(pairNodeName.second)
-			//		delete pairNodeName.second;
 		}
 		
 		virtual std::string getTagName() = 0;
@@ -39,18 +51,176 @@ namespace Archiving
 		virtual std::string getAttribute(const std::string& sKey) = 0;
 		virtual void setAttribute(const std::string& sKey, const std::string& sValue) = 0;
 		
-		virtual INode* getChild(const std::string& sKey, const std::string& sType="*") {return m_mapChildNodeNames[sKey];};
+		/**
+		 * Get the child with the given key if its type matches.
+		 * The type is compared with the "type" attribute of the child and must be equal to it, except that "*" matches
+		 * any type, also a child without one, and "" matches no child at all. All drivers follow these semantics, see
+		 * matchesType() for the symbol form.
+		 * The default implementation looks the child up in the index filled by setParent().
+		 */
+		virtual INode* getChild(const std::string& sKey, const std::string& sType="*") {return findChild(sKey, getSymbols().intern(sType));}
+
+		/**
+		 * Same as above with the type given as symbol of the driver's SymbolTable, as KeyValueArchive does.
+		 * Nodes that keep the child index override this to compare symbols only; the default passes the type's string on.
+		 */
+		virtual INode* getChild(const std::string& sKey, Symbol ulType) {return getChild(sKey, getSymbols().getString(ulType));}
+
 		virtual INode* addChild(const std::string& sKey) = 0;
 
+		/**
+		 * The child behind pChild, or the first child for NULL, if its tag name is sKey. NULL otherwise.
+		 * The ordered-read cursor of KeyValueArchive tries this before getChild(), since keys are mostly read
+		 * in the order they were written. Nodes that do not keep their children in order return NULL.
+		 */
+		virtual INode* getNextChild(INode *pChild, const std::string& sKey) {return NULL;}
+
+		/** True if the type matches as getChild() checks it: SymbolTable::kAnyType matches any type, kEmpty none. */
+		bool matchesType(Symbol ulType)
+		{
+			return ulType == SymbolTable::kAnyType || (ulType != SymbolTable::kEmpty && getTypeSymbol() == ulType);
+		}
+
+		/** The symbol of the "type" attribute, resolved on first use. */
+		Symbol getTypeSymbol()
+		{
+			if (m_ulTypeSymbol == SymbolTable::kNone)
+				m_ulTypeSymbol = getSymbols().intern(getAttribute("type"));
+			return m_ulTypeSymbol;
+		}
+
 		virtual std::string getValue() = 0;
-		virtual void setValue(std::string sValue) = 0;
+
+		/** Copies the value into sValue, whose buffer is reused. Nodes override this to read without allocating. */
+		virtual void getValue(std::string& sValue) {sValue = getValue();}
+
+		virtual void setValue(const std::string& sValue) = 0;
+
+		/**
+		 * Sets the value to a packed array of ulCount primitives, the element type given as SymbolTable::kInt,
+		 * kLong, kFloat or kDouble. The default stores the values as text separated by spaces, binary nodes
+		 * override this to store their bytes.
+		 */
+		virtual void setPackedValue(Symbol ulElementType, const void *pValues, unsigned long ulCount)
+		{
+			std::string sText;
+			switch (ulElementType)
+			{
+			case SymbolTable::kInt:    NumericCodec::formatArray((const int *)pValues, ulCount, sText); break;
+			case SymbolTable::kLong:   NumericCodec::formatArray((const long *)pValues, ulCount, sText); break;
+			case SymbolTable::kFloat:  NumericCodec::formatArray((const float *)pValues, ulCount, sText); break;
+			case SymbolTable::kDouble: NumericCodec::formatArray((const double *)pValues, ulCount, sText); break;
+			default: throw(std::runtime_error("type can not be packed!"));
+			}
+			setValue(sText);
+		}
+
+		/**
+		 * Reads a value set by setPackedValue() into pValues, which must hold ulCount elements.
+		 * @return False if the value is no array of ulCount elements of the type.
+		 */
+		virtual bool getPackedValue(Symbol ulElementType, void *pValues, unsigned long ulCount)
+		{
+			std::string sText;
+			getValue(sText);
+			switch (ulElementType)
+			{
+			case SymbolTable::kInt:    return NumericCodec::parseArray(sText, (int *)pValues, ulCount);
+			case SymbolTable::kLong:   return NumericCodec::parseArray(sText, (long *)pValues, ulCount);
+			case SymbolTable::kFloat:  return NumericCodec::parseArray(sText, (float *)pValues, ulCount);
+			case SymbolTable::kDouble: return NumericCodec::parseArray(sText, (double *)pValues, ulCount);
+			default: throw(std::runtime_error("type can not be packed!"));
+			}
+		}
 
 		INode* getParent() {return m_pParent;}
 		void setParent(INode *pParent) {m_pParent = pParent; if(pParent) pParent->addChild(this);}
 		
-		bool hasChildren() {return !m_mapChildNodeNames.empty();}
+		/** True if the node has children. The default tells by the child index, nodes that fill it lazily override this. */
+		virtual bool hasChildren() {return m_aChildIndex.size() != 0;}
 		void setDriver(IArchivingDriver* pDriver) {if(m_pDriver != pDriver) {m_pDriver = pDriver; m_pDriver->addNode(this);} }
+
+		/** Allocation on the heap or, with a driver given, from the driver's arena */
+		static void* operator new(size_t nSize)
+		{
+			char *pMemory = (char *)::operator new(nSize + kAllocationHeader);
+			pMemory[0] = 0;
+			return pMemory + kAllocationHeader;
+		}
+
+		static void* operator new(size_t nSize, IArchivingDriver *pDriver)
+		{
+			return operator new(nSize, pDriver->m_aArena);
+		}
+
+		/** Allocation from an arena that the driver takes over later, see NodeArena::adopt(). */
+		static void* operator new(size_t nSize, NodeArena& aArena)
+		{
+			char *pMemory = (char *)aArena.allocate(nSize + kAllocationHeader);
+			pMemory[0] = 1;
+			return pMemory + kAllocationHeader;
+		}
+
+		static void operator delete(void *p)
+		{
+			if (p && ((char *)p - kAllocationHeader)[0] == 0)
+				::operator delete((char *)p - kAllocationHeader);
+		}
+
+		static void operator delete(void *p, IArchivingDriver *pDriver)
+		{
+		}
+
+		static void operator delete(void *p, NodeArena& aArena)
+		{
+		}
+
+	protected:
+		/** Sets the parent and driver without registering the node in the parent's child names or with the driver.
+		 *  Used by drivers that own their nodes themselves instead of handing them to IArchivingDriver. */
+		void setParentLink(INode *pParent, IArchivingDriver *pDriver) {m_pParent = pParent; m_pDriver = pDriver;}
+
+		/** Adds pNode to the child names under the given key. */
+		void indexChild(INode* pNode, Symbol ulKey) {m_aChildIndex.insert(getArena(), ulKey, pNode);}
+
+		/** Empties the child names, for nodes that are indexed again with the symbols of another driver. */
+		void clearChildIndex() {m_aChildIndex = ChildIndex();}
+
+		/** Looks the key up in the child index and checks the type by symbol. */
+		INode* findChild(const std::string& sKey, Symbol ulType)
+		{
+			Symbol ulKey = getSymbols().find(sKey);
+			return ulKey != SymbolTable::kNone ? findChild(ulKey, ulType) : NULL;
+		}
+
+		/** Same as above with the key given as symbol. */
+		INode* findChild(Symbol ulKey, Symbol ulType)
+		{
+			INode* pNode = m_aChildIndex.find(ulKey);
+			return pNode && pNode->matchesType(ulType) ? pNode : NULL;
+		}
+
+		/** Nodes that change their "type" attribute, or are reused for another element, drop the cached symbol. */
+		void resetTypeSymbol() {m_ulTypeSymbol = SymbolTable::kNone;}
+
+		IArchivingDriver* getDriver() {return m_pDriver;}
+
+		/** The arena of the driver the node is registered with. */
+		NodeArena& getArena()
+		{
+			if (!m_pDriver)
+				throw(std::runtime_error("node is not registered with a driver!"));
+			return m_pDriver->m_aArena;
+		}
+
+		/** The symbols of the driver the node belongs to. */
+		SymbolTable& getSymbols()
+		{
+			if (!m_pDriver)
+				throw(std::runtime_error("node is not registered with a driver!"));
+			return m_pDriver->m_aSymbols;
+		}
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
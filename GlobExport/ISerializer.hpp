@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "IArchivableObject.hpp"
+#include "ArchiveExecutor.hpp"
 
 
 namespace Archiving
@@ -26,6 +27,31 @@ namespace Archiving
 		virtual void setObject(IArchivableObject*, const std::string& sKey) = 0;
 		virtual void setString(const std::string& sString, const std::string& sKey) = 0;
 		virtual void setArray(std::list<IArchivableObject*>& lList, const std::string& sKey) = 0;
+
+		/**
+		 * Same as setArray(), with the items split across the slices of aExecutor.
+		 * Each slice serializes its items into a fragment of its own (see IArchivingDriver::createFragment()),
+		 * and the fragments are appended to the array in order, so the archive is the same as after setArray().
+		 * The objects are serialized concurrently and must not share state, the delegate must be thread-safe.
+		 * Drivers without fragments, arrays of less than two items and arrays that already have items
+		 * are written by setArray() on the calling thread.
+		 */
+		virtual void setArrayParallel(std::list<IArchivableObject*>& lList, const std::string& sKey, ArchiveExecutor& aExecutor) = 0;
+
+		/**
+		 * Packed Primitive Arrays
+		 * The values are stored in a single node instead of a node per value: as text separated by spaces
+		 * in XML archives, as their bytes in binary archives.
+		 */
+		virtual void setIntArray(const int *pValues, unsigned long ulCount, const std::string& sKey) = 0;
+		virtual void setLongArray(const long *pValues, unsigned long ulCount, const std::string& sKey) = 0;
+		virtual void setFloatArray(const float *pValues, unsigned long ulCount, const std::string& sKey) = 0;
+		virtual void setDoubleArray(const double *pValues, unsigned long ulCount, const std::string& sKey) = 0;
+
+		void setIntArray(const std::vector<int>& lValues, const std::string& sKey) {setIntArray(lValues.empty() ? NULL : &lValues[0], (unsigned long)lValues.size(), sKey);}
+		void setLongArray(const std::vector<long>& lValues, const std::string& sKey) {setLongArray(lValues.empty() ? NULL : &lValues[0], (unsigned long)lValues.size(), sKey);}
+		void setFloatArray(const std::vector<float>& lValues, const std::string& sKey) {setFloatArray(lValues.empty() ? NULL : &lValues[0], (unsigned long)lValues.size(), sKey);}
+		void setDoubleArray(const std::vector<double>& lValues, const std::string& sKey) {setDoubleArray(lValues.empty() ? NULL : &lValues[0], (unsigned long)lValues.size(), sKey);}
 	};
 }
 
@@ -0,0 +1,75 @@
+#ifndef _INSTANCEMETRICS_HPP_
+#define _INSTANCEMETRICS_HPP_
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+#include <string>
+#include <vector>
+#include <typeinfo>
+
+namespace Archiving
+{
+	/**
+	 * Process wide instance and memory counts of the classes that derive from IInstanceCounter.
+	 * Every counted class has a Counter that is updated with interlocked operations, so instances can be
+	 * created and deleted on any thread. The counters register themselves with the first instance and are
+	 * reported by the name of the class. Each module that instantiates IInstanceCounter<T> has a counter
+	 * of its own, the snapshots add up the counters of the same class.
+	 *
+	 * Bytes are counted as sizeof(T_Observee) per instance: the counter of a base class like INode only
+	 * counts the base part, the concrete node classes count themselves.
+	 */
+	class ARCHIVEUTIL_API InstanceMetrics
+	{
+	public:
+		/** The counts of a class in one module. Static and zero initialized, see IInstanceCounter. */
+		struct Counter
+		{
+			volatile long long llLive;
+			volatile long long llPeak;
+			volatile long long llTotal;       /** Instances ever created. */
+			volatile long long llBytes;
+			volatile long long llPeakBytes;
+			volatile long long llTotalBytes;
+			volatile long lRegistered;
+			const std::type_info *pType;
+			Counter *pNext;
+		};
+
+		/** A copy of the counts of a class. */
+		struct Snapshot
+		{
+			std::string sName;
+			unsigned long long ullLive;
+			unsigned long long ullPeak;
+			unsigned long long ullTotal;
+			unsigned long long ullBytes;
+			unsigned long long ullPeakBytes;
+			unsigned long long ullTotalBytes;
+
+			Snapshot() : ullLive(0), ullPeak(0), ullTotal(0), ullBytes(0), ullPeakBytes(0), ullTotalBytes(0) {;}
+		};
+
+		/** Counts an instance of nBytes that has been created or deleted. */
+		static void add(Counter& aCounter, const std::type_info& aType, size_t nBytes);
+		static void remove(Counter& aCounter, size_t nBytes);
+
+		/**
+		 * The counts of the class, of all modules. The peaks are those of the single modules,
+		 * which are the same as long as the class is only instantiated in one of them.
+		 */
+		static Snapshot get(const std::type_info& aType);
+
+		/** The counts of all classes with instances so far, sorted by name. */
+		static std::vector<Snapshot> getSnapshot();
+
+		/** The snapshot as a text table, one line per class. */
+		static std::string getReport();
+	};
+}
+
+#endif
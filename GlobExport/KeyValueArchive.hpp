@@ -18,9 +18,16 @@
 #include "ISerializer.hpp"
 #include "IDeserializer.hpp"
 #include "IArchiveDelegate.hpp"
-
+#include "NumericCodec.hpp"
+#include "ArchiveStats.hpp"
+#include "ArchiveFields.hpp"
+#include "DriverTraits.hpp"
+#include "AsyncSave.hpp"
+
+#include <map>
+#include <vector>
+#include <algorithm>
 #include <boost/lexical_cast.hpp>
-#include <boost/algorithm/string.hpp>
 
 /**
  * Implementation of an archive that stores values (represented by nodes) in a tree,
@@ -56,6 +63,7 @@
  * Those instance's serialize methods will be called within the scope of a node representing that collection.
  * Note, that it is not necessary that all objects in the vector are of the same final type. They just have to extend IArchivableObject.
  * The Archive will automatically remember the correct type to deserialize the object with.
+ * To read the items back as their own classes, the classes must be registered with ARCHIVE_REGISTER_CLASS(), see ClassRegistry.
  * E.g., the following could be a representation of an array in an archive:
  *
  * root
@@ -80,6 +88,8 @@
  * of one MyClass object, since only one MyClass instance has been put in.
  * The call of MyClass::deserialize() would then result in a call to getObject<MyOtherClass>("subobject") at the scope
  * of that instance. That way, the object hierarchy would be fully restored.
+ * An object that is set at several keys is serialized at each of them, and read back as that many instances,
+ * unless trackReferences() is enabled, which stores it once and the other keys as references to it.
  *
  * An Archive can be created/loaded using one of its constructors. When using the alternate contructor, where
  * a path can be specified, the archive's load() method will be called automatically with that path.
@@ -104,15 +114,153 @@ namespace Archiving
 	protected:
 		IArchivingDriver* m_pArchivingDriver;  /** A pointer to the archive-driver instance. */
 		INode* m_pScope;                       /** A pointer that points to the current scope node. See pushScope(INode *pScope) and popScope() */
+		INode* m_pCursor;                      /** The child of the scope read last, NULL at the start of the scope. See nextChild(). */
 		IArchiveDelegate* m_pDelegate;         /** A pointer to the delegate-object. See setDelegate() and getDelegate() */
 		std::string m_sSource;                 /** A string identifying the source this driver is accessing (e.g., a file path). */
+		std::string m_sValue;                  /** Buffer the getters read and the setters format values into, reused to avoid allocations. */
+		bool m_bOwnsDriver;                    /** False for the cursors of getArrayParallel(), which share the driver of their archive. */
+		ArchiveStats* m_pStats;                /** NULL unless enabled, see enableStats(). */
+		std::map<IArchivableObject*, INode*>* m_pObjects;  /** The nodes of the objects, NULL unless enabled, see trackObjects(). */
+		std::vector<IArchivableObject*> m_lsDirty;          /** The objects marked with markDirty(). */
+
+		/** Protected: The objects of trackReferences(). */
+		struct References
+		{
+			std::map<IArchivableObject*, INode*> mapNodes;        /** Written objects by the node of their first occurrence. */
+			std::map<IArchivableObject*, std::string> mapPaths;   /** Their paths, once referenced or if the driver does not keep its nodes. */
+			std::map<std::string, IArchivableObject*> mapObjects; /** Read objects by their path, nodes of streaming drivers do not last. */
+		};
+		References* m_pReferences;             /** NULL unless enabled, see trackReferences(). */
+
+		/** Protected: The node calls of the getters and setters, bound statically for the drivers that specialize DriverTraits. */
+		typedef typename DriverTraits<T_IArchivingDriver>::NodeCalls NodeCalls;
+		std::vector<std::string> m_lsResolving; /** Paths of the references being read from their target, which cut cycles. */
+		std::map<Symbol, ClassRegistry::Factory> m_mapClasses;  /** The registered classes of the stored types looked up so far, see createInstance(). */
+		long m_lClassGeneration;               /** ClassRegistry::getGeneration() when m_mapClasses was started. */
+		AsyncSave* m_pSave;                    /** The last saveAsync(), NULL if there is none. */
+		unsigned long m_ulNestedReads;         /** beginConcurrentRead() calls of the items of a concurrent read, which is prepared already. */
+
+		/** Protected: Writes the items of one slice of setArrayParallel() into the fragment archive of the slice. */
+		class ArrayWriteTask : public ArchiveExecutor::ITask
+		{
+		public:
+			ArrayWriteTask(std::vector<IArchivableObject*>& lsObjects, std::vector<KeyValueArchive*>& lsFragments)
+				: m_lsObjects(lsObjects), m_lsFragments(lsFragments) {;}
+
+			virtual void run(unsigned nSlice, unsigned long ulBegin, unsigned long ulEnd)
+			{
+				ArrayItemKey aKey;
+				for (unsigned long i = ulBegin; i < ulEnd; ++i)
+					m_lsFragments[nSlice]->setObject(m_lsObjects[i], aKey.get(i));
+			}
+
+		protected:
+			std::vector<IArchivableObject*>& m_lsObjects;
+			std::vector<KeyValueArchive*>& m_lsFragments;
+		};
 
 		/**
 		 * Protected: Searches the current scope for a node with the given key,
 		 * and creates it if it doesn't exist.
 		 * @return A new instace of the node_type template associated with the instace of the archive.
 		 */
-		INode* getSubNode(const std::string& sKey, const std::string& sType);
+		INode* getSubNode(const std::string& sKey, Symbol ulType);
+
+		/** Protected: Formats the number with NumericCodec and sets it as the value of the subnode. */
+		template <class T_Number> void setNumber(T_Number aNumber, const std::string& sKey, Symbol ulType)
+		{
+			INode *pNode = getSubNode(sKey, ulType);
+			ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+			char aBuffer[NumericCodec::kBufferSize];
+			m_sValue.assign(aBuffer, NumericCodec::format(aNumber, aBuffer));
+			NodeCalls::setValue(pNode, m_sValue);
+		}
+
+		/**
+		 * Protected: Parses the value of the subnode with NumericCodec.
+		 * Throws boost::bad_lexical_cast if it is no number of that type, as the archive did when it used lexical_cast.
+		 * @return The number or 0 if the node can not be verified.
+		 */
+		template <class T_Number> T_Number getNumber(const std::string& sKey, Symbol ulType, ArchivingResult *bStatus)
+		{
+			INode *pTempNode = lookupChild(sKey, ulType);
+			if (!verifyChild(ulType, pTempNode, bStatus))
+				return (T_Number)0;
+
+			ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+			NodeCalls::getValue(pTempNode, m_sValue);
+			T_Number aNumber;
+			if (!NumericCodec::parse(m_sValue, aNumber))
+				throw boost::bad_lexical_cast();
+			return aNumber;
+		}
+
+		/**
+		 * Protected: Looks the key up in the current scope, counted and timed in the stats.
+		 * @see IDeserializer::lookupChild()
+		 */
+		virtual INode* lookupChild(const std::string& sKey, Symbol ulType) {return lookupChild(sKey, ulType, true);}
+
+		/** Protected: Same as above, bRead false for the lookups of the setters, which are not counted as reads. */
+		INode* lookupChild(const std::string& sKey, Symbol ulType, bool bRead)
+		{
+			if (!m_pStats)
+				return nextChild(sKey, ulType, bRead);
+
+			ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kLookup);
+			INode *pNode = nextChild(sKey, ulType, bRead);
+			m_pStats->count(ArchiveStats::kLookups);
+			if (!pNode)
+				m_pStats->count(ArchiveStats::kLookupMisses);
+			return pNode;
+		}
+
+		/**
+		 * Protected: The ordered-read cursor. deserialize() mostly reads the keys in the order serialize() wrote
+		 * them, so the child behind the one read last is tried first and the key is only looked up if that
+		 * child has another name. A repeated key of another type is looked up as well.
+		 */
+		INode* nextChild(const std::string& sKey, Symbol ulType, bool bRead)
+		{
+			INode *pNode = NodeCalls::getNextChild(m_pScope, m_pCursor, sKey);
+			if (pNode)
+			{
+				m_pCursor = pNode;
+				if (pNode->matchesType(ulType))
+				{
+					if (m_pStats && bRead)
+						m_pStats->count(ArchiveStats::kOrderedHits);
+					return pNode;
+				}
+			}
+
+			if (m_pStats && bRead)
+				m_pStats->count(ArchiveStats::kOrderedMisses);
+			if ((pNode = NodeCalls::getChild(m_pScope, sKey, ulType)) != NULL)
+				m_pCursor = pNode;
+			return pNode;
+		}
+
+		/** Protected: verifyNode(), with the result counted in the stats. */
+		virtual bool verifyChild(Symbol ulType, INode *pNode, ArchivingResult *bStatus)
+		{
+			if (!m_pStats)
+				return verifyNode(ulType, pNode, bStatus);
+
+			ArchivingResult nStatus;
+			bool bFound = verifyNode(ulType, pNode, &nStatus);
+			m_pStats->countResult(nStatus);
+			if (bStatus)
+				*bStatus = nStatus;
+			return bFound;
+		}
+
+		/** Protected: Stores a packed array of ulCount elements of the given type in a single node, see ISerializer::setIntArray(). */
+		void setPackedArray(Symbol ulArrayType, Symbol ulElementType, const void *pValues, unsigned long ulCount, const std::string& sKey);
+
+		/** Protected: Reads a packed array, see IDeserializer::getIntArray(). */
+		unsigned long getPackedArray(Symbol ulArrayType, Symbol ulElementType, const std::string& sKey, void *pValues, unsigned long ulCapacity, ArchivingResult *bStatus);
+		virtual unsigned long getPackedArray(INode *pArrayNode, Symbol ulElementType, void *pValues, unsigned long ulCapacity);
 
 		/**
 		 * Protected: Get the scope-path recursive of the given node.
@@ -120,6 +268,68 @@ namespace Archiving
 		 */
 		std::string getPath(INode *pNode);
 
+		/**
+		 * Protected: Reference paths, the keys from the root to the node separated by '/'.
+		 * A '/' or '\\' in a key is preceded by a '\\'.
+		 */
+		std::string getReferencePath(INode *pNode);
+		INode* findReferencePath(const std::string& sPath);
+
+		/** Protected: Writes a reference if the object was written before at another node. */
+		bool setReference(IArchivableObject* pObject, const std::string& sKey, Symbol ulClass);
+
+		/** Protected: Keeps the node an object is first written at. */
+		void recordReference(IArchivableObject* pObject, INode *pNode);
+
+		/**
+		 * Protected: Reads a reference node: the object read from its target, or read now from there.
+		 * With pClass given, as by createObject(), pObject is NULL and created for the target if it is read now.
+		 * With bInPlace, as by getObjectInto(), the target is always read into pObject.
+		 * pDestroyObject, if given, is set to the function that destroys the object if it was created here, NULL otherwise.
+		 */
+		bool fillReference(INode *pReference, IArchivableObject*& pObject, ArchivingResult *bStatus, const ClassRegistry::Class* pClass = NULL, bool bInPlace = false, ClassRegistry::DestroyFunction *pDestroyObject = NULL);
+
+		/**
+		 * Protected: A new instance of the class registered for the stored type if it is one of aClass, otherwise of aClass.
+		 * NULL if aClass is abstract and the type is not registered. pDestroy is set to the function that destroys it.
+		 */
+		IArchivableObject* createInstance(Symbol ulType, const ClassRegistry::Class& aClass, ClassRegistry::DestroyFunction& pDestroy);
+
+		/**
+		 * Protected: Reads the object at pNode, a child of the current scope, see fillObject().
+		 * With bInPlace, pObject belongs to the caller: it is neither replaced by the delegate or an object
+		 * read before, nor kept for the references to it.
+		 */
+		bool fillObjectNode(INode *pNode, IArchivableObject*& pObject, ArchivingResult *bStatus, bool bInPlace = false);
+
+		/** Protected: Waits for the last saveAsync() and deletes it. */
+		void endSave();
+
+		/** Protected: The loads from a file or, without bFile, from the data in sSource, see loadFromFileAsync() for bAsync. */
+		bool load(const std::string& sSource, bool bFile, bool bAsync);
+
+		/** Protected: setObject() with the stats enabled. */
+		void setObjectTimed(IArchivableObject* pObject, const std::string& sKey);
+
+		/** Protected: Serializes the objects marked with markDirty() into their nodes again. */
+		void serializeDirty();
+
+		/** Protected: Drops the tracked objects, whose nodes are gone after loading or resetting. */
+		void forgetObjects();
+
+		/** Protected: Writes the array, with the items split across the slices of pExecutor if it is given. */
+		void setArrayItems(std::list<IArchivableObject*>& lList, const std::string& sKey, ArchiveExecutor *pExecutor);
+
+		/**
+		 * Protected: Cursor constructor.
+		 * The new archive works on pDriver and calls the delegate of aArchive, starting at pScope.
+		 * It has its own scope and value buffer, so cursors can work on different subtrees from different threads.
+		 * If pDriver is the driver of aArchive, it is shared and not deleted with the cursor. Otherwise it
+		 * is a fragment (see setArrayParallel()) that belongs to the cursor.
+		 * @see createCursor()
+		 */
+		KeyValueArchive(KeyValueArchive& aArchive, IArchivingDriver *pDriver, INode *pScope);
+
 	public:
 		/**
 		 * Standard constructor.
@@ -163,6 +373,20 @@ namespace Archiving
 		bool loadFromFile(const std::string& sPath);
 		bool loadFromString(const std::string& sData);
 
+		/**
+		 * Loads like loadFromFile(), but returns once the driver has parsed the start of the archive and parses the
+		 * rest on a thread of its own (see IArchivingDriver::loadFromFileAsync()), so the objects can be read while it
+		 * runs. A getter of a key that is not parsed yet waits until it is, the setters and saves wait for the whole parse.
+		 * Binary::Driver parses asynchronously, other drivers load synchronously.
+		 * The parse time of the stats only covers the synchronous part.
+		 * @return False if the start of the archive can not be loaded. Errors of the rest are reported by waitForLoad().
+		 */
+		bool loadFromFileAsync(const std::string& sPath);
+		bool loadFromStringAsync(const std::string& sData);
+
+		/** Waits for the parse of loadFromFileAsync(). False if the archive could not be parsed completely. */
+		bool waitForLoad();
+
 		/**
 		 * Get if the archive ever was load.
 		 * @return True if a file was loaded succesfull. Otherwise false.
@@ -178,11 +402,34 @@ namespace Archiving
 		 */
 		bool save(std::string sPath="");
 
+		/**
+		 * Starts an empty archive that is written to sPath while it is serialized, for drivers that stream
+		 * their output (see IArchivingDriver::openOutput()). An existing file at sPath is replaced,
+		 * save() without a path then completes it.
+		 * @return False if the file can not be created or the driver does not stream.
+		 */
+		bool openOutput(const std::string& sPath);
+
+		/**
+		 * Saves the archive like save(), on a thread of its own, and returns once the driver has taken a snapshot
+		 * of it (see IArchivingDriver::createSnapshot()). The archive can be changed and read meanwhile, the file
+		 * gets the archive as it was when saveAsync() was called. Binary::Driver only marks its nodes for the
+		 * snapshot, Xerces::Driver clones its document, other drivers format the archive here.
+		 * A save that is still running is waited for first, as do save(), saveChanges(), loads and the destructor.
+		 * @param The file path to save, "" for the file the archive was loaded from, which the driver must support.
+		 * @param Told on the saving thread when the save is done, may be NULL.
+		 * @return The save, which belongs to the archive until the next save, load or the archive's destruction.
+		 */
+		AsyncSave& saveAsync(std::string sPath = "", AsyncSave::IListener *pListener = NULL);
+
+		/** Waits for the last saveAsync(), see AsyncSave::wait(). True if there is none. */
+		bool waitForSave();
+
 		/**
 		 * Returns the archives XML as string.
 		 * @return The archives XML string.
 		 */
-		std::wstring getArchiveString();
+		std::string getArchiveString();
 
 		/* Serializer-Interface Methods */
 		virtual void setBool(bool bBool, const std::string& sKey);
@@ -195,6 +442,15 @@ namespace Archiving
 		virtual void setString(const std::string& sString, const std::string& sKey);
 		virtual void setObject(IArchivableObject*, const std::string& sKey);
 		virtual void setArray(std::list<IArchivableObject*>& lList, const std::string& sKey);
+		virtual void setArrayParallel(std::list<IArchivableObject*>& lList, const std::string& sKey, ArchiveExecutor& aExecutor);
+		virtual void setIntArray(const int *pValues, unsigned long ulCount, const std::string& sKey);
+		virtual void setLongArray(const long *pValues, unsigned long ulCount, const std::string& sKey);
+		virtual void setFloatArray(const float *pValues, unsigned long ulCount, const std::string& sKey);
+		virtual void setDoubleArray(const double *pValues, unsigned long ulCount, const std::string& sKey);
+		using ISerializer::setIntArray;
+		using ISerializer::setLongArray;
+		using ISerializer::setFloatArray;
+		using ISerializer::setDoubleArray;
 
 		/* Deserializer Methods */
 		virtual bool	     getBool(const std::string& sKey, ArchivingResult *bStatus = NULL);
@@ -205,6 +461,14 @@ namespace Archiving
 		virtual float       getFloat(const std::string& sKey, ArchivingResult *bStatus = NULL);
 		virtual double      getDouble(const std::string& sKey, ArchivingResult *bStatus = NULL);
 		virtual std::string getString(const std::string& sKey, ArchivingResult *bStatus = NULL);
+		virtual unsigned long getIntArray(const std::string& sKey, int *pValues, unsigned long ulCapacity, ArchivingResult *bStatus = NULL);
+		virtual unsigned long getLongArray(const std::string& sKey, long *pValues, unsigned long ulCapacity, ArchivingResult *bStatus = NULL);
+		virtual unsigned long getFloatArray(const std::string& sKey, float *pValues, unsigned long ulCapacity, ArchivingResult *bStatus = NULL);
+		virtual unsigned long getDoubleArray(const std::string& sKey, double *pValues, unsigned long ulCapacity, ArchivingResult *bStatus = NULL);
+		using IDeserializer::getIntArray;
+		using IDeserializer::getLongArray;
+		using IDeserializer::getFloatArray;
+		using IDeserializer::getDoubleArray;
 
 		/**
 		 * Get the archives parsing error count
@@ -222,6 +486,75 @@ namespace Archiving
 		 */
 		std::string getSource() {return m_sSource;}
 
+		/**
+		 * Enables or disables the performance statistics of the archive, see ArchiveStats.
+		 * Enabling starts with empty stats, disabling drops them.
+		 */
+		void enableStats(bool bEnable = true);
+
+		/**
+		 * The performance statistics, NULL unless enabled.
+		 * Read them from the thread that uses the archive, between its calls.
+		 */
+		ArchiveStats* getStats() {return m_pStats;}
+
+		/**
+		 * Incremental saving.
+		 * With tracking enabled, the archive remembers the node of each object it serializes or deserializes,
+		 * except those of the parallel array methods. After changing such an object, markDirty() it: save() and
+		 * saveChanges() serialize the marked objects into their nodes again, and the setters leave the nodes
+		 * of unchanged values alone. The objects are kept by address, so a deleted object must not be marked.
+		 * Disabling drops the tracked objects.
+		 *
+		 * Instead of marking, all objects can be set again with a delegate whose preSerializeObject() returns
+		 * false for the unchanged ones, which keeps their nodes as they are.
+		 */
+		void trackObjects(bool bEnable = true);
+
+		/** @return False if the object is not tracked. */
+		bool markDirty(IArchivableObject *pObject);
+
+		/**
+		 * Saves the changes since the archive was loaded from or saved to sPath. Binary::Driver appends them to the
+		 * file, in time proportional to their size, other drivers save the whole archive.
+		 * @see Binary::Driver::saveChanges()
+		 */
+		bool saveChanges(std::string sPath = "");
+
+		/**
+		 * Shared objects.
+		 * With tracking enabled, setObject() writes an object reached again as a reference to its first node
+		 * (a node of type "ref" whose value is the path of that node) instead of serializing it once more,
+		 * and getObject() returns the instance read from the first node for each of its references, also
+		 * when the reference is read first. Cycles come back as cycles.
+		 * Without tracking, getObject() reads a reference as a copy of the object it refers to.
+		 *
+		 * The same instance is then returned several times: the caller has to own it once, e.g. through shared
+		 * pointers kept by instance. The delegate is not called for references to objects that are already read.
+		 * The cursors and fragments of the parallel array methods do not track: they write objects in full and
+		 * read references as copies.
+		 * Drivers that do not keep their nodes (see IArchivingDriver::keepsNodes()) only find references to
+		 * objects that are already read with tracking enabled, the others are NotFound.
+		 * Without tracking, a cycle is copied around once and the reference that closes it again is NotFound.
+		 * Disabling drops the tracked objects, as do loading and resetting.
+		 */
+		void trackReferences(bool bEnable = true);
+
+		/**
+		 * Compile-time fields.
+		 * Writes and reads an object whose class declares its fields, see ArchivedFields, like setObject() and
+		 * getObject() do, in the same format. The fields are visited by a FieldWriter or FieldReader bound to this
+		 * class, which calls the setters and getters without virtual dispatch, and objects with declared fields
+		 * nested in them are written and read the same way.
+		 * With a delegate, stats, trackObjects() or trackReferences() the object goes through setObject() and
+		 * getObject() instead, so they see every object as before.
+		 */
+		template <class T_Object> void setFields(T_Object& aObject, const std::string& sKey);
+		template <class T_Object> T_Object* getFields(const std::string& sKey, ArchivingResult *bStatus = NULL);
+
+		/** In-place reads, see IDeserializer::getObjectInto(). */
+		virtual bool getObjectInto(const std::string& sKey, IArchivableObject& aObject, ArchivingResult *bStatus = NULL);
+
 	protected:
 		/**
 		 * Protected: Push the scope.
@@ -252,6 +585,12 @@ namespace Archiving
 		 * @see ArchivingResult, IArchivableObject and getObject<class T>(const std::string& sKey, ArchivingResult *bStatus = NULL)
 		 */
 		virtual bool fillObject(const std::string& sKey, IArchivableObject*& pObject, ArchivingResult *bStatus = NULL );
+		virtual bool createObject(const std::string& sKey, IArchivableObject*& pObject, const ClassRegistry::Class& aClass, ArchivingResult *bStatus, ClassRegistry::DestroyFunction *pDestroyObject = NULL);
+
+		/** Protected: Concurrent reads for getArrayParallel(), see IDeserializer. */
+		virtual bool beginConcurrentRead(INode *pNode);
+		virtual void endConcurrentRead();
+		virtual IDeserializer* createCursor(INode *pScope);
 	};
 
 }
@@ -266,6 +605,14 @@ namespace Archiving
 			: m_pDelegate(NULL)
 			, m_pArchivingDriver(IArchivingDriver::CreateArchive<T_IArchivingDriver>())
 			, m_pScope(NULL)
+			, m_pCursor(NULL)
+			, m_bOwnsDriver(true)
+			, m_pStats(NULL)
+			, m_pObjects(NULL)
+			, m_pReferences(NULL)
+			, m_lClassGeneration(ClassRegistry::getGeneration())
+			, m_pSave(NULL)
+			, m_ulNestedReads(0)
 	{
 		assert(m_pArchivingDriver != NULL );
 		pushScope(m_pArchivingDriver->getRootNode());
@@ -274,17 +621,352 @@ namespace Archiving
 	template <class T_IArchivingDriver>
 	KeyValueArchive<T_IArchivingDriver>::KeyValueArchive(const std::string& sPath)
 			: m_pDelegate(NULL)
-			, m_pArchivingDriver(IArchivingDriver::LoadArchive<T_IArchivingDriver>(sPath))
+			, m_pArchivingDriver(IArchivingDriver::LoadArchiveFromFile<T_IArchivingDriver>(sPath))
 			, m_pScope(NULL)
+			, m_pCursor(NULL)
+			, m_bOwnsDriver(true)
+			, m_pStats(NULL)
+			, m_pObjects(NULL)
+			, m_pReferences(NULL)
+			, m_lClassGeneration(ClassRegistry::getGeneration())
+			, m_pSave(NULL)
+			, m_ulNestedReads(0)
 	{
 		assert(m_pArchivingDriver != NULL );
 		pushScope(m_pArchivingDriver->getRootNode());
 	}
 
+	template <class T_IArchivingDriver>
+	KeyValueArchive<T_IArchivingDriver>::KeyValueArchive(KeyValueArchive& aArchive, IArchivingDriver *pDriver, INode *pScope)
+			: m_pDelegate(aArchive.m_pDelegate)
+			, m_pArchivingDriver(pDriver)
+			, m_pScope(NULL)
+			, m_pCursor(NULL)
+			, m_sSource(aArchive.m_sSource)
+			, m_bOwnsDriver(pDriver != aArchive.m_pArchivingDriver)
+			, m_pStats(aArchive.m_pStats ? new ArchiveStats(pDriver->getSymbols(), aArchive.m_pStats) : NULL)
+			, m_pObjects(NULL)
+			, m_pReferences(NULL)
+			, m_lClassGeneration(ClassRegistry::getGeneration())
+			, m_pSave(NULL)
+			, m_ulNestedReads(0)
+	{
+		pushScope(pScope);
+	}
+
 	template <class T_IArchivingDriver>
 	KeyValueArchive<T_IArchivingDriver>::~KeyValueArchive()
 	{
-		delete m_pArchivingDriver;
+		// Before the driver, which the save may still copy
+		delete m_pSave;
+		// Before the driver, the stats of fragments look up their classes in its symbols
+		delete m_pStats;
+		delete m_pObjects;
+		delete m_pReferences;
+		if (m_bOwnsDriver)
+			delete m_pArchivingDriver;
+	}
+
+	/** Stats */
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::enableStats(bool bEnable)
+	{
+		delete m_pStats;
+		m_pStats = bEnable ? new ArchiveStats(m_pArchivingDriver->getSymbols()) : NULL;
+	}
+
+	/** Incremental saving */
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::trackObjects(bool bEnable)
+	{
+		delete m_pObjects;
+		m_pObjects = bEnable ? new std::map<IArchivableObject*, INode*>() : NULL;
+		m_lsDirty.clear();
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::markDirty(IArchivableObject *pObject)
+	{
+		if (!m_pObjects || m_pObjects->find(pObject) == m_pObjects->end())
+			return false;
+		m_lsDirty.push_back(pObject);
+		return true;
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::serializeDirty()
+	{
+		if (m_lsDirty.empty())
+			return;
+
+		std::sort(m_lsDirty.begin(), m_lsDirty.end());
+		m_lsDirty.erase(std::unique(m_lsDirty.begin(), m_lsDirty.end()), m_lsDirty.end());
+
+		// Each object goes back into its own node, the scope of the archive stays where it is
+		INode *pScope = m_pScope;
+		INode *pCursor = m_pCursor;
+		for (std::vector<IArchivableObject*>::iterator it = m_lsDirty.begin(); it != m_lsDirty.end(); ++it)
+		{
+			IArchivableObject *pObject = *it;
+			if (m_pDelegate != NULL)
+				if (!m_pDelegate->preSerializeObject(pObject))
+					continue;
+
+			pushScope((*m_pObjects)[pObject]);
+			pObject->serialize((ISerializer *)this);
+			if (m_pDelegate != NULL)
+				m_pDelegate->afterSerializeObject(pObject);
+		}
+		m_pScope = pScope;
+		m_pCursor = pCursor;
+		m_lsDirty.clear();
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::forgetObjects()
+	{
+		if (m_pObjects)
+			m_pObjects->clear();
+		m_lsDirty.clear();
+		if (m_pReferences)
+			trackReferences();
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::saveChanges(std::string sPath)
+	{
+		assert(m_pArchivingDriver != NULL && "Attempt to save unloaded archive!");
+		endSave();
+		serializeDirty();
+		if (!m_pStats)
+			return m_pArchivingDriver->saveChanges(sPath);
+
+		unsigned long long ullStart = ArchiveStats::now();
+		bool bSaved = m_pArchivingDriver->saveChanges(sPath);
+		m_pStats->addTime(ArchiveStats::kWrite, ullStart);
+		return bSaved;
+	}
+
+	/** Shared objects */
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::trackReferences(bool bEnable)
+	{
+		delete m_pReferences;
+		m_pReferences = bEnable ? new References() : NULL;
+	}
+
+	template <class T_IArchivingDriver>
+	std::string KeyValueArchive<T_IArchivingDriver>::getReferencePath(INode *pNode)
+	{
+		std::vector<INode*> lsNodes;
+		for (; pNode->getParent(); pNode = pNode->getParent())
+			lsNodes.push_back(pNode);
+
+		std::string sPath;
+		for (std::vector<INode*>::reverse_iterator it = lsNodes.rbegin(); it != lsNodes.rend(); ++it)
+		{
+			if (!sPath.empty())
+				sPath += '/';
+			std::string sKey = (*it)->getTagName();
+			for (std::string::const_iterator itChar = sKey.begin(); itChar != sKey.end(); ++itChar)
+			{
+				if (*itChar == '/' || *itChar == '\\')
+					sPath += '\\';
+				sPath += *itChar;
+			}
+		}
+		return sPath;
+	}
+
+	template <class T_IArchivingDriver>
+	INode* KeyValueArchive<T_IArchivingDriver>::findReferencePath(const std::string& sPath)
+	{
+		INode *pNode = m_pArchivingDriver->getRootNode();
+		std::string sKey;
+		for (std::string::const_iterator it = sPath.begin(); pNode; ++it)
+		{
+			if (it == sPath.end() || *it == '/')
+			{
+				pNode = pNode->getChild(sKey, (Symbol)SymbolTable::kAnyType);
+				if (it == sPath.end())
+					break;
+				sKey.erase();
+				continue;
+			}
+			if (*it == '\\' && it + 1 != sPath.end())
+				++it;
+			sKey += *it;
+		}
+		return pNode;
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::setReference(IArchivableObject* pObject, const std::string& sKey, Symbol ulClass)
+	{
+		std::map<IArchivableObject*, INode*>::iterator it = m_pReferences->mapNodes.find(pObject);
+		if (it == m_pReferences->mapNodes.end())
+			return false;
+
+		// Setting the object again at its own node, as markDirty() does, serializes it
+		INode *pNode = lookupChild(sKey, ulClass, false);
+		if (pNode && pNode == it->second)
+			return false;
+
+		std::string& sPath = m_pReferences->mapPaths[pObject];
+		if (sPath.empty())
+			sPath = getReferencePath(it->second);
+
+		pNode = getSubNode(sKey, SymbolTable::kReference);
+		ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+		NodeCalls::setValue(pNode, sPath);
+		return true;
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::recordReference(IArchivableObject* pObject, INode *pNode)
+	{
+		if (!m_pReferences->mapNodes.insert(std::make_pair(pObject, pNode)).second)
+			return;
+
+		// Streamed nodes are reused once they are written, their path is taken while it is there
+		if (!m_pArchivingDriver->keepsNodes())
+			m_pReferences->mapPaths[pObject] = getReferencePath(pNode);
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::fillReference(INode *pReference, IArchivableObject*& pObject, ArchivingResult *bStatus, const ClassRegistry::Class* pClass, bool bInPlace, ClassRegistry::DestroyFunction *pDestroyObject)
+	{
+		if (pDestroyObject)
+			*pDestroyObject = NULL;
+
+		std::string sPath;
+		{
+			ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+			NodeCalls::getValue(pReference, sPath);
+		}
+
+		if (m_pReferences && !bInPlace)
+		{
+			std::map<std::string, IArchivableObject*>::iterator it = m_pReferences->mapObjects.find(sPath);
+			if (it != m_pReferences->mapObjects.end())
+			{
+				SymbolTable& aSymbols = m_pArchivingDriver->getSymbols();
+				if (pClass ? !pClass->pAccepts(it->second) : aSymbols.getClassSymbol(it->second) != aSymbols.getClassSymbol(pObject))
+				{
+					if (bStatus)
+						*bStatus = BadType;
+					return false;
+				}
+				pObject = it->second;
+				if (bStatus)
+					*bStatus = Found;
+				return true;
+			}
+		}
+
+		// Not read yet: read it from its node, which streaming drivers can not go back to
+		INode *pTarget = NULL;
+		if (m_pArchivingDriver->keepsNodes())
+		{
+			ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kLookup);
+			pTarget = findReferencePath(sPath);
+		}
+		if (!pTarget)
+		{
+			if (bStatus)
+				*bStatus = NotFound;
+			return false;
+		}
+
+		// Without tracking, a cycle is copied until it comes back to a reference that is still being read
+		if (std::find(m_lsResolving.begin(), m_lsResolving.end(), sPath) != m_lsResolving.end())
+		{
+			if (bStatus)
+				*bStatus = NotFound;
+			return false;
+		}
+
+		INode *pScope = m_pScope;
+		INode *pCursor = m_pCursor;
+		m_pScope = pTarget->getParent();
+		m_pCursor = NULL;
+		m_lsResolving.push_back(sPath);
+		IArchivableObject *pCreated = NULL;
+		ClassRegistry::DestroyFunction pDestroy = NULL;
+		if (pClass)
+			pCreated = pObject = createInstance(pTarget->getTypeSymbol(), *pClass, pDestroy);
+		bool bFound;
+		try
+		{
+			bFound = pObject ? fillObjectNode(pTarget, pObject, bStatus, bInPlace) : verifyChild(SymbolTable::kNone, pTarget, bStatus);
+		}
+		catch (...)
+		{
+			m_lsResolving.pop_back();
+			m_pScope = pScope;
+			m_pCursor = pCursor;
+			ClassRegistry::destroy(pCreated, pDestroy);
+			throw;
+		}
+		m_lsResolving.pop_back();
+		m_pScope = pScope;
+		m_pCursor = pCursor;
+
+		if (pClass && !bFound)
+			pObject = NULL;
+		if (pObject != pCreated)
+			ClassRegistry::destroy(pCreated, pDestroy);
+		else if (pDestroyObject)
+			*pDestroyObject = pDestroy;
+		return bFound;
+	}
+
+	/** Compile-time fields */
+	template <class T_IArchivingDriver>
+	template <class T_Object>
+	void KeyValueArchive<T_IArchivingDriver>::setFields(T_Object& aObject, const std::string& sKey)
+	{
+		if (m_pDelegate || m_pStats || m_pObjects || m_pReferences)
+		{
+			setObject(&aObject, sKey);
+			return;
+		}
+
+		pushScope(getSubNode(sKey, m_pArchivingDriver->getSymbols().getClassSymbol(&aObject)));
+		FieldWriter<KeyValueArchive> aWriter(*this);
+		aObject.visitFields(aWriter);
+		popScope();
+	}
+
+	template <class T_IArchivingDriver>
+	template <class T_Object>
+	T_Object* KeyValueArchive<T_IArchivingDriver>::getFields(const std::string& sKey, ArchivingResult *bStatus)
+	{
+		if (m_pDelegate || m_pStats || m_pObjects || m_pReferences)
+			return getObject<T_Object>(sKey, bStatus);
+
+		T_Object *pObject = new T_Object();
+		Symbol ulClass = m_pArchivingDriver->getSymbols().getClassSymbol(pObject);
+		INode *pNode = lookupChild(sKey, ulClass);
+		if (!pNode)
+		{
+			// A reference is read as a copy, as getObject() reads it without trackReferences()
+			INode *pReference = lookupChild(sKey, SymbolTable::kReference);
+			IArchivableObject *pRead = pObject;
+			if (pReference && fillReference(pReference, pRead, bStatus))
+				return pObject;
+		}
+		if (!verifyChild(ulClass, pNode, bStatus))
+		{
+			delete pObject;
+			return NULL;
+		}
+
+		pushScope(pNode);
+		FieldReader<KeyValueArchive> aReader(*this);
+		pObject->visitFields(aReader);
+		popScope();
+		return pObject;
 	}
 
 	/** Delegate */
@@ -320,34 +1002,116 @@ namespace Archiving
 	template <class T_IArchivingDriver>
 	bool KeyValueArchive<T_IArchivingDriver>::loadFromFile(const std::string& sPath)
 	{
-		if (m_pArchivingDriver && m_pArchivingDriver->loadFromFile(sPath))
-		{
-			m_pScope = NULL;
-			pushScope(m_pArchivingDriver->getRootNode());
-			return true;
-		}
-		m_sSource = sPath;
-		return false;
+		return load(sPath, true, false);
 	}
 
 	template <class T_IArchivingDriver>
 	bool KeyValueArchive<T_IArchivingDriver>::loadFromString(const std::string& sData)
 	{
-		if (m_pArchivingDriver && m_pArchivingDriver->loadFromString(sData))
+		return load(sData, false, false);
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::loadFromFileAsync(const std::string& sPath)
+	{
+		return load(sPath, true, true);
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::loadFromStringAsync(const std::string& sData)
+	{
+		return load(sData, false, true);
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::waitForLoad()
+	{
+		return m_pArchivingDriver && m_pArchivingDriver->waitForLoad();
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::load(const std::string& sSource, bool bFile, bool bAsync)
+	{
+		endSave();
+		unsigned long long ullStart = m_pStats ? ArchiveStats::now() : 0;
+		bool bLoaded = false;
+		if (m_pArchivingDriver && bFile)
+			bLoaded = bAsync ? m_pArchivingDriver->loadFromFileAsync(sSource) : m_pArchivingDriver->loadFromFile(sSource);
+		else if (m_pArchivingDriver)
+			bLoaded = bAsync ? m_pArchivingDriver->loadFromStringAsync(sSource) : m_pArchivingDriver->loadFromString(sSource);
+		if (m_pStats)
+		{
+			m_pStats->addTime(ArchiveStats::kParse, ullStart);
+			if (bLoaded)
+				m_pStats->count(ArchiveStats::kBytesRead, bFile ? ArchiveStats::getFileSize(sSource) : sSource.size());
+		}
+
+		forgetObjects();
+		if (bLoaded)
 		{
 			m_pScope = NULL;
 			pushScope(m_pArchivingDriver->getRootNode());
 			return true;
 		}
-		m_sSource = sData;
+		reset(); // the driver may have dropped its previous root node
+		m_sSource = sSource;
 		return false;
 	}
 
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::openOutput(const std::string& sPath)
+	{
+		endSave();
+		if (!m_pArchivingDriver || !m_pArchivingDriver->openOutput(sPath))
+			return false;
+
+		reset();
+		return true;
+	}
+
 	template <class T_IArchivingDriver>
 	bool KeyValueArchive<T_IArchivingDriver>::save(std::string sPath="")
 	{
 		assert(m_pArchivingDriver != NULL && "Attempt to save unloaded archive!");
-		return m_pArchivingDriver->save(sPath);
+		endSave();
+		serializeDirty();
+		if (!m_pStats)
+			return m_pArchivingDriver->save(sPath);
+
+		unsigned long long ullStart = ArchiveStats::now();
+		bool bSaved = m_pArchivingDriver->save(sPath);
+		m_pStats->addTime(ArchiveStats::kWrite, ullStart);
+		if (bSaved && sPath.length())
+			m_pStats->count(ArchiveStats::kBytesWritten, ArchiveStats::getFileSize(sPath));
+		return bSaved;
+	}
+
+	template <class T_IArchivingDriver>
+	AsyncSave& KeyValueArchive<T_IArchivingDriver>::saveAsync(std::string sPath, AsyncSave::IListener *pListener)
+	{
+		assert(m_pArchivingDriver != NULL && "Attempt to save unloaded archive!");
+		endSave();
+		serializeDirty();
+
+		// Only taking the snapshot keeps the caller waiting
+		unsigned long long ullStart = m_pStats ? ArchiveStats::now() : 0;
+		m_pSave = new AsyncSave(m_pArchivingDriver->createSnapshot(sPath), pListener);
+		if (m_pStats)
+			m_pStats->addTime(ArchiveStats::kWrite, ullStart);
+		return *m_pSave;
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::waitForSave()
+	{
+		return m_pSave ? m_pSave->wait() : true;
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::endSave()
+	{
+		delete m_pSave;
+		m_pSave = NULL;
 	}
 
 	template <class T_IArchivingDriver>
@@ -360,54 +1124,74 @@ namespace Archiving
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setBool(bool bBool, const std::string& sKey)
 	{
-		getSubNode(sKey, "bool")->setValue(boost::lexical_cast<std::string>(bBool));
+		INode *pNode = getSubNode(sKey, SymbolTable::kBool);
+		ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+		m_sValue = bBool ? "1" : "0";
+		NodeCalls::setValue(pNode, m_sValue);
 	}
 
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setChar(char cChar, const std::string& sKey)
 	{
-		getSubNode(sKey, "char")->setValue(boost::lexical_cast<std::string>(cChar));
+		INode *pNode = getSubNode(sKey, SymbolTable::kChar);
+		ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+		m_sValue.assign(1, cChar);
+		NodeCalls::setValue(pNode, m_sValue);
 	}
 
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setShort(short sShort, const std::string& sKey)
 	{
-		getSubNode(sKey, "short")->setValue(boost::lexical_cast<std::string>(sShort));
+		setNumber((long)sShort, sKey, SymbolTable::kShort);
 	}
 
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setInt(int iInt, const std::string& sKey)
 	{
-		getSubNode(sKey, "int")->setValue(boost::lexical_cast<std::string>(iInt));
+		setNumber((long)iInt, sKey, SymbolTable::kInt);
 	}
 
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setLong(long lLong, const std::string& sKey)
 	{
-		getSubNode(sKey, "long")->setValue(boost::lexical_cast<std::string>(lLong));
+		setNumber(lLong, sKey, SymbolTable::kLong);
 	}
 
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setFloat(float fFloat, const std::string& sKey)
 	{
-		getSubNode(sKey, "float")->setValue(boost::lexical_cast<std::string>(fFloat));
+		setNumber(fFloat, sKey, SymbolTable::kFloat);
 	}
 
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setDouble(double dDouble, const std::string& sKey)
 	{
-		getSubNode(sKey, "double")->setValue(boost::lexical_cast<std::string>(dDouble));
+		setNumber(dDouble, sKey, SymbolTable::kDouble);
 	}
 
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setObject(IArchivableObject* pObject, const std::string& sKey)
 	{
+		if (m_pStats)
+		{
+			setObjectTimed(pObject, sKey);
+			return;
+		}
+
+		Symbol ulClass = m_pArchivingDriver->getSymbols().getClassSymbol(pObject);
+		if (m_pReferences && setReference(pObject, sKey, ulClass))
+			return;
+
 		if (m_pDelegate != NULL)
 			if(!m_pDelegate->preSerializeObject(pObject))
 				return;
 
-		INode *temp_node= getSubNode(sKey, pObject->getClassName());
+		INode *temp_node= getSubNode(sKey, ulClass);
 		assert(temp_node != NULL);
+		if (m_pObjects)
+			(*m_pObjects)[pObject] = temp_node;
+		if (m_pReferences)
+			recordReference(pObject, temp_node);
 		pushScope(temp_node);
 		pObject->serialize((ISerializer *)this);
 		popScope();
@@ -415,38 +1199,167 @@ namespace Archiving
 			m_pDelegate->afterSerializeObject(pObject);
 	}
 
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::setObjectTimed(IArchivableObject* pObject, const std::string& sKey)
+	{
+		Symbol ulClass = m_pArchivingDriver->getSymbols().getClassSymbol(pObject);
+		unsigned long long ullStart;
+
+		if (m_pReferences && setReference(pObject, sKey, ulClass))
+			return;
+
+		if (m_pDelegate != NULL)
+		{
+			ullStart = ArchiveStats::now();
+			bool bSerialize = m_pDelegate->preSerializeObject(pObject);
+			m_pStats->addDelegateTime(ulClass, ullStart);
+			if (!bSerialize)
+				return;
+		}
+
+		INode *temp_node= getSubNode(sKey, ulClass);
+		assert(temp_node != NULL);
+		if (m_pObjects)
+			(*m_pObjects)[pObject] = temp_node;
+		if (m_pReferences)
+			recordReference(pObject, temp_node);
+		pushScope(temp_node);
+		ArchiveStats::ObjectTimer aTimer;
+		m_pStats->beginObject(aTimer);
+		pObject->serialize((ISerializer *)this);
+		m_pStats->endObject(aTimer, ulClass, true);
+		popScope();
+
+		if (m_pDelegate != NULL)
+		{
+			ullStart = ArchiveStats::now();
+			m_pDelegate->afterSerializeObject(pObject);
+			m_pStats->addDelegateTime(ulClass, ullStart);
+		}
+	}
+
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setString(const std::string& sString, const std::string& sKey)
 	{
-		getSubNode(sKey, "string")->setValue(sString);
+		INode *pNode = getSubNode(sKey, SymbolTable::kString);
+		ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+		NodeCalls::setValue(pNode, sString);
 	}
 
 	template <class T_IArchivingDriver>
 	void KeyValueArchive<T_IArchivingDriver>::setArray(std::list<IArchivableObject*>& lList, const std::string& sKey)
+	{
+		setArrayItems(lList, sKey, NULL);
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::setArrayParallel(std::list<IArchivableObject*>& lList, const std::string& sKey, ArchiveExecutor& aExecutor)
+	{
+		setArrayItems(lList, sKey, &aExecutor);
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::setArrayItems(std::list<IArchivableObject*>& lList, const std::string& sKey, ArchiveExecutor *pExecutor)
 	{
 		if(!lList.size())
 			return;
 
 		INode *array_node = NULL;
-		pushScope(array_node = getSubNode(sKey, "array"));
-		unsigned long int_count = 0;
-		for(std::list<IArchivableObject*>::iterator list_iter = lList.begin(); list_iter != lList.end(); list_iter++)
+		pushScope(array_node = getSubNode(sKey, SymbolTable::kArray));
+		// The count is set before the items, streaming drivers can not add attributes after the content
+		char count_str[NumericCodec::kBufferSize];
+		NumericCodec::format((unsigned long)lList.size(), count_str);
+		NodeCalls::setAttribute(array_node, "count", count_str);
+
+		// Items of an array that is written again replace the old ones in place, fragments can only append
+		std::vector<KeyValueArchive*> lsFragments;
+		if (pExecutor && lList.size() > 1 && pExecutor->getSliceCount() > 1 && !NodeCalls::hasChildren(array_node))
+		{
+			IArchivingDriver *pFragment;
+			while (lsFragments.size() < pExecutor->getSliceCount() && (pFragment = m_pArchivingDriver->createFragment(array_node)))
+				lsFragments.push_back(new KeyValueArchive(*this, pFragment, pFragment->getRootNode()));
+		}
+
+		if (lsFragments.size() && lsFragments.size() == pExecutor->getSliceCount())
 		{
-			char temp_str[64];
-			sprintf(&temp_str[0], "item%lu", int_count++);
-			this->setObject((IArchivableObject*)(*list_iter), std::string(temp_str));
+			std::vector<IArchivableObject*> lsObjects(lList.begin(), lList.end());
+			ArrayWriteTask aTask(lsObjects, lsFragments);
+			try
+			{
+				pExecutor->execute(aTask, (unsigned long)lsObjects.size());
+				for (size_t i = 0; i < lsFragments.size(); ++i)
+					m_pArchivingDriver->appendFragment(array_node, lsFragments[i]->m_pArchivingDriver);
+			}
+			catch (...)
+			{
+				for (size_t i = 0; i < lsFragments.size(); ++i)
+					delete lsFragments[i];
+				popScope();
+				throw;
+			}
+
+			for (size_t i = 0; i < lsFragments.size(); ++i)
+				delete lsFragments[i];
+			popScope();
+			return;
 		}
-		array_node->setAttribute("count", boost::lexical_cast<std::string>((long)int_count));
+
+		for (size_t i = 0; i < lsFragments.size(); ++i)
+			delete lsFragments[i];
+
+		ArrayItemKey aKey;
+		unsigned long int_count = 0;
+		for(std::list<IArchivableObject*>::iterator list_iter = lList.begin(); list_iter != lList.end(); list_iter++)
+			this->setObject((IArchivableObject*)(*list_iter), aKey.get(int_count++));
 		popScope();
 	}
 
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::setPackedArray(Symbol ulArrayType, Symbol ulElementType, const void *pValues, unsigned long ulCount, const std::string& sKey)
+	{
+		INode *array_node = getSubNode(sKey, ulArrayType);
+		ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+		char count_str[NumericCodec::kBufferSize];
+		NumericCodec::format(ulCount, count_str);
+		NodeCalls::setAttribute(array_node, "count", count_str);
+		NodeCalls::setPackedValue(array_node, ulElementType, pValues, ulCount);
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::setIntArray(const int *pValues, unsigned long ulCount, const std::string& sKey)
+	{
+		setPackedArray(SymbolTable::kIntArray, SymbolTable::kInt, pValues, ulCount, sKey);
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::setLongArray(const long *pValues, unsigned long ulCount, const std::string& sKey)
+	{
+		setPackedArray(SymbolTable::kLongArray, SymbolTable::kLong, pValues, ulCount, sKey);
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::setFloatArray(const float *pValues, unsigned long ulCount, const std::string& sKey)
+	{
+		setPackedArray(SymbolTable::kFloatArray, SymbolTable::kFloat, pValues, ulCount, sKey);
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::setDoubleArray(const double *pValues, unsigned long ulCount, const std::string& sKey)
+	{
+		setPackedArray(SymbolTable::kDoubleArray, SymbolTable::kDouble, pValues, ulCount, sKey);
+	}
+
 	/** Deserializer Methods */
 	template <class T_IArchivingDriver>
 	bool KeyValueArchive<T_IArchivingDriver>::getBool(const std::string& sKey, ArchivingResult *bStatus)
 	{
-		INode *pTempNode = m_pScope->getChild(sKey, "bool");
-		if(verifyNode("bool", pTempNode, bStatus))
-			return pTempNode->getValue() == "1" || pTempNode->getValue() == "J" || boost::iequals(pTempNode->getValue(), "true" );
+		INode *pTempNode = lookupChild(sKey, SymbolTable::kBool);
+		if(verifyChild(SymbolTable::kBool, pTempNode, bStatus))
+		{
+			ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+			NodeCalls::getValue(pTempNode, m_sValue);
+			return NumericCodec::parseBool(m_sValue);
+		}
 		else
 			return false;
 	}
@@ -454,9 +1367,13 @@ namespace Archiving
 	template <class T_IArchivingDriver>
 	char KeyValueArchive<T_IArchivingDriver>::getChar(const std::string& sKey, ArchivingResult *bStatus)
 	{
-		INode *pTempNode = m_pScope->getChild(sKey, "char");
-		if (verifyNode("char", pTempNode, bStatus))
-			return (char)pTempNode->getValue().c_str()[0];
+		INode *pTempNode = lookupChild(sKey, SymbolTable::kChar);
+		if (verifyChild(SymbolTable::kChar, pTempNode, bStatus))
+		{
+			ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+			NodeCalls::getValue(pTempNode, m_sValue);
+			return (char)m_sValue.c_str()[0];
+		}
 		else
 			return (char)0;
 	}
@@ -464,71 +1381,257 @@ namespace Archiving
 	template <class T_IArchivingDriver>
 	short KeyValueArchive<T_IArchivingDriver>::getShort(const std::string& sKey, ArchivingResult *bStatus)
 	{
-		INode *pTempNode = m_pScope->getChild(sKey, "short");
-		if (verifyNode("short", pTempNode, bStatus))
-			return boost::lexical_cast<short>(pTempNode->getValue());
-		else
-			return (short)0;
+		return getNumber<short>(sKey, SymbolTable::kShort, bStatus);
 	}
 
 	template <class T_IArchivingDriver>
 	int KeyValueArchive<T_IArchivingDriver>::getInt(const std::string& sKey, ArchivingResult *bStatus)
 	{
-		INode *pTempNode = m_pScope->getChild(sKey, "int");
-		if (verifyNode("int", pTempNode, bStatus))
-			return boost::lexical_cast<int>(pTempNode->getValue());
-		else
-			return 0;
+		return getNumber<int>(sKey, SymbolTable::kInt, bStatus);
 	}
 
 	template <class T_IArchivingDriver>
 	long KeyValueArchive<T_IArchivingDriver>::getLong(const std::string& sKey, ArchivingResult *bStatus)
 	{
-		INode *pTempNode = m_pScope->getChild(sKey, "long");
-		if (verifyNode("long", pTempNode, bStatus))
-			return boost::lexical_cast<long>(pTempNode->getValue());
-		else
-			return 0l;
+		return getNumber<long>(sKey, SymbolTable::kLong, bStatus);
 	}
 
 	template <class T_IArchivingDriver>
 	float KeyValueArchive<T_IArchivingDriver>::getFloat(const std::string& sKey, ArchivingResult *bStatus)
 	{
-		INode *pTempNode = m_pScope->getChild(sKey, "float");
-		if (verifyNode("float", pTempNode, bStatus))
-			return boost::lexical_cast<float>(pTempNode->getValue());
-		else
-			return 0.0f;
+		return getNumber<float>(sKey, SymbolTable::kFloat, bStatus);
 	}
 
 	template <class T_IArchivingDriver>
 	double KeyValueArchive<T_IArchivingDriver>::getDouble(const std::string& sKey, ArchivingResult *bStatus)
 	{
-		INode *pTempNode = m_pScope->getChild(sKey, "double");
-		if (verifyNode("double", pTempNode, bStatus))
-			return boost::lexical_cast<double>(pTempNode->getValue());
-		else
-			return 0.0;
+		return getNumber<double>(sKey, SymbolTable::kDouble, bStatus);
+	}
+
+	template <class T_IArchivingDriver>
+	unsigned long KeyValueArchive<T_IArchivingDriver>::getPackedArray(Symbol ulArrayType, Symbol ulElementType, const std::string& sKey, void *pValues, unsigned long ulCapacity, ArchivingResult *bStatus)
+	{
+		INode *pTempNode = lookupChild(sKey, ulArrayType);
+		if (!verifyChild(ulArrayType, pTempNode, bStatus))
+			return 0;
+		return getPackedArray(pTempNode, ulElementType, pValues, ulCapacity);
+	}
+
+	template <class T_IArchivingDriver>
+	unsigned long KeyValueArchive<T_IArchivingDriver>::getPackedArray(INode *pArrayNode, Symbol ulElementType, void *pValues, unsigned long ulCapacity)
+	{
+		ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+		unsigned long ulCount;
+		if (!NumericCodec::parse(NodeCalls::getAttribute(pArrayNode, "count"), ulCount))
+			throw boost::bad_lexical_cast();
+		if (ulCount <= ulCapacity && !NodeCalls::getPackedValue(pArrayNode, ulElementType, pValues, ulCount))
+			throw boost::bad_lexical_cast();
+		return ulCount;
+	}
+
+	template <class T_IArchivingDriver>
+	unsigned long KeyValueArchive<T_IArchivingDriver>::getIntArray(const std::string& sKey, int *pValues, unsigned long ulCapacity, ArchivingResult *bStatus)
+	{
+		return getPackedArray(SymbolTable::kIntArray, SymbolTable::kInt, sKey, pValues, ulCapacity, bStatus);
+	}
+
+	template <class T_IArchivingDriver>
+	unsigned long KeyValueArchive<T_IArchivingDriver>::getLongArray(const std::string& sKey, long *pValues, unsigned long ulCapacity, ArchivingResult *bStatus)
+	{
+		return getPackedArray(SymbolTable::kLongArray, SymbolTable::kLong, sKey, pValues, ulCapacity, bStatus);
+	}
+
+	template <class T_IArchivingDriver>
+	unsigned long KeyValueArchive<T_IArchivingDriver>::getFloatArray(const std::string& sKey, float *pValues, unsigned long ulCapacity, ArchivingResult *bStatus)
+	{
+		return getPackedArray(SymbolTable::kFloatArray, SymbolTable::kFloat, sKey, pValues, ulCapacity, bStatus);
+	}
+
+	template <class T_IArchivingDriver>
+	unsigned long KeyValueArchive<T_IArchivingDriver>::getDoubleArray(const std::string& sKey, double *pValues, unsigned long ulCapacity, ArchivingResult *bStatus)
+	{
+		return getPackedArray(SymbolTable::kDoubleArray, SymbolTable::kDouble, sKey, pValues, ulCapacity, bStatus);
 	}
 
 	template <class T_IArchivingDriver>
 	bool KeyValueArchive<T_IArchivingDriver>::fillObject( const std::string& sKey, IArchivableObject*& pObject, ArchivingResult *bStatus /*= NULL*/ )
 	{
-		INode* pTempNode = m_pScope->getChild(sKey, pObject->getClassName());
+		INode* pTempNode = lookupChild(sKey, m_pArchivingDriver->getSymbols().getClassSymbol(pObject));
+		if (!pTempNode)
+		{
+			INode* pReference = lookupChild(sKey, SymbolTable::kReference);
+			if (pReference)
+				return fillReference(pReference, pObject, bStatus);
+		}
+		return fillObjectNode(pTempNode, pObject, bStatus);
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::createObject(const std::string& sKey, IArchivableObject*& pObject, const ClassRegistry::Class& aClass, ArchivingResult *bStatus, ClassRegistry::DestroyFunction *pDestroyObject)
+	{
+		if (pDestroyObject)
+			*pDestroyObject = NULL;
+
+		// The stored type decides the class, so the node is looked up before anything is created
+		INode *pCursor = m_pCursor;
+		INode *pTempNode = lookupChild(sKey, SymbolTable::kAnyType);
+		if (!pTempNode)
+			return verifyChild(SymbolTable::kAnyType, NULL, bStatus);
+
+		Symbol ulType = pTempNode->getTypeSymbol();
+		if (ulType == SymbolTable::kReference)
+			return fillReference(pTempNode, pObject, bStatus, &aClass, false, pDestroyObject);
+
+		ClassRegistry::DestroyFunction pDestroy = NULL;
+		IArchivableObject *pCreated = pObject = createInstance(ulType, aClass, pDestroy);
+		bool bFound;
+		try
+		{
+			if (!pCreated)
+				bFound = verifyChild(SymbolTable::kNone, pTempNode, bStatus);
+			else if (m_pArchivingDriver->getSymbols().getClassSymbol(pCreated) == ulType)
+				bFound = fillObjectNode(pTempNode, pObject, bStatus);
+			else
+			{
+				// Another type at the key: fillObject() looks for a node of the class, as getObject() always did
+				m_pCursor = pCursor;
+				bFound = fillObject(sKey, pObject, bStatus);
+			}
+		}
+		catch (...)
+		{
+			// The object that throws is not returned, so it is destroyed here like one that is not found
+			ClassRegistry::destroy(pCreated, pDestroy);
+			throw;
+		}
+
+		if (!bFound)
+			pObject = NULL;
+		if (pObject != pCreated)
+			ClassRegistry::destroy(pCreated, pDestroy);
+		else if (pDestroyObject)
+			*pDestroyObject = pDestroy;
+		return bFound;
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::getObjectInto(const std::string& sKey, IArchivableObject& aObject, ArchivingResult *bStatus)
+	{
+		IArchivableObject *pObject = &aObject;
+		INode* pTempNode = lookupChild(sKey, m_pArchivingDriver->getSymbols().getClassSymbol(pObject));
+		if (!pTempNode)
+		{
+			INode* pReference = lookupChild(sKey, SymbolTable::kReference);
+			if (pReference)
+				return fillReference(pReference, pObject, bStatus, NULL, true);
+		}
+		return fillObjectNode(pTempNode, pObject, bStatus, true);
+	}
+
+	template <class T_IArchivingDriver>
+	IArchivableObject* KeyValueArchive<T_IArchivingDriver>::createInstance(Symbol ulType, const ClassRegistry::Class& aClass, ClassRegistry::DestroyFunction& pDestroy)
+	{
+		// Classes registered since, or an ObjectPool uninstalled, replace what was looked up
+		long lGeneration = ClassRegistry::getGeneration();
+		if (lGeneration != m_lClassGeneration)
+		{
+			m_mapClasses.clear();
+			m_lClassGeneration = lGeneration;
+		}
 
-		if (pTempNode && getDelegate())
+		std::map<Symbol, ClassRegistry::Factory>::iterator it = m_mapClasses.find(ulType);
+		if (it == m_mapClasses.end())
+			it = m_mapClasses.insert(std::make_pair(ulType, ClassRegistry::find(m_pArchivingDriver->getSymbols().getString(ulType)))).first;
+
+		if (it->second.pCreate)
+		{
+			IArchivableObject *pObject = it->second.pCreate();
+			if (pObject && aClass.pAccepts(pObject))
+			{
+				pDestroy = it->second.pDestroy;
+				return pObject;
+			}
+			ClassRegistry::destroy(pObject, it->second.pDestroy);
+		}
+		pDestroy = NULL;
+		return aClass.pCreate();
+	}
+
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::fillObjectNode(INode *pTempNode, IArchivableObject*& pObject, ArchivingResult *bStatus, bool bInPlace)
+	{
+		SymbolTable& aSymbols = m_pArchivingDriver->getSymbols();
+		unsigned long long ullStart = 0;
+		std::string sPath;
+
+		if (pTempNode && m_pReferences && !bInPlace)
+		{
+			// The object may have been read through a reference before its own node came up
+			sPath = getReferencePath(pTempNode);
+			std::map<std::string, IArchivableObject*>::iterator it = m_pReferences->mapObjects.find(sPath);
+			if (it != m_pReferences->mapObjects.end())
+			{
+				pObject = it->second;
+				if (bStatus)
+					*bStatus = Found;
+				return true;
+			}
+		}
+
+		if (pTempNode && !bInPlace && getDelegate())
+		{
+			if (m_pStats)
+				ullStart = ArchiveStats::now();
 			pObject = getDelegate()->handleInstance(pObject);
+			if (m_pStats)
+				m_pStats->addDelegateTime(aSymbols.getClassSymbol(pObject), ullStart);
+		}
 
-		if (verifyNode(pObject->getClassName(), pTempNode, bStatus))
+		Symbol ulClass = aSymbols.getClassSymbol(pObject);
+		if (verifyChild(ulClass, pTempNode, bStatus))
 		{
+			if (m_pObjects)
+				(*m_pObjects)[pObject] = pTempNode;
+			// Registered before it is read, so the references of a cycle find it
+			if (m_pReferences && !bInPlace)
+				m_pReferences->mapObjects[sPath] = pObject;
 			pushScope(pTempNode);
-			pObject->deserialize((IDeserializer *)this);
+			try
+			{
+				if (m_pStats)
+				{
+					ArchiveStats::ObjectTimer aTimer;
+					m_pStats->beginObject(aTimer);
+					pObject->deserialize((IDeserializer *)this);
+					m_pStats->endObject(aTimer, ulClass, false);
+				}
+				else
+					pObject->deserialize((IDeserializer *)this);
+			}
+			catch (...)
+			{
+				// The caller may destroy the object, nothing may find it afterwards
+				popScope();
+				if (m_pObjects)
+					m_pObjects->erase(pObject);
+				if (m_pReferences && !bInPlace)
+					m_pReferences->mapObjects.erase(sPath);
+				throw;
+			}
 			popScope();
 
 			if (m_pDelegate != NULL)
 			{
+				if (m_pStats)
+					ullStart = ArchiveStats::now();
 				bool bDeserialize = m_pDelegate->afterDeserializeObject(pObject);
+				if (m_pStats)
+					m_pStats->addDelegateTime(ulClass, ullStart);
 				if(bDeserialize == false) {
+					if (m_pObjects)
+						m_pObjects->erase(pObject);
+					if (m_pReferences && !bInPlace)
+						m_pReferences->mapObjects.erase(sPath);
 					if(bStatus)
 						*bStatus = Denied;
 					return false;
@@ -541,25 +1644,64 @@ namespace Archiving
 			return false;
 	}
 
+	template <class T_IArchivingDriver>
+	bool KeyValueArchive<T_IArchivingDriver>::beginConcurrentRead(INode *pNode)
+	{
+		// An item of a concurrent read reads an array of its own, below the subtree that is prepared,
+		// and the symbols stay concurrent until the outer read ends
+		if (m_pArchivingDriver->getSymbols().isConcurrent())
+		{
+			++m_ulNestedReads;
+			return true;
+		}
+
+		if (!m_pArchivingDriver->prepareConcurrentReads(pNode))
+			return false;
+		m_pArchivingDriver->getSymbols().setConcurrent(true);
+		return true;
+	}
+
+	template <class T_IArchivingDriver>
+	void KeyValueArchive<T_IArchivingDriver>::endConcurrentRead()
+	{
+		if (m_ulNestedReads)
+			--m_ulNestedReads;
+		else
+			m_pArchivingDriver->getSymbols().setConcurrent(false);
+	}
+
+	template <class T_IArchivingDriver>
+	IDeserializer* KeyValueArchive<T_IArchivingDriver>::createCursor(INode *pScope)
+	{
+		return new KeyValueArchive(*this, m_pArchivingDriver, pScope);
+	}
+
 	template <class T_IArchivingDriver>
 	std::string KeyValueArchive<T_IArchivingDriver>::getString(const std::string& sKey, ArchivingResult *bStatus)
 	{
-		INode *pTempNode = m_pScope->getChild(sKey, "string");
-		if (verifyNode("string", pTempNode, bStatus))
-			return pTempNode->getValue();
+		INode *pTempNode = lookupChild(sKey, SymbolTable::kString);
+		if (verifyChild(SymbolTable::kString, pTempNode, bStatus))
+		{
+			ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kValue);
+			std::string sString;
+			NodeCalls::getValue(pTempNode, sString);
+			return sString;
+		}
 		else
 			return std::string("");
 	}
 
 	template <class T_IArchivingDriver>
-	INode* KeyValueArchive<T_IArchivingDriver>::getSubNode( const std::string& sKey, const std::string& sType )
+	INode* KeyValueArchive<T_IArchivingDriver>::getSubNode( const std::string& sKey, Symbol ulType )
 	{
-		INode* pNode = this->m_pScope->getChild(sKey, sType);
+		INode* pNode = lookupChild(sKey, ulType, false);
 
-		if(!pNode || (pNode && pNode->getAttribute("type") != sType))
+		if(!pNode || pNode->getTypeSymbol() != ulType)
 		{
-			pNode = this->m_pScope->addChild(sKey);
-			pNode->setAttribute("type", sType);
+			pNode = NodeCalls::addChild(m_pScope, sKey);
+			if (m_pStats)
+				m_pStats->count(ArchiveStats::kNodesCreated);
+			NodeCalls::setAttribute(pNode, "type", m_pArchivingDriver->getSymbols().getString(ulType));
 		}
 		return pNode;
 	}
@@ -588,15 +1730,22 @@ namespace Archiving
 			m_pScope = NULL;
 			pushScope(m_pArchivingDriver->getRootNode());
 		}
+		forgetObjects();
 	}
 
 	/* Method: getArchiveString()
 	 * Return: Returns the archives serialized string.
 	 */
 	template <class T_IArchivingDriver>
-	std::wstring KeyValueArchive<T_IArchivingDriver>::getArchiveString()
+	std::string KeyValueArchive<T_IArchivingDriver>::getArchiveString()
 	{
-		return m_pArchivingDriver->getString();
+		if (!m_pStats)
+			return m_pArchivingDriver->getString();
+
+		ArchiveStats::PhaseTimer aTimer(m_pStats, ArchiveStats::kWrite);
+		std::string sData = m_pArchivingDriver->getString();
+		m_pStats->count(ArchiveStats::kBytesWritten, sData.size());
+		return sData;
 	}
 
 	/** Scope */
@@ -605,12 +1754,15 @@ namespace Archiving
 	{
 		if (!(m_pScope = pNode) )
 			throw(std::runtime_error("error pushing NULL scope!"));
+		m_pCursor = NULL;
 		return m_pScope;
 	}
 
 	template <class T_IArchivingDriver>
 	INode *KeyValueArchive<T_IArchivingDriver>::popScope()
 	{
+		// The cursor continues behind the child that is left
+		m_pCursor = m_pScope;
 		if (!(m_pScope = m_pScope->getParent()))
 			throw(std::runtime_error("error popping NULL scope!"));
 		return m_pScope;
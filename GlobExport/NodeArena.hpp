@@ -0,0 +1,158 @@
+#ifndef _NODEARENA_HPP_
+#define _NODEARENA_HPP_
+
+#include <string>
+#include <cstring>
+#include "SymbolTable.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+namespace Archiving
+{
+	class INode;
+
+	/**
+	 * Monotonic allocator for the nodes of one archive, together with their child indexes and strings.
+	 * Memory is taken from large blocks and never given back one by one: release() frees everything
+	 * allocated since the last release at once. Each driver owns an arena, see IArchivingDriver::getArena().
+	 */
+	class ARCHIVEUTIL_API NodeArena
+	{
+	public:
+		NodeArena();
+		~NodeArena();
+
+		/** Returns nSize bytes aligned for any type, valid until release(). */
+		void* allocate(size_t nSize)
+		{
+			nSize = (nSize + kAlignment - 1) & ~(kAlignment - 1);
+			if ((size_t)(m_pEnd - m_pPos) < nSize)
+				addBlock(nSize);
+
+			void *pResult = m_pPos;
+			m_pPos += nSize;
+			m_nAllocated += nSize;
+			return pResult;
+		}
+
+		/** Copies the string into the arena and terminates it. */
+		const char* copyString(const char *pData, size_t nLength)
+		{
+			char *pCopy = allocateString(nLength);
+			memcpy(pCopy, pData, nLength);
+			return pCopy;
+		}
+
+		/** Allocates nLength bytes for a string and terminates them. */
+		char* allocateString(size_t nLength)
+		{
+			char *pString = (char *)allocate(nLength + 1);
+			pString[nLength] = 0;
+			return pString;
+		}
+
+		/** Frees all allocations. The largest block is kept for reuse. */
+		void release();
+
+		/** Takes over the blocks of aOther, which is left empty. Their allocations stay valid until this arena is released. */
+		void adopt(NodeArena& aOther);
+
+		/** Bytes handed out since the last release. */
+		size_t getAllocatedSize() const {return m_nAllocated;}
+
+	protected:
+		static const size_t kAlignment = 8;
+		static const size_t kFirstBlockSize = 64 * 1024;
+		static const size_t kMaxBlockSize = 16 * 1024 * 1024;
+
+		struct Block
+		{
+			Block *pNext;
+			size_t nSize;
+		};
+
+		/** Starts a new block that can hold at least nSize bytes. */
+		void addBlock(size_t nSize);
+
+		Block *m_pBlocks;         /** The current block first. */
+		char *m_pPos;
+		char *m_pEnd;
+		size_t m_nNextBlockSize;
+		size_t m_nAllocated;
+
+	private:
+		NodeArena(const NodeArena&);
+		NodeArena& operator=(const NodeArena&);
+	};
+
+	/**
+	 * String stored in a NodeArena. Copying only copies the pointer, so nodes can share the strings of an arena.
+	 */
+	class ArenaString
+	{
+	public:
+		ArenaString() : m_pData(""), m_nLength(0) {;}
+		ArenaString(NodeArena& aArena, const std::string& sString) : m_pData(aArena.copyString(sString.data(), sString.length())), m_nLength(sString.length()) {;}
+		ArenaString(NodeArena& aArena, const char *pData, size_t nLength) : m_pData(aArena.copyString(pData, nLength)), m_nLength(nLength) {;}
+
+		/** Allocates a terminated string of nLength bytes that the caller fills in through pData. */
+		ArenaString(NodeArena& aArena, size_t nLength, char*& pData) : m_pData(pData = aArena.allocateString(nLength)), m_nLength(nLength) {;}
+
+		const char* data() const {return m_pData;}
+		size_t length() const {return m_nLength;}
+		std::string str() const {return std::string(m_pData, m_nLength);}
+
+		bool equals(const char *pData, size_t nLength) const {return m_nLength == nLength && memcmp(m_pData, pData, nLength) == 0;}
+		bool operator==(const std::string& sString) const {return equals(sString.data(), sString.length());}
+		bool operator==(const ArenaString& aString) const {return m_pData == aString.m_pData || equals(aString.m_pData, aString.m_nLength);}
+
+	protected:
+		const char *m_pData;
+		size_t m_nLength;
+	};
+
+	/**
+	 * Hash index from a symbol to a pointer, allocated from a NodeArena.
+	 * Inserting a symbol again replaces the pointer stored for it. Lookups never change the index.
+	 */
+	class ARCHIVEUTIL_API SymbolIndex
+	{
+	public:
+		SymbolIndex() : m_pEntries(NULL), m_ulCapacity(0), m_ulCount(0) {;}
+
+		void* find(Symbol ulKey) const;
+		void insert(NodeArena& aArena, Symbol ulKey, void *pValue);
+		unsigned long size() const {return m_ulCount;}
+
+	protected:
+		struct Entry
+		{
+			Symbol ulKey;         /** SymbolTable::kNone for an empty entry. */
+			void *pValue;
+		};
+
+		/** Returns the entry for the key, or the empty entry where it belongs. */
+		Entry* lookup(Symbol ulKey) const;
+
+		Entry *m_pEntries;
+		unsigned long m_ulCapacity;  /** Power of two, 0 before the first insert. */
+		unsigned long m_ulCount;
+	};
+
+	/**
+	 * Index from the symbol of a tag name to the child node.
+	 * As with the former std::map, inserting a name again replaces the node stored for it.
+	 */
+	class ChildIndex : public SymbolIndex
+	{
+	public:
+		INode* find(Symbol ulKey) const {return (INode *)SymbolIndex::find(ulKey);}
+		void insert(NodeArena& aArena, Symbol ulKey, INode *pNode) {SymbolIndex::insert(aArena, ulKey, pNode);}
+	};
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef _NUMERICCODEC_HPP_
+#define _NUMERICCODEC_HPP_
+
+#include <string>
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+namespace Archiving
+{
+	/**
+	 * Conversion of the primitive values to and from their text in the archive, independent of the locale.
+	 * Floats and doubles are written with the fewest digits that read back to the same value (Grisu2),
+	 * integers are formatted and parsed directly. Formatting writes into a buffer of the caller and
+	 * parsing reads the string in place, neither allocates.
+	 */
+	class ARCHIVEUTIL_API NumericCodec
+	{
+	public:
+		/** Size of a buffer that holds every formatted value, including the terminating 0. */
+		enum {kBufferSize = 32};
+
+		/**
+		 * Formats the value into pBuffer, which must hold kBufferSize characters, and terminates it.
+		 * @return The length of the text.
+		 */
+		static size_t format(long lValue, char *pBuffer);
+		static size_t format(unsigned long ulValue, char *pBuffer);
+		static size_t format(float fValue, char *pBuffer);
+		static size_t format(double dValue, char *pBuffer);
+
+		/**
+		 * Parses the whole text as a number: an optional sign and digits, for floating point numbers also
+		 * a fraction, an exponent, "inf" or "nan". Leading or trailing spaces are not allowed.
+		 * @return False if the text is no such number or out of the range of the type, the value is unchanged then.
+		 */
+		static bool parse(const std::string& sText, short& nValue);
+		static bool parse(const std::string& sText, int& iValue);
+		static bool parse(const std::string& sText, long& lValue);
+		static bool parse(const std::string& sText, unsigned long& ulValue);
+		static bool parse(const std::string& sText, float& fValue);
+		static bool parse(const std::string& sText, double& dValue);
+
+		/** Formats the values separated by spaces, the text encoding of packed arrays. sText is replaced. */
+		static void formatArray(const int *pValues, unsigned long ulCount, std::string& sText);
+		static void formatArray(const long *pValues, unsigned long ulCount, std::string& sText);
+		static void formatArray(const float *pValues, unsigned long ulCount, std::string& sText);
+		static void formatArray(const double *pValues, unsigned long ulCount, std::string& sText);
+
+		/**
+		 * Parses exactly ulCount values separated by white space into pValues, in a single pass over the text
+		 * without copying the numbers out of it.
+		 * @return False if the text holds fewer or more values, or one is no number of the type.
+		 */
+		static bool parseArray(const std::string& sText, int *pValues, unsigned long ulCount);
+		static bool parseArray(const std::string& sText, long *pValues, unsigned long ulCount);
+		static bool parseArray(const std::string& sText, float *pValues, unsigned long ulCount);
+		static bool parseArray(const std::string& sText, double *pValues, unsigned long ulCount);
+
+		/** Returns true for "1", "J" and "true" in any case, as the archive always has. */
+		static bool parseBool(const std::string& sText);
+	};
+
+	/**
+	 * The keys of the items of an array, "item" followed by the index. Every path that writes or reads array
+	 * items takes its keys from here, so they always agree. The key is formatted into a reused string.
+	 */
+	class ArrayItemKey
+	{
+	public:
+		ArrayItemKey() : m_sKey("item") {;}
+
+		/** The key of the item at ulIndex, valid until the next call. */
+		const std::string& get(unsigned long ulIndex)
+		{
+			char aIndex[NumericCodec::kBufferSize];
+			m_sKey.replace(4, std::string::npos, aIndex, NumericCodec::format(ulIndex, aIndex));
+			return m_sKey;
+		}
+
+	protected:
+		std::string m_sKey;
+	};
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef _OBJECTPOOL_HPP_
+#define _OBJECTPOOL_HPP_
+
+#include <new>
+#include <string>
+#include "ClassRegistry.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+namespace boost
+{
+	class mutex;
+}
+
+namespace Archiving
+{
+	/**
+	 * Slots of one size that are recycled instead of freed.
+	 * Slots are taken from blocks of ulBlockSlots each, released slots are handed out again first,
+	 * and the blocks are freed with the pool. The pool is locked, so cursors of getArrayParallel()
+	 * can take slots from several threads.
+	 */
+	class ARCHIVEUTIL_API SlotPool
+	{
+	public:
+		SlotPool(size_t nSlotSize, unsigned long ulBlockSlots);
+		~SlotPool();
+
+		/** A slot of the size of the pool, aligned for any type. */
+		void* allocate();
+
+		/** Gives a slot of allocate() back to the pool. */
+		void free(void *pSlot);
+
+		/** The slots handed out and not given back. */
+		unsigned long getUsedCount() const {return m_ulUsed;}
+
+		/** The slots of all blocks. */
+		unsigned long getSlotCount() const {return m_ulSlots;}
+
+	protected:
+		static const size_t kAlignment = 8;
+
+		struct Block
+		{
+			Block *pNext;
+		};
+
+		struct FreeSlot
+		{
+			FreeSlot *pNext;
+		};
+
+		size_t m_nSlotSize;
+		unsigned long m_ulBlockSlots;
+		Block *m_pBlocks;
+		FreeSlot *m_pFree;
+		unsigned long m_ulUsed;
+		unsigned long m_ulSlots;
+		boost::mutex *m_pMutex;
+
+	private:
+		SlotPool(const SlotPool&);
+		SlotPool& operator=(const SlotPool&);
+	};
+
+	/**
+	 * Pool of the objects of T_Class that getObject() and getArray() read, for archives that are read again and again.
+	 * install() registers T_Class with the ClassRegistry under its class name, with functions that construct
+	 * the objects in slots of the pool, so every object of that class stored in an archive is read into one.
+	 * The objects the archive returns are given back with release() instead of delete.
+	 *
+	 * The pool must be installed before the archives read that class, and outlive the objects and the archives.
+	 * Only one pool of a class can be installed, uninstall() restores the registration it replaced.
+	 */
+	template <class T_Class>
+	class ObjectPool : public SlotPool
+	{
+	public:
+		ObjectPool(unsigned long ulBlockSlots = 64) : SlotPool(sizeof(T_Class), ulBlockSlots), m_bInstalled(false) {;}
+		~ObjectPool() {uninstall();}
+
+		T_Class* create()
+		{
+			void *pSlot = allocate();
+			try
+			{
+				return new (pSlot) T_Class();
+			}
+			catch (...)
+			{
+				free(pSlot);
+				throw;
+			}
+		}
+
+		void release(T_Class *pObject)
+		{
+			if (!pObject)
+				return;
+			pObject->~T_Class();
+			free(pObject);
+		}
+
+		void install()
+		{
+			if (m_bInstalled)
+				return;
+			T_Class aPrototype;
+			m_sName = aPrototype.getClassName();
+			m_aReplaced = ClassRegistry::find(m_sName);
+			s_pInstalled = this;
+			m_bInstalled = true;
+			ClassRegistry::registerClass(m_sName, &createInstalled, &releaseInstalled);
+		}
+
+		void uninstall()
+		{
+			if (!m_bInstalled)
+				return;
+			if (m_aReplaced.pCreate)
+				ClassRegistry::registerClass(m_sName, m_aReplaced.pCreate, m_aReplaced.pDestroy);
+			else
+				ClassRegistry::unregisterClass(m_sName);
+			s_pInstalled = NULL;
+			m_bInstalled = false;
+		}
+
+	protected:
+		static IArchivableObject* createInstalled() {return s_pInstalled->create();}
+		static void releaseInstalled(IArchivableObject *pObject) {s_pInstalled->release(static_cast<T_Class*>(pObject));}
+
+		static ObjectPool *s_pInstalled;
+		std::string m_sName;
+		ClassRegistry::Factory m_aReplaced;
+		bool m_bInstalled;
+	};
+
+	template <class T_Class> ObjectPool<T_Class>* ObjectPool<T_Class>::s_pInstalled = NULL;
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef _SYMBOLTABLE_HPP_
+#define _SYMBOLTABLE_HPP_
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <map>
+#include <typeinfo>
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+namespace boost
+{
+	class mutex;
+}
+
+namespace Archiving
+{
+	class IArchivableObject;
+
+	/** Id of a string interned in a SymbolTable. Equal strings have equal symbols within one table. */
+	typedef unsigned long Symbol;
+
+	/**
+	 * Interns the keys, type names and class names of one archive, so that lookups and type checks
+	 * compare integers instead of strings. Each driver owns a table, see IArchivingDriver::getSymbols().
+	 * Symbols are never removed; the table only grows by the distinct names of the archive.
+	 *
+	 * The table is not synchronized, except in concurrent mode, see setConcurrent().
+	 */
+	class ARCHIVEUTIL_API SymbolTable
+	{
+	public:
+		/** Symbols that exist in every table. */
+		enum
+		{
+			kNone = 0,      /** No symbol, returned by find() for unknown strings. */
+			kEmpty,         /** "" */
+			kAnyType,       /** "*", matches every type in INode::getChild() */
+			kBool,
+			kChar,
+			kShort,
+			kInt,
+			kLong,
+			kFloat,
+			kDouble,
+			kString,
+			kArray,
+			kIntArray,      /** "int[]", packed arrays of primitives */
+			kLongArray,
+			kFloatArray,
+			kDoubleArray,
+			kReference      /** "ref", objects stored again by KeyValueArchive::trackReferences() */
+		};
+
+		SymbolTable();
+		~SymbolTable();
+
+		/** Returns the symbol of the string, adding it if it is new. In concurrent mode new strings are not added but give kNone. */
+		Symbol intern(const char *pString, size_t nLength);
+		Symbol intern(const std::string& sString) {return intern(sString.data(), sString.length());}
+
+		/** Returns the symbol of the string, or kNone without adding it. */
+		Symbol find(const char *pString, size_t nLength) const;
+		Symbol find(const std::string& sString) const {return find(sString.data(), sString.length());}
+
+		/** The string of a symbol. The reference stays valid as long as the table. */
+		const std::string& getString(Symbol ulSymbol) const {return m_lsStrings[ulSymbol];}
+
+		/**
+		 * Returns the symbol of pObject->getClassName(), which is called only once per class.
+		 * getClassName() must therefore depend on the class alone, as IArchivableObject requires.
+		 * In concurrent mode this is kNone for a class whose name is not in the table yet.
+		 */
+		Symbol getClassSymbol(const IArchivableObject *pObject);
+
+		/**
+		 * In concurrent mode several threads may read the table at once: no strings are added, which
+		 * keeps find() and getString() free of writes, and getClassSymbol() locks its class cache.
+		 * A string that is not in the table can not be the name of a node that was resolved before,
+		 * so kNone for it does not change the result of a lookup.
+		 * Only switch the mode while no other thread uses the table.
+		 */
+		void setConcurrent(bool bConcurrent) {m_bConcurrent = bConcurrent;}
+		bool isConcurrent() const {return m_bConcurrent;}
+
+		unsigned long size() const {return (unsigned long)m_lsStrings.size();}
+
+	protected:
+		struct Entry
+		{
+			unsigned long ulHash;
+			Symbol ulSymbol;        /** kNone for an empty entry. */
+		};
+
+		static unsigned long hash(const char *pString, size_t nLength);
+
+		/** Returns the entry for the string, or the empty entry where it belongs. */
+		const Entry* lookup(const char *pString, size_t nLength, unsigned long ulHash) const;
+
+		std::deque<std::string> m_lsStrings;                 /** Indexed by symbol, a deque keeps the references stable. */
+		std::vector<Entry> m_lsEntries;                      /** Open addressing, the size is a power of two. */
+		std::map<const std::type_info*, Symbol> m_mapClasses; /** Class symbols by type, see getClassSymbol(). */
+		boost::mutex *m_pClassMutex;                         /** Guards m_mapClasses in concurrent mode. */
+		bool m_bConcurrent;
+
+	private:
+		SymbolTable(const SymbolTable&);
+		SymbolTable& operator=(const SymbolTable&);
+	};
+}
+
+#endif
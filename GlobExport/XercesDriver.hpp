@@ -2,6 +2,8 @@
 #define _XERCESDRIVER_HPP_
 
 #include "IArchivingDriver.hpp"
+#include "DriverTraits.hpp"
+#include "XercesNode.hpp"
 #include <xercesc\util\XercesDefs.hpp>
 
 #ifdef ARCHIVEUTIL_EXPORTS
@@ -37,12 +39,18 @@ namespace Archiving
 			unsigned long m_DOMErrorCount;
 			bool m_bIsLoad;
 
+			/** Deletes the node wrappers and releases the document unless the parser owns it. */
+			void releaseDocument();
+
 		public:
 			/** Init */
 			virtual void init();
 
 			/** Load/Write */
 			virtual bool save(std::string sFile = "");
+
+			/** Clones the document, which the saving thread writes. */
+			virtual Snapshot* createSnapshot(std::string sFile);
 			virtual bool loadFromFile(const std::string& sFile);
 			virtual bool loadFromString(const std::string& sData);
 			virtual void reset();
@@ -55,6 +63,9 @@ namespace Archiving
 			virtual bool getIsLoad();
 		};
 	}
+
+	/** Every element is wrapped in a Xerces::Node. */
+	template <> struct DriverTraits<Xerces::Driver> {typedef StaticNodeCalls<Xerces::Node> NodeCalls;};
 }
 
 #endif
\ No newline at end of file
@@ -41,9 +41,12 @@ namespace Archiving
 			virtual std::string getAttribute(const std::string& sKey);
 			virtual void setAttribute(const std::string& sKey, const std::string& sValue);
 			virtual std::string getValue();
-			virtual void setValue(std::string sValue);
+			virtual void getValue(std::string& sValue);
+			virtual void setValue(const std::string& sValue);
 			virtual INode* getChild(const std::string& sKey, const std::string& sType="*");
+			virtual INode* getChild(const std::string& sKey, Symbol ulType);
 			virtual INode* addChild(const std::string& sKey);
+			virtual INode* getNextChild(INode *pChild, const std::string& sKey);
 
 			/** Xerces specific methods */
 			xercesc::DOMElement *getDOMElement();
@@ -52,6 +55,13 @@ namespace Archiving
 		protected:
 			xercesc::DOMElement *m_pElement;
 			xercesc::DOMDocument *m_pDocument;
+			std::string m_sTagName;         /** Transcoded on first use, empty until then. */
+			std::string m_sType;            /** The "type" attribute, valid if m_bHasType. */
+			bool m_bHasType;
+			SymbolIndex m_aElements;        /** Tag name -> DOM element of the children, built by the first lookup. */
+			bool m_bElementsIndexed;
+
+			void indexElements();
 		};
 	}
 }
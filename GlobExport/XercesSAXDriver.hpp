@@ -0,0 +1,107 @@
+#ifndef _XERCESSAXDRIVER_HPP_
+#define _XERCESSAXDRIVER_HPP_
+
+#include <vector>
+#include "IArchivingDriver.hpp"
+#include "DriverTraits.hpp"
+#include "XercesSAXNode.hpp"
+#include <xercesc\util\XercesDefs.hpp>
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+XERCES_CPP_NAMESPACE_BEGIN
+class SAX2XMLReader;
+class XMLPScanToken;
+class InputSource;
+class Attributes;
+XERCES_CPP_NAMESPACE_END
+
+class KeyValueArchive;
+class INode;
+
+namespace Archiving
+{
+	namespace Xerces
+	{
+		class SAXNode;
+		class SAXHandler;
+
+		/**
+		 * Read-only, forward-only driver for XML archives written by Xerces::Driver.
+		 * Instead of parsing the file into a DOM, the driver runs a progressive SAX parse and only advances
+		 * the parser when a node is asked for something that has not been parsed yet. Reading the keys in the
+		 * order they were written keeps one node per nesting level in memory, see SAXNode for the handling of
+		 * keys read out of order.
+		 *
+		 * Since the parse only moves forward, every key of an object should be read while the object is the
+		 * current scope. The setters of the archive throw, save() fails and getString() returns an empty string.
+		 */
+		class ARCHIVEUTIL_API SAXDriver : public IArchivingDriver
+		{
+			friend class SAXNode;
+			friend class SAXHandler;
+
+		public:
+			SAXDriver();
+			virtual ~SAXDriver();
+
+		protected:
+			xercesc::SAX2XMLReader *m_pParser;
+			xercesc::XMLPScanToken *m_pToken;
+			xercesc::InputSource *m_pSource;      /** Input of loadFromString(), must live as long as the parse. */
+			SAXHandler *m_pHandler;
+			std::string m_sData;                  /** Copy of the data given to loadFromString(). */
+			SAXNode *m_pRootNode;
+			std::vector<SAXNode*> m_lsOpenNodes;  /** Started but unfinished elements, the innermost last. */
+			unsigned long m_ulSkipDepth;          /** Nesting depth inside a skipped element. */
+			bool m_bParsing;                      /** The parser has more input. */
+			unsigned long m_ulErrorCount;
+			bool m_bIsLoad;
+
+			/**
+			 * Starts the progressive parse of the file pSystemId, or of m_pSource if pSystemId is NULL,
+			 * and reads up to the start of the root element.
+			 */
+			bool open(const char *pSystemId);
+
+			/** Stops the parse and drops the root node. */
+			void close();
+
+			/** Advances the parser by one token. @return False at the end of the input or on an error. */
+			bool parseNext();
+
+			/** Parser callbacks */
+			void onStartElement(const XMLCh *pName, const xercesc::Attributes& aAttributes);
+			void onEndElement();
+			void onCharacters(const XMLCh *pChars, unsigned int nLength);
+
+		public:
+			/** Init */
+			virtual void init();
+
+			/** Load/Write */
+			virtual bool save(std::string sFile = "");
+			virtual Snapshot* createSnapshot(std::string sFile) {throw(std::runtime_error("the driver can not save!"));}
+			virtual bool loadFromFile(const std::string& sFile);
+			virtual bool loadFromString(const std::string& sData);
+			virtual void reset();
+
+			virtual std::string getString();
+
+			/** Accessors */
+			virtual INode* getRootNode();
+			virtual unsigned long getErrorCount();
+			virtual bool getIsLoad();
+			virtual bool keepsNodes() {return false;}
+		};
+	}
+
+	/** Live and buffered nodes are both SAXNode, only their mode differs. */
+	template <> struct DriverTraits<Xerces::SAXDriver> {typedef StaticNodeCalls<Xerces::SAXNode> NodeCalls;};
+}
+
+#endif
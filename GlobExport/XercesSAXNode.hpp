@@ -0,0 +1,96 @@
+#ifndef _XERCESSAXNODE_HPP_
+#define _XERCESSAXNODE_HPP_
+
+#include <string>
+#include <vector>
+#include <map>
+#include "INode.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+#include "IInstanceCounter.hpp"
+
+namespace Archiving
+{
+	namespace Xerces
+	{
+		class SAXDriver;
+
+		/**
+		 * Element of an XML archive read by the SAXDriver.
+		 * A node is created when the parser reports the start of its element and is filled while the parser
+		 * moves through the element. Only the child that is currently being parsed is kept (the "current" child).
+		 *
+		 * getChild() pulls the parser forward until a child with the requested name starts. Children passed on
+		 * the way were never asked for, so they are read completely and buffered, where later lookups find them.
+		 * A current child that has already been returned is skipped without buffering when the parser moves on,
+		 * since the archive reads each key once. As long as keys are read in the order they were written, no
+		 * child is ever buffered and the number of nodes is bounded by the nesting depth.
+		 *
+		 * A returned node stays valid until its parent moves on to another child.
+		 */
+		class ARCHIVEUTIL_API SAXNode : public INode, public IInstanceCounter<SAXNode>
+		{
+			friend class SAXDriver;
+
+		public:
+			/** The way a node treats the content the parser reports for it. */
+			enum Mode
+			{
+				Live,       /** Children become the current child and are handed out by getChild(). */
+				Buffering,  /** Children are stored, the node is kept until its parent is deleted. */
+				Skipping    /** The remaining content is dropped. */
+			};
+
+		protected:
+			/** Con/Destructor */
+			SAXNode(SAXDriver *pDriver, SAXNode *pParentNode, const std::string& sName, Mode eMode);
+			virtual ~SAXNode();
+
+		public:
+			/** Interface methods */
+			virtual std::string getTagName();
+			virtual std::string getAttribute(const std::string& sKey);
+			virtual void setAttribute(const std::string& sKey, const std::string& sValue);
+			using INode::getValue;
+			virtual std::string getValue();
+			virtual void setValue(const std::string& sValue);
+			using INode::getChild;
+			virtual INode* getChild(const std::string& sKey, const std::string& sType="*");
+			virtual INode* addChild(const std::string& sKey);
+
+		protected:
+			typedef std::pair<std::string, std::string> Attribute;
+
+			/** Checks the type of a child found by getChild() against the requested type. */
+			static INode* matchType(SAXNode *pNode, const std::string& sType);
+
+			/** Reads the rest of the current child, buffers or drops it, and clears the current child. */
+			void finishCurrentChild();
+
+			/** Switches the node and its unfinished current children to the given mode. */
+			void setMode(Mode eMode);
+
+			/** Called by the driver when the parser reports a child element. */
+			void addParsedChild(SAXNode *pChild);
+
+			SAXDriver *m_pSAXDriver;
+			std::string m_sName;
+			std::string m_sValue;
+			std::vector<Attribute> m_lsAttributes;
+			Mode m_eMode;
+			bool m_bComplete;                         /** The end of the element has been parsed. */
+			bool m_bHasElements;                      /** A child element has been parsed, further text is ignored. */
+			bool m_bReturned;                         /** The node has been returned by getChild(). */
+			SAXNode *m_pCurrentChild;                 /** The child element the parser is in or has just left. */
+			std::vector<SAXNode*> m_lsBuffered;       /** Buffered children, in document order. */
+			std::map<std::string, SAXNode*> m_mapBuffered;
+		};
+	}
+}
+
+#endif
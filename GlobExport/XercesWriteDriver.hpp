@@ -0,0 +1,119 @@
+#ifndef _XERCESWRITEDRIVER_HPP_
+#define _XERCESWRITEDRIVER_HPP_
+
+#include <cstdio>
+#include <vector>
+#include "IArchivingDriver.hpp"
+#include "DriverTraits.hpp"
+#include "XercesWriteNode.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+class KeyValueArchive;
+class INode;
+
+namespace Archiving
+{
+	namespace Xerces
+	{
+		class WriteNode;
+
+		/**
+		 * Write-only driver that streams an XML archive to a file while it is being serialized.
+		 * No DOM is built: the elements are written through a fixed size buffer as setObject()/setArray()
+		 * recurse, so the memory used does not grow with the archive. The output is the same XML that
+		 * Xerces::Driver writes and can be loaded by Xerces::Driver and SAXDriver.
+		 *
+		 * openOutput() opens the file the archive is written to, save() without a path then only completes that
+		 * file. Without such a file the output goes to a temporary file once it outgrows the buffer, and save()
+		 * copies it to the given path. Nothing can be loaded, loadFromFile() fails and leaves the file alone.
+		 *
+		 * Since written elements can not be looked up, getChild() always returns NULL and every setter adds
+		 * a new element, even if the key has been used before.
+		 *
+		 * Fragments (see IArchivingDriver::createFragment()) buffer the elements written below the parent, at
+		 * its depth, and appendFragment() copies them to the output once the parent is the innermost open element.
+		 */
+		class ARCHIVEUTIL_API WriteDriver : public IArchivingDriver
+		{
+			friend class WriteNode;
+
+		public:
+			WriteDriver();
+			virtual ~WriteDriver();
+
+		protected:
+			FILE *m_pFile;                        /** The output file, NULL while everything fits into the buffer. */
+			std::string m_sPath;                  /** Path of m_pFile if it was opened by openOutput(). */
+			std::string m_sBuffer;
+			std::vector<WriteNode*> m_lsNodes;    /** One node per nesting level, see WriteNode. */
+			size_t m_nOpenElements;
+			size_t m_nBaseDepth;                  /** Depth of the root node, that of the parent for fragments. */
+			bool m_bStartTagOpen;                 /** The start tag of the innermost element still takes attributes. */
+			bool m_bFinished;                     /** All elements have been closed. */
+			unsigned long m_ulErrorCount;
+			bool m_bIsLoad;
+
+			/** Drops the output and starts a new document. */
+			void begin(FILE *pFile, const std::string& sPath);
+
+			/** Drops the output and continues below an open element at nDepth, which the root node stands in for. */
+			void beginFragment(size_t nDepth);
+
+			/** Closes the output file. */
+			void close();
+
+			/** Closes all elements and flushes the buffer. */
+			void finish();
+
+			/** Writes the complete document to pFile. */
+			bool copyTo(FILE *pFile);
+
+			/** Output */
+			void write(const char *pData, size_t nLength);
+			void write(const std::string& sData) {write(sData.data(), sData.length());}
+			/** Writes the text as UTF-8 with the XML escapes, control characters XML 1.0 can not take are errors. */
+			void writeEscaped(const std::string& sText, bool bAttribute);
+			void writeIndent(size_t nDepth);
+			void flush();
+
+			/** Element handling for the nodes */
+			WriteNode* startElement(size_t nDepth, const std::string& sName);
+			void closeElements(size_t nDepth);
+			void writeAttribute(WriteNode *pNode, const std::string& sKey, const std::string& sValue);
+			void writeValue(WriteNode *pNode, const std::string& sValue);
+
+		public:
+			/** Init */
+			virtual void init();
+
+			/** Load/Write */
+			virtual bool save(std::string sFile = "");
+			virtual bool loadFromFile(const std::string& sFile);
+			virtual bool loadFromString(const std::string& sData);
+			virtual bool openOutput(const std::string& sFile);
+			virtual void reset();
+
+			virtual std::string getString();
+
+			/** Accessors */
+			virtual INode* getRootNode();
+			virtual unsigned long getErrorCount();
+			virtual bool getIsLoad();
+			virtual bool keepsNodes() {return false;}
+
+			/** Parallel writes */
+			virtual IArchivingDriver* createFragment(INode *pParent);
+			virtual void appendFragment(INode *pParent, IArchivingDriver *pFragment);
+		};
+	}
+
+	/** Fragments write WriteNode as well. */
+	template <> struct DriverTraits<Xerces::WriteDriver> {typedef StaticNodeCalls<Xerces::WriteNode> NodeCalls;};
+}
+
+#endif
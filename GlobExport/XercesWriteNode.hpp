@@ -0,0 +1,64 @@
+#ifndef _XERCESWRITENODE_HPP_
+#define _XERCESWRITENODE_HPP_
+
+#include <string>
+#include <vector>
+#include "INode.hpp"
+
+#ifdef ARCHIVEUTIL_EXPORTS
+#define ARCHIVEUTIL_API __declspec(dllexport)
+#else
+#define ARCHIVEUTIL_API __declspec(dllimport)
+#endif
+
+#include "IInstanceCounter.hpp"
+
+namespace Archiving
+{
+	namespace Xerces
+	{
+		class WriteDriver;
+
+		/**
+		 * Element of an XML archive written by the WriteDriver.
+		 * The driver keeps one node per nesting level and reuses it for every element written at that level,
+		 * so a node stands for the element most recently started at its depth. Setting an attribute or value
+		 * writes it to the output right away; nothing is kept except the attributes of the current element.
+		 *
+		 * Attributes have to be set before the value or the first child of the element. Once a sibling or
+		 * the parent has been continued, the element is closed and can not be changed anymore.
+		 */
+		class ARCHIVEUTIL_API WriteNode : public INode, public IInstanceCounter<WriteNode>
+		{
+			friend class WriteDriver;
+
+		protected:
+			/** Con/Destructor */
+			WriteNode(WriteDriver *pDriver, WriteNode *pParentNode, size_t nDepth);
+			virtual ~WriteNode();
+
+		public:
+			/** Interface methods */
+			virtual std::string getTagName();
+			virtual std::string getAttribute(const std::string& sKey);
+			virtual void setAttribute(const std::string& sKey, const std::string& sValue);
+			using INode::getValue;
+			virtual std::string getValue();
+			virtual void setValue(const std::string& sValue);
+			using INode::getChild;
+			virtual INode* getChild(const std::string& sKey, const std::string& sType="*");
+			virtual INode* addChild(const std::string& sKey);
+
+		protected:
+			typedef std::pair<std::string, std::string> Attribute;
+
+			WriteDriver *m_pWriteDriver;
+			size_t m_nDepth;                          /** Nesting level, 0 for the root element. */
+			std::string m_sName;
+			std::vector<Attribute> m_lsAttributes;
+			bool m_bHasChildren;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,326 @@
+#ifndef _BINARYFORMAT_H_
+#define _BINARYFORMAT_H_
+
+/** includes */
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include "../GlobExport/SymbolTable.hpp"
+
+namespace Archiving
+{
+	namespace Binary
+	{
+		/**
+		 * Layout of the binary archive format (version 2).
+		 * All multi-byte integers are little endian, "vu" is an unsigned LEB128 varint.
+		 *
+		 * archive     := header stringtable node segment*
+		 * header      := 'K' 'V' 'A' 'B' version:u8 flags:u8
+		 * stringtable := count:u32 offset:u32[count] datasize:u32 data   (string i spans data[offset[i], offset[i+1]))
+		 * node        := kNodeTag:u8 length:u32 body        (length is the byte size of body)
+		 * body        := name:vu fields childcount:vu node*
+		 * fields      := type:vu attrcount:vu (key:vu value:vu)* valuelength:vu valuebytes
+		 * segment     := kSegmentTag:u8 length:u32 checksum:u32 segmentbody   (checksum is Format::checksum() of segmentbody)
+		 * segmentbody := stringtable patchcount:vu patch*
+		 * patch       := kPatchFields:u8 target:vu fields | kPatchAppend:u8 target:vu node
+		 *
+		 * Tag names, the type attribute and all other attribute keys and values are stored once in the
+		 * string table and referenced by index. The type is stored as index+1, 0 meaning "no type".
+		 * The offset array gives readers constant time access to a string without decoding the table,
+		 * and the length prefix of a node allows them to skip a whole subtree.
+		 *
+		 * The valuebytes of packed arrays (type "int[]", "long[]", "float[]" or "double[]") are the elements
+		 * one after another, little endian: 4 bytes for int, long and float, 8 for double.
+		 *
+		 * Segments are appended by Binary::Driver::saveChanges() and set kFlagSegments in the header.
+		 * They are applied in order on loading. A patch targets a node by its number: the nodes of the archive
+		 * are numbered in the order they are read, depth first, and the nodes appended by a patch continue the
+		 * numbering. kPatchFields replaces type, attributes and value of the target and keeps its children,
+		 * kPatchAppend adds the node as the last child of the target. The string indices of a segment refer
+		 * to its own string table.
+		 * A segment that is cut off or does not match its checksum is what an append that did not complete leaves
+		 * behind. Loading ignores it together with everything after it, and the next saveChanges() writes the file anew.
+		 */
+		namespace Format
+		{
+			const char kMagic[4]        = {'K', 'V', 'A', 'B'};
+			const unsigned char kVersion = 2;
+			const unsigned char kNodeTag = 0x01;
+			const unsigned char kSegmentTag = 0x02;
+			const unsigned char kPatchFields = 0x01;
+			const unsigned char kPatchAppend = 0x02;
+			const unsigned char kFlagSegments = 0x01;
+			const size_t kHeaderSize     = 6;
+			const size_t kFlagsOffset    = 5;
+
+			/** FNV-1a of the bytes, the checksum of a segment. */
+			inline unsigned long checksum(const char *pData, size_t nLength)
+			{
+				unsigned long ulHash = 2166136261ul;
+				for (size_t i = 0; i < nLength; ++i)
+					ulHash = ((ulHash ^ (unsigned char)pData[i]) * 16777619ul) & 0xffffffff;
+				return ulHash;
+			}
+
+			/** Thrown by Reader if the data is truncated or malformed. */
+			class Error : public std::runtime_error
+			{
+			public:
+				Error(const char *pMessage) : std::runtime_error(pMessage) {;}
+			};
+
+			/**
+			 * Appends the binary encoding to a string buffer.
+			 */
+			class Writer
+			{
+			public:
+				Writer(std::string& sBuffer) : m_sBuffer(sBuffer) {;}
+
+				void putByte(unsigned char cByte) {m_sBuffer.push_back((char)cByte);}
+				void putBytes(const char *pData, size_t nLength) {m_sBuffer.append(pData, nLength);}
+
+				void putVarInt(unsigned long ulValue)
+				{
+					while (ulValue >= 0x80)
+					{
+						putByte((unsigned char)(ulValue | 0x80));
+						ulValue >>= 7;
+					}
+					putByte((unsigned char)ulValue);
+				}
+
+				void putString(const std::string& sString)
+				{
+					putVarInt((unsigned long)sString.size());
+					putBytes(sString.data(), sString.size());
+				}
+
+				void putU32(unsigned long ulValue)
+				{
+					patchU32(reserveU32(), ulValue);
+				}
+
+				/** Reserves space for an u32 that is written later on with patchU32(). */
+				size_t reserveU32()
+				{
+					size_t nPos = m_sBuffer.size();
+					m_sBuffer.append(4, '\0');
+					return nPos;
+				}
+
+				void patchU32(size_t nPos, unsigned long ulValue)
+				{
+					for (int i = 0; i < 4; ++i)
+						m_sBuffer[nPos + i] = (char)((ulValue >> (8 * i)) & 0xff);
+				}
+
+				size_t getSize() const {return m_sBuffer.size();}
+
+				/** The checksum of the bytes from nPos on. */
+				unsigned long getChecksum(size_t nPos) const {return checksum(m_sBuffer.data() + nPos, m_sBuffer.size() - nPos);}
+
+			protected:
+				std::string& m_sBuffer;
+			};
+
+			/**
+			 * Reads the binary encoding from a memory range. Throws Format::Error on truncated data.
+			 */
+			class Reader
+			{
+			public:
+				Reader(const char *pBegin, const char *pEnd) : m_pPos(pBegin), m_pEnd(pEnd) {;}
+
+				unsigned char getByte()
+				{
+					if (m_pPos >= m_pEnd)
+						throw Error("unexpected end of binary archive");
+					return (unsigned char)*m_pPos++;
+				}
+
+				const char *getBytes(size_t nLength)
+				{
+					if ((size_t)(m_pEnd - m_pPos) < nLength)
+						throw Error("unexpected end of binary archive");
+					const char *pResult = m_pPos;
+					m_pPos += nLength;
+					return pResult;
+				}
+
+				/** Reads what Writer::putVarInt() wrote. Encodings longer than needed or beyond an unsigned long are rejected. */
+				unsigned long getVarInt()
+				{
+					const int iBits = (int)(sizeof(unsigned long) * 8);
+					unsigned long ulValue = 0;
+					for (int iShift = 0; iShift < iBits; iShift += 7)
+					{
+						unsigned char cByte = getByte();
+						unsigned long ulBits = (unsigned long)(cByte & 0x7f);
+						if (iBits - iShift < 7 && (ulBits >> (iBits - iShift)) != 0)
+							throw Error("varint out of range in binary archive");
+						ulValue |= ulBits << iShift;
+						if (!(cByte & 0x80))
+						{
+							if (cByte == 0 && iShift > 0)
+								throw Error("over-long varint in binary archive");
+							return ulValue;
+						}
+					}
+					throw Error("over-long varint in binary archive");
+				}
+
+				unsigned long getU32()
+				{
+					const unsigned char *pBytes = (const unsigned char *)getBytes(4);
+					return (unsigned long)pBytes[0] | ((unsigned long)pBytes[1] << 8) | ((unsigned long)pBytes[2] << 16) | ((unsigned long)pBytes[3] << 24);
+				}
+
+				const char *getPos() const {return m_pPos;}
+				const char *getEnd() const {return m_pEnd;}
+				bool atEnd() const {return m_pPos >= m_pEnd;}
+
+			protected:
+				const char *m_pPos;
+				const char *m_pEnd;
+			};
+
+			/**
+			 * Read access to the string table of an encoded archive, without copying or decoding the strings.
+			 */
+			class StringTableView
+			{
+			public:
+				StringTableView() : m_pOffsets(NULL), m_pData(NULL), m_ulCount(0), m_ulDataSize(0) {;}
+
+				/** Positions the view on the table at the reader's position and moves the reader behind it. */
+				void read(Reader& aReader)
+				{
+					m_ulCount = aReader.getU32();
+					if (m_ulCount > (unsigned long)(aReader.getEnd() - aReader.getPos()) / 4)
+						throw Error("invalid string table in binary archive");
+					m_pOffsets = (const unsigned char *)aReader.getBytes(m_ulCount * 4);
+					m_ulDataSize = aReader.getU32();
+					m_pData = aReader.getBytes(m_ulDataSize);
+				}
+
+				unsigned long getCount() const {return m_ulCount;}
+
+				/** Obtains the bytes of string ulIndex. Throws Format::Error if the index or its offsets are invalid. */
+				void get(unsigned long ulIndex, const char*& pString, size_t& nLength) const
+				{
+					if (ulIndex >= m_ulCount)
+						throw Error("invalid string index in binary archive");
+
+					unsigned long ulBegin = getOffset(ulIndex);
+					unsigned long ulEnd = ulIndex + 1 < m_ulCount ? getOffset(ulIndex + 1) : m_ulDataSize;
+					if (ulBegin > ulEnd || ulEnd > m_ulDataSize)
+						throw Error("invalid string offset in binary archive");
+
+					pString = m_pData + ulBegin;
+					nLength = ulEnd - ulBegin;
+				}
+
+				std::string get(unsigned long ulIndex) const
+				{
+					const char *pString;
+					size_t nLength;
+					get(ulIndex, pString, nLength);
+					return std::string(pString, nLength);
+				}
+
+				bool equals(unsigned long ulIndex, const char *pString, size_t nLength) const
+				{
+					const char *pEntry;
+					size_t nEntryLength;
+					get(ulIndex, pEntry, nEntryLength);
+					return nEntryLength == nLength && memcmp(pEntry, pString, nLength) == 0;
+				}
+
+			protected:
+				unsigned long getOffset(unsigned long ulIndex) const
+				{
+					const unsigned char *pBytes = m_pOffsets + ulIndex * 4;
+					return (unsigned long)pBytes[0] | ((unsigned long)pBytes[1] << 8) | ((unsigned long)pBytes[2] << 16) | ((unsigned long)pBytes[3] << 24);
+				}
+
+				const unsigned char *m_pOffsets;
+				const char *m_pData;
+				unsigned long m_ulCount;
+				unsigned long m_ulDataSize;
+			};
+
+			/** Byte size of one element of a packed array, 0 for types that can not be packed. */
+			inline size_t getPackedWidth(Symbol ulElementType)
+			{
+				switch (ulElementType)
+				{
+				case SymbolTable::kInt:
+				case SymbolTable::kLong:
+				case SymbolTable::kFloat:  return 4;
+				case SymbolTable::kDouble: return 8;
+				default:                   return 0;
+				}
+			}
+
+			/**
+			 * Writes ulCount elements to pBytes, which holds getPackedWidth() * ulCount bytes.
+			 * The hosts are little endian, so elements of the stored width are copied as a block.
+			 */
+			inline void packValues(Symbol ulElementType, const void *pValues, unsigned long ulCount, char *pBytes)
+			{
+				if (ulElementType == SymbolTable::kLong && sizeof(long) != 4)
+				{
+					for (unsigned long i = 0; i < ulCount; ++i)
+					{
+						unsigned long ulValue = (unsigned long)((const long *)pValues)[i];
+						for (int j = 0; j < 4; ++j)
+							pBytes[4 * i + j] = (char)((ulValue >> (8 * j)) & 0xff);
+					}
+				}
+				else if (ulCount)
+				{
+					memcpy(pBytes, pValues, getPackedWidth(ulElementType) * ulCount);
+				}
+			}
+
+			/**
+			 * Reads ulCount elements written by packValues().
+			 * @return False if nLength does not match the count.
+			 */
+			inline bool unpackValues(Symbol ulElementType, const char *pBytes, size_t nLength, void *pValues, unsigned long ulCount)
+			{
+				size_t nWidth = getPackedWidth(ulElementType);
+				if (!nWidth || nLength != nWidth * ulCount)
+					return false;
+
+				if (ulElementType == SymbolTable::kLong && sizeof(long) != 4)
+				{
+					const unsigned char *pData = (const unsigned char *)pBytes;
+					for (unsigned long i = 0; i < ulCount; ++i)
+					{
+						const unsigned char *pElement = pData + 4 * i;
+						unsigned long ulValue = (unsigned long)pElement[0] | ((unsigned long)pElement[1] << 8) | ((unsigned long)pElement[2] << 16) | ((unsigned long)pElement[3] << 24);
+						((long *)pValues)[i] = (long)(int)ulValue;
+					}
+				}
+				else if (nLength)
+				{
+					memcpy(pValues, pBytes, nLength);
+				}
+				return true;
+			}
+
+			/** Checks magic and version of a binary archive. */
+			inline bool hasHeader(const char *pData, size_t nLength)
+			{
+				return nLength >= kHeaderSize
+					&& pData[0] == kMagic[0] && pData[1] == kMagic[1] && pData[2] == kMagic[2] && pData[3] == kMagic[3]
+					&& (unsigned char)pData[4] == kVersion;
+			}
+		}
+	}
+}
+
+#endif
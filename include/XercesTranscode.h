@@ -0,0 +1,158 @@
+#ifndef _XERCESTRANSCODE_H_
+#define _XERCESTRANSCODE_H_
+
+/** includes */
+#include <string>
+#include <xercesc/util/XMLString.hpp>
+
+namespace Archiving
+{
+	namespace Xerces
+	{
+		/**
+		 * Conversion between the strings of the archive interface and XMLCh.
+		 * ASCII text, which covers keys, type names and numbers, is copied character by character without
+		 * allocating; only other text goes through XMLString::transcode() as before.
+		 */
+		namespace Transcode
+		{
+			inline bool isASCII(const std::string& sString)
+			{
+				for (std::string::const_iterator it = sString.begin(); it != sString.end(); ++it)
+					if ((unsigned char)*it >= 0x80)
+						return false;
+				return true;
+			}
+
+			/** Appends the first nLength characters of pString, which need not be terminated, to sResult. */
+			inline void append(const XMLCh *pString, size_t nLength, std::string& sResult)
+			{
+				size_t nASCII = 0;
+				while (nASCII < nLength && pString[nASCII] < 0x80)
+					++nASCII;
+
+				size_t nOffset = sResult.size();
+				sResult.resize(nOffset + nASCII);
+				for (size_t i = 0; i < nASCII; ++i)
+					sResult[nOffset + i] = (char)pString[i];
+
+				if (nASCII < nLength)
+				{
+					std::basic_string<XMLCh> sRest(pString + nASCII, nLength - nASCII);
+					char *pTranscoded = xercesc::XMLString::transcode(sRest.c_str());
+					sResult += pTranscoded;
+					xercesc::XMLString::release(&pTranscoded);
+				}
+			}
+
+			/** Appends the terminated pString to sResult. */
+			inline void append(const XMLCh *pString, std::string& sResult)
+			{
+				if (pString)
+					append(pString, xercesc::XMLString::stringLen(pString), sResult);
+			}
+
+			/** Replaces sResult with pString, reusing its buffer. */
+			inline void assign(const XMLCh *pString, std::string& sResult)
+			{
+				sResult.erase();
+				append(pString, sResult);
+			}
+
+			inline std::string toString(const XMLCh *pString)
+			{
+				std::string sResult;
+				append(pString, sResult);
+				return sResult;
+			}
+
+			/** Converts text in the local code page to UTF-8, as the XML files are written. */
+			inline std::string toUTF8(const std::string& sString)
+			{
+				XMLCh *pWide = xercesc::XMLString::transcode(sString.c_str());
+				std::string sResult;
+
+				for (const XMLCh *p = pWide; p && *p; ++p)
+				{
+					unsigned long c = *p;
+					if (c >= 0xD800 && c < 0xDC00 && p[1] >= 0xDC00 && p[1] < 0xE000)
+					{
+						c = 0x10000 + ((c - 0xD800) << 10) + (p[1] - 0xDC00);
+						++p;
+					}
+
+					if (c < 0x80)
+					{
+						sResult += (char)c;
+					}
+					else if (c < 0x800)
+					{
+						sResult += (char)(0xC0 | (c >> 6));
+						sResult += (char)(0x80 | (c & 0x3F));
+					}
+					else if (c < 0x10000)
+					{
+						sResult += (char)(0xE0 | (c >> 12));
+						sResult += (char)(0x80 | ((c >> 6) & 0x3F));
+						sResult += (char)(0x80 | (c & 0x3F));
+					}
+					else
+					{
+						sResult += (char)(0xF0 | (c >> 18));
+						sResult += (char)(0x80 | ((c >> 12) & 0x3F));
+						sResult += (char)(0x80 | ((c >> 6) & 0x3F));
+						sResult += (char)(0x80 | (c & 0x3F));
+					}
+				}
+
+				xercesc::XMLString::release(&pWide);
+				return sResult;
+			}
+
+			/**
+			 * Zero terminated XMLCh copy of a string for the Xerces API.
+			 * Short ASCII strings are copied to the stack, others are transcoded on the heap.
+			 */
+			class XMLChString
+			{
+			public:
+				explicit XMLChString(const std::string& sString)
+					: m_pHeap(NULL)
+				{
+					if (sString.length() < kStackSize && isASCII(sString))
+					{
+						for (size_t i = 0; i < sString.length(); ++i)
+							m_aStack[i] = (XMLCh)sString[i];
+						m_aStack[sString.length()] = 0;
+						m_pData = m_aStack;
+					}
+					else
+					{
+						m_pData = m_pHeap = xercesc::XMLString::transcode(sString.c_str());
+					}
+				}
+
+				~XMLChString()
+				{
+					if (m_pHeap)
+						xercesc::XMLString::release(&m_pHeap);
+				}
+
+				const XMLCh* get() const {return m_pData;}
+
+			protected:
+				enum {kStackSize = 128};
+
+				XMLCh m_aStack[kStackSize];
+				XMLCh *m_pHeap;
+				const XMLCh *m_pData;
+
+			private:
+				XMLChString(const XMLChString&);
+				XMLChString& operator=(const XMLChString&);
+			};
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <vector>
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/bind.hpp>
+
+#include "../GlobExport/ArchiveExecutor.hpp"
+
+namespace Archiving
+{
+	struct ArchiveExecutor::State
+	{
+		boost::mutex aBatchMutex;             /** Held by execute(), one batch at a time. */
+		boost::mutex aMutex;                  /** Guards the fields below. */
+		boost::condition_variable aStart;
+		boost::condition_variable aDone;
+		boost::thread_group aThreads;
+		std::vector<boost::thread::id> lsWorkers;  /** Written by the constructor only. */
+		boost::thread::id aOwner;             /** The thread that runs the current batch. */
+
+		ITask *pTask;
+		unsigned long ulCount;
+		unsigned long ulBatch;                /** Counts the batches, the workers wait for it to change. */
+		unsigned nPending;                    /** Worker slices of the current batch that are not done. */
+		bool bStop;
+		boost::exception_ptr pError;          /** The first exception of the current batch. */
+
+		State() : pTask(NULL), ulCount(0), ulBatch(0), nPending(0), bStop(false) {;}
+	};
+
+	ArchiveExecutor::ArchiveExecutor(unsigned nSlices)
+		: m_nSlices(nSlices ? nSlices : boost::thread::hardware_concurrency())
+		, m_pState(new State())
+	{
+		if (!m_nSlices)
+			m_nSlices = 1;
+
+		for (unsigned i = 0; i + 1 < m_nSlices; ++i)
+			m_pState->lsWorkers.push_back(m_pState->aThreads.create_thread(boost::bind(&ArchiveExecutor::work, this, i))->get_id());
+	}
+
+	ArchiveExecutor::~ArchiveExecutor()
+	{
+		{
+			boost::mutex::scoped_lock aLock(m_pState->aMutex);
+			m_pState->bStop = true;
+		}
+		m_pState->aStart.notify_all();
+		m_pState->aThreads.join_all();
+		delete m_pState;
+	}
+
+	void ArchiveExecutor::execute(ITask& aTask, unsigned long ulCount)
+	{
+		// A task of the running batch would wait for itself
+		if (isBatchThread())
+		{
+			executeInline(aTask, ulCount);
+			return;
+		}
+
+		boost::mutex::scoped_lock aBatchLock(m_pState->aBatchMutex);
+
+		{
+			boost::mutex::scoped_lock aLock(m_pState->aMutex);
+			m_pState->aOwner = boost::this_thread::get_id();
+			m_pState->pTask = &aTask;
+			m_pState->ulCount = ulCount;
+			m_pState->nPending = m_nSlices - 1;
+			m_pState->pError = boost::exception_ptr();
+			++m_pState->ulBatch;
+		}
+		m_pState->aStart.notify_all();
+
+		runSlice(m_nSlices - 1);
+
+		boost::exception_ptr pError;
+		{
+			boost::mutex::scoped_lock aLock(m_pState->aMutex);
+			while (m_pState->nPending)
+				m_pState->aDone.wait(aLock);
+			m_pState->pTask = NULL;
+			m_pState->aOwner = boost::thread::id();
+			pError = m_pState->pError;
+		}
+
+		if (pError)
+			boost::rethrow_exception(pError);
+	}
+
+	bool ArchiveExecutor::isBatchThread()
+	{
+		boost::thread::id aThread = boost::this_thread::get_id();
+		if (std::find(m_pState->lsWorkers.begin(), m_pState->lsWorkers.end(), aThread) != m_pState->lsWorkers.end())
+			return true;
+
+		boost::mutex::scoped_lock aLock(m_pState->aMutex);
+		return m_pState->aOwner == aThread;
+	}
+
+	void ArchiveExecutor::executeInline(ITask& aTask, unsigned long ulCount)
+	{
+		boost::exception_ptr pError;
+		for (unsigned nSlice = 0; nSlice < m_nSlices; ++nSlice)
+		{
+			unsigned long ulBegin = (unsigned long)((unsigned long long)ulCount * nSlice / m_nSlices);
+			unsigned long ulEnd = (unsigned long)((unsigned long long)ulCount * (nSlice + 1) / m_nSlices);
+			if (ulBegin == ulEnd)
+				continue;
+
+			try
+			{
+				aTask.run(nSlice, ulBegin, ulEnd);
+			}
+			catch (...)
+			{
+				if (!pError)
+					pError = boost::current_exception();
+			}
+		}
+
+		if (pError)
+			boost::rethrow_exception(pError);
+	}
+
+	void ArchiveExecutor::work(unsigned nSlice)
+	{
+		unsigned long ulBatch = 0;
+		for (;;)
+		{
+			{
+				boost::mutex::scoped_lock aLock(m_pState->aMutex);
+				while (!m_pState->bStop && m_pState->ulBatch == ulBatch)
+					m_pState->aStart.wait(aLock);
+				if (m_pState->bStop)
+					return;
+				ulBatch = m_pState->ulBatch;
+			}
+
+			runSlice(nSlice);
+
+			boost::mutex::scoped_lock aLock(m_pState->aMutex);
+			if (!--m_pState->nPending)
+				m_pState->aDone.notify_one();
+		}
+	}
+
+	void ArchiveExecutor::runSlice(unsigned nSlice)
+	{
+		// The batch fields are only written while no slice runs
+		unsigned long long ulCount = m_pState->ulCount;
+		unsigned long ulBegin = (unsigned long)(ulCount * nSlice / m_nSlices);
+		unsigned long ulEnd = (unsigned long)(ulCount * (nSlice + 1) / m_nSlices);
+		if (ulBegin == ulEnd)
+			return;
+
+		try
+		{
+			m_pState->pTask->run(nSlice, ulBegin, ulEnd);
+		}
+		catch (...)
+		{
+			boost::mutex::scoped_lock aLock(m_pState->aMutex);
+			if (!m_pState->pError)
+				m_pState->pError = boost::current_exception();
+		}
+	}
+}
@@ -0,0 +1,248 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <windows.h>
+#include <cstdio>
+#include <cstring>
+
+#include <boost/thread/mutex.hpp>
+
+#include "../GlobExport/ArchiveStats.hpp"
+
+namespace Archiving
+{
+	static const char *kCounterNames[ArchiveStats::kCounterCount] =
+	{
+		"nodes_created", "bytes_read", "bytes_written", "lookups", "lookup_misses", "bad_type", "not_found", "ordered_hits", "ordered_misses"
+	};
+
+	static const char *kPhaseNames[ArchiveStats::kPhaseCount] =
+	{
+		"parse_ms", "write_ms", "lookup_ms", "value_ms"
+	};
+
+	ArchiveStats::ArchiveStats(SymbolTable& aSymbols, ArchiveStats *pParent)
+		: m_aSymbols(aSymbols)
+		, m_pParent(pParent)
+		, m_pMutex(new boost::mutex())
+	{
+		reset();
+	}
+
+	ArchiveStats::~ArchiveStats()
+	{
+		if (m_pParent)
+			m_pParent->merge(*this);
+		delete m_pMutex;
+	}
+
+	void ArchiveStats::reset()
+	{
+		memset(m_aCounters, 0, sizeof(m_aCounters));
+		memset(m_aTicks, 0, sizeof(m_aTicks));
+		m_ullNested = 0;
+		m_lsClasses.clear();
+	}
+
+	unsigned long long ArchiveStats::now()
+	{
+		LARGE_INTEGER liNow;
+		QueryPerformanceCounter(&liNow);
+		return (unsigned long long)liNow.QuadPart;
+	}
+
+	unsigned long long ArchiveStats::getFileSize(const std::string& sPath)
+	{
+		FILE *pFile = fopen(sPath.c_str(), "rb");
+		if (!pFile)
+			return 0;
+
+		fseek(pFile, 0, SEEK_END);
+		long lSize = ftell(pFile);
+		fclose(pFile);
+		return lSize > 0 ? (unsigned long long)lSize : 0;
+	}
+
+	double ArchiveStats::toMilliseconds(unsigned long long ullTicks)
+	{
+		static double s_dTicksPerMs = 0.0;
+		if (s_dTicksPerMs == 0.0)
+		{
+			LARGE_INTEGER liFrequency;
+			QueryPerformanceFrequency(&liFrequency);
+			s_dTicksPerMs = (double)liFrequency.QuadPart / 1000.0;
+		}
+		return (double)ullTicks / s_dTicksPerMs;
+	}
+
+	void ArchiveStats::countResult(ArchivingResult nResult)
+	{
+		if (nResult == BadType)
+			++m_aCounters[kBadType];
+		else if (nResult == NotFound)
+			++m_aCounters[kNotFound];
+	}
+
+	ArchiveStats::ClassTicks& ArchiveStats::getClass(Symbol ulClass)
+	{
+		if (m_lsClasses.size() <= ulClass)
+		{
+			ClassTicks aEmpty;
+			memset(&aEmpty, 0, sizeof(aEmpty));
+			m_lsClasses.resize(ulClass + 1, aEmpty);
+		}
+		return m_lsClasses[ulClass];
+	}
+
+	void ArchiveStats::beginObject(ObjectTimer& aTimer)
+	{
+		aTimer.ullOuterNested = m_ullNested;
+		m_ullNested = 0;
+		aTimer.ullStart = now();
+	}
+
+	void ArchiveStats::endObject(ObjectTimer& aTimer, Symbol ulClass, bool bSerialize)
+	{
+		unsigned long long ullTicks = now() - aTimer.ullStart;
+		unsigned long long ullSelf = ullTicks > m_ullNested ? ullTicks - m_ullNested : 0;
+		m_ullNested = aTimer.ullOuterNested + ullTicks;
+
+		ClassTicks& aClass = getClass(ulClass);
+		if (bSerialize)
+		{
+			++aClass.ulSerialized;
+			aClass.ullSerialize += ullTicks;
+			aClass.ullSerializeSelf += ullSelf;
+		}
+		else
+		{
+			++aClass.ulDeserialized;
+			aClass.ullDeserialize += ullTicks;
+			aClass.ullDeserializeSelf += ullSelf;
+		}
+	}
+
+	void ArchiveStats::addDelegateTime(Symbol ulClass, unsigned long long ullStart)
+	{
+		unsigned long long ullTicks = now() - ullStart;
+		m_ullNested += ullTicks;
+
+		ClassTicks& aClass = getClass(ulClass);
+		++aClass.ulDelegateCalls;
+		aClass.ullDelegate += ullTicks;
+	}
+
+	void ArchiveStats::merge(const ArchiveStats& aOther)
+	{
+		boost::mutex::scoped_lock aLock(*m_pMutex);
+
+		for (int i = 0; i < kCounterCount; ++i)
+			m_aCounters[i] += aOther.m_aCounters[i];
+		for (int i = 0; i < kPhaseCount; ++i)
+			m_aTicks[i] += aOther.m_aTicks[i];
+
+		for (Symbol ulOther = 0; ulOther < aOther.m_lsClasses.size(); ++ulOther)
+		{
+			const ClassTicks& aFrom = aOther.m_lsClasses[ulOther];
+			if (!aFrom.ulSerialized && !aFrom.ulDeserialized && !aFrom.ulDelegateCalls)
+				continue;
+
+			// Fragments have symbol tables of their own, and are merged on the thread of the archive
+			Symbol ulClass = &aOther.m_aSymbols == &m_aSymbols ? ulOther : m_aSymbols.intern(aOther.m_aSymbols.getString(ulOther));
+			ClassTicks& aTo = getClass(ulClass);
+			aTo.ulSerialized += aFrom.ulSerialized;
+			aTo.ulDeserialized += aFrom.ulDeserialized;
+			aTo.ulDelegateCalls += aFrom.ulDelegateCalls;
+			aTo.ullSerialize += aFrom.ullSerialize;
+			aTo.ullSerializeSelf += aFrom.ullSerializeSelf;
+			aTo.ullDeserialize += aFrom.ullDeserialize;
+			aTo.ullDeserializeSelf += aFrom.ullDeserializeSelf;
+			aTo.ullDelegate += aFrom.ullDelegate;
+		}
+	}
+
+	std::vector<ArchiveStats::ClassStats> ArchiveStats::getClasses() const
+	{
+		std::vector<ClassStats> lsClasses;
+		for (Symbol ulClass = 0; ulClass < m_lsClasses.size(); ++ulClass)
+		{
+			const ClassTicks& aTicks = m_lsClasses[ulClass];
+			if (!aTicks.ulSerialized && !aTicks.ulDeserialized && !aTicks.ulDelegateCalls)
+				continue;
+
+			ClassStats aClass;
+			aClass.sName = ulClass != SymbolTable::kNone ? m_aSymbols.getString(ulClass) : "?";
+			aClass.ulSerialized = aTicks.ulSerialized;
+			aClass.ulDeserialized = aTicks.ulDeserialized;
+			aClass.ulDelegateCalls = aTicks.ulDelegateCalls;
+			aClass.dSerializeMs = toMilliseconds(aTicks.ullSerialize);
+			aClass.dSerializeSelfMs = toMilliseconds(aTicks.ullSerializeSelf);
+			aClass.dDeserializeMs = toMilliseconds(aTicks.ullDeserialize);
+			aClass.dDeserializeSelfMs = toMilliseconds(aTicks.ullDeserializeSelf);
+			aClass.dDelegateMs = toMilliseconds(aTicks.ullDelegate);
+			lsClasses.push_back(aClass);
+		}
+		return lsClasses;
+	}
+
+	std::vector<std::pair<std::string, double> > ArchiveStats::getValues() const
+	{
+		std::vector<std::pair<std::string, double> > lsValues;
+		for (int i = 0; i < kCounterCount; ++i)
+			lsValues.push_back(std::make_pair(std::string(kCounterNames[i]), (double)m_aCounters[i]));
+		for (int i = 0; i < kPhaseCount; ++i)
+			lsValues.push_back(std::make_pair(std::string(kPhaseNames[i]), getMilliseconds((Phase)i)));
+
+		std::vector<ClassStats> lsClasses = getClasses();
+		for (size_t i = 0; i < lsClasses.size(); ++i)
+		{
+			const ClassStats& aClass = lsClasses[i];
+			std::string sPrefix = "class." + aClass.sName + ".";
+			lsValues.push_back(std::make_pair(sPrefix + "serialized", (double)aClass.ulSerialized));
+			lsValues.push_back(std::make_pair(sPrefix + "serialize_ms", aClass.dSerializeMs));
+			lsValues.push_back(std::make_pair(sPrefix + "serialize_self_ms", aClass.dSerializeSelfMs));
+			lsValues.push_back(std::make_pair(sPrefix + "deserialized", (double)aClass.ulDeserialized));
+			lsValues.push_back(std::make_pair(sPrefix + "deserialize_ms", aClass.dDeserializeMs));
+			lsValues.push_back(std::make_pair(sPrefix + "deserialize_self_ms", aClass.dDeserializeSelfMs));
+			lsValues.push_back(std::make_pair(sPrefix + "delegate_calls", (double)aClass.ulDelegateCalls));
+			lsValues.push_back(std::make_pair(sPrefix + "delegate_ms", aClass.dDelegateMs));
+		}
+		return lsValues;
+	}
+
+	std::string ArchiveStats::getReport() const
+	{
+		std::string sReport;
+		char aLine[512];
+
+		for (int i = 0; i < kCounterCount; ++i)
+		{
+			sprintf(aLine, "%-16s %14llu\n", kCounterNames[i], m_aCounters[i]);
+			sReport += aLine;
+		}
+		for (int i = 0; i < kPhaseCount; ++i)
+		{
+			sprintf(aLine, "%-16s %14.3f\n", kPhaseNames[i], getMilliseconds((Phase)i));
+			sReport += aLine;
+		}
+
+		std::vector<ClassStats> lsClasses = getClasses();
+		if (!lsClasses.empty())
+		{
+			sprintf(aLine, "%-32s %10s %12s %12s %10s %12s %12s %10s %12s\n", "class", "serialized", "ms", "self ms",
+				"deserialized", "ms", "self ms", "delegate", "ms");
+			sReport += aLine;
+		}
+		for (size_t i = 0; i < lsClasses.size(); ++i)
+		{
+			const ClassStats& aClass = lsClasses[i];
+			sprintf(aLine, "%-32.256s %10lu %12.3f %12.3f %10lu %12.3f %12.3f %10lu %12.3f\n", aClass.sName.c_str(),
+				aClass.ulSerialized, aClass.dSerializeMs, aClass.dSerializeSelfMs,
+				aClass.ulDeserialized, aClass.dDeserializeMs, aClass.dDeserializeSelfMs,
+				aClass.ulDelegateCalls, aClass.dDelegateMs);
+			sReport += aLine;
+		}
+		return sReport;
+	}
+}
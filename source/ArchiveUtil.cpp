@@ -38,7 +38,7 @@ namespace Archiving
 	char *newline = "\n";
 
 	/** Verify Node */
-	bool verifyNode(string sType, INode *pNode, ArchivingResult *pResult)
+	bool verifyNode(const string& sType, INode *pNode, ArchivingResult *pResult)
 	{
 		if (pNode == NULL) {
 			if (pResult != NULL) {*pResult = NotFound;}
@@ -51,4 +51,18 @@ namespace Archiving
 		if (pResult != NULL) {*pResult = Found;}
 		return true;
 	}
+
+	bool verifyNode(Symbol ulType, INode *pNode, ArchivingResult *pResult)
+	{
+		if (pNode == NULL) {
+			if (pResult != NULL) {*pResult = NotFound;}
+			return false;
+		}
+		if (pNode->getTypeSymbol() != ulType) {
+			if (pResult != NULL) {*pResult = BadType;}
+			return false;
+		}
+		if (pResult != NULL) {*pResult = Found;}
+		return true;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/bind.hpp>
+
+#include "../GlobExport/AsyncSave.hpp"
+
+namespace Archiving
+{
+	struct AsyncSave::State
+	{
+		boost::mutex aMutex;                  /** Guards the fields below. */
+		boost::condition_variable aDone;
+		boost::thread *pThread;
+
+		bool bDone;
+		bool bSaved;
+		boost::exception_ptr pError;
+
+		State() : pThread(NULL), bDone(false), bSaved(false) {;}
+	};
+
+	AsyncSave::AsyncSave(IArchivingDriver::Snapshot *pSnapshot, IListener *pListener)
+		: m_pSnapshot(pSnapshot)
+		, m_pListener(pListener)
+		, m_pState(new State())
+	{
+		try
+		{
+			m_pState->pThread = new boost::thread(boost::bind(&AsyncSave::run, this));
+		}
+		catch (...)
+		{
+			delete m_pState;
+			delete m_pSnapshot;
+			throw;
+		}
+	}
+
+	AsyncSave::~AsyncSave()
+	{
+		m_pState->pThread->join();
+		delete m_pState->pThread;
+		// The snapshot may detach from its driver, which is used by the thread that deletes the save
+		delete m_pSnapshot;
+		delete m_pState;
+	}
+
+	bool AsyncSave::isDone()
+	{
+		boost::mutex::scoped_lock aLock(m_pState->aMutex);
+		return m_pState->bDone;
+	}
+
+	bool AsyncSave::wait()
+	{
+		boost::exception_ptr pError;
+		bool bSaved;
+		{
+			boost::mutex::scoped_lock aLock(m_pState->aMutex);
+			while (!m_pState->bDone)
+				m_pState->aDone.wait(aLock);
+			pError = m_pState->pError;
+			bSaved = m_pState->bSaved;
+		}
+
+		if (pError)
+			boost::rethrow_exception(pError);
+		return bSaved;
+	}
+
+	const std::string& AsyncSave::getFile() const
+	{
+		return m_pSnapshot->getFile();
+	}
+
+	void AsyncSave::run()
+	{
+		bool bSaved = false;
+		boost::exception_ptr pError;
+		try
+		{
+			bSaved = m_pSnapshot->save();
+		}
+		catch (...)
+		{
+			pError = boost::current_exception();
+		}
+
+		if (m_pListener)
+			m_pListener->saveFinished(*this, bSaved);
+
+		boost::mutex::scoped_lock aLock(m_pState->aMutex);
+		m_pState->bSaved = bSaved;
+		m_pState->pError = pError;
+		m_pState->bDone = true;
+		m_pState->aDone.notify_all();
+	}
+}
@@ -0,0 +1,1165 @@
+#pragma hdrstop
+
+#include "StdAfx.h"
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <algorithm>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/bind.hpp>
+
+#include "../GlobExport/BinaryNode.hpp"
+#include "../GlobExport/BinaryDriver.hpp"
+#include "../GlobExport/ArchiveUtil.hpp"
+#include "../include/BinaryFormat.h"
+
+namespace Archiving
+{
+	namespace Binary
+	{
+		namespace
+		{
+			/**
+			 * Collects the strings of a node tree while saving and assigns each one its string table index.
+			 */
+			class StringTable
+			{
+			public:
+				unsigned long add(const ArenaString& aString)
+				{
+					std::string sString = aString.str();
+					std::map<std::string, unsigned long>::iterator it = m_mapIndices.find(sString);
+					if (it != m_mapIndices.end())
+						return it->second;
+
+					unsigned long ulIndex = (unsigned long)m_lsStrings.size();
+					m_lsStrings.push_back(&m_mapIndices.insert(std::make_pair(sString, ulIndex)).first->first);
+					return ulIndex;
+				}
+
+				unsigned long get(const ArenaString& aString) const
+				{
+					return m_mapIndices.find(aString.str())->second;
+				}
+
+				void write(Format::Writer& aWriter) const
+				{
+					unsigned long ulOffset = 0;
+					aWriter.putU32((unsigned long)m_lsStrings.size());
+					for (std::vector<const std::string*>::const_iterator it = m_lsStrings.begin(); it != m_lsStrings.end(); ++it)
+					{
+						aWriter.putU32(ulOffset);
+						ulOffset += (unsigned long)(*it)->size();
+					}
+					aWriter.putU32(ulOffset);
+					for (std::vector<const std::string*>::const_iterator it = m_lsStrings.begin(); it != m_lsStrings.end(); ++it)
+						aWriter.putBytes((*it)->data(), (*it)->size());
+				}
+
+			protected:
+				std::map<std::string, unsigned long> m_mapIndices;
+				std::vector<const std::string*> m_lsStrings;
+			};
+
+			bool readFile(const std::string& sFile, std::string& sData)
+			{
+				FILE *pFile = fopen(sFile.c_str(), "rb");
+				if (!pFile)
+					return false;
+
+				char aBuffer[64 * 1024];
+				size_t nRead;
+				while ((nRead = fread(aBuffer, sizeof(char), sizeof(aBuffer), pFile)) > 0)
+					sData.append(aBuffer, nRead);
+				fclose(pFile);
+				return true;
+			}
+		}
+
+		/**
+		 * The parse of an asynchronous load, see Driver::loadFromStringAsync(). start() reads the string table and the root
+		 * on the calling thread, run() the children of the root on a thread of its own.
+		 * The nodes of the thread are allocated from the arena of the load, which the driver adopts in waitForLoad(),
+		 * so the lookups meanwhile can index their children in the arena of the driver. The nodes are published in batches
+		 * once their fields are read: flush() links those whose parent the lookups can reach under the lock, and tells
+		 * which nodes may still get more children.
+		 * The nodes of the thread register with the driver through IArchivingDriver::addNode(), which is not locked.
+		 * The owning thread therefore creates no node before waitForLoad(): Node::addChild() and appendFragment()
+		 * wait first, and the root is created before the thread starts.
+		 */
+		class BackgroundLoad
+		{
+		public:
+			BackgroundLoad(Driver *pDriver, std::string& sData, const std::string& sFile)
+				: m_pDriver(pDriver)
+				, m_sFile(sFile)
+				, m_aReader(NULL, NULL)
+				, m_pRoot(NULL)
+				, m_ulRootChildren(0)
+				, m_ulNextId(0)
+				, m_nBaseSize(0)
+				, m_ulLinked(0)
+				, m_ulUnpublished(0)
+				, m_ulParsed(0)
+				, m_pWaiting(NULL)
+				, m_bDone(false)
+				, m_bFailed(false)
+				, m_pThread(NULL)
+				, m_ulSeenParsed(0)
+			{
+				m_sData.swap(sData);
+			}
+
+			~BackgroundLoad()
+			{
+				join();
+			}
+
+			/** Reads up to the children of the root and starts the thread for them. Throws Format::Error. */
+			Node* start();
+
+			void join()
+			{
+				if (!m_pThread)
+					return;
+				m_pThread->join();
+				delete m_pThread;
+				m_pThread = NULL;
+			}
+
+			/**
+			 * Called by the thread when the fields of pNode are read. Nodes below a node the lookups can not reach yet
+			 * are linked right away, the others under the lock with the next batch.
+			 */
+			void publish(Node *pNode, bool bChildren)
+			{
+				Node *pParent = (Node *)pNode->getParent();
+				while (m_lsPath.back() != pParent)
+					m_lsPath.pop_back();
+				if (bChildren)
+					m_lsPath.push_back(pNode);
+
+				if (pParent->m_ulId >= m_ulLinked)
+					pParent->linkChild(pNode);
+				else
+					m_lsPending.push_back(pNode);
+				if (++m_ulUnpublished == kBatchSize)
+					flush(pNode->m_ulId + 1);
+			}
+
+			/** Links the pending nodes, after which the lookups can reach all nodes below ulParsed. */
+			void flush(unsigned long ulParsed)
+			{
+				boost::mutex::scoped_lock aLock(m_aMutex);
+				for (std::vector<Node*>::iterator it = m_lsPending.begin(); it != m_lsPending.end(); ++it)
+					((Node *)(*it)->getParent())->linkChild(*it);
+				m_lsPending.clear();
+				m_lsOpen = m_lsPath;
+				m_ulParsed = m_ulLinked = ulParsed;
+				m_ulUnpublished = 0;
+				if (m_pWaiting)
+					m_aChanged.notify_all();
+			}
+
+			/** The lock of the links between the nodes while the thread runs. */
+			boost::mutex& getMutex() {return m_aMutex;}
+
+			/** Waits with the lock held until pNode gets another child or is complete. */
+			void wait(boost::mutex::scoped_lock& aLock, Node *pNode)
+			{
+				m_pWaiting = pNode;
+				m_aChanged.wait(aLock);
+				m_pWaiting = NULL;
+			}
+
+			/** True while pNode may get more children. With the lock held. */
+			bool isOpen(Node *pNode) const {return std::find(m_lsOpen.begin(), m_lsOpen.end(), pNode) != m_lsOpen.end();}
+			bool isDone() const {return m_bDone;}
+
+			/** Remembers how far the thread is, for isComplete(). With the lock held. */
+			void see()
+			{
+				m_ulSeenParsed = m_ulParsed;
+				m_lsSeenOpen = m_lsOpen;
+			}
+
+			/**
+			 * True if pNode was complete when the lookups last took the lock. Its links do not change any more then,
+			 * so the lookups read them without the lock.
+			 */
+			bool isComplete(Node *pNode) const
+			{
+				return pNode->m_ulId < m_ulSeenParsed && std::find(m_lsSeenOpen.begin(), m_lsSeenOpen.end(), pNode) == m_lsSeenOpen.end();
+			}
+
+			/** After join() */
+			bool hasFailed() const {return m_bFailed;}
+			NodeArena& getArena() {return m_aArena;}
+			const std::string& getFile() const {return m_sFile;}
+			size_t getBaseSize() const {return m_nBaseSize;}
+			unsigned long getNextId() const {return m_ulNextId;}
+
+		protected:
+			void run();
+
+			Driver *m_pDriver;
+			std::string m_sData;
+			std::string m_sFile;
+			NodeArena m_aArena;
+			Format::Reader m_aReader;
+			std::vector<ArenaString> m_lsStrings;
+			ArenaString m_aType;
+			Node *m_pRoot;
+			unsigned long m_ulRootChildren;
+			unsigned long m_ulNextId;
+			size_t m_nBaseSize;
+
+			/** The state of the thread. */
+			static const unsigned long kBatchSize = 64;
+			std::vector<Node*> m_lsPath;            /** The path from the root to the node the thread reads. */
+			std::vector<Node*> m_lsPending;         /** Nodes to link to a parent the lookups can reach. */
+			unsigned long m_ulLinked;               /** The ids below were linked to their parents. */
+			unsigned long m_ulUnpublished;          /** Nodes read since the last flush(). */
+
+			boost::mutex m_aMutex;                  /** Guards the links of the nodes and the fields below. */
+			boost::condition_variable m_aChanged;
+			std::vector<Node*> m_lsOpen;            /** m_lsPath as of the last flush(), the nodes that may get more children. */
+			unsigned long m_ulParsed;               /** The ids below can be reached by the lookups. */
+			Node *m_pWaiting;                       /** The node a lookup waits for, the reader of the archive is one thread. */
+			bool m_bDone;
+			bool m_bFailed;
+			boost::thread *m_pThread;
+
+			/** The state of the thread when the lookups last took the lock, see see(). Only used by the lookups. */
+			unsigned long m_ulSeenParsed;
+			std::vector<Node*> m_lsSeenOpen;
+		};
+
+		/**
+		 * Encodes and decodes a tree of Binary::Node. Friend of Node, declared here to keep the format out of the public header.
+		 */
+		class NodeCodec
+		{
+		public:
+			/** What reading a node record needs besides the reader. */
+			struct Context
+			{
+				const std::vector<ArenaString> *pStrings;   /** The string table of the archive or segment. */
+				ArenaString aType;
+				unsigned long ulNextId;                     /** Nodes are numbered in the order they are read. */
+				std::vector<Node*> *pNodes;                 /** The nodes by id, only if there are segments to apply. */
+				NodeArena *pArena;                          /** Where the nodes and their fields are allocated. */
+				BackgroundLoad *pLoad;                      /** The asynchronous load that links the nodes, NULL to link them when they are created. */
+			};
+
+			static void collectFields(Node *pNode, StringTable& aTable)
+			{
+				for (Node::Attribute *pAttribute = pNode->m_pFirstAttribute; pAttribute; pAttribute = pAttribute->pNext)
+				{
+					aTable.add(pAttribute->aKey);
+					aTable.add(pAttribute->aValue);
+				}
+			}
+
+			static void collect(Node *pNode, StringTable& aTable)
+			{
+				aTable.add(pNode->m_aName);
+				collectFields(pNode, aTable);
+				for (Node *pChild = pNode->m_pFirstChild; pChild; pChild = pChild->m_pNextSibling)
+					collect(pChild, aTable);
+			}
+
+			static void writeFields(Node *pNode, const StringTable& aTable, Format::Writer& aWriter)
+			{
+				// the type attribute is stored in its own field, all others follow as key/value pairs
+				unsigned long ulType = 0;
+				unsigned long ulAttributes = 0;
+				for (Node::Attribute *pAttribute = pNode->m_pFirstAttribute; pAttribute; pAttribute = pAttribute->pNext)
+				{
+					if (pAttribute->aKey == Node::kType)
+						ulType = aTable.get(pAttribute->aValue) + 1;
+					else
+						++ulAttributes;
+				}
+
+				aWriter.putVarInt(ulType);
+				aWriter.putVarInt(ulAttributes);
+				for (Node::Attribute *pAttribute = pNode->m_pFirstAttribute; pAttribute; pAttribute = pAttribute->pNext)
+				{
+					if (pAttribute->aKey == Node::kType)
+						continue;
+					aWriter.putVarInt(aTable.get(pAttribute->aKey));
+					aWriter.putVarInt(aTable.get(pAttribute->aValue));
+				}
+				aWriter.putVarInt((unsigned long)pNode->m_aValue.length());
+				aWriter.putBytes(pNode->m_aValue.data(), pNode->m_aValue.length());
+			}
+
+			static void write(Node *pNode, const StringTable& aTable, Format::Writer& aWriter)
+			{
+				aWriter.putByte(Format::kNodeTag);
+				size_t nLengthPos = aWriter.reserveU32();
+				size_t nBodyPos = aWriter.getSize();
+
+				aWriter.putVarInt(aTable.get(pNode->m_aName));
+				writeFields(pNode, aTable, aWriter);
+
+				aWriter.putVarInt(pNode->m_ulChildren);
+				for (Node *pChild = pNode->m_pFirstChild; pChild; pChild = pChild->m_pNextSibling)
+					write(pChild, aTable, aWriter);
+
+				aWriter.patchU32(nLengthPos, (unsigned long)(aWriter.getSize() - nBodyPos));
+			}
+
+			static const ArenaString& getString(const std::vector<ArenaString>& lsStrings, unsigned long ulIndex)
+			{
+				if (ulIndex >= lsStrings.size())
+					throw Format::Error("invalid string index in binary archive");
+				return lsStrings[ulIndex];
+			}
+
+			/** Reads tag, length and name of a node record and creates the node with the next id. */
+			static Node* create(IArchivingDriver *pDriver, Node *pParent, Context& aContext, Format::Reader& aReader)
+			{
+				readHeader(aReader);
+				const ArenaString& aName = getString(*aContext.pStrings, aReader.getVarInt());
+				Node *pNode;
+				if (aContext.pLoad)
+				{
+					pNode = new (*aContext.pArena) Node(pDriver, NULL, aName);
+					pNode->setParentLink(pParent, pDriver);
+				}
+				else
+					pNode = new (*aContext.pArena) Node(pDriver, pParent, aName);
+				pNode->m_ulId = aContext.ulNextId++;
+				if (aContext.pNodes)
+					aContext.pNodes->push_back(pNode);
+				return pNode;
+			}
+
+			/** Reads type, attributes and value into pNode, replacing those it has. */
+			static void readFields(Node *pNode, Context& aContext, Format::Reader& aReader)
+			{
+				const std::vector<ArenaString>& lsStrings = *aContext.pStrings;
+				pNode->m_pFirstAttribute = pNode->m_pLastAttribute = NULL;
+				pNode->resetTypeSymbol();
+
+				unsigned long ulType = aReader.getVarInt();
+				if (ulType)
+					pNode->addAttribute(*aContext.pArena, aContext.aType, getString(lsStrings, ulType - 1));
+
+				unsigned long ulAttributes = aReader.getVarInt();
+				for (unsigned long i = 0; i < ulAttributes; ++i)
+				{
+					const ArenaString& aKey = getString(lsStrings, aReader.getVarInt());
+					pNode->addAttribute(*aContext.pArena, aKey, getString(lsStrings, aReader.getVarInt()));
+				}
+
+				unsigned long ulValueLength = aReader.getVarInt();
+				pNode->m_aValue = ArenaString(*aContext.pArena, aReader.getBytes(ulValueLength), ulValueLength);
+			}
+
+			/**
+			 * Reads the body of a node record after its name into pNode, creating the children recursively.
+			 * The strings of the table have been copied to the arena once, all nodes share them.
+			 */
+			static void read(Node *pNode, Context& aContext, Format::Reader& aReader)
+			{
+				readFields(pNode, aContext, aReader);
+
+				IArchivingDriver *pDriver = pNode->getDriver();
+				unsigned long ulChildren = aReader.getVarInt();
+				if (aContext.pLoad)
+					aContext.pLoad->publish(pNode, ulChildren != 0);
+				for (unsigned long i = 0; i < ulChildren; ++i)
+					read(create(pDriver, pNode, aContext, aReader), aContext, aReader);
+			}
+
+			/** Reads tag and length of a node record and checks them against the remaining data. */
+			static void readHeader(Format::Reader& aReader)
+			{
+				if (aReader.getByte() != Format::kNodeTag)
+					throw Format::Error("unknown record tag in binary archive");
+				if (aReader.getU32() > (unsigned long)(aReader.getEnd() - aReader.getPos()))
+					throw Format::Error("invalid record length in binary archive");
+			}
+
+			/** Copies the strings of a table to the arena. */
+			static void readStrings(NodeArena& aArena, Format::Reader& aReader, std::vector<ArenaString>& lsStrings)
+			{
+				Format::StringTableView aTable;
+				aTable.read(aReader);
+
+				lsStrings.resize(aTable.getCount());
+				for (unsigned long i = 0; i < aTable.getCount(); ++i)
+				{
+					const char *pString;
+					size_t nLength;
+					aTable.get(i, pString, nLength);
+					lsStrings[i] = ArenaString(aArena, pString, nLength);
+				}
+			}
+
+			/** Writes the changed nodes as a segment, numbering the nodes they add. */
+			static void writeSegment(const std::vector<Node*>& lsChanged, unsigned long& ulNextId, Format::Writer& aWriter)
+			{
+				StringTable aTable;
+				for (std::vector<Node*>::const_iterator it = lsChanged.begin(); it != lsChanged.end(); ++it)
+				{
+					if ((*it)->m_ulId == Node::kNoId)
+						collect(*it, aTable);
+					else
+						collectFields(*it, aTable);
+				}
+
+				aWriter.putByte(Format::kSegmentTag);
+				size_t nLengthPos = aWriter.reserveU32();
+				size_t nChecksumPos = aWriter.reserveU32();
+				size_t nBodyPos = aWriter.getSize();
+				aTable.write(aWriter);
+				aWriter.putVarInt((unsigned long)lsChanged.size());
+
+				for (std::vector<Node*>::const_iterator it = lsChanged.begin(); it != lsChanged.end(); ++it)
+				{
+					Node *pNode = *it;
+					if (pNode->m_ulId == Node::kNoId)
+					{
+						aWriter.putByte(Format::kPatchAppend);
+						aWriter.putVarInt(((Node *)pNode->getParent())->m_ulId);
+						write(pNode, aTable, aWriter);
+						number(pNode, ulNextId);
+					}
+					else
+					{
+						aWriter.putByte(Format::kPatchFields);
+						aWriter.putVarInt(pNode->m_ulId);
+						writeFields(pNode, aTable, aWriter);
+					}
+				}
+
+				aWriter.patchU32(nChecksumPos, aWriter.getChecksum(nBodyPos));
+				aWriter.patchU32(nLengthPos, (unsigned long)(aWriter.getSize() - nBodyPos));
+			}
+
+			/**
+			 * Applies a segment to the nodes read so far.
+			 * @return False, leaving the nodes as they are, if the segment is cut off or does not match its checksum.
+			 */
+			static bool readSegment(NodeArena& aArena, Context& aContext, Format::Reader& aReader)
+			{
+				if ((size_t)(aReader.getEnd() - aReader.getPos()) < 9 || aReader.getByte() != Format::kSegmentTag)
+					return false;
+				unsigned long ulLength = aReader.getU32();
+				unsigned long ulChecksum = aReader.getU32();
+				if (ulLength > (unsigned long)(aReader.getEnd() - aReader.getPos()) || Format::checksum(aReader.getPos(), ulLength) != ulChecksum)
+					return false;
+
+				const char *pBody = aReader.getBytes(ulLength);
+				Format::Reader aBody(pBody, pBody + ulLength);
+
+				std::vector<ArenaString> lsStrings;
+				readStrings(aArena, aBody, lsStrings);
+				aContext.pStrings = &lsStrings;
+
+				std::vector<Node*>& lsNodes = *aContext.pNodes;
+				unsigned long ulPatches = aBody.getVarInt();
+				for (unsigned long i = 0; i < ulPatches; ++i)
+				{
+					unsigned char cPatch = aBody.getByte();
+					unsigned long ulTarget = aBody.getVarInt();
+					if (ulTarget >= lsNodes.size())
+						throw Format::Error("invalid patch target in binary archive");
+
+					Node *pTarget = lsNodes[ulTarget];
+					if (cPatch == Format::kPatchFields)
+						readFields(pTarget, aContext, aBody);
+					else if (cPatch == Format::kPatchAppend)
+						read(create(pTarget->getDriver(), pTarget, aContext, aBody), aContext, aBody);
+					else
+						throw Format::Error("unknown patch in binary archive");
+				}
+				aContext.pStrings = NULL;
+				return true;
+			}
+
+			/** Numbers the nodes of the subtree depth first, as they are read. Same walk as Driver::prepareConcurrentReads(). */
+			static void number(Node *pTop, unsigned long& ulNextId)
+			{
+				Node *pCurrent = pTop;
+				while (pCurrent)
+				{
+					pCurrent->m_ulId = ulNextId++;
+					if (pCurrent->m_pFirstChild)
+					{
+						pCurrent = pCurrent->m_pFirstChild;
+						continue;
+					}
+					while (pCurrent != pTop && !pCurrent->m_pNextSibling)
+						pCurrent = (Node *)pCurrent->getParent();
+					pCurrent = pCurrent != pTop ? pCurrent->m_pNextSibling : NULL;
+				}
+			}
+		};
+
+		/**
+		 * Snapshot of a Driver, see Driver::createSnapshot(). Holds the nodes of the driver that existed when it was
+		 * taken, up to the children they had then, and copies them into a driver of its own on the saving thread.
+		 * Nodes that change before they are copied hand their former fields to preserve() first, the copy takes those.
+		 * Only the last child of a node ever gets a next sibling, so the copy follows the other links without the lock.
+		 */
+		class TreeSnapshot : public IArchivingDriver::Snapshot
+		{
+		public:
+			TreeSnapshot(Driver *pDriver, const std::string& sFile)
+				: Snapshot(sFile)
+				, m_pDriver(pDriver)
+				, m_pRoot((Node *)pDriver->getRootNode())
+				, m_ulGeneration(pDriver->m_ulGeneration)
+				, m_bCopied(false)
+			{
+			}
+
+			virtual ~TreeSnapshot()
+			{
+				std::vector<TreeSnapshot*>& lsSnapshots = m_pDriver->m_lsSnapshots;
+				lsSnapshots.erase(std::find(lsSnapshots.begin(), lsSnapshots.end(), this));
+			}
+
+			/** Copies and formats the nodes, once. */
+			virtual std::string getString()
+			{
+				Driver aCopy;
+				aCopy.init();
+				aCopy.m_pRootNode = copy(aCopy, m_pRoot, NULL);
+				{
+					boost::mutex::scoped_lock aLock(m_aMutex);
+					m_bCopied = true;
+					m_mapPreserved.clear();
+				}
+				return aCopy.getString();
+			}
+
+			/** Called by the driver before pNode changes. */
+			void preserve(Node *pNode)
+			{
+				if (pNode->m_ulGeneration > m_ulGeneration)
+					return;
+
+				boost::mutex::scoped_lock aLock(m_aMutex);
+				if (m_bCopied)
+					return;
+
+				Fields& aFields = m_mapPreserved[pNode];
+				aFields.aValue = pNode->m_aValue;
+				for (Node::Attribute *pAttribute = pNode->m_pFirstAttribute; pAttribute; pAttribute = pAttribute->pNext)
+					aFields.lsAttributes.push_back(std::make_pair(pAttribute->aKey, pAttribute->aValue));
+				aFields.pFirstChild = pNode->m_pFirstChild;
+				aFields.ulChildren = pNode->m_ulChildren;
+			}
+
+		protected:
+			/** The fields of a node as the snapshot holds it. */
+			struct Fields
+			{
+				ArenaString aValue;
+				std::vector<std::pair<ArenaString, ArenaString> > lsAttributes;
+				Node *pFirstChild;
+				unsigned long ulChildren;
+			};
+
+			Node* copy(Driver& aCopy, Node *pNode, Node *pParent)
+			{
+				Node *pResult = new (&aCopy) Node(&aCopy, pParent, pNode->m_aName);
+				Node *pChild;
+				unsigned long ulChildren;
+				{
+					boost::mutex::scoped_lock aLock(m_aMutex);
+					std::map<Node*, Fields>::const_iterator it = m_mapPreserved.find(pNode);
+					if (it != m_mapPreserved.end())
+					{
+						const Fields& aFields = it->second;
+						for (size_t i = 0; i < aFields.lsAttributes.size(); ++i)
+							pResult->addAttribute(pResult->getArena(), aFields.lsAttributes[i].first, aFields.lsAttributes[i].second);
+						pResult->m_aValue = aFields.aValue;
+						pChild = aFields.pFirstChild;
+						ulChildren = aFields.ulChildren;
+					}
+					else
+					{
+						for (Node::Attribute *pAttribute = pNode->m_pFirstAttribute; pAttribute; pAttribute = pAttribute->pNext)
+							pResult->addAttribute(pResult->getArena(), pAttribute->aKey, pAttribute->aValue);
+						pResult->m_aValue = pNode->m_aValue;
+						pChild = pNode->m_pFirstChild;
+						ulChildren = pNode->m_ulChildren;
+					}
+				}
+
+				for (unsigned long i = 0; i < ulChildren; ++i)
+				{
+					copy(aCopy, pChild, pResult);
+					if (i + 1 < ulChildren)
+						pChild = pChild->m_pNextSibling;
+				}
+				return pResult;
+			}
+
+			Driver *m_pDriver;
+			Node *m_pRoot;
+			unsigned long m_ulGeneration;                /** Nodes of later generations were created after the snapshot. */
+			boost::mutex m_aMutex;                       /** Guards the fields below, and the nodes while they are preserved or copied. */
+			std::map<Node*, Fields> m_mapPreserved;
+			bool m_bCopied;
+		};
+
+		Node* BackgroundLoad::start()
+		{
+			// The strings and the root belong to the driver, they are used before the thread runs
+			NodeArena& aDriverArena = m_pDriver->getArena();
+			m_aReader = Format::Reader(m_sData.data() + Format::kHeaderSize, m_sData.data() + m_sData.size());
+			NodeCodec::readStrings(aDriverArena, m_aReader, m_lsStrings);
+			m_aType = ArenaString(aDriverArena, Node::kType);
+
+			NodeCodec::Context aContext;
+			aContext.pStrings = &m_lsStrings;
+			aContext.aType = m_aType;
+			aContext.ulNextId = 0;
+			aContext.pNodes = NULL;
+			aContext.pArena = &aDriverArena;
+			aContext.pLoad = NULL;
+
+			m_pRoot = NodeCodec::create(m_pDriver, NULL, aContext, m_aReader);
+			NodeCodec::readFields(m_pRoot, aContext, m_aReader);
+			m_ulRootChildren = m_aReader.getVarInt();
+			m_ulNextId = aContext.ulNextId;
+			m_lsPath.push_back(m_pRoot);
+			m_lsOpen = m_lsPath;
+			m_ulLinked = m_ulNextId;
+
+			m_pThread = new boost::thread(boost::bind(&BackgroundLoad::run, this));
+			return m_pRoot;
+		}
+
+		void BackgroundLoad::run()
+		{
+			NodeCodec::Context aContext;
+			aContext.pStrings = &m_lsStrings;
+			aContext.aType = m_aType;
+			aContext.ulNextId = m_ulNextId;
+			aContext.pNodes = NULL;
+			aContext.pArena = &m_aArena;
+			aContext.pLoad = this;
+
+			bool bFailed = false;
+			try
+			{
+				for (unsigned long i = 0; i < m_ulRootChildren; ++i)
+					NodeCodec::read(NodeCodec::create(m_pDriver, m_pRoot, aContext, m_aReader), aContext, m_aReader);
+				m_nBaseSize = m_aReader.getPos() - m_sData.data();
+			}
+			catch (...)
+			{
+				// Invalid data, or no memory left for it, ends the load as loadFromString() fails
+				bFailed = true;
+			}
+			m_ulNextId = aContext.ulNextId;
+			flush(m_ulNextId);
+
+			boost::mutex::scoped_lock aLock(m_aMutex);
+			m_lsOpen.clear();
+			m_bFailed = bFailed;
+			m_bDone = true;
+			m_aChanged.notify_all();
+		}
+
+		/** Con/Destructor */
+
+		Driver::Driver()
+			: m_pRootNode(NULL)
+			, m_ulErrorCount(0)
+			, m_bIsLoad(false)
+			, m_ullFileSize(0)
+			, m_ullBaseSize(0)
+			, m_ulNextId(0)
+			, m_ulGeneration(0)
+			, m_pLoad(NULL)
+		{
+		}
+
+		Driver::~Driver()
+		{
+			waitForLoad();
+		}
+
+		void Driver::init()
+		{
+		}
+
+		INode* Driver::getRootNode()
+		{
+			if (!m_pRootNode) { /* A new archiver was created without loading a file */
+				assert(m_pLoad == NULL);
+				m_pRootNode = new (this) Node(this, NULL, ArenaString(getArena(), "archive"));
+			}
+			return m_pRootNode;
+		}
+
+		bool Driver::save(std::string sPath)
+		{
+			waitForLoad();
+			if (sPath.length() == 0)
+				sPath = m_sPath;
+			if (sPath.length() == 0)
+				throw(std::runtime_error("invalid path!"));
+
+			FILE *pFile = fopen(sPath.c_str(), "wb");
+			if (pFile)
+			{
+				std::string sData = getString();
+				bool bResult = fwrite(sData.data(), sizeof(char), sData.size(), pFile) == sData.size();
+				bResult = fclose(pFile) == 0 && bResult;
+
+				// The file now stores all nodes, numbered as a load would number them
+				m_ulNextId = 0;
+				number((Node *)getRootNode());
+				setBase(bResult ? sPath : std::string(), sData.size(), sData.size());
+				return bResult;
+			}
+
+			return false;
+		}
+
+		bool Driver::saveChanges(std::string sPath)
+		{
+			waitForLoad();
+			if (sPath.length() == 0)
+				sPath = m_sPath;
+			if (sPath.length() == 0)
+				throw(std::runtime_error("invalid path!"));
+
+			if (sPath != m_sBasePath || m_ullFileSize - m_ullBaseSize > m_ullBaseSize)
+				return save(sPath);
+
+			FILE *pFile = fopen(sPath.c_str(), "r+b");
+			if (!pFile)
+				return save(sPath);
+
+			// Someone else wrote the file if it has another size, or an append did not complete
+			_fseeki64(pFile, 0, SEEK_END);
+			if ((unsigned long long)_ftelli64(pFile) != m_ullFileSize)
+			{
+				fclose(pFile);
+				return save(sPath);
+			}
+			if (m_lsChanged.empty())
+			{
+				fclose(pFile);
+				return true;
+			}
+
+			std::string sData;
+			Format::Writer aWriter(sData);
+			NodeCodec::writeSegment(m_lsChanged, m_ulNextId, aWriter);
+
+			// The segment is written before the flag, a reader ignores it until the flag is set
+			unsigned char cFlags = Format::kFlagSegments;
+			bool bResult = fwrite(sData.data(), sizeof(char), sData.size(), pFile) == sData.size()
+				&& fflush(pFile) == 0
+				&& _fseeki64(pFile, Format::kFlagsOffset, SEEK_SET) == 0
+				&& fwrite(&cFlags, 1, 1, pFile) == 1;
+			bResult = fclose(pFile) == 0 && bResult;
+
+			// After a failed write, the next call saves the whole archive
+			setBase(bResult ? sPath : std::string(), m_ullFileSize + sData.size(), m_ullBaseSize);
+			return bResult;
+		}
+
+		void Driver::setBase(const std::string& sPath, unsigned long long ullFileSize, unsigned long long ullBaseSize)
+		{
+			for (std::vector<Node*>::iterator it = m_lsChanged.begin(); it != m_lsChanged.end(); ++it)
+				(*it)->m_bChanged = false;
+			m_lsChanged.clear();
+
+			m_sBasePath = sPath;
+			m_ullFileSize = ullFileSize;
+			m_ullBaseSize = ullBaseSize;
+		}
+
+		void Driver::dropChanges()
+		{
+			waitForLoad();
+			setBase(std::string(), 0, 0);
+		}
+
+		void Driver::number(Node *pNode)
+		{
+			NodeCodec::number(pNode, m_ulNextId);
+		}
+
+		IArchivingDriver::Snapshot* Driver::createSnapshot(std::string sPath)
+		{
+			waitForLoad();
+			if (sPath.length() == 0)
+				sPath = m_sPath;
+			if (sPath.length() == 0)
+				throw(std::runtime_error("invalid path!"));
+
+			// The ids are those of the file as the driver left it, the snapshot writes it anew
+			setBase(std::string(), 0, 0);
+
+			TreeSnapshot *pSnapshot = new TreeSnapshot(this, sPath);
+			m_lsSnapshots.push_back(pSnapshot);
+			++m_ulGeneration;
+			return pSnapshot;
+		}
+
+		void Driver::preserve(Node *pNode)
+		{
+			for (std::vector<TreeSnapshot*>::iterator it = m_lsSnapshots.begin(); it != m_lsSnapshots.end(); ++it)
+				(*it)->preserve(pNode);
+			pNode->m_ulGeneration = m_ulGeneration;
+		}
+
+		std::string Driver::getString()
+		{
+			waitForLoad();
+			Node *pRoot = (Node *)getRootNode();
+
+			StringTable aTable;
+			NodeCodec::collect(pRoot, aTable);
+
+			std::string sData;
+			Format::Writer aWriter(sData);
+			aWriter.putBytes(Format::kMagic, sizeof(Format::kMagic));
+			aWriter.putByte(Format::kVersion);
+			aWriter.putByte(0);
+			aTable.write(aWriter);
+			NodeCodec::write(pRoot, aTable, aWriter);
+
+			return sData;
+		}
+
+		bool Driver::loadFromFile(const std::string& sFile)
+		{
+			waitForLoad();
+			std::string sData;
+			if (!readFile(sFile, sData))
+				return (m_bIsLoad = false);
+
+			m_sPath = sFile;
+			if (!loadFromString(sData))
+				return false;
+
+			setBase(sFile, m_ullFileSize, m_ullBaseSize);
+			return true;
+		}
+
+		bool Driver::loadFromString(const std::string& sData)
+		{
+			reset();
+			m_ulErrorCount = 0;
+
+			try
+			{
+				if (!Format::hasHeader(sData.data(), sData.size()))
+					throw Format::Error("not a binary archive");
+
+				Format::Reader aReader(sData.data() + Format::kHeaderSize, sData.data() + sData.size());
+
+				std::vector<ArenaString> lsStrings;
+				NodeCodec::readStrings(getArena(), aReader, lsStrings);
+
+				// The segments address nodes by their number, which needs the nodes in a table
+				std::vector<Node*> lsNodes;
+				bool bSegments = (sData[Format::kFlagsOffset] & Format::kFlagSegments) != 0;
+
+				NodeCodec::Context aContext;
+				aContext.pStrings = &lsStrings;
+				aContext.aType = ArenaString(getArena(), Node::kType);
+				aContext.ulNextId = 0;
+				aContext.pNodes = bSegments ? &lsNodes : NULL;
+				aContext.pArena = &getArena();
+				aContext.pLoad = NULL;
+
+				m_pRootNode = NodeCodec::create(this, NULL, aContext, aReader);
+				NodeCodec::read(m_pRootNode, aContext, aReader);
+				m_ullBaseSize = m_ullFileSize = aReader.getPos() - sData.data();
+
+				// The file ends after the last complete segment, the rest is left by an append that did not complete
+				while (bSegments && aReader.getPos() != aReader.getEnd())
+				{
+					if (!NodeCodec::readSegment(getArena(), aContext, aReader))
+					{
+						++m_ulErrorCount;
+						break;
+					}
+					m_ullFileSize = aReader.getPos() - sData.data();
+				}
+				m_ulNextId = aContext.ulNextId;
+			}
+			catch (Format::Error&)
+			{
+				++m_ulErrorCount;
+				reset();
+				return (m_bIsLoad = false);
+			}
+
+			return (m_bIsLoad = true);
+		}
+
+		bool Driver::loadFromFileAsync(const std::string& sFile)
+		{
+			waitForLoad();
+			std::string sData;
+			if (!readFile(sFile, sData))
+				return (m_bIsLoad = false);
+
+			m_sPath = sFile;
+			return startLoad(sData, sFile);
+		}
+
+		bool Driver::loadFromStringAsync(const std::string& sData)
+		{
+			std::string sCopy(sData);
+			return startLoad(sCopy, std::string());
+		}
+
+		bool Driver::startLoad(std::string& sData, const std::string& sFile)
+		{
+			if (!Format::hasHeader(sData.data(), sData.size()) || (sData[Format::kFlagsOffset] & Format::kFlagSegments))
+			{
+				if (!loadFromString(sData))
+					return false;
+				if (sFile.length())
+					setBase(sFile, m_ullFileSize, m_ullBaseSize);
+				return true;
+			}
+
+			reset();
+			m_ulErrorCount = 0;
+
+			BackgroundLoad *pLoad = new BackgroundLoad(this, sData, sFile);
+			try
+			{
+				m_pRootNode = pLoad->start();
+			}
+			catch (Format::Error&)
+			{
+				delete pLoad;
+				++m_ulErrorCount;
+				reset();
+				return (m_bIsLoad = false);
+			}
+			catch (...)
+			{
+				delete pLoad;
+				reset();
+				throw;
+			}
+
+			m_pLoad = pLoad;
+			return (m_bIsLoad = true);
+		}
+
+		bool Driver::isParsed(Node *pNode)
+		{
+			return m_pLoad->isComplete(pNode);
+		}
+
+		bool Driver::waitForLoad()
+		{
+			if (!m_pLoad)
+				return m_bIsLoad;
+
+			BackgroundLoad *pLoad = m_pLoad;
+			m_pLoad = NULL;
+			pLoad->join();
+
+			getArena().adopt(pLoad->getArena());
+			m_ulNextId = pLoad->getNextId();
+			if (pLoad->hasFailed())
+			{
+				++m_ulErrorCount;
+				m_bIsLoad = false;
+			}
+			else
+			{
+				m_ullBaseSize = pLoad->getBaseSize();
+				if (pLoad->getFile().length())
+					setBase(pLoad->getFile(), m_ullBaseSize, m_ullBaseSize);
+			}
+
+			delete pLoad;
+			return m_bIsLoad;
+		}
+
+		INode* Driver::getChildWhileLoading(Node *pNode, const std::string& sKey, Symbol ulType)
+		{
+			INode *pChild;
+			bool bDone;
+			{
+				// A later child with the same key replaces an earlier one in the index, as a key set again with another
+				// type adds one. The child found is only the one a complete node returns once no more can follow.
+				boost::mutex::scoped_lock aLock(m_pLoad->getMutex());
+				while (m_pLoad->isOpen(pNode))
+					m_pLoad->wait(aLock, pNode);
+				if (pNode->m_pLastIndexed != pNode->m_pLastChild)
+					pNode->indexChildren();
+				pChild = pNode->findChild(sKey, ulType);
+				m_pLoad->see();
+				bDone = m_pLoad->isDone();
+			}
+
+			if (bDone)
+				waitForLoad();
+			return pChild;
+		}
+
+		INode* Driver::getNextChildWhileLoading(Node *pNode, INode *pChild, const std::string& sKey)
+		{
+			Node *pNext;
+			bool bDone;
+			{
+				boost::mutex::scoped_lock aLock(m_pLoad->getMutex());
+				while (!(pNext = pChild ? ((Node *)pChild)->m_pNextSibling : pNode->m_pFirstChild) && m_pLoad->isOpen(pNode))
+					m_pLoad->wait(aLock, pNode);
+				m_pLoad->see();
+				bDone = m_pLoad->isDone();
+			}
+
+			if (bDone)
+				waitForLoad();
+			return pNext && pNext->m_aName == sKey ? pNext : NULL;
+		}
+
+		bool Driver::hasChildrenWhileLoading(Node *pNode)
+		{
+			bool bChildren;
+			bool bDone;
+			{
+				boost::mutex::scoped_lock aLock(m_pLoad->getMutex());
+				while (!(bChildren = pNode->m_ulChildren != 0) && m_pLoad->isOpen(pNode))
+					m_pLoad->wait(aLock, pNode);
+				m_pLoad->see();
+				bDone = m_pLoad->isDone();
+			}
+
+			if (bDone)
+				waitForLoad();
+			return bChildren;
+		}
+
+		/*
+		 *
+		 */
+		unsigned long Driver::getErrorCount()
+		{
+			return m_ulErrorCount;
+		}
+
+		bool Driver::getIsLoad()
+		{
+			return m_bIsLoad;
+		}
+
+		bool Driver::prepareConcurrentReads(INode *pNode)
+		{
+			waitForLoad();
+
+			// Depth first without recursion, following the sibling links back up through the parents
+			Node *pTop = (Node *)pNode;
+			Node *pCurrent = pTop;
+			while (pCurrent)
+			{
+				pCurrent->getTypeSymbol();
+				if (pCurrent->m_pLastIndexed != pCurrent->m_pLastChild)
+					pCurrent->indexChildren();
+				if (pCurrent->m_pFirstChild)
+				{
+					pCurrent = pCurrent->m_pFirstChild;
+					continue;
+				}
+				while (pCurrent != pTop && !pCurrent->m_pNextSibling)
+					pCurrent = (Node *)pCurrent->getParent();
+				pCurrent = pCurrent != pTop ? pCurrent->m_pNextSibling : NULL;
+			}
+			return true;
+		}
+
+		IArchivingDriver* Driver::createFragment(INode *pParent)
+		{
+			Driver *pFragment = new Driver();
+			pFragment->init();
+			return pFragment;
+		}
+
+		void Driver::appendFragment(INode *pParent, IArchivingDriver *pFragment)
+		{
+			waitForLoad();
+			assert(m_pLoad == NULL);
+			Driver *pSource = dynamic_cast<Driver *>(pFragment);
+			if (!pSource)
+				throw(std::runtime_error("the fragment belongs to another driver!"));
+
+			Node *pTarget = (Node *)pParent;
+			Node *pSourceRoot = (Node *)pSource->getRootNode();
+			Node *pFirst = pSourceRoot->m_pFirstChild;
+			if (!pFirst)
+				return;
+
+			adoptNodes(*pSource);
+			pSource->m_pRootNode = NULL;
+
+			pTarget->preserve();
+			if (pTarget->m_pLastChild)
+				pTarget->m_pLastChild->m_pNextSibling = pFirst;
+			else
+				pTarget->m_pFirstChild = pFirst;
+			pTarget->m_pLastChild = pSourceRoot->m_pLastChild;
+			pTarget->m_ulChildren += pSourceRoot->m_ulChildren;
+
+			// The target indexes the appended children on its next lookup, and saveChanges() adds them to a stored target
+			for (Node *pChild = pFirst; pChild; pChild = pChild->m_pNextSibling)
+			{
+				pChild->setParentLink(pTarget, this);
+				reindex(pChild);
+				if (pTarget->m_ulId != Node::kNoId)
+					m_lsChanged.push_back(pChild);
+			}
+		}
+
+		void Driver::reindex(Node *pNode)
+		{
+			// The symbols of the fragment mean nothing here, the indexes are filled again on lookup.
+			// Same walk as prepareConcurrentReads().
+			Node *pCurrent = pNode;
+			while (pCurrent)
+			{
+				pCurrent->resetTypeSymbol();
+				pCurrent->clearChildIndex();
+				pCurrent->m_pLastIndexed = NULL;
+				pCurrent->m_ulGeneration = m_ulGeneration;
+
+				if (pCurrent->m_pFirstChild)
+				{
+					pCurrent = pCurrent->m_pFirstChild;
+					continue;
+				}
+				while (pCurrent != pNode && !pCurrent->m_pNextSibling)
+					pCurrent = (Node *)pCurrent->getParent();
+				pCurrent = pCurrent != pNode ? pCurrent->m_pNextSibling : NULL;
+			}
+		}
+
+		void Driver::reset()
+		{
+			waitForLoad();
+			setBase(std::string(), 0, 0);
+			m_ulNextId = 0;
+			releaseNodes();
+			m_pRootNode = NULL;
+			getRootNode();
+		}
+	}
+}
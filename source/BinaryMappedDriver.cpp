@@ -0,0 +1,184 @@
+#pragma hdrstop
+
+#include "StdAfx.h"
+#include <cstdio>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "../GlobExport/BinaryMappedNode.hpp"
+#include "../GlobExport/BinaryMappedDriver.hpp"
+#include "../GlobExport/ArchiveUtil.hpp"
+#include "../include/BinaryFormat.h"
+
+using namespace boost::interprocess;
+
+namespace Archiving
+{
+	namespace Binary
+	{
+		/** Con/Destructor */
+
+		MappedDriver::MappedDriver()
+			: m_pMapping(NULL)
+			, m_pRegion(NULL)
+			, m_pData(NULL)
+			, m_nSize(0)
+			, m_pStrings(new Format::StringTableView())
+			, m_pRootNode(NULL)
+			, m_ulErrorCount(0)
+			, m_bIsLoad(false)
+		{
+		}
+
+		MappedDriver::~MappedDriver()
+		{
+			close();
+			delete m_pStrings;
+		}
+
+		void MappedDriver::init()
+		{
+		}
+
+		bool MappedDriver::open()
+		{
+			m_ulErrorCount = 0;
+
+			try
+			{
+				if (!Format::hasHeader(m_pData, m_nSize))
+					throw Format::Error("not a binary archive");
+
+				// The patches of the segments can not be applied in place
+				if (m_pData[Format::kFlagsOffset] & Format::kFlagSegments)
+					throw Format::Error("binary archive with segments");
+
+				Format::Reader aReader(m_pData + Format::kHeaderSize, m_pData + m_nSize);
+				m_pStrings->read(aReader);
+
+				m_pRootNode = new MappedNode(this, NULL);
+				if (!m_pRootNode->setRecord(aReader.getPos(), aReader.getEnd()))
+					throw Format::Error("invalid root record in binary archive");
+			}
+			catch (Format::Error&)
+			{
+				++m_ulErrorCount;
+				close();
+				return (m_bIsLoad = false);
+			}
+
+			return (m_bIsLoad = true);
+		}
+
+		void MappedDriver::close()
+		{
+			delete m_pRootNode;
+			m_pRootNode = NULL;
+
+			delete m_pRegion;
+			m_pRegion = NULL;
+			delete m_pMapping;
+			m_pMapping = NULL;
+
+			m_sData.clear();
+			m_pData = NULL;
+			m_nSize = 0;
+		}
+
+		INode* MappedDriver::getRootNode()
+		{
+			if (!m_pRootNode) /* Nothing loaded: provide an empty root so that all lookups fail */
+			{
+				static const char aEmpty[] = {
+					'K', 'V', 'A', 'B', Format::kVersion, 0,                 // header
+					1, 0, 0, 0, 0, 0, 0, 0, 7, 0, 0, 0,                      // string table with one entry
+					'a', 'r', 'c', 'h', 'i', 'v', 'e',
+					Format::kNodeTag, 5, 0, 0, 0, 0, 0, 0, 0, 0};            // root node "archive" without content
+
+				m_pData = aEmpty;
+				m_nSize = sizeof(aEmpty);
+				Format::Reader aReader(m_pData + Format::kHeaderSize, m_pData + m_nSize);
+				m_pStrings->read(aReader);
+
+				m_pRootNode = new MappedNode(this, NULL);
+				m_pRootNode->setRecord(aReader.getPos(), aReader.getEnd());
+			}
+			return m_pRootNode;
+		}
+
+		bool MappedDriver::save(std::string sPath)
+		{
+			if (sPath.length() == 0)
+				sPath = m_sPath;
+			if (sPath.length() == 0)
+				throw(std::runtime_error("invalid path!"));
+
+			FILE *pFile = fopen(sPath.c_str(), "wb");
+			if (pFile)
+			{
+				bool bResult = fwrite(m_pData, sizeof(char), m_nSize, pFile) == m_nSize;
+				fclose(pFile);
+
+				return bResult;
+			}
+
+			return false;
+		}
+
+		std::string MappedDriver::getString()
+		{
+			return m_pData ? std::string(m_pData, m_nSize) : std::string();
+		}
+
+		bool MappedDriver::loadFromFile(const std::string& sFile)
+		{
+			close();
+
+			try
+			{
+				m_pMapping = new file_mapping(sFile.c_str(), read_only);
+				m_pRegion = new mapped_region(*m_pMapping, read_only);
+			}
+			catch (interprocess_exception&)
+			{
+				close();
+				return (m_bIsLoad = false);
+			}
+
+			m_pData = (const char *)m_pRegion->get_address();
+			m_nSize = m_pRegion->get_size();
+			m_sPath = sFile;
+			return open();
+		}
+
+		bool MappedDriver::loadFromString(const std::string& sData)
+		{
+			close();
+
+			m_sData = sData;
+			m_pData = m_sData.data();
+			m_nSize = m_sData.size();
+			return open();
+		}
+
+		/*
+		 *
+		 */
+		unsigned long MappedDriver::getErrorCount()
+		{
+			return m_ulErrorCount;
+		}
+
+		bool MappedDriver::getIsLoad()
+		{
+			return m_bIsLoad;
+		}
+
+		void MappedDriver::reset()
+		{
+			close();
+			getRootNode();
+		}
+	}
+}
@@ -0,0 +1,202 @@
+#pragma hdrstop
+
+#include "stdafx.h"
+
+#include "../GlobExport/BinaryMappedNode.hpp"
+#include "../GlobExport/BinaryMappedDriver.hpp"
+#include "../include/BinaryFormat.h"
+
+namespace Archiving
+{
+	namespace Binary
+	{
+		/** Con/Destructor */
+
+		MappedNode::MappedNode(MappedDriver *pDriver, MappedNode *pParentNode)
+			: m_pMappedDriver(pDriver)
+			, m_pRecordEnd(NULL)
+			, m_ulName(0)
+			, m_ulType(0)
+			, m_pAttributes(NULL)
+			, m_ulAttributes(0)
+			, m_pValue(NULL)
+			, m_ulValueLength(0)
+			, m_pChildren(NULL)
+			, m_ulChildren(0)
+			, m_pCursor(NULL)
+			, m_pChildView(NULL)
+		{
+			setParentLink(pParentNode, pDriver);
+		}
+
+		MappedNode::~MappedNode()
+		{
+			delete m_pChildView;
+		}
+
+		bool MappedNode::setRecord(const char *pRecord, const char *pEnd)
+		{
+			// The child view is repositioned for every lookup
+			resetTypeSymbol();
+
+			try
+			{
+				Format::Reader aReader(pRecord, pEnd);
+				if (aReader.getByte() != Format::kNodeTag)
+					return false;
+
+				unsigned long ulLength = aReader.getU32();
+				if (ulLength > (unsigned long)(pEnd - aReader.getPos()))
+					return false;
+				aReader = Format::Reader(aReader.getPos(), aReader.getPos() + ulLength);
+				m_pRecordEnd = aReader.getEnd();
+
+				m_ulName = aReader.getVarInt();
+				m_ulType = aReader.getVarInt();
+
+				m_ulAttributes = aReader.getVarInt();
+				m_pAttributes = aReader.getPos();
+				for (unsigned long i = 0; i < m_ulAttributes; ++i)
+				{
+					aReader.getVarInt();
+					aReader.getVarInt();
+				}
+
+				m_ulValueLength = aReader.getVarInt();
+				m_pValue = aReader.getBytes(m_ulValueLength);
+
+				m_ulChildren = aReader.getVarInt();
+				m_pChildren = m_pCursor = aReader.getPos();
+			}
+			catch (Format::Error&)
+			{
+				return false;
+			}
+			return true;
+		}
+
+		/** Accessors */
+
+		std::string MappedNode::getTagName()
+		{
+			return m_pMappedDriver->m_pStrings->get(m_ulName);
+		}
+
+		std::string MappedNode::getAttribute(const std::string& sKey)
+		{
+			const Format::StringTableView& aStrings = *m_pMappedDriver->m_pStrings;
+
+			if (sKey == "type")
+				return m_ulType ? aStrings.get(m_ulType - 1) : std::string();
+
+			Format::Reader aReader(m_pAttributes, m_pRecordEnd);
+			for (unsigned long i = 0; i < m_ulAttributes; ++i)
+			{
+				unsigned long ulKey = aReader.getVarInt();
+				unsigned long ulValue = aReader.getVarInt();
+				if (aStrings.equals(ulKey, sKey.data(), sKey.size()))
+					return aStrings.get(ulValue);
+			}
+			return std::string();
+		}
+
+		void MappedNode::setAttribute(const std::string& sKey, const std::string& sValue)
+		{
+			throw(std::runtime_error("mapped binary archives are read-only!"));
+		}
+
+		void MappedNode::setPackedValue(Symbol ulElementType, const void *pValues, unsigned long ulCount)
+		{
+			throw(std::runtime_error("mapped binary archives are read-only!"));
+		}
+
+		/* Copies the packed bytes straight out of the mapping */
+		bool MappedNode::getPackedValue(Symbol ulElementType, void *pValues, unsigned long ulCount)
+		{
+			return Format::unpackValues(ulElementType, m_pValue, m_ulValueLength, pValues, ulCount);
+		}
+
+		std::string MappedNode::getValue()
+		{
+			return std::string(m_pValue, m_ulValueLength);
+		}
+
+		void MappedNode::getValue(std::string& sValue)
+		{
+			sValue.assign(m_pValue, m_ulValueLength);
+		}
+
+		void MappedNode::setValue(const std::string& sValue)
+		{
+			throw(std::runtime_error("mapped binary archives are read-only!"));
+		}
+
+		bool MappedNode::matchChild(const char*& pRecord, const std::string& sKey, const std::string& sType, const char*& pMatch)
+		{
+			Format::Reader aReader(pRecord, m_pRecordEnd);
+			if (aReader.getByte() != Format::kNodeTag)
+				throw Format::Error("unknown record tag in binary archive");
+			unsigned long ulLength = aReader.getU32();
+			if (ulLength > (unsigned long)(m_pRecordEnd - aReader.getPos()))
+				throw Format::Error("invalid record length in binary archive");
+
+			pMatch = pRecord;
+			pRecord = aReader.getPos() + ulLength;
+			if (!m_pMappedDriver->m_pStrings->equals(aReader.getVarInt(), sKey.data(), sKey.size()))
+				return false;
+
+			// The type semantics of INode::getChild()
+			if (sType == "*")
+				return true;
+			unsigned long ulType = aReader.getVarInt();
+			return ulType && m_pMappedDriver->m_pStrings->equals(ulType - 1, sType.data(), sType.size());
+		}
+
+		/* Returns a child (search-depth = 1) for the given tag-name or NULL if it doesnt exist */
+		INode* MappedNode::getChild(const std::string& sKey, const std::string& sType /*="*"*/)
+		{
+			// The type must not be empty
+			if (!m_ulChildren || sType == "")
+				return NULL;
+
+			// Scan from the cursor to the end, then wrap around to the first child.
+			// A child with the key but another type is passed over, a later one with the key may have the type.
+			const char *pMatch = NULL;
+			try
+			{
+				const char *pRecord = m_pCursor;
+				bool bFound = false;
+				while (!bFound && pRecord < m_pRecordEnd)
+					bFound = matchChild(pRecord, sKey, sType, pMatch);
+
+				if (!bFound)
+				{
+					const char *pStop = m_pCursor;
+					pRecord = m_pChildren;
+					while (!bFound && pRecord < pStop)
+						bFound = matchChild(pRecord, sKey, sType, pMatch);
+				}
+
+				if (!bFound)
+					return NULL;
+
+				m_pCursor = pRecord < m_pRecordEnd ? pRecord : m_pChildren;
+			}
+			catch (Format::Error&)
+			{
+				return NULL;
+			}
+
+			if (!m_pChildView)
+				m_pChildView = new MappedNode(m_pMappedDriver, this);
+			if (!m_pChildView->setRecord(pMatch, m_pRecordEnd))
+				return NULL;
+			return m_pChildView;
+		}
+
+		INode* MappedNode::addChild(const std::string& sKey)
+		{
+			throw(std::runtime_error("mapped binary archives are read-only!"));
+		}
+	}
+}
@@ -0,0 +1,204 @@
+#pragma hdrstop
+
+#include "stdafx.h"
+#include <new>
+#include <cassert>
+
+#include "../GlobExport/BinaryNode.hpp"
+#include "../GlobExport/BinaryDriver.hpp"
+#include "../include/BinaryFormat.h"
+
+namespace Archiving
+{
+	namespace Binary
+	{
+		/** Con/Destructor */
+
+		Node::Node(IArchivingDriver *pDriver, Node *pParentNode, const ArenaString& aName)
+			: m_aName(aName)
+			, m_pFirstAttribute(NULL)
+			, m_pLastAttribute(NULL)
+			, m_pFirstChild(NULL)
+			, m_pLastChild(NULL)
+			, m_pNextSibling(NULL)
+			, m_pLastIndexed(NULL)
+			, m_ulChildren(0)
+			, m_ulId(kNoId)
+			, m_bChanged(false)
+			, m_ulGeneration(((Driver *)pDriver)->m_ulGeneration)
+		{
+			setDriver(pDriver);
+
+			if (pParentNode)
+				pParentNode->linkChild(this);
+		}
+
+		Node::~Node()
+		{
+		}
+
+		/** Accessors */
+
+		std::string Node::getTagName()
+		{
+			return m_aName.str();
+		}
+
+		Node::Attribute* Node::findAttribute(const char *pKey, size_t nLength)
+		{
+			for (Attribute *pAttribute = m_pFirstAttribute; pAttribute; pAttribute = pAttribute->pNext)
+				if (pAttribute->aKey.equals(pKey, nLength))
+					return pAttribute;
+
+			return NULL;
+		}
+
+		void Node::addAttribute(NodeArena& aArena, const ArenaString& aKey, const ArenaString& aValue)
+		{
+			Attribute *pAttribute = new (aArena.allocate(sizeof(Attribute))) Attribute();
+			pAttribute->aKey = aKey;
+			pAttribute->aValue = aValue;
+			pAttribute->pNext = NULL;
+
+			if (m_pLastAttribute)
+				m_pLastAttribute->pNext = pAttribute;
+			else
+				m_pFirstAttribute = pAttribute;
+			m_pLastAttribute = pAttribute;
+		}
+
+		std::string Node::getAttribute(const std::string& sKey)
+		{
+			Attribute *pAttribute = findAttribute(sKey.data(), sKey.length());
+			return pAttribute ? pAttribute->aValue.str() : std::string();
+		}
+
+		void Node::setAttribute(const std::string& sKey, const std::string& sValue)
+		{
+			waitForLoad();
+			if (sKey == kType)
+				resetTypeSymbol();
+
+			if (Attribute *pAttribute = findAttribute(sKey.data(), sKey.length()))
+			{
+				if (pAttribute->aValue.equals(sValue.data(), sValue.length()))
+					return;
+				preserve();
+				pAttribute->aValue = ArenaString(getArena(), sValue);
+			}
+			else
+			{
+				preserve();
+				addAttribute(getArena(), ArenaString(getArena(), sKey), ArenaString(getArena(), sValue));
+			}
+			markChanged();
+		}
+
+		std::string Node::getValue()
+		{
+			return m_aValue.str();
+		}
+
+		void Node::setValue(const std::string& sValue)
+		{
+			waitForLoad();
+			// Serializing an unchanged object again leaves its nodes unchanged
+			if (m_aValue.equals(sValue.data(), sValue.length()))
+				return;
+			preserve();
+			m_aValue = ArenaString(getArena(), sValue);
+			markChanged();
+		}
+
+		/* Packed arrays are stored as their bytes, see BinaryFormat.h */
+		void Node::setPackedValue(Symbol ulElementType, const void *pValues, unsigned long ulCount)
+		{
+			size_t nWidth = Format::getPackedWidth(ulElementType);
+			if (!nWidth)
+				throw(std::runtime_error("type can not be packed!"));
+
+			char *pBytes;
+			waitForLoad();
+			preserve();
+			m_aValue = ArenaString(getArena(), nWidth * ulCount, pBytes);
+			Format::packValues(ulElementType, pValues, ulCount, pBytes);
+			markChanged();
+		}
+
+		bool Node::getPackedValue(Symbol ulElementType, void *pValues, unsigned long ulCount)
+		{
+			return Format::unpackValues(ulElementType, m_aValue.data(), m_aValue.length(), pValues, ulCount);
+		}
+
+		/* Returns a child (search-depth = 1) for the given tag-name or NULL if it doesnt exist */
+		INode* Node::getChild(const std::string& sKey, Symbol ulType)
+		{
+			Driver *pDriver = (Driver *)getDriver();
+			if (pDriver->m_pLoad && !pDriver->isParsed(this))
+				return pDriver->getChildWhileLoading(this, sKey, ulType);
+
+			// The type is compared by symbol
+			if (m_pLastIndexed != m_pLastChild)
+				indexChildren();
+			return findChild(sKey, ulType);
+		}
+
+		void Node::indexChildren()
+		{
+			for (Node *pChild = m_pLastIndexed ? m_pLastIndexed->m_pNextSibling : m_pFirstChild; pChild; pChild = pChild->m_pNextSibling)
+			{
+				indexChild(pChild, getSymbols().intern(pChild->m_aName.data(), pChild->m_aName.length()));
+				m_pLastIndexed = pChild;
+			}
+		}
+
+		INode* Node::addChild(const std::string& sKey)
+		{
+			// The thread of the load registers its nodes with the driver unlocked, see BackgroundLoad
+			waitForLoad();
+			assert(((Driver *)getDriver())->m_pLoad == NULL);
+			Node *pChild = new (getDriver()) Node(getDriver(), this, ArenaString(getArena(), sKey));
+			if (m_ulId != kNoId)
+				((Driver *)getDriver())->m_lsChanged.push_back(pChild);
+			return pChild;
+		}
+
+		void Node::preserve()
+		{
+			// Nodes created or preserved since the last snapshot are not held by any
+			Driver *pDriver = (Driver *)getDriver();
+			if (m_ulGeneration != pDriver->m_ulGeneration)
+				pDriver->preserve(this);
+		}
+
+		void Node::linkChild(Node *pChild)
+		{
+			preserve();
+			pChild->setParentLink(this, getDriver());
+
+			if (m_pLastChild)
+				m_pLastChild->m_pNextSibling = pChild;
+			else
+				m_pFirstChild = pChild;
+			m_pLastChild = pChild;
+			++m_ulChildren;
+		}
+
+		void Node::waitForLoad()
+		{
+			Driver *pDriver = (Driver *)getDriver();
+			if (pDriver->m_pLoad)
+				pDriver->waitForLoad();
+		}
+
+		void Node::markChanged()
+		{
+			if (m_ulId == kNoId || m_bChanged)
+				return;
+			m_bChanged = true;
+			((Driver *)getDriver())->m_lsChanged.push_back(this);
+		}
+
+		const std::string Node::kType = "type";
+	}
+}
@@ -0,0 +1,74 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <windows.h>
+#include <map>
+#include <boost/thread/mutex.hpp>
+
+#include "../GlobExport/ClassRegistry.hpp"
+#include "../GlobExport/IArchivableObject.hpp"
+
+namespace Archiving
+{
+	struct Registry
+	{
+		Registry() : lGeneration(0) {;}
+
+		std::map<std::string, ClassRegistry::Factory> mapClasses;
+		boost::mutex aMutex;
+		volatile long lGeneration;   /** Raised after each change of mapClasses, with the lock held. */
+	};
+
+	/** Created by the first registration, which may come from the static initialization of another module. */
+	static Registry& getRegistry()
+	{
+		static Registry s_aRegistry;
+		return s_aRegistry;
+	}
+
+	/** Created while the module is loaded at the latest, before archives are read on other threads. */
+	static Registry& s_aRegistry = getRegistry();
+
+	void ClassRegistry::registerClass(const std::string& sName, CreateFunction pCreate, DestroyFunction pDestroy)
+	{
+		Factory aFactory = {pCreate, pDestroy};
+		Registry& aRegistry = getRegistry();
+		boost::mutex::scoped_lock aLock(aRegistry.aMutex);
+		aRegistry.mapClasses[sName] = aFactory;
+		InterlockedIncrement(&aRegistry.lGeneration);
+	}
+
+	void ClassRegistry::unregisterClass(const std::string& sName)
+	{
+		Registry& aRegistry = getRegistry();
+		boost::mutex::scoped_lock aLock(aRegistry.aMutex);
+		aRegistry.mapClasses.erase(sName);
+		InterlockedIncrement(&aRegistry.lGeneration);
+	}
+
+	ClassRegistry::Factory ClassRegistry::find(const std::string& sName)
+	{
+		Registry& aRegistry = getRegistry();
+		boost::mutex::scoped_lock aLock(aRegistry.aMutex);
+		std::map<std::string, Factory>::const_iterator it = aRegistry.mapClasses.find(sName);
+		if (it != aRegistry.mapClasses.end())
+			return it->second;
+
+		Factory aNone = {NULL, NULL};
+		return aNone;
+	}
+
+	long ClassRegistry::getGeneration()
+	{
+		return InterlockedCompareExchange(&getRegistry().lGeneration, 0, 0);
+	}
+
+	void ClassRegistry::destroy(IArchivableObject *pObject, DestroyFunction pDestroy)
+	{
+		if (pObject && pDestroy)
+			pDestroy(pObject);
+		else
+			delete pObject;
+	}
+}
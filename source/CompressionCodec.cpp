@@ -0,0 +1,254 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+#include "../GlobExport/CompressionCodec.hpp"
+#include "../GlobExport/ArchiveExecutor.hpp"
+#include "../include/BinaryFormat.h"
+
+namespace Archiving
+{
+	static const char kMagic[4] = {'K', 'V', 'A', 'Z'};
+	static const unsigned char kVersion = 1;
+	static const size_t kHeaderSize = 10;
+
+	/** The most deflate expands a byte of packed data to, the limit for the raw size in the chunk table. */
+	static const unsigned long kMaxRatio = 1032;
+
+	static ArchiveExecutor *s_pExecutor = NULL;
+
+	/** Runs the chunks on the executor if there is one and more than one chunk, else on the calling thread. */
+	static void runChunks(ArchiveExecutor::ITask& aTask, unsigned long ulChunks)
+	{
+		if (s_pExecutor && ulChunks > 1)
+			s_pExecutor->execute(aTask, ulChunks);
+		else if (ulChunks)
+			aTask.run(0, 0, ulChunks);
+	}
+
+	/** Deflates chunk i of the data into lsPacked[i]. */
+	class CompressTask : public ArchiveExecutor::ITask
+	{
+	public:
+		CompressTask(const std::string& sData, size_t nChunkSize, int nLevel, std::vector<std::string>& lsPacked)
+			: m_sData(sData), m_nChunkSize(nChunkSize), m_nLevel(nLevel), m_lsPacked(lsPacked) {;}
+
+		virtual void run(unsigned nSlice, unsigned long ulBegin, unsigned long ulEnd)
+		{
+			for (unsigned long i = ulBegin; i < ulEnd; ++i)
+			{
+				size_t nOffset = i * m_nChunkSize;
+				uLong ulRaw = (uLong)std::min(m_nChunkSize, m_sData.size() - nOffset);
+				uLongf ulPacked = compressBound(ulRaw);
+
+				std::string& sPacked = m_lsPacked[i];
+				sPacked.resize(ulPacked);
+				if (compress2((Bytef *)&sPacked[0], &ulPacked, (const Bytef *)m_sData.data() + nOffset, ulRaw, m_nLevel) != Z_OK)
+					throw(std::runtime_error("compressing the archive failed!"));
+				sPacked.resize(ulPacked);
+			}
+		}
+
+	protected:
+		const std::string& m_sData;
+		size_t m_nChunkSize;
+		int m_nLevel;
+		std::vector<std::string>& m_lsPacked;
+	};
+
+	/** Inflates the chunks of a container into their places in the result. */
+	class DecompressTask : public ArchiveExecutor::ITask
+	{
+	public:
+		struct Chunk
+		{
+			const char *pPacked;
+			unsigned long ulPacked;
+			size_t nOffset;           /** Where the raw bytes go in the result. */
+			unsigned long ulRaw;
+		};
+
+		DecompressTask(const std::vector<Chunk>& lsChunks, std::string& sResult)
+			: m_lsChunks(lsChunks), m_sResult(sResult) {;}
+
+		virtual void run(unsigned nSlice, unsigned long ulBegin, unsigned long ulEnd)
+		{
+			for (unsigned long i = ulBegin; i < ulEnd; ++i)
+			{
+				const Chunk& aChunk = m_lsChunks[i];
+				uLongf ulRaw = aChunk.ulRaw;
+				if (uncompress((Bytef *)&m_sResult[0] + aChunk.nOffset, &ulRaw, (const Bytef *)aChunk.pPacked, aChunk.ulPacked) != Z_OK || ulRaw != aChunk.ulRaw)
+					throw(std::runtime_error("corrupt chunk in compressed archive!"));
+			}
+		}
+
+	protected:
+		const std::vector<Chunk>& m_lsChunks;
+		std::string& m_sResult;
+	};
+
+	/** Inflates a gzip file, including files of several members as concatenating them gives. */
+	static bool gunzip(const char *pData, size_t nLength, std::string& sResult)
+	{
+		z_stream aStream;
+		memset(&aStream, 0, sizeof(aStream));
+		if (inflateInit2(&aStream, 16 + MAX_WBITS) != Z_OK)
+			return false;
+
+		aStream.next_in = (Bytef *)pData;
+		aStream.avail_in = (uInt)nLength;
+
+		char aBuffer[64 * 1024];
+		int nResult;
+		do
+		{
+			aStream.next_out = (Bytef *)aBuffer;
+			aStream.avail_out = sizeof(aBuffer);
+			nResult = inflate(&aStream, Z_NO_FLUSH);
+			sResult.append(aBuffer, sizeof(aBuffer) - aStream.avail_out);
+
+			if (nResult == Z_STREAM_END && aStream.avail_in)
+				nResult = inflateReset(&aStream);
+		}
+		while (nResult == Z_OK);
+
+		inflateEnd(&aStream);
+		return nResult == Z_STREAM_END;
+	}
+
+	void CompressionCodec::setExecutor(ArchiveExecutor *pExecutor)
+	{
+		s_pExecutor = pExecutor;
+	}
+
+	ArchiveExecutor* CompressionCodec::getExecutor()
+	{
+		return s_pExecutor;
+	}
+
+	void CompressionCodec::compress(const std::string& sData, std::string& sResult, int nLevel, size_t nChunkSize)
+	{
+		if (!nChunkSize)
+			nChunkSize = kChunkSize;
+		unsigned long ulChunks = (unsigned long)((sData.size() + nChunkSize - 1) / nChunkSize);
+
+		std::vector<std::string> lsPacked(ulChunks);
+		CompressTask aTask(sData, nChunkSize, nLevel, lsPacked);
+		runChunks(aTask, ulChunks);
+
+		size_t nSize = kHeaderSize + ulChunks * 8;
+		for (unsigned long i = 0; i < ulChunks; ++i)
+			nSize += lsPacked[i].size();
+
+		sResult.erase();
+		sResult.reserve(nSize);
+		Binary::Format::Writer aWriter(sResult);
+		aWriter.putBytes(kMagic, sizeof(kMagic));
+		aWriter.putByte(kVersion);
+		aWriter.putByte((unsigned char)nLevel);
+		aWriter.putU32(ulChunks);
+		for (unsigned long i = 0; i < ulChunks; ++i)
+		{
+			aWriter.putU32((unsigned long)std::min(nChunkSize, sData.size() - i * nChunkSize));
+			aWriter.putU32((unsigned long)lsPacked[i].size());
+		}
+		for (unsigned long i = 0; i < ulChunks; ++i)
+			aWriter.putBytes(lsPacked[i].data(), lsPacked[i].size());
+	}
+
+	bool CompressionCodec::decompress(const char *pData, size_t nLength, std::string& sResult)
+	{
+		sResult.erase();
+		if (nLength >= 2 && (unsigned char)pData[0] == 0x1f && (unsigned char)pData[1] == 0x8b)
+			return gunzip(pData, nLength, sResult);
+
+		try
+		{
+			Binary::Format::Reader aReader(pData, pData + nLength);
+			if (memcmp(aReader.getBytes(sizeof(kMagic)), kMagic, sizeof(kMagic)) != 0 || aReader.getByte() != kVersion)
+				return false;
+			aReader.getByte();
+
+			// The table is checked against the data before anything is allocated for the result
+			unsigned long ulChunks = aReader.getU32();
+			if (ulChunks > nLength / 8)
+				return false;
+
+			std::vector<DecompressTask::Chunk> lsChunks(ulChunks);
+			size_t nRaw = 0;
+			for (unsigned long i = 0; i < ulChunks; ++i)
+			{
+				lsChunks[i].nOffset = nRaw;
+				lsChunks[i].ulRaw = aReader.getU32();
+				lsChunks[i].ulPacked = aReader.getU32();
+				// The chunk size is chosen by the writer, so only a raw size deflate can not reach is rejected
+				if (lsChunks[i].ulRaw / kMaxRatio > lsChunks[i].ulPacked || nRaw + lsChunks[i].ulRaw < nRaw)
+					return false;
+				nRaw += lsChunks[i].ulRaw;
+			}
+			for (unsigned long i = 0; i < ulChunks; ++i)
+				lsChunks[i].pPacked = aReader.getBytes(lsChunks[i].ulPacked);
+
+			sResult.resize(nRaw);
+			DecompressTask aTask(lsChunks, sResult);
+			runChunks(aTask, ulChunks);
+		}
+		catch (std::exception&)
+		{
+			sResult.erase();
+			return false;
+		}
+		return true;
+	}
+
+	bool CompressionCodec::isCompressed(const char *pData, size_t nLength)
+	{
+		if (nLength >= 2 && (unsigned char)pData[0] == 0x1f && (unsigned char)pData[1] == 0x8b)
+			return true;
+		return nLength >= kHeaderSize && memcmp(pData, kMagic, sizeof(kMagic)) == 0;
+	}
+
+	bool CompressionCodec::isCompressedFile(const std::string& sPath)
+	{
+		FILE *pFile = fopen(sPath.c_str(), "rb");
+		if (!pFile)
+			return false;
+
+		char aHeader[kHeaderSize];
+		size_t nRead = fread(aHeader, sizeof(char), sizeof(aHeader), pFile);
+		fclose(pFile);
+		return isCompressed(aHeader, nRead);
+	}
+
+	bool CompressionCodec::readFile(const std::string& sPath, std::string& sData)
+	{
+		FILE *pFile = fopen(sPath.c_str(), "rb");
+		if (!pFile)
+			return false;
+
+		sData.erase();
+		char aBuffer[64 * 1024];
+		size_t nRead;
+		while ((nRead = fread(aBuffer, sizeof(char), sizeof(aBuffer), pFile)) > 0)
+			sData.append(aBuffer, nRead);
+		fclose(pFile);
+		return true;
+	}
+
+	bool CompressionCodec::writeFile(const std::string& sPath, const std::string& sData)
+	{
+		FILE *pFile = fopen(sPath.c_str(), "wb");
+		if (!pFile)
+			return false;
+
+		bool bResult = fwrite(sData.data(), sizeof(char), sData.size(), pFile) == sData.size();
+		return fclose(pFile) == 0 && bResult;
+	}
+}
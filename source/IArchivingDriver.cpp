@@ -2,12 +2,86 @@
 
 #pragma hdrstop
 
+#include <cstdio>
+
 #include "../GlobExport/IArchivingDriver.hpp"
 #include "../GlobExport/INode.hpp"
 
+namespace
+{
+	/** The formatted archive, see IArchivingDriver::createSnapshot(). */
+	class StringSnapshot : public Archiving::IArchivingDriver::Snapshot
+	{
+	public:
+		StringSnapshot(const std::string& sFile, const std::string& sData) : Snapshot(sFile), m_sData(sData) {;}
+
+		virtual std::string getString() {return m_sData;}
+
+	protected:
+		std::string m_sData;
+	};
+}
+
+Archiving::IArchivingDriver::IArchivingDriver()
+	: m_pFirstNode(NULL)
+{
+}
+
 Archiving::IArchivingDriver::~IArchivingDriver()
 {
-	for each(INode* pNode in m_lsNodes)
-		delete pNode;
+	releaseNodes();
+}
+
+void Archiving::IArchivingDriver::addNode(INode* pNode)
+{
+	pNode->m_pNextNode = m_pFirstNode;
+	m_pFirstNode = pNode;
 }
 
+void Archiving::IArchivingDriver::releaseNodes()
+{
+	// The destructors of arena nodes do not free anything, the memory goes back with the arena
+	while (m_pFirstNode)
+	{
+		INode* pNext = m_pFirstNode->m_pNextNode;
+		delete m_pFirstNode;
+		m_pFirstNode = pNext;
+	}
+	m_aArena.release();
+}
+
+void Archiving::IArchivingDriver::adoptNodes(IArchivingDriver& aSource)
+{
+	INode* pLast = NULL;
+	for (INode* pNode = aSource.m_pFirstNode; pNode; pNode = pNode->m_pNextNode)
+	{
+		pNode->m_pDriver = this;
+		pLast = pNode;
+	}
+
+	if (pLast)
+	{
+		pLast->m_pNextNode = m_pFirstNode;
+		m_pFirstNode = aSource.m_pFirstNode;
+		aSource.m_pFirstNode = NULL;
+	}
+	m_aArena.adopt(aSource.m_aArena);
+}
+
+Archiving::IArchivingDriver::Snapshot* Archiving::IArchivingDriver::createSnapshot(std::string sFile)
+{
+	if (sFile.length() == 0)
+		throw(std::runtime_error("invalid path!"));
+	return new StringSnapshot(sFile, getString());
+}
+
+bool Archiving::IArchivingDriver::Snapshot::save()
+{
+	FILE *pFile = fopen(m_sFile.c_str(), "wb");
+	if (!pFile)
+		return false;
+
+	std::string sData = getString();
+	bool bResult = fwrite(sData.data(), sizeof(char), sData.size(), pFile) == sData.size();
+	return fclose(pFile) == 0 && bResult;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <windows.h>
+#include <cstdio>
+#include <map>
+
+#include "../GlobExport/InstanceMetrics.hpp"
+
+namespace Archiving
+{
+	/** The registered counters, a list that only grows. */
+	static InstanceMetrics::Counter * volatile s_pFirstCounter = NULL;
+
+	static long long load(volatile long long& llValue)
+	{
+		// Plain reads of 64 bit values are not atomic on 32 bit targets
+		return InterlockedCompareExchange64(&llValue, 0, 0);
+	}
+
+	static void raise(volatile long long& llPeak, long long llValue)
+	{
+		long long llSeen = load(llPeak);
+		while (llValue > llSeen)
+		{
+			long long llPrevious = InterlockedCompareExchange64(&llPeak, llValue, llSeen);
+			if (llPrevious == llSeen)
+				break;
+			llSeen = llPrevious;
+		}
+	}
+
+	static void merge(InstanceMetrics::Snapshot& aSnapshot, InstanceMetrics::Counter& aCounter)
+	{
+		unsigned long long ullPeak = (unsigned long long)load(aCounter.llPeak);
+		unsigned long long ullPeakBytes = (unsigned long long)load(aCounter.llPeakBytes);
+
+		aSnapshot.ullLive += (unsigned long long)load(aCounter.llLive);
+		aSnapshot.ullTotal += (unsigned long long)load(aCounter.llTotal);
+		aSnapshot.ullBytes += (unsigned long long)load(aCounter.llBytes);
+		aSnapshot.ullTotalBytes += (unsigned long long)load(aCounter.llTotalBytes);
+		if (aSnapshot.ullPeak < ullPeak)
+			aSnapshot.ullPeak = ullPeak;
+		if (aSnapshot.ullPeakBytes < ullPeakBytes)
+			aSnapshot.ullPeakBytes = ullPeakBytes;
+	}
+
+	void InstanceMetrics::add(Counter& aCounter, const std::type_info& aType, size_t nBytes)
+	{
+		if (!aCounter.lRegistered && InterlockedCompareExchange(&aCounter.lRegistered, 1, 0) == 0)
+		{
+			aCounter.pType = &aType;
+			Counter *pFirst;
+			do
+			{
+				pFirst = s_pFirstCounter;
+				aCounter.pNext = pFirst;
+			}
+			while (InterlockedCompareExchangePointer((void * volatile *)&s_pFirstCounter, &aCounter, pFirst) != pFirst);
+		}
+
+		raise(aCounter.llPeak, InterlockedIncrement64(&aCounter.llLive));
+		raise(aCounter.llPeakBytes, InterlockedExchangeAdd64(&aCounter.llBytes, (long long)nBytes) + (long long)nBytes);
+		InterlockedIncrement64(&aCounter.llTotal);
+		InterlockedExchangeAdd64(&aCounter.llTotalBytes, (long long)nBytes);
+	}
+
+	void InstanceMetrics::remove(Counter& aCounter, size_t nBytes)
+	{
+		InterlockedDecrement64(&aCounter.llLive);
+		InterlockedExchangeAdd64(&aCounter.llBytes, -(long long)nBytes);
+	}
+
+	InstanceMetrics::Snapshot InstanceMetrics::get(const std::type_info& aType)
+	{
+		Snapshot aSnapshot;
+		aSnapshot.sName = aType.name();
+
+		for (Counter *pCounter = s_pFirstCounter; pCounter; pCounter = pCounter->pNext)
+			if (*pCounter->pType == aType)
+				merge(aSnapshot, *pCounter);
+
+		return aSnapshot;
+	}
+
+	std::vector<InstanceMetrics::Snapshot> InstanceMetrics::getSnapshot()
+	{
+		std::map<std::string, Snapshot> mSnapshots;
+		for (Counter *pCounter = s_pFirstCounter; pCounter; pCounter = pCounter->pNext)
+		{
+			Snapshot& aSnapshot = mSnapshots[pCounter->pType->name()];
+			aSnapshot.sName = pCounter->pType->name();
+			merge(aSnapshot, *pCounter);
+		}
+
+		std::vector<Snapshot> lsSnapshots;
+		for (std::map<std::string, Snapshot>::const_iterator it = mSnapshots.begin(); it != mSnapshots.end(); ++it)
+			lsSnapshots.push_back(it->second);
+		return lsSnapshots;
+	}
+
+	std::string InstanceMetrics::getReport()
+	{
+		std::vector<Snapshot> lsSnapshots = getSnapshot();
+		std::string sReport;
+		char aLine[512];
+
+		sprintf(aLine, "%-40s %10s %10s %12s %14s %14s\n", "class", "live", "peak", "total", "bytes", "peak bytes");
+		sReport += aLine;
+		for (size_t i = 0; i < lsSnapshots.size(); ++i)
+		{
+			const Snapshot& aSnapshot = lsSnapshots[i];
+			sprintf(aLine, "%-40s %10llu %10llu %12llu %14llu %14llu\n", aSnapshot.sName.c_str(), aSnapshot.ullLive, aSnapshot.ullPeak,
+				aSnapshot.ullTotal, aSnapshot.ullBytes, aSnapshot.ullPeakBytes);
+			sReport += aLine;
+		}
+		return sReport;
+	}
+}
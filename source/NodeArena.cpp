@@ -0,0 +1,159 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <cstdlib>
+#include <new>
+
+#include "../GlobExport/NodeArena.hpp"
+
+namespace Archiving
+{
+	/** NodeArena */
+
+	NodeArena::NodeArena()
+		: m_pBlocks(NULL)
+		, m_pPos(NULL)
+		, m_pEnd(NULL)
+		, m_nNextBlockSize(kFirstBlockSize)
+		, m_nAllocated(0)
+	{
+	}
+
+	NodeArena::~NodeArena()
+	{
+		while (m_pBlocks)
+		{
+			Block *pNext = m_pBlocks->pNext;
+			free(m_pBlocks);
+			m_pBlocks = pNext;
+		}
+	}
+
+	void NodeArena::addBlock(size_t nSize)
+	{
+		size_t nBlockSize = m_nNextBlockSize;
+		if (nBlockSize < nSize)
+			nBlockSize = nSize;
+
+		Block *pBlock = (Block *)malloc(sizeof(Block) + kAlignment + nBlockSize);
+		if (!pBlock)
+			throw std::bad_alloc();
+
+		pBlock->pNext = m_pBlocks;
+		pBlock->nSize = nBlockSize;
+		m_pBlocks = pBlock;
+
+		m_pPos = (char *)(((size_t)(pBlock + 1) + kAlignment - 1) & ~(kAlignment - 1));
+		m_pEnd = m_pPos + nBlockSize;
+
+		if (m_nNextBlockSize < kMaxBlockSize)
+			m_nNextBlockSize *= 2;
+	}
+
+	void NodeArena::release()
+	{
+		// Keep the largest block, which is the most recent one unless a single large allocation came after it
+		Block *pKeep = NULL;
+		while (m_pBlocks)
+		{
+			Block *pNext = m_pBlocks->pNext;
+			if (!pKeep || m_pBlocks->nSize > pKeep->nSize)
+			{
+				free(pKeep);
+				pKeep = m_pBlocks;
+			}
+			else
+			{
+				free(m_pBlocks);
+			}
+			m_pBlocks = pNext;
+		}
+
+		m_pBlocks = pKeep;
+		m_pPos = m_pEnd = NULL;
+		if (pKeep)
+		{
+			pKeep->pNext = NULL;
+			m_pPos = (char *)(((size_t)(pKeep + 1) + kAlignment - 1) & ~(kAlignment - 1));
+			m_pEnd = m_pPos + pKeep->nSize;
+		}
+		m_nAllocated = 0;
+	}
+
+	void NodeArena::adopt(NodeArena& aOther)
+	{
+		if (!aOther.m_pBlocks)
+			return;
+
+		// The blocks go behind the current one, which keeps serving allocations
+		Block *pLast = aOther.m_pBlocks;
+		while (pLast->pNext)
+			pLast = pLast->pNext;
+
+		if (m_pBlocks)
+		{
+			pLast->pNext = m_pBlocks->pNext;
+			m_pBlocks->pNext = aOther.m_pBlocks;
+		}
+		else
+		{
+			m_pBlocks = aOther.m_pBlocks;
+			m_pPos = aOther.m_pPos;
+			m_pEnd = aOther.m_pEnd;
+		}
+		m_nAllocated += aOther.m_nAllocated;
+
+		aOther.m_pBlocks = NULL;
+		aOther.m_pPos = aOther.m_pEnd = NULL;
+		aOther.m_nAllocated = 0;
+	}
+
+	/** SymbolIndex */
+
+	SymbolIndex::Entry* SymbolIndex::lookup(Symbol ulKey) const
+	{
+		// Symbols are handed out in sequence, spread them with a multiplicative hash
+		unsigned long ulMask = m_ulCapacity - 1;
+		for (unsigned long i = (ulKey * 2654435761ul) & ulMask; ; i = (i + 1) & ulMask)
+		{
+			Entry *pEntry = &m_pEntries[i];
+			if (pEntry->ulKey == ulKey || pEntry->ulKey == SymbolTable::kNone)
+				return pEntry;
+		}
+	}
+
+	void* SymbolIndex::find(Symbol ulKey) const
+	{
+		if (!m_ulCount)
+			return NULL;
+
+		return lookup(ulKey)->pValue;
+	}
+
+	void SymbolIndex::insert(NodeArena& aArena, Symbol ulKey, void *pValue)
+	{
+		// Grow at a load of 3/4. The old table stays in the arena until it is released.
+		if ((m_ulCount + 1) * 4 > m_ulCapacity * 3)
+		{
+			Entry *pOldEntries = m_pEntries;
+			unsigned long ulOldCapacity = m_ulCapacity;
+
+			m_ulCapacity = m_ulCapacity ? m_ulCapacity * 2 : 8;
+			m_pEntries = (Entry *)aArena.allocate(m_ulCapacity * sizeof(Entry));
+			memset(m_pEntries, 0, m_ulCapacity * sizeof(Entry));
+
+			for (unsigned long i = 0; i < ulOldCapacity; ++i)
+				if (pOldEntries[i].ulKey != SymbolTable::kNone)
+					*lookup(pOldEntries[i].ulKey) = pOldEntries[i];
+		}
+
+		Entry *pEntry = lookup(ulKey);
+		if (pEntry->ulKey == SymbolTable::kNone)
+		{
+			pEntry->ulKey = ulKey;
+			++m_ulCount;
+		}
+		pEntry->pValue = pValue;
+	}
+}
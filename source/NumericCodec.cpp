@@ -0,0 +1,702 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <cstring>
+#include <climits>
+#include <cfloat>
+#include <cmath>
+#include <cerrno>
+#include <locale.h>
+
+#include "../GlobExport/NumericCodec.hpp"
+
+namespace Archiving
+{
+	typedef unsigned long long uint64;
+
+	/** The "C" locale for the rare numbers that are handed to _strtod_l(). */
+	static _locale_t s_pClassicLocale = _create_locale(LC_NUMERIC, "C");
+
+	/**
+	 * Floating point number f * 2^e with a 64 bit significand, as used by Grisu.
+	 * See Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers", PLDI 2010.
+	 */
+	struct DiyFp
+	{
+		uint64 f;
+		int e;
+
+		DiyFp() : f(0), e(0) {;}
+		DiyFp(uint64 f_, int e_) : f(f_), e(e_) {;}
+
+		DiyFp operator-(const DiyFp& rhs) const
+		{
+			return DiyFp(f - rhs.f, e);
+		}
+
+		/** Product rounded to 64 bits, computed from 32 bit halves. */
+		DiyFp operator*(const DiyFp& rhs) const
+		{
+			const uint64 M32 = 0xFFFFFFFFu;
+			uint64 a = f >> 32;
+			uint64 b = f & M32;
+			uint64 c = rhs.f >> 32;
+			uint64 d = rhs.f & M32;
+			uint64 ac = a * c;
+			uint64 bc = b * c;
+			uint64 ad = a * d;
+			uint64 bd = b * d;
+			uint64 tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+			tmp += 1u << 31;
+			return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+		}
+
+		DiyFp normalize() const
+		{
+			DiyFp res = *this;
+			while (!(res.f & ((uint64)1 << 63)))
+			{
+				res.f <<= 1;
+				res.e--;
+			}
+			return res;
+		}
+	};
+
+	/**
+	 * The value as DiyFp together with the boundaries of its rounding interval, normalized to a common exponent.
+	 * Numbers in between read back to the value. nSignificandSize is the size without the hidden bit.
+	 */
+	static void getBoundaries(uint64 ulSignificand, int nBiasedExponent, int nSignificandSize, int nExponentBias, DiyFp& aValue, DiyFp& aMinus, DiyFp& aPlus)
+	{
+		const uint64 ulHidden = (uint64)1 << nSignificandSize;
+		bool bCloserBelow = false;
+		if (nBiasedExponent)
+		{
+			aValue = DiyFp(ulSignificand + ulHidden, nBiasedExponent - nExponentBias - nSignificandSize);
+			bCloserBelow = ulSignificand == 0 && nBiasedExponent > 1;
+		}
+		else
+		{
+			aValue = DiyFp(ulSignificand, 1 - nExponentBias - nSignificandSize);
+		}
+
+		aPlus = DiyFp((aValue.f << 1) + 1, aValue.e - 1).normalize();
+		aMinus = bCloserBelow ? DiyFp((aValue.f << 2) - 1, aValue.e - 2) : DiyFp((aValue.f << 1) - 1, aValue.e - 1);
+		aMinus.f <<= aMinus.e - aPlus.e;
+		aMinus.e = aPlus.e;
+	}
+
+	/** Returns the cached power of ten c = 10^-K whose product with a number of exponent e has an exponent in [-60, -32]. */
+	static DiyFp getCachedPower(int e, int& K)
+	{
+		// 10^-348, 10^-340, ..., 10^340
+		static const uint64 aSignificands[] =
+		{
+			0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+			0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+			0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+			0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+			0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+			0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+			0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+			0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+			0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+			0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+			0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+			0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+			0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+			0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+			0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+			0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+			0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+			0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+			0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+			0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+			0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+			0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+		};
+		static const short aExponents[] =
+		{
+			-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927, -901, -874, -847, -821,
+			-794, -768, -741, -715, -688, -661, -635, -608, -582, -555, -529, -502, -475, -449, -422, -396,
+			-369, -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+			56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402, 428, 455,
+			481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+			907, 933, 960, 986, 1013, 1039, 1066
+		};
+
+		double dk = (-61 - e) * 0.30102999566398114 + 347; // dk must be positive, so can do ceiling in positive
+		int k = (int)dk;
+		if (dk - k > 0.0)
+			k++;
+
+		unsigned nIndex = (unsigned)((k >> 3) + 1);
+		K = -(-348 + (int)(nIndex << 3));
+		return DiyFp(aSignificands[nIndex], aExponents[nIndex]);
+	}
+
+	static const uint64 s_aPow10[] =
+	{
+		1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+		10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+		1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+	};
+
+	static void grisuRound(char *pBuffer, int nLength, uint64 delta, uint64 rest, uint64 ten_kappa, uint64 wp_w)
+	{
+		while (rest < wp_w && delta - rest >= ten_kappa &&
+			(rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+		{
+			pBuffer[nLength - 1]--;
+			rest += ten_kappa;
+		}
+	}
+
+	static int countDecimalDigits(unsigned n)
+	{
+		int nDigits = 1;
+		while (n >= 10 && nDigits < 10)
+		{
+			n /= 10;
+			++nDigits;
+		}
+		return nDigits;
+	}
+
+	/** Generates the shortest digits of W within the interval (Mp - delta, Mp), adjusting K. */
+	static void generateDigits(const DiyFp& W, const DiyFp& Mp, uint64 delta, char *pBuffer, int& nLength, int& K)
+	{
+		const DiyFp one((uint64)1 << -Mp.e, Mp.e);
+		const DiyFp wp_w = Mp - W;
+		unsigned p1 = (unsigned)(Mp.f >> -one.e);
+		uint64 p2 = Mp.f & (one.f - 1);
+		int kappa = countDecimalDigits(p1);
+		nLength = 0;
+
+		while (kappa > 0)
+		{
+			unsigned nPow10 = (unsigned)s_aPow10[kappa - 1];
+			unsigned d = p1 / nPow10;
+			p1 %= nPow10;
+			if (d || nLength)
+				pBuffer[nLength++] = (char)('0' + d);
+			kappa--;
+
+			uint64 tmp = ((uint64)p1 << -one.e) + p2;
+			if (tmp <= delta)
+			{
+				K += kappa;
+				grisuRound(pBuffer, nLength, delta, tmp, s_aPow10[kappa] << -one.e, wp_w.f);
+				return;
+			}
+		}
+
+		for (;;)
+		{
+			p2 *= 10;
+			delta *= 10;
+			char d = (char)(p2 >> -one.e);
+			if (d || nLength)
+				pBuffer[nLength++] = (char)('0' + d);
+			p2 &= one.f - 1;
+			kappa--;
+			if (p2 < delta)
+			{
+				K += kappa;
+				grisuRound(pBuffer, nLength, delta, p2, one.f, -kappa < 20 ? wp_w.f * s_aPow10[-kappa] : 0);
+				return;
+			}
+		}
+	}
+
+	/** Shortest digits of a positive finite number: value = digits * 10^K. */
+	static void grisu2(uint64 ulSignificand, int nBiasedExponent, int nSignificandSize, int nExponentBias, char *pBuffer, int& nLength, int& K)
+	{
+		DiyFp v, w_m, w_p;
+		getBoundaries(ulSignificand, nBiasedExponent, nSignificandSize, nExponentBias, v, w_m, w_p);
+
+		const DiyFp c_mk = getCachedPower(w_p.e, K);
+		const DiyFp W = v.normalize() * c_mk;
+		DiyFp Wp = w_p * c_mk;
+		DiyFp Wm = w_m * c_mk;
+		Wm.f++;
+		Wp.f--;
+		generateDigits(W, Wp, Wp.f - Wm.f, pBuffer, nLength, K);
+	}
+
+	static size_t writeExponent(int K, char *pBuffer)
+	{
+		char *p = pBuffer;
+		*p++ = 'e';
+		if (K < 0)
+		{
+			*p++ = '-';
+			K = -K;
+		}
+		if (K >= 100)
+		{
+			*p++ = (char)('0' + K / 100);
+			K %= 100;
+			*p++ = (char)('0' + K / 10);
+		}
+		else if (K >= 10)
+		{
+			*p++ = (char)('0' + K / 10);
+		}
+		*p++ = (char)('0' + K % 10);
+		return p - pBuffer;
+	}
+
+	/** Turns the digits into plain or, for very large and small numbers, exponential notation. */
+	static size_t prettify(char *pBuffer, int nLength, int k)
+	{
+		const int kk = nLength + k; // 10^(kk-1) <= v < 10^kk
+
+		if (nLength <= kk && kk <= 21)
+		{
+			// 1234e7 -> 12340000000
+			for (int i = nLength; i < kk; i++)
+				pBuffer[i] = '0';
+			return kk;
+		}
+		else if (0 < kk && kk <= 21)
+		{
+			// 1234e-2 -> 12.34
+			memmove(&pBuffer[kk + 1], &pBuffer[kk], nLength - kk);
+			pBuffer[kk] = '.';
+			return nLength + 1;
+		}
+		else if (-6 < kk && kk <= 0)
+		{
+			// 1234e-6 -> 0.001234
+			const int nOffset = 2 - kk;
+			memmove(&pBuffer[nOffset], &pBuffer[0], nLength);
+			pBuffer[0] = '0';
+			pBuffer[1] = '.';
+			for (int i = 2; i < nOffset; i++)
+				pBuffer[i] = '0';
+			return nLength + nOffset;
+		}
+		else if (nLength == 1)
+		{
+			// 1e30
+			return 1 + writeExponent(kk - 1, &pBuffer[1]);
+		}
+		else
+		{
+			// 1234e30 -> 1.234e33
+			memmove(&pBuffer[2], &pBuffer[1], nLength - 1);
+			pBuffer[1] = '.';
+			return nLength + 1 + writeExponent(kk - 1, &pBuffer[nLength + 1]);
+		}
+	}
+
+	/** Formats a floating point number given by its fields, see grisu2(). */
+	static size_t formatFloatingPoint(bool bNegative, uint64 ulSignificand, int nBiasedExponent, int nMaxExponent, int nSignificandSize, int nExponentBias, char *pBuffer)
+	{
+		char *p = pBuffer;
+		if (nBiasedExponent == nMaxExponent)
+		{
+			if (ulSignificand)
+			{
+				strcpy(p, "nan");
+				return 3;
+			}
+			if (bNegative)
+				*p++ = '-';
+			strcpy(p, "inf");
+			return p - pBuffer + 3;
+		}
+
+		if (bNegative)
+			*p++ = '-';
+
+		if (!ulSignificand && !nBiasedExponent)
+		{
+			*p++ = '0';
+		}
+		else
+		{
+			int nLength, K;
+			grisu2(ulSignificand, nBiasedExponent, nSignificandSize, nExponentBias, p, nLength, K);
+			p += prettify(p, nLength, K);
+		}
+
+		*p = 0;
+		return p - pBuffer;
+	}
+
+	/** Formatting */
+
+	size_t NumericCodec::format(unsigned long ulValue, char *pBuffer)
+	{
+		char aDigits[24];
+		size_t nDigits = 0;
+		do
+		{
+			aDigits[nDigits++] = (char)('0' + ulValue % 10);
+			ulValue /= 10;
+		}
+		while (ulValue);
+
+		for (size_t i = 0; i < nDigits; ++i)
+			pBuffer[i] = aDigits[nDigits - 1 - i];
+		pBuffer[nDigits] = 0;
+		return nDigits;
+	}
+
+	size_t NumericCodec::format(long lValue, char *pBuffer)
+	{
+		if (lValue >= 0)
+			return format((unsigned long)lValue, pBuffer);
+
+		pBuffer[0] = '-';
+		return 1 + format(0ul - (unsigned long)lValue, pBuffer + 1);
+	}
+
+	size_t NumericCodec::format(double dValue, char *pBuffer)
+	{
+		uint64 ulBits;
+		memcpy(&ulBits, &dValue, sizeof(ulBits));
+		return formatFloatingPoint((ulBits >> 63) != 0, ulBits & (((uint64)1 << 52) - 1), (int)((ulBits >> 52) & 0x7FF), 0x7FF, 52, 1023, pBuffer);
+	}
+
+	size_t NumericCodec::format(float fValue, char *pBuffer)
+	{
+		unsigned int nBits;
+		memcpy(&nBits, &fValue, sizeof(nBits));
+		return formatFloatingPoint((nBits >> 31) != 0, nBits & ((1u << 23) - 1), (int)((nBits >> 23) & 0xFF), 0xFF, 23, 127, pBuffer);
+	}
+
+	/** Parsing, all on the range [p, pEnd) */
+
+	/** Parses an optional sign and at least one digit up to the end, false on overflow of ulMax. */
+	static bool parseInteger(const char *p, const char *pEnd, unsigned long ulMax, bool& bNegative, unsigned long& ulValue)
+	{
+		bNegative = false;
+		if (p < pEnd && (*p == '-' || *p == '+'))
+			bNegative = *p++ == '-';
+		if (p == pEnd)
+			return false;
+
+		unsigned long ulResult = 0;
+		for (; p < pEnd; ++p)
+		{
+			unsigned nDigit = (unsigned)(*p - '0');
+			if (nDigit > 9)
+				return false;
+			if (ulResult > (ulMax - nDigit) / 10)
+				return false;
+			ulResult = ulResult * 10 + nDigit;
+		}
+
+		ulValue = ulResult;
+		return true;
+	}
+
+	/** Parses a signed integer in [-lMax - 1, lMax]. */
+	static bool parseSigned(const char *p, const char *pEnd, long lMax, long& lValue)
+	{
+		bool bNegative;
+		unsigned long ulValue;
+		if (!parseInteger(p, pEnd, (unsigned long)lMax + 1, bNegative, ulValue))
+			return false;
+		if (!bNegative && ulValue > (unsigned long)lMax)
+			return false;
+
+		lValue = bNegative ? (long)(0ul - ulValue) : (long)ulValue;
+		return true;
+	}
+
+	static bool parseText(const char *p, const char *pEnd, short& nValue)
+	{
+		long lValue;
+		if (!parseSigned(p, pEnd, SHRT_MAX, lValue))
+			return false;
+		nValue = (short)lValue;
+		return true;
+	}
+
+	static bool parseText(const char *p, const char *pEnd, int& iValue)
+	{
+		long lValue;
+		if (!parseSigned(p, pEnd, INT_MAX, lValue))
+			return false;
+		iValue = (int)lValue;
+		return true;
+	}
+
+	static bool parseText(const char *p, const char *pEnd, long& lValue)
+	{
+		return parseSigned(p, pEnd, LONG_MAX, lValue);
+	}
+
+	static bool parseText(const char *p, const char *pEnd, unsigned long& ulValue)
+	{
+		bool bNegative;
+		unsigned long ulResult;
+		if (!parseInteger(p, pEnd, ULONG_MAX, bNegative, ulResult) || (bNegative && ulResult))
+			return false;
+		ulValue = ulResult;
+		return true;
+	}
+
+	static bool equalsNoCase(const char *pText, const char *pEnd, const char *pLower)
+	{
+		for (; pText < pEnd && *pLower; ++pText, ++pLower)
+			if (*pText != *pLower && *pText != *pLower - 'a' + 'A')
+				return false;
+		return pText == pEnd && !*pLower;
+	}
+
+	/** The range must be followed by the end of the string or white space, which ends the number for _strtod_l(). */
+	static bool parseText(const char *pStart, const char *pEnd, double& dValue)
+	{
+		// Powers of ten that are exact as double
+		static const double aExact[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const char *p = pStart;
+
+		bool bNegative = false;
+		if (p < pEnd && (*p == '-' || *p == '+'))
+			bNegative = *p++ == '-';
+
+		if (equalsNoCase(p, pEnd, "inf") || equalsNoCase(p, pEnd, "infinity"))
+		{
+			dValue = bNegative ? -HUGE_VAL : HUGE_VAL;
+			return true;
+		}
+		if (equalsNoCase(p, pEnd, "nan"))
+		{
+			uint64 ulNaN = 0x7FF8000000000000ULL;
+			memcpy(&dValue, &ulNaN, sizeof(dValue));
+			return true;
+		}
+
+		// Up to 19 significant digits fit the mantissa, the exponent takes the dropped ones
+		uint64 ulMantissa = 0;
+		int nSignificant = 0;
+		int nExponent = 0;
+		int nDigits = 0;
+		bool bExact = true;
+
+		for (; p < pEnd && (unsigned)(*p - '0') <= 9; ++p, ++nDigits)
+		{
+			if (nSignificant < 19)
+			{
+				ulMantissa = ulMantissa * 10 + (*p - '0');
+				if (ulMantissa)
+					++nSignificant;
+			}
+			else
+			{
+				++nExponent;
+				bExact &= *p == '0';
+			}
+		}
+		if (p < pEnd && *p == '.')
+		{
+			for (++p; p < pEnd && (unsigned)(*p - '0') <= 9; ++p, ++nDigits)
+			{
+				if (nSignificant < 19)
+				{
+					ulMantissa = ulMantissa * 10 + (*p - '0');
+					if (ulMantissa)
+						++nSignificant;
+					--nExponent;
+				}
+				else
+				{
+					bExact &= *p == '0';
+				}
+			}
+		}
+		if (!nDigits)
+			return false;
+
+		if (p < pEnd && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+			bool bNegativeExponent = false;
+			if (p < pEnd && (*p == '-' || *p == '+'))
+				bNegativeExponent = *p++ == '-';
+			if (p == pEnd)
+				return false;
+
+			int nExplicit = 0;
+			for (; p < pEnd; ++p)
+			{
+				unsigned nDigit = (unsigned)(*p - '0');
+				if (nDigit > 9)
+					return false;
+				if (nExplicit < 100000)
+					nExplicit = nExplicit * 10 + nDigit;
+			}
+			nExponent += bNegativeExponent ? -nExplicit : nExplicit;
+		}
+		if (p != pEnd)
+			return false;
+
+		// Both the mantissa and the power of ten are exact, a single operation rounds correctly
+		if (bExact && ulMantissa <= ((uint64)1 << 53) && nExponent >= -22 && nExponent <= 22)
+		{
+			double dResult = (double)(long long)ulMantissa;
+			dResult = nExponent < 0 ? dResult / aExact[-nExponent] : dResult * aExact[nExponent];
+			dValue = bNegative ? -dResult : dResult;
+			return true;
+		}
+
+		// Long mantissas and large exponents are left to the C runtime, in the "C" locale
+		char *pParsed = NULL;
+		errno = 0;
+		double dResult = _strtod_l(pStart, &pParsed, s_pClassicLocale);
+		if (pParsed != pEnd)
+			return false;
+		// Overflow to infinity or underflow to zero, denormals are kept
+		if (errno == ERANGE && (dResult == 0.0 || fabs(dResult) == HUGE_VAL))
+			return false;
+		dValue = dResult;
+		return true;
+	}
+
+	/** Beyond FLT_MAX by half a unit in the last place, which is the first double rounding to infinity as float. */
+	static const double s_dFloatOverflow = (double)FLT_MAX + ldexp(1.0, 103);
+
+	static bool parseText(const char *p, const char *pEnd, float& fValue)
+	{
+		double dValue;
+		if (!parseText(p, pEnd, dValue))
+			return false;
+		// The text of FLT_MAX may be slightly above it, all that rounds back to it is in range
+		if (fabs(dValue) >= s_dFloatOverflow)
+			return false;
+		fValue = (float)dValue;
+		return true;
+	}
+
+	bool NumericCodec::parse(const std::string& sText, short& nValue)
+	{
+		return parseText(sText.c_str(), sText.c_str() + sText.length(), nValue);
+	}
+
+	bool NumericCodec::parse(const std::string& sText, int& iValue)
+	{
+		return parseText(sText.c_str(), sText.c_str() + sText.length(), iValue);
+	}
+
+	bool NumericCodec::parse(const std::string& sText, long& lValue)
+	{
+		return parseText(sText.c_str(), sText.c_str() + sText.length(), lValue);
+	}
+
+	bool NumericCodec::parse(const std::string& sText, unsigned long& ulValue)
+	{
+		return parseText(sText.c_str(), sText.c_str() + sText.length(), ulValue);
+	}
+
+	bool NumericCodec::parse(const std::string& sText, float& fValue)
+	{
+		return parseText(sText.c_str(), sText.c_str() + sText.length(), fValue);
+	}
+
+	bool NumericCodec::parse(const std::string& sText, double& dValue)
+	{
+		return parseText(sText.c_str(), sText.c_str() + sText.length(), dValue);
+	}
+
+	/** Arrays */
+
+	/** Formats the values, converted to T_Format, into sText in one go. */
+	template <class T_Format, class T_Value> static void formatValues(const T_Value *pValues, unsigned long ulCount, std::string& sText)
+	{
+		// Room for every value and its separator, trimmed to the written length at the end
+		sText.resize(ulCount * NumericCodec::kBufferSize);
+		char *pStart = ulCount ? &sText[0] : NULL;
+		char *p = pStart;
+		for (unsigned long i = 0; i < ulCount; ++i)
+		{
+			if (i)
+				*p++ = ' ';
+			p += NumericCodec::format((T_Format)pValues[i], p);
+		}
+		sText.resize(p - pStart);
+	}
+
+	static bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	/** Parses exactly ulCount values separated by white space, in a single pass over the text. */
+	template <class T_Value> static bool parseValues(const std::string& sText, T_Value *pValues, unsigned long ulCount)
+	{
+		const char *p = sText.c_str();
+		const char *pEnd = p + sText.length();
+		for (unsigned long i = 0; i < ulCount; ++i)
+		{
+			while (p < pEnd && isSpace(*p))
+				++p;
+			const char *pToken = p;
+			while (p < pEnd && !isSpace(*p))
+				++p;
+			if (!parseText(pToken, p, pValues[i]))
+				return false;
+		}
+		while (p < pEnd && isSpace(*p))
+			++p;
+		return p == pEnd;
+	}
+
+	void NumericCodec::formatArray(const int *pValues, unsigned long ulCount, std::string& sText)
+	{
+		formatValues<long>(pValues, ulCount, sText);
+	}
+
+	void NumericCodec::formatArray(const long *pValues, unsigned long ulCount, std::string& sText)
+	{
+		formatValues<long>(pValues, ulCount, sText);
+	}
+
+	void NumericCodec::formatArray(const float *pValues, unsigned long ulCount, std::string& sText)
+	{
+		formatValues<float>(pValues, ulCount, sText);
+	}
+
+	void NumericCodec::formatArray(const double *pValues, unsigned long ulCount, std::string& sText)
+	{
+		formatValues<double>(pValues, ulCount, sText);
+	}
+
+	bool NumericCodec::parseArray(const std::string& sText, int *pValues, unsigned long ulCount)
+	{
+		return parseValues(sText, pValues, ulCount);
+	}
+
+	bool NumericCodec::parseArray(const std::string& sText, long *pValues, unsigned long ulCount)
+	{
+		return parseValues(sText, pValues, ulCount);
+	}
+
+	bool NumericCodec::parseArray(const std::string& sText, float *pValues, unsigned long ulCount)
+	{
+		return parseValues(sText, pValues, ulCount);
+	}
+
+	bool NumericCodec::parseArray(const std::string& sText, double *pValues, unsigned long ulCount)
+	{
+		return parseValues(sText, pValues, ulCount);
+	}
+
+	bool NumericCodec::parseBool(const std::string& sText)
+	{
+		const char *pText = sText.c_str();
+		const char *pEnd = pText + sText.length();
+		return (sText.length() == 1 && (*pText == '1' || *pText == 'J')) || equalsNoCase(pText, pEnd, "true");
+	}
+}
@@ -0,0 +1,68 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <boost/thread/mutex.hpp>
+
+#include "../GlobExport/ObjectPool.hpp"
+
+namespace Archiving
+{
+	SlotPool::SlotPool(size_t nSlotSize, unsigned long ulBlockSlots)
+		: m_nSlotSize(((nSlotSize < sizeof(FreeSlot) ? sizeof(FreeSlot) : nSlotSize) + kAlignment - 1) & ~(kAlignment - 1))
+		, m_ulBlockSlots(ulBlockSlots ? ulBlockSlots : 1)
+		, m_pBlocks(NULL)
+		, m_pFree(NULL)
+		, m_ulUsed(0)
+		, m_ulSlots(0)
+		, m_pMutex(new boost::mutex())
+	{
+	}
+
+	SlotPool::~SlotPool()
+	{
+		while (m_pBlocks)
+		{
+			Block *pNext = m_pBlocks->pNext;
+			::operator delete(m_pBlocks);
+			m_pBlocks = pNext;
+		}
+		delete m_pMutex;
+	}
+
+	void* SlotPool::allocate()
+	{
+		boost::mutex::scoped_lock aLock(*m_pMutex);
+		if (!m_pFree)
+		{
+			// The header is rounded up to the alignment, so the slots behind it stay aligned
+			size_t nHeader = (sizeof(Block) + kAlignment - 1) & ~(kAlignment - 1);
+			char *pMemory = (char *)::operator new(nHeader + m_nSlotSize * m_ulBlockSlots);
+			Block *pBlock = (Block *)pMemory;
+			pBlock->pNext = m_pBlocks;
+			m_pBlocks = pBlock;
+
+			for (unsigned long i = m_ulBlockSlots; i-- > 0; )
+			{
+				FreeSlot *pSlot = (FreeSlot *)(pMemory + nHeader + i * m_nSlotSize);
+				pSlot->pNext = m_pFree;
+				m_pFree = pSlot;
+			}
+			m_ulSlots += m_ulBlockSlots;
+		}
+
+		FreeSlot *pSlot = m_pFree;
+		m_pFree = pSlot->pNext;
+		++m_ulUsed;
+		return pSlot;
+	}
+
+	void SlotPool::free(void *pSlot)
+	{
+		boost::mutex::scoped_lock aLock(*m_pMutex);
+		FreeSlot *pFree = (FreeSlot *)pSlot;
+		pFree->pNext = m_pFree;
+		m_pFree = pFree;
+		--m_ulUsed;
+	}
+}
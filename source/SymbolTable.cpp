@@ -0,0 +1,116 @@
+#include "StdAfx.h"
+
+#pragma hdrstop
+
+#include <cstring>
+
+#include <boost/thread/mutex.hpp>
+
+#include "../GlobExport/SymbolTable.hpp"
+#include "../GlobExport/IArchivableObject.hpp"
+
+namespace Archiving
+{
+	SymbolTable::SymbolTable()
+		: m_lsEntries(64)
+		, m_pClassMutex(new boost::mutex())
+		, m_bConcurrent(false)
+	{
+		// Same order as the enum
+		m_lsStrings.push_back("");
+		const char *aPredefined[] = {"", "*", "bool", "char", "short", "int", "long", "float", "double", "string", "array", "int[]", "long[]", "float[]", "double[]", "ref"};
+		for (size_t i = 0; i < sizeof(aPredefined) / sizeof(aPredefined[0]); ++i)
+			intern(aPredefined[i], strlen(aPredefined[i]));
+	}
+
+	SymbolTable::~SymbolTable()
+	{
+		delete m_pClassMutex;
+	}
+
+	unsigned long SymbolTable::hash(const char *pString, size_t nLength)
+	{
+		// FNV-1a
+		unsigned long ulHash = 2166136261ul;
+		for (size_t i = 0; i < nLength; ++i)
+			ulHash = (ulHash ^ (unsigned char)pString[i]) * 16777619ul;
+		return ulHash;
+	}
+
+	const SymbolTable::Entry* SymbolTable::lookup(const char *pString, size_t nLength, unsigned long ulHash) const
+	{
+		size_t nMask = m_lsEntries.size() - 1;
+		for (size_t i = ulHash & nMask; ; i = (i + 1) & nMask)
+		{
+			const Entry& aEntry = m_lsEntries[i];
+			if (aEntry.ulSymbol == kNone)
+				return &aEntry;
+			if (aEntry.ulHash == ulHash)
+			{
+				const std::string& sString = m_lsStrings[aEntry.ulSymbol];
+				if (sString.length() == nLength && memcmp(sString.data(), pString, nLength) == 0)
+					return &aEntry;
+			}
+		}
+	}
+
+	Symbol SymbolTable::find(const char *pString, size_t nLength) const
+	{
+		return lookup(pString, nLength, hash(pString, nLength))->ulSymbol;
+	}
+
+	Symbol SymbolTable::intern(const char *pString, size_t nLength)
+	{
+		unsigned long ulHash = hash(pString, nLength);
+		Entry *pEntry = const_cast<Entry*>(lookup(pString, nLength, ulHash));
+		if (pEntry->ulSymbol != kNone || m_bConcurrent)
+			return pEntry->ulSymbol;
+
+		Symbol ulSymbol = (Symbol)m_lsStrings.size();
+		m_lsStrings.push_back(std::string(pString, nLength));
+		pEntry->ulHash = ulHash;
+		pEntry->ulSymbol = ulSymbol;
+
+		// Grow at a load of 3/4
+		if (m_lsStrings.size() * 4 > m_lsEntries.size() * 3)
+		{
+			std::vector<Entry> lsOldEntries(m_lsEntries.size() * 2);
+			lsOldEntries.swap(m_lsEntries);
+			for (std::vector<Entry>::const_iterator it = lsOldEntries.begin(); it != lsOldEntries.end(); ++it)
+				if (it->ulSymbol != kNone)
+				{
+					const std::string& sString = m_lsStrings[it->ulSymbol];
+					*const_cast<Entry*>(lookup(sString.data(), sString.length(), it->ulHash)) = *it;
+				}
+		}
+		return ulSymbol;
+	}
+
+	Symbol SymbolTable::getClassSymbol(const IArchivableObject *pObject)
+	{
+		if (m_bConcurrent)
+		{
+			const std::type_info *pType = &typeid(*pObject);
+			boost::mutex::scoped_lock aLock(*m_pClassMutex);
+			std::map<const std::type_info*, Symbol>::const_iterator it = m_mapClasses.find(pType);
+			if (it != m_mapClasses.end())
+				return it->second;
+
+			// Unknown names are not cached, the class may be looked up again once the table can grow
+			Symbol ulSymbol = find(pObject->getClassName());
+			if (ulSymbol != kNone)
+				m_mapClasses[pType] = ulSymbol;
+			return ulSymbol;
+		}
+
+		const std::type_info *pType = &typeid(*pObject);
+		std::map<const std::type_info*, Symbol>::const_iterator it = m_mapClasses.find(pType);
+		if (it != m_mapClasses.end())
+			return it->second;
+
+		// Modules may hold their own copy of a type_info, which only costs a second entry for the same symbol
+		Symbol ulSymbol = intern(pObject->getClassName());
+		m_mapClasses[pType] = ulSymbol;
+		return ulSymbol;
+	}
+}
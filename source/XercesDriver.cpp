@@ -42,6 +42,55 @@ namespace Archiving
 {
 	namespace Xerces
 	{
+		namespace
+		{
+			std::string writeDocument(DOMDocument *pDocument)
+			{
+				DOMImplementation *implementation = DOMImplementationRegistry::getDOMImplementation(L"LS");
+				
+				DOMWriter *pWriter = ((DOMImplementationLS*)implementation)->createDOMWriter();
+				
+				if (pWriter->canSetFeature(XMLUni::fgDOMWRTFormatPrettyPrint, true))
+					pWriter->setFeature(XMLUni::fgDOMWRTFormatPrettyPrint, true);
+				
+				MemBufFormatTarget *aFormatTarget = new MemBufFormatTarget();
+				XMLFormatter aFormatter(L"UTF-8", aFormatTarget);
+				
+				pWriter->writeNode(aFormatTarget, *pDocument);
+				
+				return std::string((char *)(aFormatTarget->getRawBuffer()));
+			}
+
+			/**
+			 * A clone of the document, written on the saving thread. Documents are independent of each other,
+			 * so the driver goes on with its own. Xerces stays initialized for the clone.
+			 */
+			class DocumentSnapshot : public IArchivingDriver::Snapshot
+			{
+			public:
+				DocumentSnapshot(const std::string& sFile, DOMDocument *pDocument) : Snapshot(sFile), m_pDocument(NULL)
+				{
+					XMLPlatformUtils::Initialize();
+					m_pDocument = (DOMDocument *)pDocument->cloneNode(true);
+				}
+
+				virtual ~DocumentSnapshot()
+				{
+					if (m_pDocument)
+						m_pDocument->release();
+					XMLPlatformUtils::Terminate();
+				}
+
+				virtual std::string getString()
+				{
+					return writeDocument(m_pDocument);
+				}
+
+			protected:
+				DOMDocument *m_pDocument;
+			};
+		}
+
 		Driver::Driver()
 			: m_pCurrentNode(NULL)
 			, m_pDocument(NULL)
@@ -55,10 +104,8 @@ namespace Archiving
 
 		Driver::~Driver()
 		{
-			if(m_pParser)
-				delete m_pParser; // document owned by parser
-			else if(m_pDocument)
-				m_pDocument->release();
+			releaseDocument();
+			delete m_pParser;
 			
 			XMLPlatformUtils::Terminate();
 		}
@@ -95,7 +142,7 @@ namespace Archiving
 					XMLString::release(&xml_document_name);
 					
 					m_pRootElement = m_pDocument->getDocumentElement();
-					this->m_pCurrentNode = new Node(NULL, this->m_pDocument, this->m_pRootElement, false);
+					this->m_pCurrentNode = new (this) Node(NULL, this->m_pDocument, this->m_pRootElement, false);
 					m_pCurrentNode->setDriver(this);
 				}
 				catch (...)
@@ -126,28 +173,25 @@ namespace Archiving
 			return false;
 		}
 
+		IArchivingDriver::Snapshot* Driver::createSnapshot(std::string sPath)
+		{
+			if (sPath.length() == 0)
+				throw(std::runtime_error("invalid path!"));
+
+			getRootNode();
+			return new DocumentSnapshot(sPath, m_pDocument);
+		}
+
 		std::string Driver::getString()
 		{
-			DOMImplementation *implementation = DOMImplementationRegistry::getDOMImplementation(L"LS");
-			
-			DOMWriter *pWriter = ((DOMImplementationLS*)implementation)->createDOMWriter();
-			
-			if (pWriter->canSetFeature(XMLUni::fgDOMWRTFormatPrettyPrint, true))
-				pWriter->setFeature(XMLUni::fgDOMWRTFormatPrettyPrint, true);
-			
-			MemBufFormatTarget *aFormatTarget = new MemBufFormatTarget();
-			XMLFormatter aFormatter(L"UTF-8", aFormatTarget);
-			
-			pWriter->writeNode(aFormatTarget, *m_pDocument);
-			
-			return std::string((char *)(aFormatTarget->getRawBuffer()));
+			return writeDocument(m_pDocument);
 		}
 
 		bool Driver::loadFromFile(const std::string& sFile)
 		{
 			try
 			{
-				reset();
+				releaseDocument();
 					
 				m_pParser->reset();
 				m_pParser->parse(sFile.c_str());
@@ -170,7 +214,7 @@ namespace Archiving
 			{
 				if (m_pRootElement = m_pDocument->getDocumentElement())
 				{
-					this->m_pCurrentNode = new Node(NULL, this->m_pDocument, this->m_pRootElement, false);
+					this->m_pCurrentNode = new (this) Node(NULL, this->m_pDocument, this->m_pRootElement, false);
 					m_pCurrentNode->setDriver(this);
 
 					return (m_bIsLoad = true);
@@ -184,7 +228,7 @@ namespace Archiving
 		{
 			try
 			{
-				reset();
+				releaseDocument();
 					
 				m_pParser->reset();
 				xercesc::MemBufInputSource archiveSource((const XMLByte*)sData.c_str(), sData.length(), "archive_dummy", false);
@@ -211,7 +255,7 @@ namespace Archiving
 			{
 				if (m_pRootElement = m_pDocument->getDocumentElement())
 				{
-					this->m_pCurrentNode = new Node(NULL, this->m_pDocument, this->m_pRootElement, false);
+					this->m_pCurrentNode = new (this) Node(NULL, this->m_pDocument, this->m_pRootElement, false);
 					m_pCurrentNode->setDriver(this);
 
 					return (m_bIsLoad = true);
@@ -234,12 +278,22 @@ namespace Archiving
 			return m_bIsLoad;
 		}
 
-		void Driver::reset()
+		void Driver::releaseDocument()
 		{
-			if (m_pDocument)
+			// The node wrappers point into the document, drop them first
+			releaseNodes();
+			m_pCurrentNode = NULL;
+
+			if (m_pDocument && (!m_pParser || m_pDocument != m_pParser->getDocument())) // parsed documents are owned by the parser
 				m_pDocument->release();
-				
+
+			m_pDocument = NULL;
 			m_pRootElement = NULL;
+		}
+
+		void Driver::reset()
+		{
+			releaseDocument();
 			getRootNode();
 		}
 	}
@@ -7,11 +7,15 @@
 #include <xercesc/dom/DOMElement.hpp>
 #include <xercesc/dom/DOMDocument.hpp>
 #include <xercesc/dom/DOMNodeList.hpp>
+#include <xercesc/dom/DOMText.hpp>
 
 #include <xercesc/parsers/XercesDOMParser.hpp>
 #include <xercesc/util/XMLUni.hpp>
+#include <xercesc/util/XMLUniDefs.hpp>
 #include <xercesc/util/XMLString.hpp>
 
+#include "../include/XercesTranscode.h"
+
 using namespace xercesc;
 
 namespace Archiving
@@ -22,15 +26,16 @@ namespace Archiving
 
 		Node::Node(Node *pParentNode, xercesc::DOMDocument *pDOMDocument, std::string sName)
 			: m_pDocument(pDOMDocument)
+			, m_sTagName(sName)
+			, m_bHasType(false)
+			, m_bElementsIndexed(false)
 		{
 			assert(pDOMDocument);
 			
-			XMLCh* xml_tagname = XMLString::transcode(sName.c_str());
+			Transcode::XMLChString xml_tagname(sName);
 			
-			setDOMElement(m_pDocument->createElement(xml_tagname));
+			m_pElement = m_pDocument->createElement(xml_tagname.get());
 			setParent(pParentNode);
-			
-			XMLString::release(&xml_tagname);
 
 			if (getParent())
 				((DOMNode*)pParentNode->getDOMElement())->appendChild((DOMNode*)this->getDOMElement());
@@ -38,6 +43,8 @@ namespace Archiving
 
 		Node::Node(Node *pParentNode, xercesc::DOMDocument *pDOMDocument, xercesc::DOMElement *pDOMElement, bool bNew /*=true*/)
 			: m_pDocument(pDOMDocument), m_pElement(pDOMElement)
+			, m_bHasType(false)
+			, m_bElementsIndexed(false)
 		{
 			assert(pDOMDocument);
 			assert(pDOMElement);
@@ -59,79 +66,182 @@ namespace Archiving
 
 		std::string Node::getTagName()
 		{
-			char *xml_tagname = XMLString::transcode(m_pElement->getTagName());
-			std::string sRet = xml_tagname;
-
-			XMLString::release(&xml_tagname);
-			return sRet;
+			// Element names are never empty, an empty name has not been transcoded yet
+			if (m_sTagName.empty())
+				Transcode::assign(m_pElement->getTagName(), m_sTagName);
+			return m_sTagName;
 		}
 
 		std::string Node::getAttribute(const std::string& sKey)
 		{
-			XMLCh *xml_key = XMLString::transcode(sKey.c_str());
-			char *xml_attribute = XMLString::transcode(m_pElement->getAttribute(const_cast<const XMLCh *>(xml_key)));
-			
-			std::string sRet = xml_attribute;
-			
-			XMLString::release(&xml_attribute);
-			XMLString::release(&xml_key);
-			
+			bool bType = sKey == kType;
+			if (bType && m_bHasType)
+				return m_sType;
+
+			Transcode::XMLChString xml_key(sKey);
+			std::string sRet = Transcode::toString(m_pElement->getAttribute(xml_key.get()));
+
+			if (bType)
+			{
+				m_sType = sRet;
+				m_bHasType = true;
+			}
 			return sRet;
 		}
 
 		void Node::setAttribute(const std::string& sKey, const std::string& sValue)
 		{
-			XMLCh *xml_key   = XMLString::transcode(sKey.c_str());
-			XMLCh *xml_value = XMLString::transcode(sValue.c_str());
-			m_pElement->setAttribute(const_cast<const XMLCh *>(xml_key), const_cast<const XMLCh *>(xml_value));
+			Transcode::XMLChString xml_key(sKey);
+			Transcode::XMLChString xml_value(sValue);
+			m_pElement->setAttribute(xml_key.get(), xml_value.get());
+
+			if (sKey == kType)
+			{
+				m_sType = sValue;
+				m_bHasType = true;
+				resetTypeSymbol();
+			}
+		}
 
-			XMLString::release(&xml_key);
-			XMLString::release(&xml_value);
+		/* Appends the text of pNode and its descendants, like DOMNode::getTextContent() but without a copy in the document */
+		static void appendTextContent(DOMNode *pNode, std::string& sValue)
+		{
+			for (DOMNode *pChild = pNode->getFirstChild(); pChild != NULL; pChild = pChild->getNextSibling())
+			{
+				switch (pChild->getNodeType())
+				{
+				case DOMNode::TEXT_NODE:
+				case DOMNode::CDATA_SECTION_NODE:
+					Transcode::append(pChild->getNodeValue(), sValue);
+					break;
+				case DOMNode::ELEMENT_NODE:
+				case DOMNode::ENTITY_REFERENCE_NODE:
+					appendTextContent(pChild, sValue);
+					break;
+				default:
+					break;
+				}
+			}
 		}
 
 		/* Returns the inner content of a XML-Tag as std::string */
 		std::string Node::getValue()
 		{
-			char *xml_value = XMLString::transcode(m_pElement->getTextContent());
-
-			std::string sValue = xml_value ? xml_value : "";
-			XMLString::release(&xml_value);
-			
+			std::string sValue;
+			getValue(sValue);
 			return sValue;
 		}
+
+		void Node::getValue(std::string& sValue)
+		{
+			sValue.erase();
+			appendTextContent(m_pElement, sValue);
+		}
 		
 		/* Sets the inner content of a XML-Tag */
-		void Node::setValue(std::string sValue)
+		void Node::setValue(const std::string& sValue)
 		{
-			XMLCh *xml_value = XMLString::transcode(sValue.c_str());
-			m_pElement->setTextContent(xml_value);
+			Transcode::XMLChString xml_value(sValue);
 
-			XMLString::release(&xml_value);
+			// A value set again goes into the text node it already has, which keeps its buffer if the text fits
+			DOMNode *pText = m_pElement->getFirstChild();
+			if (pText && !pText->getNextSibling() && pText->getNodeType() == DOMNode::TEXT_NODE && !sValue.empty())
+				((DOMText *)pText)->setData(xml_value.get());
+			else
+				m_pElement->setTextContent(xml_value.get());
 		}
 		
 		/* Returns a child (search-depth = 1) for the given tag-name or NULL if it doesnt exist */
 		INode* Node::getChild(const std::string& sKey, const std::string& sType /*="*"*/)
 		{
-			// Create child nodes if not created yet
-			if(!hasChildren())
-				for(DOMNode *pChild = m_pElement->getFirstChild(); pChild != NULL; pChild = pChild->getNextSibling())
-					if (pChild->getNodeType() == DOMNode::ELEMENT_NODE)
-						new Node(this, m_pDocument, (DOMElement *)pChild, false);
-			
-			// Obtain the node with the specified name
-			INode* pResult = INode::getChild(sKey);
-			
-			// Check the type if a result was found. The type must not be empty.
-			if(pResult)
-				if(sType != pResult->getAttribute(kType) && sType != "*" || sType == "")
-					pResult = NULL;
+			return getChild(sKey, getSymbols().intern(sType));
+		}
 
-			return pResult;
+		/** The name of the "type" attribute, see Node::kType. */
+		static const XMLCh s_aTypeName[] = {chLatin_t, chLatin_y, chLatin_p, chLatin_e, chNull};
+
+		/** True if the "type" attribute of the element matches as INode::matchesType() compares it for a node. */
+		static bool matchesElementType(DOMElement *pElement, SymbolTable& aSymbols, Symbol ulType)
+		{
+			if (ulType == SymbolTable::kAnyType)
+				return true;
+			if (ulType == SymbolTable::kEmpty)
+				return false;
+
+			std::string sType;
+			Transcode::assign(pElement->getAttribute(s_aTypeName), sType);
+			return aSymbols.find(sType) == ulType;
+		}
+
+		INode* Node::getChild(const std::string& sKey, Symbol ulType)
+		{
+			// The tag names of the children are interned by the index, so it is built before the key is looked up
+			if (!m_bElementsIndexed)
+				indexElements();
+
+			Symbol ulKey = getSymbols().find(sKey);
+			if (ulKey == SymbolTable::kNone)
+				return NULL;
+
+			// Only the children that are asked for get a node, the index of elements stays as it is on a miss
+			if (!findChild(ulKey, SymbolTable::kAnyType))
+			{
+				DOMElement *pElement = (DOMElement *)m_aElements.find(ulKey);
+				if (!pElement || !matchesElementType(pElement, getSymbols(), ulType))
+					return NULL;
+				new (getDriver()) Node(this, m_pDocument, pElement, false);
+			}
+
+			// Check the type by symbol. The type must not be empty.
+			return findChild(ulKey, ulType);
+		}
+
+		/* Compares an element name with a key, ASCII names without transcoding */
+		static bool equalsName(const XMLCh *pName, const std::string& sKey)
+		{
+			for (size_t i = 0; i < sKey.length(); ++i)
+			{
+				unsigned char c = (unsigned char)sKey[i];
+				if (c >= 0x80)
+					return Transcode::toString(pName) == sKey;
+				if (pName[i] != c)
+					return false;
+			}
+			return pName[sKey.length()] == 0;
+		}
+
+		INode* Node::getNextChild(INode *pChild, const std::string& sKey)
+		{
+			DOMNode *pNext = pChild ? ((Node *)pChild)->m_pElement->getNextSibling() : m_pElement->getFirstChild();
+			while (pNext && pNext->getNodeType() != DOMNode::ELEMENT_NODE)
+				pNext = pNext->getNextSibling();
+			if (!pNext || !equalsName(((DOMElement *)pNext)->getTagName(), sKey))
+				return NULL;
+
+			// The element may have a node from an earlier lookup
+			Symbol ulKey = getSymbols().find(sKey);
+			Node *pNode = ulKey != SymbolTable::kNone ? (Node *)findChild(ulKey, SymbolTable::kAnyType) : NULL;
+			if (pNode && pNode->m_pElement == pNext)
+				return pNode;
+			return new (getDriver()) Node(this, m_pDocument, (DOMElement *)pNext, false);
+		}
+
+		void Node::indexElements()
+		{
+			std::string sName;
+			for (DOMNode *pChild = m_pElement->getFirstChild(); pChild != NULL; pChild = pChild->getNextSibling())
+			{
+				if (pChild->getNodeType() != DOMNode::ELEMENT_NODE)
+					continue;
+				Transcode::assign(((DOMElement *)pChild)->getTagName(), sName);
+				m_aElements.insert(getArena(), getSymbols().intern(sName), (DOMElement *)pChild);
+			}
+			m_bElementsIndexed = true;
 		}
 
 		INode* Node::addChild(const std::string& sKey)
 		{
-			return new Node(this, m_pDocument, sKey);
+			return new (getDriver()) Node(this, m_pDocument, sKey);
 		}
 
 		/** XercesNode Specific Accessors */
@@ -144,6 +254,13 @@ namespace Archiving
 		void Node::setDOMElement(DOMElement *pDOMElement)
 		{
 			m_pElement = pDOMElement;
+
+			// The cached names and elements belong to the previous element
+			m_sTagName.erase();
+			m_bHasType = false;
+			resetTypeSymbol();
+			m_aElements = SymbolIndex();
+			m_bElementsIndexed = false;
 		}
 
 		const std::string Node::kType = "type";
@@ -0,0 +1,319 @@
+#pragma hdrstop
+
+#include "StdAfx.h"
+
+#include "../GlobExport/XercesSAXNode.hpp"
+#include "../GlobExport/XercesSAXDriver.hpp"
+#include "../GlobExport/ArchiveUtil.hpp"
+
+#include <xercesc/util/PlatformUtils.hpp>
+#include <xercesc/util/XMLUni.hpp>
+#include <xercesc/util/XMLString.hpp>
+#include <xercesc/util/XMLException.hpp>
+#include <xercesc/util/OutOfMemoryException.hpp>
+#include <xercesc/sax/SAXParseException.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/sax2/Attributes.hpp>
+#include <xercesc/framework/XMLPScanToken.hpp>
+#include <xercesc/framework/MemBufInputSource.hpp>
+
+#include "../include/XercesTranscode.h"
+
+using namespace xercesc;
+
+namespace Archiving
+{
+	namespace Xerces
+	{
+		/**
+		 * Forwards the SAX events of the parser to the driver.
+		 */
+		class SAXHandler : public DefaultHandler
+		{
+		public:
+			SAXHandler(SAXDriver *pDriver) : m_pDriver(pDriver) {;}
+
+			virtual void startElement(const XMLCh* const pURI, const XMLCh* const pLocalName, const XMLCh* const pQName, const Attributes& aAttributes)
+			{
+				m_pDriver->onStartElement(pQName, aAttributes);
+			}
+
+			virtual void endElement(const XMLCh* const pURI, const XMLCh* const pLocalName, const XMLCh* const pQName)
+			{
+				m_pDriver->onEndElement();
+			}
+
+			virtual void characters(const XMLCh* const pChars, const unsigned int nLength)
+			{
+				m_pDriver->onCharacters(pChars, nLength);
+			}
+
+			virtual void error(const SAXParseException& e)
+			{
+				++m_pDriver->m_ulErrorCount;
+			}
+
+			virtual void fatalError(const SAXParseException& e)
+			{
+				++m_pDriver->m_ulErrorCount;
+			}
+
+		protected:
+			SAXDriver *m_pDriver;
+		};
+
+		/** Con/Destructor */
+
+		SAXDriver::SAXDriver()
+			: m_pParser(NULL)
+			, m_pToken(NULL)
+			, m_pSource(NULL)
+			, m_pHandler(NULL)
+			, m_pRootNode(NULL)
+			, m_ulSkipDepth(0)
+			, m_bParsing(false)
+			, m_ulErrorCount(0)
+			, m_bIsLoad(false)
+		{
+		}
+
+		SAXDriver::~SAXDriver()
+		{
+			close();
+
+			delete m_pParser;
+			delete m_pHandler;
+			delete m_pToken;
+
+			XMLPlatformUtils::Terminate();
+		}
+
+		void SAXDriver::init()
+		{
+			try
+			{
+				XMLPlatformUtils::Initialize();
+			}
+			catch (...)
+			{
+				throw(std::runtime_error("Error initializing Xerces API!"));
+			}
+
+			m_pParser = XMLReaderFactory::createXMLReader();
+			assert(m_pParser != NULL);
+			m_pParser->setFeature(XMLUni::fgSAX2CoreNameSpaces, false);
+			m_pParser->setFeature(XMLUni::fgSAX2CoreValidation, false);
+
+			m_pHandler = new SAXHandler(this);
+			m_pParser->setContentHandler(m_pHandler);
+			m_pParser->setErrorHandler(m_pHandler);
+
+			m_pToken = new XMLPScanToken();
+		}
+
+		bool SAXDriver::open(const char *pSystemId)
+		{
+			try
+			{
+				if (pSystemId)
+					m_bParsing = m_pParser->parseFirst(pSystemId, *m_pToken);
+				else
+					m_bParsing = m_pParser->parseFirst(*m_pSource, *m_pToken);
+			}
+			catch (const XMLException&)
+			{
+				++m_ulErrorCount;
+				m_bParsing = false;
+			}
+			catch (const SAXException&)
+			{
+				m_bParsing = false;
+			}
+			catch (const OutOfMemoryException&)
+			{
+				++m_ulErrorCount;
+				m_bParsing = false;
+			}
+
+			while (!m_pRootNode && parseNext());
+
+			if (!m_pRootNode)
+			{
+				close();
+				return (m_bIsLoad = false);
+			}
+
+			return (m_bIsLoad = true);
+		}
+
+		void SAXDriver::close()
+		{
+			if (m_bParsing)
+				m_pParser->parseReset(*m_pToken);
+			m_bParsing = false;
+
+			m_lsOpenNodes.clear();
+			m_ulSkipDepth = 0;
+
+			delete m_pRootNode;
+			m_pRootNode = NULL;
+
+			delete m_pSource;
+			m_pSource = NULL;
+			m_sData.clear();
+		}
+
+		bool SAXDriver::parseNext()
+		{
+			if (!m_bParsing)
+				return false;
+
+			try
+			{
+				m_bParsing = m_pParser->parseNext(*m_pToken);
+			}
+			catch (const XMLException&)
+			{
+				++m_ulErrorCount;
+				m_bParsing = false;
+			}
+			catch (const SAXException&)
+			{
+				m_bParsing = false;
+			}
+			catch (const OutOfMemoryException&)
+			{
+				++m_ulErrorCount;
+				m_bParsing = false;
+			}
+
+			return m_bParsing;
+		}
+
+		/** Parser callbacks */
+
+		void SAXDriver::onStartElement(const XMLCh *pName, const Attributes& aAttributes)
+		{
+			if (m_ulSkipDepth)
+			{
+				++m_ulSkipDepth;
+				return;
+			}
+
+			SAXNode *pParent = m_lsOpenNodes.empty() ? NULL : m_lsOpenNodes.back();
+			SAXNode *pNode = NULL;
+
+			if (!pParent)
+			{
+				pNode = m_pRootNode = new SAXNode(this, NULL, Transcode::toString(pName), SAXNode::Live);
+				pNode->m_bReturned = true;
+			}
+			else if (pParent->m_eMode == SAXNode::Skipping)
+			{
+				m_ulSkipDepth = 1;
+				return;
+			}
+			else
+			{
+				pNode = new SAXNode(this, pParent, Transcode::toString(pName), pParent->m_eMode);
+				pParent->addParsedChild(pNode);
+			}
+
+			pNode->m_lsAttributes.reserve(aAttributes.getLength());
+			for (unsigned int i = 0; i < aAttributes.getLength(); ++i)
+				pNode->m_lsAttributes.push_back(SAXNode::Attribute(Transcode::toString(aAttributes.getQName(i)), Transcode::toString(aAttributes.getValue(i))));
+
+			m_lsOpenNodes.push_back(pNode);
+		}
+
+		void SAXDriver::onEndElement()
+		{
+			if (m_ulSkipDepth)
+			{
+				--m_ulSkipDepth;
+				return;
+			}
+
+			if (!m_lsOpenNodes.empty())
+			{
+				m_lsOpenNodes.back()->m_bComplete = true;
+				m_lsOpenNodes.pop_back();
+			}
+		}
+
+		void SAXDriver::onCharacters(const XMLCh *pChars, unsigned int nLength)
+		{
+			if (m_ulSkipDepth || m_lsOpenNodes.empty())
+				return;
+
+			SAXNode *pNode = m_lsOpenNodes.back();
+			if (pNode->m_eMode == SAXNode::Skipping || pNode->m_bHasElements)
+				return;
+
+			// The characters are not terminated
+			Transcode::append(pChars, nLength, pNode->m_sValue);
+		}
+
+		/** Load/Write */
+
+		INode* SAXDriver::getRootNode()
+		{
+			if (!m_pRootNode) /* Nothing loaded: provide an empty root so that all lookups fail */
+			{
+				m_pRootNode = new SAXNode(this, NULL, "archive", SAXNode::Buffering);
+				m_pRootNode->m_bComplete = true;
+				m_pRootNode->m_bReturned = true;
+			}
+			return m_pRootNode;
+		}
+
+		bool SAXDriver::save(std::string sPath)
+		{
+			return false;
+		}
+
+		std::string SAXDriver::getString()
+		{
+			return std::string();
+		}
+
+		bool SAXDriver::loadFromFile(const std::string& sFile)
+		{
+			close();
+			m_ulErrorCount = 0;
+
+			return open(sFile.c_str());
+		}
+
+		bool SAXDriver::loadFromString(const std::string& sData)
+		{
+			close();
+			m_ulErrorCount = 0;
+
+			m_sData = sData;
+			m_pSource = new MemBufInputSource((const XMLByte*)m_sData.c_str(), m_sData.length(), "archive_dummy", false);
+			return open(NULL);
+		}
+
+		/*
+		 *
+		 */
+		unsigned long SAXDriver::getErrorCount()
+		{
+			return m_ulErrorCount;
+		}
+
+		bool SAXDriver::getIsLoad()
+		{
+			return m_bIsLoad;
+		}
+
+		void SAXDriver::reset()
+		{
+			close();
+			getRootNode();
+		}
+	}
+}
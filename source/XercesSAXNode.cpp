@@ -0,0 +1,170 @@
+#pragma hdrstop
+
+#include "stdafx.h"
+
+#include "../GlobExport/XercesSAXNode.hpp"
+#include "../GlobExport/XercesSAXDriver.hpp"
+
+namespace Archiving
+{
+	namespace Xerces
+	{
+		/** Con/Destructor */
+
+		SAXNode::SAXNode(SAXDriver *pDriver, SAXNode *pParentNode, const std::string& sName, Mode eMode)
+			: m_pSAXDriver(pDriver)
+			, m_sName(sName)
+			, m_eMode(eMode)
+			, m_bComplete(false)
+			, m_bHasElements(false)
+			, m_bReturned(false)
+			, m_pCurrentChild(NULL)
+		{
+			setParentLink(pParentNode, pDriver);
+		}
+
+		SAXNode::~SAXNode()
+		{
+			delete m_pCurrentChild;
+			for (std::vector<SAXNode*>::iterator it = m_lsBuffered.begin(); it != m_lsBuffered.end(); ++it)
+				delete *it;
+		}
+
+		/** Accessors */
+
+		std::string SAXNode::getTagName()
+		{
+			return m_sName;
+		}
+
+		std::string SAXNode::getAttribute(const std::string& sKey)
+		{
+			for (std::vector<Attribute>::const_iterator it = m_lsAttributes.begin(); it != m_lsAttributes.end(); ++it)
+				if (it->first == sKey)
+					return it->second;
+
+			return std::string();
+		}
+
+		void SAXNode::setAttribute(const std::string& sKey, const std::string& sValue)
+		{
+			throw(std::runtime_error("streamed XML archives are read-only!"));
+		}
+
+		std::string SAXNode::getValue()
+		{
+			// The text may not have been parsed yet. Read up to the end of the element, keeping any children.
+			if (!m_bComplete && m_eMode == Live)
+			{
+				setMode(Buffering);
+				while (!m_bComplete && m_pSAXDriver->parseNext());
+			}
+			return m_sValue;
+		}
+
+		void SAXNode::setValue(const std::string& sValue)
+		{
+			throw(std::runtime_error("streamed XML archives are read-only!"));
+		}
+
+		INode* SAXNode::matchType(SAXNode *pNode, const std::string& sType)
+		{
+			// The type semantics of INode::getChild()
+			if(sType != pNode->getAttribute("type") && sType != "*" || sType == "")
+				return NULL;
+
+			return pNode;
+		}
+
+		/* Returns a child (search-depth = 1) for the given tag-name or NULL if it doesnt exist */
+		INode* SAXNode::getChild(const std::string& sKey, const std::string& sType /*="*"*/)
+		{
+			std::map<std::string, SAXNode*>::iterator itBuffered = m_mapBuffered.find(sKey);
+			if (itBuffered != m_mapBuffered.end())
+				return matchType(itBuffered->second, sType);
+
+			// The current child is asked for again, e.g. by getArray() and getArrayCount()
+			if (m_pCurrentChild && m_pCurrentChild->m_sName == sKey)
+			{
+				INode *pResult = matchType(m_pCurrentChild, sType);
+				m_pCurrentChild->m_bReturned |= pResult != NULL;
+				return pResult;
+			}
+
+			// Move the parser on to the next child until the key turns up
+			while (!m_bComplete)
+			{
+				finishCurrentChild();
+				while (!m_pCurrentChild && !m_bComplete && m_pSAXDriver->parseNext());
+
+				if (!m_pCurrentChild)
+					break;
+
+				if (m_pCurrentChild->m_sName == sKey)
+				{
+					INode *pResult = matchType(m_pCurrentChild, sType);
+					m_pCurrentChild->m_bReturned = pResult != NULL;
+					return pResult;
+				}
+
+				m_pCurrentChild->setMode(Buffering);
+			}
+
+			return NULL;
+		}
+
+		INode* SAXNode::addChild(const std::string& sKey)
+		{
+			throw(std::runtime_error("streamed XML archives are read-only!"));
+		}
+
+		/** Parsing */
+
+		void SAXNode::finishCurrentChild()
+		{
+			SAXNode *pChild = m_pCurrentChild;
+			if (!pChild)
+				return;
+
+			pChild->setMode(pChild->m_bReturned ? Skipping : Buffering);
+			while (!pChild->m_bComplete && m_pSAXDriver->parseNext());
+
+			m_pCurrentChild = NULL;
+			if (pChild->m_bReturned)
+			{
+				delete pChild;
+			}
+			else
+			{
+				m_lsBuffered.push_back(pChild);
+				m_mapBuffered[pChild->m_sName] = pChild;
+			}
+		}
+
+		void SAXNode::setMode(Mode eMode)
+		{
+			m_eMode = eMode;
+			if (m_pCurrentChild && !m_pCurrentChild->m_bComplete)
+				m_pCurrentChild->setMode(eMode);
+		}
+
+		void SAXNode::addParsedChild(SAXNode *pChild)
+		{
+			// Text between child elements is formatting
+			m_bHasElements = true;
+			m_sValue.clear();
+
+			// A live node gets children only while getChild() is pulling, after the previous child was finished.
+			// Anything else is kept so that it is not lost.
+			if (m_eMode == Live && !m_pCurrentChild)
+			{
+				m_pCurrentChild = pChild;
+			}
+			else
+			{
+				m_lsBuffered.push_back(pChild);
+				m_mapBuffered[pChild->m_sName] = pChild;
+			}
+		}
+	}
+}
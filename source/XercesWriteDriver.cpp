@@ -0,0 +1,440 @@
+#pragma hdrstop
+
+#include "StdAfx.h"
+#include <cstdio>
+#include <cstring>
+
+#include "../GlobExport/XercesWriteNode.hpp"
+#include "../GlobExport/XercesWriteDriver.hpp"
+#include "../GlobExport/ArchiveUtil.hpp"
+
+#include <xercesc/util/PlatformUtils.hpp>
+#include <xercesc/util/XMLString.hpp>
+
+#include "../include/XercesTranscode.h"
+
+using namespace xercesc;
+
+namespace Archiving
+{
+	namespace Xerces
+	{
+		/** Size of the output buffer, it is written to the file whenever it is full. */
+		static const size_t kBufferSize = 64 * 1024;
+
+		static const char kHeader[] = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n";
+
+		/** Con/Destructor */
+
+		WriteDriver::WriteDriver()
+			: m_pFile(NULL)
+			, m_nOpenElements(0)
+			, m_nBaseDepth(0)
+			, m_bStartTagOpen(false)
+			, m_bFinished(false)
+			, m_ulErrorCount(0)
+			, m_bIsLoad(false)
+		{
+		}
+
+		WriteDriver::~WriteDriver()
+		{
+			close();
+
+			for (std::vector<WriteNode*>::iterator it = m_lsNodes.begin(); it != m_lsNodes.end(); ++it)
+				delete *it;
+
+			XMLPlatformUtils::Terminate();
+		}
+
+		void WriteDriver::init()
+		{
+			try
+			{
+				XMLPlatformUtils::Initialize();
+			}
+			catch (...)
+			{
+				throw(std::runtime_error("Error initializing Xerces API!"));
+			}
+
+			begin(NULL, std::string());
+		}
+
+		void WriteDriver::begin(FILE *pFile, const std::string& sPath)
+		{
+			close();
+			m_pFile = pFile;
+			m_sPath = sPath;
+
+			m_sBuffer.clear();
+			m_sBuffer.reserve(kBufferSize);
+			m_nOpenElements = 0;
+			m_nBaseDepth = 0;
+			m_bStartTagOpen = false;
+			m_bFinished = false;
+			m_ulErrorCount = 0;
+
+			write(kHeader, sizeof(kHeader) - 1);
+			startElement(0, "archive");
+		}
+
+		void WriteDriver::beginFragment(size_t nDepth)
+		{
+			begin(NULL, std::string());
+			m_sBuffer.clear();
+
+			// Stand-ins for the open elements down to the parent, whose start tag the main output closes
+			while (m_lsNodes.size() <= nDepth)
+				m_lsNodes.push_back(new WriteNode(this, m_lsNodes.back(), m_lsNodes.size()));
+			for (size_t i = 0; i <= nDepth; ++i)
+				m_lsNodes[i]->m_bHasChildren = true;
+
+			m_nOpenElements = nDepth + 1;
+			m_nBaseDepth = nDepth;
+			m_bStartTagOpen = false;
+		}
+
+		void WriteDriver::close()
+		{
+			if (m_pFile)
+				fclose(m_pFile);
+			m_pFile = NULL;
+			m_sPath.clear();
+		}
+
+		void WriteDriver::finish()
+		{
+			if (!m_bFinished)
+			{
+				closeElements(0);
+				m_bFinished = true;
+			}
+
+			if (m_pFile)
+			{
+				flush();
+				if (fflush(m_pFile) != 0)
+					++m_ulErrorCount;
+			}
+		}
+
+		bool WriteDriver::copyTo(FILE *pFile)
+		{
+			if (!m_pFile)
+				return fwrite(m_sBuffer.data(), sizeof(char), m_sBuffer.size(), pFile) == m_sBuffer.size();
+
+			std::vector<char> aChunk(kBufferSize);
+			bool bResult = true;
+			size_t nRead;
+
+			fseek(m_pFile, 0, SEEK_SET);
+			while (bResult && (nRead = fread(&aChunk[0], sizeof(char), aChunk.size(), m_pFile)) > 0)
+				bResult = fwrite(&aChunk[0], sizeof(char), nRead, pFile) == nRead;
+			bResult = bResult && !ferror(m_pFile);
+			fseek(m_pFile, 0, SEEK_END);
+
+			return bResult;
+		}
+
+		/** Output */
+
+		void WriteDriver::write(const char *pData, size_t nLength)
+		{
+			m_sBuffer.append(pData, nLength);
+			if (m_sBuffer.size() >= kBufferSize)
+				flush();
+		}
+
+		void WriteDriver::writeEscaped(const std::string& sText, bool bAttribute)
+		{
+			const std::string *pText = &sText;
+			std::string sUTF8;
+			if (!Transcode::isASCII(sText))
+			{
+				sUTF8 = Transcode::toUTF8(sText);
+				pText = &sUTF8;
+			}
+
+			// Write runs of plain characters in one go
+			const char *pRun = pText->data();
+			const char *pEnd = pRun + pText->size();
+			for (const char *p = pRun; p < pEnd; ++p)
+			{
+				const char *pEscape = NULL;
+				switch (*p)
+				{
+				case '&':  pEscape = "&amp;"; break;
+				case '<':  pEscape = "&lt;"; break;
+				case '>':  pEscape = "&gt;"; break;
+				case '"':  pEscape = bAttribute ? "&quot;" : NULL; break;
+				case '\r': pEscape = "&#xD;"; break;
+				case '\n': pEscape = bAttribute ? "&#xA;" : NULL; break;
+				case '\t': pEscape = bAttribute ? "&#x9;" : NULL; break;
+				default:
+					if ((unsigned char)*p < 0x20)
+					{
+						// Not allowed in XML 1.0, the character is dropped and the save fails
+						pEscape = "";
+						++m_ulErrorCount;
+					}
+				}
+
+				if (pEscape)
+				{
+					write(pRun, p - pRun);
+					write(pEscape, strlen(pEscape));
+					pRun = p + 1;
+				}
+			}
+			write(pRun, pEnd - pRun);
+		}
+
+		void WriteDriver::writeIndent(size_t nDepth)
+		{
+			for (size_t i = 0; i < nDepth; ++i)
+				write("  ", 2);
+		}
+
+		void WriteDriver::flush()
+		{
+			if (m_sBuffer.empty())
+				return;
+
+			if (!m_pFile && !(m_pFile = tmpfile()))
+				throw(std::runtime_error("error creating temporary file!"));
+
+			if (fwrite(m_sBuffer.data(), sizeof(char), m_sBuffer.size(), m_pFile) != m_sBuffer.size())
+				++m_ulErrorCount;
+			m_sBuffer.clear();
+		}
+
+		/** Elements */
+
+		WriteNode* WriteDriver::startElement(size_t nDepth, const std::string& sName)
+		{
+			if (m_bFinished)
+				throw(std::runtime_error("the streamed XML archive has already been written!"));
+			if (nDepth > m_nOpenElements)
+				throw(std::runtime_error("the parent element has already been closed!"));
+
+			closeElements(nDepth);
+
+			if (nDepth > 0)
+			{
+				WriteNode *pParent = m_lsNodes[nDepth - 1];
+				if (m_bStartTagOpen)
+					write(">", 1);
+				if (!pParent->m_bHasChildren)
+					write("\n", 1);
+				pParent->m_bHasChildren = true;
+			}
+
+			if (m_lsNodes.size() <= nDepth)
+				m_lsNodes.push_back(new WriteNode(this, nDepth ? m_lsNodes[nDepth - 1] : NULL, nDepth));
+
+			WriteNode *pNode = m_lsNodes[nDepth];
+			pNode->m_sName = sName;
+			pNode->m_lsAttributes.clear();
+			pNode->m_bHasChildren = false;
+			pNode->resetTypeSymbol();
+
+			writeIndent(nDepth);
+			write("<", 1);
+			write(sName);
+
+			m_bStartTagOpen = true;
+			m_nOpenElements = nDepth + 1;
+			return pNode;
+		}
+
+		void WriteDriver::closeElements(size_t nDepth)
+		{
+			while (m_nOpenElements > nDepth)
+			{
+				WriteNode *pNode = m_lsNodes[--m_nOpenElements];
+				if (m_bStartTagOpen)
+				{
+					write("/>\n", 3);
+				}
+				else
+				{
+					if (pNode->m_bHasChildren)
+						writeIndent(pNode->m_nDepth);
+					write("</", 2);
+					write(pNode->m_sName);
+					write(">\n", 2);
+				}
+				m_bStartTagOpen = false;
+			}
+		}
+
+		void WriteDriver::writeAttribute(WriteNode *pNode, const std::string& sKey, const std::string& sValue)
+		{
+			if (m_bFinished || pNode->m_nDepth + 1 != m_nOpenElements || !m_bStartTagOpen)
+				throw(std::runtime_error("attributes of a streamed XML element must be set before its content!"));
+			for (std::vector<WriteNode::Attribute>::const_iterator it = pNode->m_lsAttributes.begin(); it != pNode->m_lsAttributes.end(); ++it)
+				if (it->first == sKey)
+					throw(std::runtime_error("attribute has already been written!"));
+
+			pNode->m_lsAttributes.push_back(WriteNode::Attribute(sKey, sValue));
+
+			write(" ", 1);
+			write(sKey);
+			write("=\"", 2);
+			writeEscaped(sValue, true);
+			write("\"", 1);
+		}
+
+		void WriteDriver::writeValue(WriteNode *pNode, const std::string& sValue)
+		{
+			if (m_bFinished || pNode->m_nDepth + 1 != m_nOpenElements)
+				throw(std::runtime_error("the streamed XML element has already been closed!"));
+
+			if (m_bStartTagOpen)
+			{
+				write(">", 1);
+				m_bStartTagOpen = false;
+			}
+			writeEscaped(sValue, false);
+		}
+
+		/** Load/Write */
+
+		INode* WriteDriver::getRootNode()
+		{
+			if (m_lsNodes.empty())
+				begin(NULL, std::string());
+			return m_lsNodes[m_nBaseDepth];
+		}
+
+		bool WriteDriver::save(std::string sPath)
+		{
+			if (sPath.length() == 0)
+				sPath = m_sPath;
+			if (sPath.length() == 0)
+				throw(std::runtime_error("invalid path!"));
+
+			finish();
+
+			// The archive has been streamed to this file already
+			if (m_pFile && sPath == m_sPath)
+				return m_ulErrorCount == 0;
+
+			FILE *pFile = fopen(sPath.c_str(), "wb");
+			if (pFile)
+			{
+				bool bResult = copyTo(pFile);
+				fclose(pFile);
+
+				return bResult && m_ulErrorCount == 0;
+			}
+
+			return false;
+		}
+
+		std::string WriteDriver::getString()
+		{
+			finish();
+
+			if (!m_pFile)
+				return m_sBuffer;
+
+			std::string sRet;
+			fseek(m_pFile, 0, SEEK_END);
+			sRet.resize((size_t)ftell(m_pFile));
+			fseek(m_pFile, 0, SEEK_SET);
+			if (!sRet.empty())
+				sRet.resize(fread(&sRet[0], sizeof(char), sRet.size(), m_pFile));
+			fseek(m_pFile, 0, SEEK_END);
+
+			return sRet;
+		}
+
+		bool WriteDriver::loadFromFile(const std::string& sFile)
+		{
+			return (m_bIsLoad = false);
+		}
+
+		bool WriteDriver::loadFromString(const std::string& sData)
+		{
+			return (m_bIsLoad = false);
+		}
+
+		bool WriteDriver::openOutput(const std::string& sFile)
+		{
+			FILE *pFile = fopen(sFile.c_str(), "w+b");
+			if (!pFile)
+				return false;
+
+			begin(pFile, sFile);
+			return true;
+		}
+
+		/*
+		 *
+		 */
+		unsigned long WriteDriver::getErrorCount()
+		{
+			return m_ulErrorCount;
+		}
+
+		bool WriteDriver::getIsLoad()
+		{
+			return m_bIsLoad;
+		}
+
+		/** Parallel writes */
+
+		IArchivingDriver* WriteDriver::createFragment(INode *pParent)
+		{
+			WriteDriver *pFragment = new WriteDriver();
+			pFragment->init();
+			pFragment->beginFragment(((WriteNode *)pParent)->m_nDepth);
+			return pFragment;
+		}
+
+		void WriteDriver::appendFragment(INode *pParent, IArchivingDriver *pFragment)
+		{
+			WriteDriver *pSource = dynamic_cast<WriteDriver *>(pFragment);
+			WriteNode *pNode = (WriteNode *)pParent;
+			if (!pSource || pSource->m_nBaseDepth != pNode->m_nDepth)
+				throw(std::runtime_error("the fragment belongs to another element!"));
+
+			pSource->closeElements(pSource->m_nBaseDepth + 1);
+			if (!pSource->m_pFile && pSource->m_sBuffer.empty())
+				return;
+
+			// Continue the parent as startElement() does for its children
+			if (m_bFinished || pNode->m_nDepth >= m_nOpenElements)
+				throw(std::runtime_error("the parent element has already been closed!"));
+			closeElements(pNode->m_nDepth + 1);
+			if (m_bStartTagOpen)
+				write(">", 1);
+			if (!pNode->m_bHasChildren)
+				write("\n", 1);
+			pNode->m_bHasChildren = true;
+			m_bStartTagOpen = false;
+
+			if (pSource->m_pFile)
+			{
+				std::vector<char> aChunk(kBufferSize);
+				size_t nRead;
+
+				fseek(pSource->m_pFile, 0, SEEK_SET);
+				while ((nRead = fread(&aChunk[0], sizeof(char), aChunk.size(), pSource->m_pFile)) > 0)
+					write(&aChunk[0], nRead);
+				if (ferror(pSource->m_pFile))
+					++m_ulErrorCount;
+			}
+			write(pSource->m_sBuffer);
+			m_ulErrorCount += pSource->m_ulErrorCount;
+		}
+
+		void WriteDriver::reset()
+		{
+			begin(NULL, std::string());
+			m_bIsLoad = false;
+		}
+	}
+}
@@ -0,0 +1,68 @@
+#pragma hdrstop
+
+#include "stdafx.h"
+
+#include "../GlobExport/XercesWriteNode.hpp"
+#include "../GlobExport/XercesWriteDriver.hpp"
+
+namespace Archiving
+{
+	namespace Xerces
+	{
+		/** Con/Destructor */
+
+		WriteNode::WriteNode(WriteDriver *pDriver, WriteNode *pParentNode, size_t nDepth)
+			: m_pWriteDriver(pDriver)
+			, m_nDepth(nDepth)
+			, m_bHasChildren(false)
+		{
+			setParentLink(pParentNode, pDriver);
+		}
+
+		WriteNode::~WriteNode()
+		{
+		}
+
+		/** Accessors */
+
+		std::string WriteNode::getTagName()
+		{
+			return m_sName;
+		}
+
+		std::string WriteNode::getAttribute(const std::string& sKey)
+		{
+			for (std::vector<Attribute>::const_iterator it = m_lsAttributes.begin(); it != m_lsAttributes.end(); ++it)
+				if (it->first == sKey)
+					return it->second;
+
+			return std::string();
+		}
+
+		void WriteNode::setAttribute(const std::string& sKey, const std::string& sValue)
+		{
+			m_pWriteDriver->writeAttribute(this, sKey, sValue);
+		}
+
+		std::string WriteNode::getValue()
+		{
+			return std::string();
+		}
+
+		void WriteNode::setValue(const std::string& sValue)
+		{
+			m_pWriteDriver->writeValue(this, sValue);
+		}
+
+		/* Written elements can not be looked up */
+		INode* WriteNode::getChild(const std::string& sKey, const std::string& sType /*="*"*/)
+		{
+			return NULL;
+		}
+
+		INode* WriteNode::addChild(const std::string& sKey)
+		{
+			return m_pWriteDriver->startElement(m_nDepth + 1, sKey);
+		}
+	}
+}
@@ -0,0 +1,1005 @@
+#include <windows.h>
+#include <psapi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+
+#include <xercesc/util/PlatformUtils.hpp>
+#include <xercesc/util/XMLUni.hpp>
+#include <xercesc/framework/MemoryManager.hpp>
+
+#include "Base/ArchiveUtil/GlobExport/ArchiveUtil.hpp"
+
+/**
+ * Benchmark of the archiving drivers.
+ * Saves and loads an array of rectangles (modeled on doku/XMLArchiveDemo/classes.h) with every driver
+ * and prints the timings and file sizes.
+ * Then measures single getInt/setInt calls on an existing key and counts the heap allocations per call, of which
+ * there must be none: the benchmark fails otherwise.
+ * Then deserializes the binary archive again with getArrayParallel() on all hardware threads.
+ * Then saves and loads as many doubles as a single packed array.
+ * Then writes and reads samples with declared fields, through the virtual interface and statically.
+ * Last, loads the binary archive again with the archive stats enabled and prints them.
+ *
+ * With --json, runs the suite instead: wide, deep, string-heavy and numeric-heavy object graphs at
+ * count / 100, count / 10 and count objects through every driver, written as JSON for tracking
+ * regressions between releases, see runSuite().
+ *
+ * Usage: ArchiveUtilBench [count] [--json <file>]
+ */
+
+using namespace Archiving;
+
+class BenchSize : public IArchivableObject
+{
+public:
+	float width;
+	float height;
+
+	BenchSize() : width(0), height(0) {}
+
+	void serialize(ISerializer *encoder)
+	{
+		encoder->setFloat(width, "width");
+		encoder->setFloat(height, "height");
+	}
+
+	void deserialize(IDeserializer *decoder)
+	{
+		width = decoder->getFloat("width", NULL);
+		height = decoder->getFloat("height", NULL);
+	}
+};
+
+class BenchPoint : public IArchivableObject
+{
+public:
+	float x;
+	float y;
+
+	BenchPoint() : x(0), y(0) {}
+
+	void serialize(ISerializer *encoder)
+	{
+		encoder->setFloat(x, "x");
+		encoder->setFloat(y, "y");
+	}
+
+	void deserialize(IDeserializer *decoder)
+	{
+		x = decoder->getFloat("x", NULL);
+		y = decoder->getFloat("y", NULL);
+	}
+};
+
+class BenchRect : public IArchivableObject
+{
+public:
+	BenchSize size;
+	BenchPoint origin;
+	std::string name;
+	int id;
+
+	BenchRect() : id(0) {}
+
+	void serialize(ISerializer *encoder)
+	{
+		encoder->setObject(&size, "size");
+		encoder->setObject(&origin, "origin");
+		encoder->setString(name, "name");
+		encoder->setInt(id, "id");
+	}
+
+	void deserialize(IDeserializer *decoder)
+	{
+		BenchSize *pSize = decoder->getObject<BenchSize>("size", NULL);
+		BenchPoint *pOrigin = decoder->getObject<BenchPoint>("origin", NULL);
+		if (pSize)
+			size = *pSize;
+		if (pOrigin)
+			origin = *pOrigin;
+		delete pSize;
+		delete pOrigin;
+		name = decoder->getString("name", NULL);
+		id = decoder->getInt("id", NULL);
+	}
+};
+
+/** Deep shape: chains of nodes, each nested in the one before. */
+class BenchNode : public IArchivableObject
+{
+public:
+	int depth;
+	double weight;
+	BenchNode *child;
+
+	BenchNode() : depth(0), weight(0), child(NULL) {}
+	~BenchNode() {delete child;}
+
+	void serialize(ISerializer *encoder)
+	{
+		encoder->setInt(depth, "depth");
+		encoder->setDouble(weight, "weight");
+		if (child)
+			encoder->setObject(child, "child");
+	}
+
+	void deserialize(IDeserializer *decoder)
+	{
+		depth = decoder->getInt("depth", NULL);
+		weight = decoder->getDouble("weight", NULL);
+		ArchivingResult nStatus = Undefined;
+		delete child;
+		child = decoder->getObject<BenchNode>("child", &nStatus);
+	}
+};
+
+/** String-heavy shape, with text that XML has to escape. */
+class BenchText : public IArchivableObject
+{
+public:
+	std::string title;
+	std::string author;
+	std::string body;
+	std::string tags;
+
+	void serialize(ISerializer *encoder)
+	{
+		encoder->setString(title, "title");
+		encoder->setString(author, "author");
+		encoder->setString(body, "body");
+		encoder->setString(tags, "tags");
+	}
+
+	void deserialize(IDeserializer *decoder)
+	{
+		title = decoder->getString("title", NULL);
+		author = decoder->getString("author", NULL);
+		body = decoder->getString("body", NULL);
+		tags = decoder->getString("tags", NULL);
+	}
+};
+
+/** Numeric-heavy shape. */
+class BenchSample : public IArchivableObject
+{
+public:
+	long time;
+	int channel;
+	bool valid;
+	double value[6];
+
+	BenchSample() : time(0), channel(0), valid(false) {memset(value, 0, sizeof(value));}
+
+	void serialize(ISerializer *encoder)
+	{
+		static const char *s_pKeys[6] = {"v0", "v1", "v2", "v3", "v4", "v5"};
+		encoder->setLong(time, "time");
+		encoder->setInt(channel, "channel");
+		encoder->setBool(valid, "valid");
+		for (int i = 0; i < 6; ++i)
+			encoder->setDouble(value[i], s_pKeys[i]);
+	}
+
+	void deserialize(IDeserializer *decoder)
+	{
+		static const char *s_pKeys[6] = {"v0", "v1", "v2", "v3", "v4", "v5"};
+		time = decoder->getLong("time", NULL);
+		channel = decoder->getInt("channel", NULL);
+		valid = decoder->getBool("valid", NULL);
+		for (int i = 0; i < 6; ++i)
+			value[i] = decoder->getDouble(s_pKeys[i], NULL);
+	}
+};
+
+/** The numeric shape with declared fields, see ArchivedFields. */
+class BenchFieldSample : public ArchivedFields<BenchFieldSample>
+{
+public:
+	long time;
+	int channel;
+	bool valid;
+	double v0, v1, v2, v3, v4, v5;
+
+	BenchFieldSample() : time(0), channel(0), valid(false), v0(0), v1(0), v2(0), v3(0), v4(0), v5(0) {}
+
+	ARCHIVE_FIELDS_BEGIN()
+		ARCHIVE_FIELD(time)
+		ARCHIVE_FIELD(channel)
+		ARCHIVE_FIELD(valid)
+		ARCHIVE_FIELD(v0)
+		ARCHIVE_FIELD(v1)
+		ARCHIVE_FIELD(v2)
+		ARCHIVE_FIELD(v3)
+		ARCHIVE_FIELD(v4)
+		ARCHIVE_FIELD(v5)
+	ARCHIVE_FIELDS_END()
+};
+
+class StopWatch
+{
+public:
+	StopWatch() {QueryPerformanceCounter(&m_liStart);}
+
+	double getMilliseconds()
+	{
+		LARGE_INTEGER liNow, liFrequency;
+		QueryPerformanceCounter(&liNow);
+		QueryPerformanceFrequency(&liFrequency);
+		return (double)(liNow.QuadPart - m_liStart.QuadPart) * 1000.0 / (double)liFrequency.QuadPart;
+	}
+
+protected:
+	LARGE_INTEGER m_liStart;
+};
+
+static volatile long g_lAllocations = 0;
+static bool g_bAllocationsCounted = false;
+
+#ifdef _DEBUG
+static int countAllocations(int nAllocType, void *pData, size_t nSize, int nBlockUse, long lRequest, const unsigned char *pFile, int nLine)
+{
+	if (nAllocType != _HOOK_FREE)
+		InterlockedIncrement(&g_lAllocations);
+	return TRUE;
+}
+
+static void installAllocationCounter()
+{
+	_CrtSetAllocHook(countAllocations);
+	g_bAllocationsCounted = true;
+}
+#else
+/**
+ * Release builds have no allocation hook. Instead the imports of the allocation functions of the C runtime are
+ * redirected in every module of the process: a replaced operator new of the executable would not see the archiving
+ * DLL, nor the C++ library whose std::string allocates for it. Calls within the C runtime itself are not redirected,
+ * so its operator new is not counted again by malloc.
+ */
+typedef void* (__cdecl *AllocateFunction)(size_t);
+static AllocateFunction s_pMalloc = NULL;
+static AllocateFunction s_pNew = NULL;
+static AllocateFunction s_pNewArray = NULL;
+static void* (__cdecl *s_pCalloc)(size_t, size_t) = NULL;
+static void* (__cdecl *s_pRealloc)(void*, size_t) = NULL;
+
+static void* __cdecl countMalloc(size_t nSize)                {InterlockedIncrement(&g_lAllocations); return s_pMalloc(nSize);}
+static void* __cdecl countNew(size_t nSize)                   {InterlockedIncrement(&g_lAllocations); return s_pNew(nSize);}
+static void* __cdecl countNewArray(size_t nSize)              {InterlockedIncrement(&g_lAllocations); return s_pNewArray(nSize);}
+static void* __cdecl countCalloc(size_t nCount, size_t nSize) {InterlockedIncrement(&g_lAllocations); return s_pCalloc(nCount, nSize);}
+static void* __cdecl countRealloc(void *pMemory, size_t nSize)
+{
+	if (nSize)
+		InterlockedIncrement(&g_lAllocations);
+	return s_pRealloc(pMemory, nSize);
+}
+
+/** An import that is redirected, by its decorated name. */
+struct CountedImport
+{
+	const char *pName;
+	void **ppOriginal;
+	void *pCounting;
+};
+
+/** Redirects the imports of hModule from the C runtime hCrt. @return The number redirected. */
+static int redirectImports(HMODULE hModule, HMODULE hCrt, const CountedImport *pImports, size_t nImports)
+{
+	BYTE *pBase = (BYTE *)hModule;
+	IMAGE_NT_HEADERS *pHeaders = (IMAGE_NT_HEADERS *)(pBase + ((IMAGE_DOS_HEADER *)pBase)->e_lfanew);
+	IMAGE_DATA_DIRECTORY& aDirectory = pHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+	if (!aDirectory.VirtualAddress)
+		return 0;
+
+	int nRedirected = 0;
+	for (IMAGE_IMPORT_DESCRIPTOR *pImport = (IMAGE_IMPORT_DESCRIPTOR *)(pBase + aDirectory.VirtualAddress); pImport->Name; ++pImport)
+	{
+		if (!pImport->OriginalFirstThunk || GetModuleHandleA((const char *)(pBase + pImport->Name)) != hCrt)
+			continue;
+
+		IMAGE_THUNK_DATA *pName = (IMAGE_THUNK_DATA *)(pBase + pImport->OriginalFirstThunk);
+		IMAGE_THUNK_DATA *pAddress = (IMAGE_THUNK_DATA *)(pBase + pImport->FirstThunk);
+		for (; pName->u1.AddressOfData; ++pName, ++pAddress)
+		{
+			if (IMAGE_SNAP_BY_ORDINAL(pName->u1.Ordinal))
+				continue;
+			const char *pFunction = (const char *)((IMAGE_IMPORT_BY_NAME *)(pBase + pName->u1.AddressOfData))->Name;
+			for (size_t i = 0; i < nImports; ++i)
+			{
+				if (strcmp(pFunction, pImports[i].pName) != 0)
+					continue;
+				if (!*pImports[i].ppOriginal)
+					*pImports[i].ppOriginal = (void *)pAddress->u1.Function;
+
+				DWORD dwProtect;
+				if (VirtualProtect(&pAddress->u1.Function, sizeof(pAddress->u1.Function), PAGE_READWRITE, &dwProtect))
+				{
+					pAddress->u1.Function = (ULONG_PTR)pImports[i].pCounting;
+					VirtualProtect(&pAddress->u1.Function, sizeof(pAddress->u1.Function), dwProtect, &dwProtect);
+					++nRedirected;
+				}
+			}
+		}
+	}
+	return nRedirected;
+}
+
+static void installAllocationCounter()
+{
+	static const CountedImport aImports[] =
+	{
+		{"malloc",  (void **)&s_pMalloc,  (void *)&countMalloc},
+		{"calloc",  (void **)&s_pCalloc,  (void *)&countCalloc},
+		{"realloc", (void **)&s_pRealloc, (void *)&countRealloc},
+#ifdef _WIN64
+		{"??2@YAPEAX_K@Z",  (void **)&s_pNew,      (void *)&countNew},
+		{"??_U@YAPEAX_K@Z", (void **)&s_pNewArray, (void *)&countNewArray},
+#else
+		{"??2@YAPAXI@Z",  (void **)&s_pNew,      (void *)&countNew},
+		{"??_U@YAPAXI@Z", (void **)&s_pNewArray, (void *)&countNewArray},
+#endif
+	};
+
+	// The C runtime the executable uses, which the DLLs of the same build share
+	HMODULE hCrt = NULL;
+	HMODULE ahModules[1024];
+	DWORD dwSize = 0;
+	if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)&malloc, &hCrt)
+		|| !EnumProcessModules(GetCurrentProcess(), ahModules, sizeof(ahModules), &dwSize))
+		return;
+
+	int nRedirected = 0;
+	for (DWORD i = 0; i < dwSize / sizeof(HMODULE) && i < sizeof(ahModules) / sizeof(HMODULE); ++i)
+		if (ahModules[i] != hCrt)
+			nRedirected += redirectImports(ahModules[i], hCrt, aImports, sizeof(aImports) / sizeof(aImports[0]));
+	g_bAllocationsCounted = nRedirected > 0;
+}
+#endif
+
+/**
+ * The memory manager of Xerces, installed before the drivers initialize it. The document heaps of the DOM and
+ * everything else Xerces allocates come from here, which the counting of the C runtime does not see.
+ * Takes the memory from the process heap, so nothing is counted twice.
+ */
+class CountingMemoryManager : public XERCES_CPP_NAMESPACE::MemoryManager
+{
+public:
+	CountingMemoryManager() : m_lAllocations(0) {;}
+
+	virtual void* allocate(size_t nSize)
+	{
+		InterlockedIncrement(&m_lAllocations);
+		void *pMemory = HeapAlloc(GetProcessHeap(), 0, nSize ? nSize : 1);
+		if (!pMemory)
+			throw std::bad_alloc();
+		return pMemory;
+	}
+
+	virtual void deallocate(void *pMemory)
+	{
+		if (pMemory)
+			HeapFree(GetProcessHeap(), 0, pMemory);
+	}
+
+	long getAllocations() {return InterlockedCompareExchange(&m_lAllocations, 0, 0);}
+
+protected:
+	volatile long m_lAllocations;
+};
+
+static CountingMemoryManager s_aXercesMemory;
+
+static long getAllocations()
+{
+	return InterlockedCompareExchange(&g_lAllocations, 0, 0) + s_aXercesMemory.getAllocations();
+}
+
+static long getFileSize(const std::string& sPath)
+{
+	FILE *pFile = fopen(sPath.c_str(), "rb");
+	if (!pFile)
+		return -1;
+	fseek(pFile, 0, SEEK_END);
+	long lSize = ftell(pFile);
+	fclose(pFile);
+	return lSize;
+}
+
+static std::string readFile(const std::string& sPath)
+{
+	std::string sData;
+	FILE *pFile = fopen(sPath.c_str(), "rb");
+	if (!pFile)
+		return sData;
+	char aBuffer[65536];
+	size_t nRead;
+	while ((nRead = fread(aBuffer, 1, sizeof(aBuffer), pFile)) > 0)
+		sData.append(aBuffer, nRead);
+	fclose(pFile);
+	return sData;
+}
+
+/** The working set of the process and its peak so far, in bytes. */
+static void getMemory(size_t& nWorkingSet, size_t& nPeakWorkingSet)
+{
+	PROCESS_MEMORY_COUNTERS aCounters;
+	memset(&aCounters, 0, sizeof(aCounters));
+	GetProcessMemoryInfo(GetCurrentProcess(), &aCounters, sizeof(aCounters));
+	nWorkingSet = aCounters.WorkingSetSize;
+	nPeakWorkingSet = aCounters.PeakWorkingSetSize;
+}
+
+template <class T_SaveArchive, class T_LoadArchive> void runBenchmark(const char *pName, const std::string& sPath, std::list<IArchivableObject*>& lsRects)
+{
+	double dSerialize, dSave, dLoad, dDeserialize;
+	size_t nLoaded = 0;
+
+	{
+		T_SaveArchive archive;
+
+		StopWatch aSerialize;
+		archive.setArray(lsRects, "rects");
+		dSerialize = aSerialize.getMilliseconds();
+
+		StopWatch aSave;
+		archive.save(sPath);
+		dSave = aSave.getMilliseconds();
+	}
+
+	{
+		T_LoadArchive archive;
+
+		StopWatch aLoad;
+		archive.loadFromFile(sPath);
+		dLoad = aLoad.getMilliseconds();
+
+		StopWatch aDeserialize;
+		ArchivingResult nStatus = Undefined;
+		std::list<BenchRect*> *pRects = archive.template getArray<BenchRect>("rects", &nStatus);
+		dDeserialize = aDeserialize.getMilliseconds();
+
+		if (pRects)
+		{
+			nLoaded = pRects->size();
+			for (std::list<BenchRect*>::iterator it = pRects->begin(); it != pRects->end(); ++it)
+				delete *it;
+			delete pRects;
+		}
+	}
+
+	printf("%-8s %10.1f %10.1f %10.1f %12.1f %12ld %8lu\n", pName, dSerialize, dSave, dLoad, dDeserialize, getFileSize(sPath), (unsigned long)nLoaded);
+}
+
+/** Same as runBenchmark(), with setArrayParallel() and getArrayParallel(). */
+template <class T_SaveArchive, class T_LoadArchive> void runParallelBenchmark(const char *pName, const std::string& sPath, std::list<IArchivableObject*>& lsRects, ArchiveExecutor& aExecutor)
+{
+	double dSerialize, dSave, dLoad, dDeserialize;
+	size_t nLoaded = 0;
+
+	{
+		T_SaveArchive archive;
+
+		StopWatch aSerialize;
+		archive.setArrayParallel(lsRects, "rects", aExecutor);
+		dSerialize = aSerialize.getMilliseconds();
+
+		StopWatch aSave;
+		archive.save(sPath);
+		dSave = aSave.getMilliseconds();
+	}
+
+	{
+		T_LoadArchive archive;
+
+		StopWatch aLoad;
+		archive.loadFromFile(sPath);
+		dLoad = aLoad.getMilliseconds();
+
+		StopWatch aDeserialize;
+		ArchivingResult nStatus = Undefined;
+		std::list<BenchRect*> *pRects = archive.template getArrayParallel<BenchRect>("rects", &nStatus, aExecutor);
+		dDeserialize = aDeserialize.getMilliseconds();
+
+		if (pRects)
+		{
+			nLoaded = pRects->size();
+			for (std::list<BenchRect*>::iterator it = pRects->begin(); it != pRects->end(); ++it)
+				delete *it;
+			delete pRects;
+		}
+	}
+
+	printf("%-8s %10.1f %10.1f %10.1f %12.1f %12ld %8lu\n", pName, dSerialize, dSave, dLoad, dDeserialize, getFileSize(sPath), (unsigned long)nLoaded);
+}
+
+/**
+ * Sets and gets the same int repeatedly, the steady state of reading or updating a loaded archive.
+ * Prints nanoseconds and heap allocations per call.
+ * @return False if a call allocated.
+ */
+template <class T_Archive> bool runAccessBenchmark(const char *pName, unsigned long ulCount)
+{
+	T_Archive archive;
+	const std::string sKey("value");
+	// The widest value first, all later ones fit into the text it leaves
+	archive.setInt((int)ulCount, sKey);
+
+	long lAllocations = getAllocations();
+	StopWatch aSet;
+	for (unsigned long i = 0; i < ulCount; ++i)
+		archive.setInt((int)i, sKey);
+	double dSet = aSet.getMilliseconds();
+	double dSetAllocations = (double)(getAllocations() - lAllocations) / ulCount;
+
+	long lSum = 0;
+	lAllocations = getAllocations();
+	StopWatch aGet;
+	for (unsigned long i = 0; i < ulCount; ++i)
+		lSum += archive.getInt(sKey, NULL);
+	double dGet = aGet.getMilliseconds();
+	double dGetAllocations = (double)(getAllocations() - lAllocations) / ulCount;
+
+	printf("%-8s %10.1f %10.2f %10.1f %10.2f %8ld\n", pName, dSet * 1e6 / ulCount, dSetAllocations, dGet * 1e6 / ulCount, dGetAllocations, lSum % 10);
+	return dSetAllocations == 0 && dGetAllocations == 0;
+}
+
+/**
+ * Writes and reads ulCount samples with declared fields by setObject() and getObject(), which call serialize()
+ * and deserialize() through the virtual interface, and by setFields() and getFields(), which do not.
+ * Prints nanoseconds per object.
+ */
+template <class T_SaveArchive, class T_LoadArchive> void runFieldsBenchmark(const char *pName, unsigned long ulCount)
+{
+	std::vector<std::string> lsKeys;
+	std::vector<BenchFieldSample> lsSamples(ulCount);
+	char aKey[32];
+	for (unsigned long i = 0; i < ulCount; ++i)
+	{
+		sprintf(aKey, "item%lu", i);
+		lsKeys.push_back(aKey);
+		lsSamples[i].time = (long)i;
+		lsSamples[i].v0 = i * 0.5;
+	}
+
+	T_SaveArchive aVirtual;
+	StopWatch aSetObject;
+	for (unsigned long i = 0; i < ulCount; ++i)
+		aVirtual.setObject(&lsSamples[i], lsKeys[i]);
+	double dSetObject = aSetObject.getMilliseconds();
+
+	T_SaveArchive aStatic;
+	StopWatch aSetFields;
+	for (unsigned long i = 0; i < ulCount; ++i)
+		aStatic.setFields(lsSamples[i], lsKeys[i]);
+	double dSetFields = aSetFields.getMilliseconds();
+
+	T_LoadArchive aLoad;
+	aLoad.loadFromString(aStatic.getArchiveString());
+	long lSum = 0;
+	StopWatch aGetObject;
+	for (unsigned long i = 0; i < ulCount; ++i)
+	{
+		BenchFieldSample *pSample = aLoad.template getObject<BenchFieldSample>(lsKeys[i], NULL);
+		lSum += pSample ? pSample->time : 0;
+		delete pSample;
+	}
+	double dGetObject = aGetObject.getMilliseconds();
+
+	StopWatch aGetFields;
+	for (unsigned long i = 0; i < ulCount; ++i)
+	{
+		BenchFieldSample *pSample = aLoad.template getFields<BenchFieldSample>(lsKeys[i], NULL);
+		lSum -= pSample ? pSample->time : 0;
+		delete pSample;
+	}
+	double dGetFields = aGetFields.getMilliseconds();
+
+	printf("%-8s %10.1f %10.1f %10.1f %10.1f %8ld\n", pName, dSetObject * 1e6 / ulCount, dSetFields * 1e6 / ulCount,
+		dGetObject * 1e6 / ulCount, dGetFields * 1e6 / ulCount, lSum);
+}
+
+/** Saves and loads the doubles as a packed array, see ISerializer::setDoubleArray(). */
+template <class T_SaveArchive, class T_LoadArchive> void runPackedBenchmark(const char *pName, const std::string& sPath, const std::vector<double>& lsDoubles)
+{
+	double dSerialize, dSave, dLoad, dDeserialize;
+	std::vector<double> lsLoaded;
+
+	{
+		T_SaveArchive archive;
+
+		StopWatch aSerialize;
+		archive.setDoubleArray(lsDoubles, "doubles");
+		dSerialize = aSerialize.getMilliseconds();
+
+		StopWatch aSave;
+		archive.save(sPath);
+		dSave = aSave.getMilliseconds();
+	}
+
+	{
+		T_LoadArchive archive;
+
+		StopWatch aLoad;
+		archive.loadFromFile(sPath);
+		dLoad = aLoad.getMilliseconds();
+
+		StopWatch aDeserialize;
+		archive.getDoubleArray("doubles", lsLoaded, NULL);
+		dDeserialize = aDeserialize.getMilliseconds();
+	}
+
+	printf("%-8s %10.1f %10.1f %10.1f %12.1f %12ld %8lu\n", pName, dSerialize, dSave, dLoad, dDeserialize, getFileSize(sPath), (unsigned long)lsLoaded.size());
+}
+
+/** Loads the archive of runBenchmark(), changes ulChanged rects and saves them with saveChanges(), then with save(). */
+static void runIncrementalBenchmark(const char *pName, const std::string& sPath, unsigned long ulChanged)
+{
+	double dChanges, dSave;
+	long lBefore, lAfter;
+
+	BinaryArchive archive;
+	archive.trackObjects();
+	archive.loadFromFile(sPath);
+	std::list<BenchRect*> *pRects = archive.getArray<BenchRect>("rects", NULL);
+	if (!pRects)
+		return;
+
+	unsigned long ulStep = (unsigned long)pRects->size() / ulChanged + 1;
+	unsigned long i = 0;
+	for (std::list<BenchRect*>::iterator it = pRects->begin(); it != pRects->end(); ++it, ++i)
+	{
+		if (i % ulStep)
+			continue;
+		(*it)->origin.x += 1.0f;
+		(*it)->name = "changed";
+		archive.markDirty(*it);
+	}
+
+	lBefore = getFileSize(sPath);
+	StopWatch aChanges;
+	archive.saveChanges(sPath);
+	dChanges = aChanges.getMilliseconds();
+	lAfter = getFileSize(sPath);
+
+	StopWatch aSave;
+	archive.save(sPath);
+	dSave = aSave.getMilliseconds();
+
+	printf("%-8s %8lu %12.2f %10.1f %12ld\n", pName, ulChanged, dChanges, dSave, lAfter - lBefore);
+
+	for (std::list<BenchRect*>::iterator it = pRects->begin(); it != pRects->end(); ++it)
+		delete *it;
+	delete pRects;
+}
+
+/** The object graphs of the suite, each of ulCount objects in all. */
+static void createWide(std::list<IArchivableObject*>& lsItems, unsigned long ulCount)
+{
+	// A rect is three objects
+	for (unsigned long i = 0; i < ulCount / 3; ++i)
+	{
+		BenchRect *pRect = new BenchRect();
+		pRect->origin.x = (float)i;
+		pRect->size.width = (float)i * 2.0f;
+		pRect->name = "rect";
+		pRect->id = (int)i;
+		lsItems.push_back(pRect);
+	}
+}
+
+static void createDeep(std::list<IArchivableObject*>& lsItems, unsigned long ulCount)
+{
+	const int nDepth = 32;
+	for (unsigned long i = 0; i < ulCount / nDepth; ++i)
+	{
+		BenchNode *pRoot = new BenchNode();
+		BenchNode *pNode = pRoot;
+		for (int nLevel = 1; nLevel < nDepth; ++nLevel)
+		{
+			pNode->child = new BenchNode();
+			pNode = pNode->child;
+			pNode->depth = nLevel;
+			pNode->weight = (double)i / nLevel;
+		}
+		lsItems.push_back(pRoot);
+	}
+}
+
+static void createStrings(std::list<IArchivableObject*>& lsItems, unsigned long ulCount)
+{
+	char aNumber[32];
+	for (unsigned long i = 0; i < ulCount; ++i)
+	{
+		sprintf(aNumber, "%lu", i);
+		BenchText *pText = new BenchText();
+		pText->title = std::string("Title <") + aNumber + ">";
+		pText->author = "A. N. Author & Co.";
+		pText->body = std::string(200, 'x') + " \"quoted\" " + aNumber;
+		pText->tags = "alpha;beta;gamma;delta";
+		lsItems.push_back(pText);
+	}
+}
+
+static void createNumbers(std::list<IArchivableObject*>& lsItems, unsigned long ulCount)
+{
+	for (unsigned long i = 0; i < ulCount; ++i)
+	{
+		BenchSample *pSample = new BenchSample();
+		pSample->time = (long)i * 1000;
+		pSample->channel = (int)(i % 16);
+		pSample->valid = (i % 7) != 0;
+		for (int j = 0; j < 6; ++j)
+			pSample->value[j] = (double)i * 0.1 + 1.0 / (j + 1);
+		lsItems.push_back(pSample);
+	}
+}
+
+/** Writes the results of the suite as a JSON array of flat records. */
+class JsonReport
+{
+public:
+	JsonReport(FILE *pFile) : m_pFile(pFile), m_bFirst(true)
+	{
+		fprintf(m_pFile, "{\n\"benchmark\": \"ArchiveUtilBench\",\n\"allocations_counted\": %s,\n\"results\": [", allocationsCounted() ? "true" : "false");
+	}
+
+	~JsonReport()
+	{
+		fprintf(m_pFile, "\n]\n}\n");
+	}
+
+	void beginRecord(const char *pShape, const char *pDriver, unsigned long ulObjects)
+	{
+		fprintf(m_pFile, "%s\n{\"shape\": \"%s\", \"driver\": \"%s\", \"objects\": %lu", m_bFirst ? "" : ",", pShape, pDriver, ulObjects);
+		m_bFirst = false;
+	}
+
+	void add(const char *pName, double dValue) {fprintf(m_pFile, ", \"%s\": %.3f", pName, dValue);}
+	void add(const char *pName, unsigned long long ullValue) {fprintf(m_pFile, ", \"%s\": %llu", pName, ullValue);}
+	void endRecord() {fprintf(m_pFile, "}");}
+
+	/** Only the allocations of Xerces are counted if the counter could not be installed. */
+	static bool allocationsCounted() {return g_bAllocationsCounted;}
+
+protected:
+	FILE *m_pFile;
+	bool m_bFirst;
+};
+
+static double perSecond(double dAmount, double dMilliseconds)
+{
+	return dMilliseconds > 0 ? dAmount * 1000.0 / dMilliseconds : 0;
+}
+
+/**
+ * One record of the suite: serializes and saves the items, then loads the file with loadFromFile()
+ * and its contents with loadFromString(), and deserializes them.
+ * The working set is taken before loading and with the loaded archive and objects alive; the peak is
+ * that of the process so far, so the suite runs the scales from small to large.
+ */
+template <class T_Item, class T_SaveArchive, class T_LoadArchive>
+void runSuiteRecord(JsonReport& aReport, const char *pShape, const char *pDriver, const std::string& sPath, std::list<IArchivableObject*>& lsItems, unsigned long ulObjects)
+{
+	double dSerialize, dSave, dLoadFile, dLoadString, dDeserialize;
+	long lSaveAllocations, lLoadAllocations;
+	size_t nLoaded = 0, nWorkingSet, nLoadedWorkingSet, nPeakWorkingSet;
+
+	{
+		long lAllocations = getAllocations();
+		T_SaveArchive archive;
+
+		StopWatch aSerialize;
+		archive.setArray(lsItems, "items");
+		dSerialize = aSerialize.getMilliseconds();
+
+		StopWatch aSave;
+		archive.save(sPath);
+		dSave = aSave.getMilliseconds();
+		lSaveAllocations = getAllocations() - lAllocations;
+	}
+
+	std::string sData = readFile(sPath);
+	{
+		T_LoadArchive archive;
+
+		StopWatch aLoad;
+		archive.loadFromString(sData);
+		dLoadString = aLoad.getMilliseconds();
+	}
+
+	getMemory(nWorkingSet, nPeakWorkingSet);
+	{
+		long lAllocations = getAllocations();
+		T_LoadArchive archive;
+
+		StopWatch aLoad;
+		archive.loadFromFile(sPath);
+		dLoadFile = aLoad.getMilliseconds();
+
+		StopWatch aDeserialize;
+		ArchivingResult nStatus = Undefined;
+		std::list<T_Item*> *pItems = archive.template getArray<T_Item>("items", &nStatus);
+		dDeserialize = aDeserialize.getMilliseconds();
+		lLoadAllocations = getAllocations() - lAllocations;
+		getMemory(nLoadedWorkingSet, nPeakWorkingSet);
+
+		if (pItems)
+		{
+			nLoaded = pItems->size();
+			for (typename std::list<T_Item*>::iterator it = pItems->begin(); it != pItems->end(); ++it)
+				delete *it;
+			delete pItems;
+		}
+	}
+
+	double dMegabytes = (double)sData.size() / (1024.0 * 1024.0);
+	aReport.beginRecord(pShape, pDriver, ulObjects);
+	aReport.add("items", (unsigned long long)nLoaded);
+	aReport.add("size_bytes", (unsigned long long)sData.size());
+	aReport.add("serialize_ms", dSerialize);
+	aReport.add("save_ms", dSave);
+	aReport.add("load_file_ms", dLoadFile);
+	aReport.add("load_string_ms", dLoadString);
+	aReport.add("deserialize_ms", dDeserialize);
+	aReport.add("serialize_objects_per_s", perSecond(ulObjects, dSerialize));
+	aReport.add("save_mb_per_s", perSecond(dMegabytes, dSave));
+	aReport.add("load_file_mb_per_s", perSecond(dMegabytes, dLoadFile));
+	aReport.add("load_string_mb_per_s", perSecond(dMegabytes, dLoadString));
+	aReport.add("deserialize_objects_per_s", perSecond(ulObjects, dDeserialize));
+	aReport.add("save_allocs_per_object", (double)lSaveAllocations / ulObjects);
+	aReport.add("load_allocs_per_object", (double)lLoadAllocations / ulObjects);
+	aReport.add("loaded_working_set_bytes", (unsigned long long)(nLoadedWorkingSet > nWorkingSet ? nLoadedWorkingSet - nWorkingSet : 0));
+	aReport.add("peak_working_set_bytes", (unsigned long long)nPeakWorkingSet);
+	aReport.endRecord();
+}
+
+/** All drivers on one shape and scale. */
+template <class T_Item> void runSuiteShape(JsonReport& aReport, const char *pShape, void (*pCreate)(std::list<IArchivableObject*>&, unsigned long), unsigned long ulObjects)
+{
+	std::list<IArchivableObject*> lsItems;
+	pCreate(lsItems, ulObjects);
+
+	runSuiteRecord<T_Item, XMLArchive, XMLArchive>(aReport, pShape, "xerces", "suite.xml", lsItems, ulObjects);
+	runSuiteRecord<T_Item, StreamingXMLWriter, StreamingXMLArchive>(aReport, pShape, "stream", "suite_stream.xml", lsItems, ulObjects);
+	runSuiteRecord<T_Item, BinaryArchive, BinaryArchive>(aReport, pShape, "binary", "suite.kvab", lsItems, ulObjects);
+	runSuiteRecord<T_Item, BinaryArchive, MappedBinaryArchive>(aReport, pShape, "mapped", "suite.kvab", lsItems, ulObjects);
+	runSuiteRecord<T_Item, CompressedXMLArchive, CompressedXMLArchive>(aReport, pShape, "xerces_z", "suite_z.xml", lsItems, ulObjects);
+	runSuiteRecord<T_Item, CompressedBinaryArchive, CompressedBinaryArchive>(aReport, pShape, "binary_z", "suite_z.kvab", lsItems, ulObjects);
+
+	for (std::list<IArchivableObject*>::iterator it = lsItems.begin(); it != lsItems.end(); ++it)
+		delete *it;
+}
+
+static int runSuite(unsigned long ulCount, const char *pPath)
+{
+	FILE *pFile = fopen(pPath, "w");
+	if (!pFile)
+	{
+		fprintf(stderr, "cannot write %s\n", pPath);
+		return 1;
+	}
+
+	{
+		JsonReport aReport(pFile);
+		unsigned long lsScales[3] = {ulCount / 100, ulCount / 10, ulCount};
+		for (int i = 0; i < 3; ++i)
+		{
+			if (lsScales[i] < 100)
+				continue;
+			runSuiteShape<BenchRect>(aReport, "wide", createWide, lsScales[i]);
+			runSuiteShape<BenchNode>(aReport, "deep", createDeep, lsScales[i]);
+			runSuiteShape<BenchText>(aReport, "strings", createStrings, lsScales[i]);
+			runSuiteShape<BenchSample>(aReport, "numbers", createNumbers, lsScales[i]);
+		}
+	}
+
+	fclose(pFile);
+	return 0;
+}
+
+int main(int argc, char **args)
+{
+	unsigned long ulCount = argc > 1 ? strtoul(args[1], NULL, 10) : 10000;
+
+	installAllocationCounter();
+	// Before the drivers, the first initialization decides the memory manager
+	XERCES_CPP_NAMESPACE::XMLPlatformUtils::Initialize(XERCES_CPP_NAMESPACE::XMLUni::fgXercescDefaultLocale, 0, 0, &s_aXercesMemory);
+	if (argc > 3 && !strcmp(args[2], "--json"))
+	{
+		int nResult = runSuite(ulCount, args[3]);
+		XERCES_CPP_NAMESPACE::XMLPlatformUtils::Terminate();
+		return nResult;
+	}
+
+	std::list<IArchivableObject*> lsRects;
+	for (unsigned long i = 0; i < ulCount; ++i)
+	{
+		BenchRect *pRect = new BenchRect();
+		pRect->origin.x = (float)i;
+		pRect->origin.y = (float)i * 0.5f;
+		pRect->size.width = (float)i * 2.0f;
+		pRect->size.height = (float)i * 3.0f;
+		pRect->name = "rect";
+		pRect->id = (int)i;
+		lsRects.push_back(pRect);
+	}
+
+	printf("%lu rects, times in ms, size in bytes\n", ulCount);
+	printf("%-8s %10s %10s %10s %12s %12s %8s\n", "driver", "serialize", "save", "load", "deserialize", "size", "items");
+
+	runBenchmark<XMLArchive, XMLArchive>("xerces", "bench.xml", lsRects);
+	runBenchmark<StreamingXMLWriter, StreamingXMLArchive>("stream", "bench_stream.xml", lsRects);
+	runBenchmark<BinaryArchive, BinaryArchive>("binary", "bench.kvab", lsRects);
+	runBenchmark<BinaryArchive, MappedBinaryArchive>("mapped", "bench.kvab", lsRects);
+	runBenchmark<CompressedXMLArchive, CompressedXMLArchive>("xerces_z", "bench_z.xml", lsRects);
+	runBenchmark<CompressedBinaryArchive, CompressedBinaryArchive>("binary_z", "bench_z.kvab", lsRects);
+
+	ArchiveExecutor aExecutor;
+	CompressionCodec::setExecutor(&aExecutor);
+	runBenchmark<CompressedBinaryArchive, CompressedBinaryArchive>("binary_zp", "bench_z.kvab", lsRects);
+	CompressionCodec::setExecutor(NULL);
+
+	printf("\nparallel on %u threads\n", aExecutor.getSliceCount());
+	runParallelBenchmark<StreamingXMLWriter, StreamingXMLArchive>("stream", "bench_stream.xml", lsRects, aExecutor);
+	runParallelBenchmark<BinaryArchive, BinaryArchive>("binary", "bench.kvab", lsRects, aExecutor);
+
+	printf("\n%lu calls, times in ns per call, allocations per call\n", ulCount);
+	printf("%-8s %10s %10s %10s %10s %8s\n", "driver", "setInt", "allocs", "getInt", "allocs", "check");
+
+	bool bNoAllocations = runAccessBenchmark<XMLArchive>("xerces", ulCount);
+	bNoAllocations = runAccessBenchmark<BinaryArchive>("binary", ulCount) && bNoAllocations;
+	if (!bNoAllocations)
+		printf("FAILED: getInt or setInt on an existing key allocated\n");
+
+	std::vector<double> lsDoubles;
+	for (unsigned long i = 0; i < ulCount; ++i)
+		lsDoubles.push_back((double)i * 0.25 + 1.0 / (i + 1));
+
+	printf("\n%lu doubles as packed array, times in ms, size in bytes\n", ulCount);
+	printf("%-8s %10s %10s %10s %12s %12s %8s\n", "driver", "serialize", "save", "load", "deserialize", "size", "items");
+
+	runPackedBenchmark<XMLArchive, XMLArchive>("xerces", "bench_packed.xml", lsDoubles);
+	runPackedBenchmark<StreamingXMLWriter, StreamingXMLArchive>("stream", "bench_packed_stream.xml", lsDoubles);
+	runPackedBenchmark<BinaryArchive, BinaryArchive>("binary", "bench_packed.kvab", lsDoubles);
+	runPackedBenchmark<BinaryArchive, MappedBinaryArchive>("mapped", "bench_packed.kvab", lsDoubles);
+
+	printf("\n%lu samples with declared fields, times in ns per object\n", ulCount);
+	printf("%-8s %10s %10s %10s %10s %8s\n", "driver", "setObject", "setFields", "getObject", "getFields", "check");
+
+	runFieldsBenchmark<XMLArchive, XMLArchive>("xerces", ulCount);
+	runFieldsBenchmark<BinaryArchive, BinaryArchive>("binary", ulCount);
+	runFieldsBenchmark<BinaryArchive, MappedBinaryArchive>("mapped", ulCount);
+
+	printf("\nchanged rects saved incrementally, times in ms, size in bytes\n");
+	printf("%-8s %8s %12s %10s %12s\n", "driver", "changed", "saveChanges", "save", "appended");
+
+	runIncrementalBenchmark("binary", "bench.kvab", 1);
+	runIncrementalBenchmark("binary", "bench.kvab", 100);
+
+	{
+		BinaryArchive archive;
+		archive.enableStats();
+		archive.loadFromFile("bench.kvab");
+		std::list<BenchRect*> *pRects = archive.getArray<BenchRect>("rects", NULL);
+		if (pRects)
+		{
+			for (std::list<BenchRect*>::iterator it = pRects->begin(); it != pRects->end(); ++it)
+				delete *it;
+			delete pRects;
+		}
+		printf("\narchive stats of loading the binary archive\n%s", archive.getStats()->getReport().c_str());
+	}
+
+	for (std::list<IArchivableObject*>::iterator it = lsRects.begin(); it != lsRects.end(); ++it)
+		delete *it;
+
+	printf("\ninstances, bytes in sizeof of the counted class\n%s", InstanceMetrics::getReport().c_str());
+
+	XERCES_CPP_NAMESPACE::XMLPlatformUtils::Terminate();
+	return bNoAllocations ? 0 : 1;
+}
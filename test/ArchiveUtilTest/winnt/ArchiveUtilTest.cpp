@@ -1,14 +1,157 @@
 using namespace NUnit::Framework;
 
 #include <stdio.h>
+#include <float.h>
+#include <locale.h>
 #include <string>
 #include "Base/ArchiveUtil/GlobExport/ArchiveUtil.hpp"
 #include "Base/ArchiveUtil/GlobExport/IDeserializer.hpp"
+#include "Base/ArchiveUtil/include/BinaryFormat.h"
 #include "tests/TestUtil/GlobExport/TestBase.hpp"
 
 
 #define XML_TEST_HEADER "<?xml version=\"1.0\" encoding=\"UTF-16\" standalone=\"no\" ?>"
 
+class TestItem : public Archiving::IArchivableObject
+{
+public:
+	int id;
+	std::string name;
+
+	TestItem() : id(0) {}
+
+	void serialize(Archiving::ISerializer *encoder)
+	{
+		encoder->setInt(id, "id");
+		encoder->setString(name, "name");
+	}
+
+	void deserialize(Archiving::IDeserializer *decoder)
+	{
+		id = decoder->getInt("id", NULL);
+		name = decoder->getString("name", NULL);
+	}
+};
+
+class TestPair : public Archiving::IArchivableObject
+{
+public:
+	TestItem *first;
+	TestItem *second;
+	TestPair *next;
+
+	TestPair() : first(NULL), second(NULL), next(NULL) {}
+
+	void serialize(Archiving::ISerializer *encoder)
+	{
+		encoder->setObject(first, "first");
+		encoder->setObject(second, "second");
+		if (next)
+			encoder->setObject(next, "next");
+	}
+
+	void deserialize(Archiving::IDeserializer *decoder)
+	{
+		first = decoder->getObject<TestItem>("first", NULL);
+		second = decoder->getObject<TestItem>("second", NULL);
+		next = decoder->getObject<TestPair>("next", NULL);
+	}
+};
+
+class TestFieldItem : public Archiving::ArchivedFields<TestFieldItem>
+{
+public:
+	int id;
+	std::string name;
+	std::vector<double> values;
+	TestItem *item;
+
+	TestFieldItem() : id(0), item(NULL) {}
+
+	ARCHIVE_FIELDS_BEGIN()
+		ARCHIVE_FIELD(id)
+		ARCHIVE_FIELD(name)
+		ARCHIVE_FIELD(values)
+		ARCHIVE_FIELD(item)
+	ARCHIVE_FIELDS_END()
+};
+
+/** A subclass of TestItem that is read back as itself from arrays of TestItem. */
+class TestLabeledItem : public TestItem
+{
+public:
+	std::string label;
+
+	void serialize(Archiving::ISerializer *encoder)
+	{
+		TestItem::serialize(encoder);
+		encoder->setString(label, "label");
+	}
+
+	void deserialize(Archiving::IDeserializer *decoder)
+	{
+		TestItem::deserialize(decoder);
+		label = decoder->getString("label", NULL);
+	}
+};
+
+ARCHIVE_REGISTER_CLASS(TestLabeledItem)
+
+/** Counted by its own class, besides IArchivableObject. */
+class TestCountedItem : public TestItem, public IInstanceCounter<TestCountedItem>
+{
+};
+
+/** Reads and writes its items in parallel on the executor its array is read on as well. */
+class TestGroup : public Archiving::IArchivableObject
+{
+public:
+	static Archiving::ArchiveExecutor *s_pExecutor;
+	std::list<TestItem*> items;
+
+	~TestGroup()
+	{
+		for (std::list<TestItem*>::iterator it = items.begin(); it != items.end(); ++it)
+			delete *it;
+	}
+
+	void serialize(Archiving::ISerializer *encoder)
+	{
+		std::list<Archiving::IArchivableObject*> lsItems(items.begin(), items.end());
+		encoder->setArrayParallel(lsItems, "items", *s_pExecutor);
+	}
+
+	void deserialize(Archiving::IDeserializer *decoder)
+	{
+		std::list<TestItem*> *pItems = decoder->getArrayParallel<TestItem>("items", NULL, *s_pExecutor);
+		if (pItems)
+			items.swap(*pItems);
+		delete pItems;
+	}
+};
+
+Archiving::ArchiveExecutor *TestGroup::s_pExecutor = NULL;
+
+/** Not covered by the DriverTraits of Binary::Driver, archives of it call the nodes virtually. */
+class TestBinaryDriver : public Archiving::Binary::Driver
+{
+};
+
+/** Decodes sData as one varint of the binary format, false if it is rejected or followed by more bytes. */
+static bool ReadVarInt(const std::string& sData, unsigned long& ulValue)
+{
+	Archiving::Binary::Format::Reader aReader(sData.data(), sData.data() + sData.size());
+	try
+	{
+		ulValue = aReader.getVarInt();
+		return aReader.getPos() == aReader.getEnd();
+	}
+	catch (Archiving::Binary::Format::Error&)
+	{
+		return false;
+	}
+}
+
 [TestFixture]
 ref class ArchiveUtilTest : public Tests::TestBase
 {
@@ -45,4 +188,1019 @@ public:
 		*/
 	}
 
+	[Test]
+	void Test_BinaryRoundTrip()
+	{
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setInt(12, "test");
+		pArchive1->setString("value", "text");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		Assert::IsTrue(pArchive2->getInt("test") == 12, "Archive2 getInt");
+		Assert::IsTrue(pArchive2->getString("text") == "value", "Archive2 getString");
+
+		delete pArchive2;
+	}
+
+	[Test]
+	void Test_BinaryVarInt()
+	{
+		unsigned long aValues[] = {0, 127, 128, 0xffffffffUL, (unsigned long)-1};
+		for (int i = 0; i < 5; ++i)
+		{
+			std::string sData;
+			Archiving::Binary::Format::Writer aWriter(sData);
+			aWriter.putVarInt(aValues[i]);
+			unsigned long ulValue = 0;
+			Assert::IsTrue(ReadVarInt(sData, ulValue) && ulValue == aValues[i], "Varint round trip");
+		}
+
+		// Trailing zero groups and bits beyond an unsigned long are rejected
+		unsigned long ulValue;
+		Assert::IsTrue(!ReadVarInt(std::string("\x80\x00", 2), ulValue), "Varint over-long");
+		std::string sTooLong((sizeof(unsigned long) * 8 + 6) / 7, (char)0xff);
+		Assert::IsTrue(!ReadVarInt(sTooLong + (char)0x01, ulValue), "Varint too many bytes");
+		sTooLong.resize(sTooLong.size() - 1);
+		Assert::IsTrue(!ReadVarInt(sTooLong + (char)0x7f, ulValue), "Varint out of range");
+	}
+
+	[Test]
+	void Test_MappedBinaryReadOnly()
+	{
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setInt(12, "test");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		Archiving::MappedBinaryArchive *pArchive2 = new Archiving::MappedBinaryArchive();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		Assert::IsTrue(pArchive2->getInt("test") == 12, "Archive2 getInt");
+
+		Archiving::ArchivingResult nStatus;
+		pArchive2->getInt("missing", &nStatus);
+		Assert::IsTrue(nStatus == Archiving::NotFound, "Archive2 missing key");
+
+		delete pArchive2;
+	}
+
+	[Test]
+	void Test_StreamingXMLOutOfOrder()
+	{
+		Archiving::StreamingXMLArchive *pArchive1 = new Archiving::StreamingXMLArchive();
+		Assert::IsTrue(pArchive1->loadFromString(XML_TEST_HEADER "<archive><first type=\"int\">1</first><second type=\"string\">two</second><third type=\"int\">3</third></archive>"), "Archive1 loadFromString");
+
+		Assert::IsTrue(pArchive1->getInt("third") == 3, "Archive1 getInt third");
+		Assert::IsTrue(pArchive1->getInt("first") == 1, "Archive1 getInt first (buffered)");
+		Assert::IsTrue(pArchive1->getString("second") == "two", "Archive1 getString second (buffered)");
+
+		Archiving::ArchivingResult nStatus;
+		pArchive1->getInt("missing", &nStatus);
+		Assert::IsTrue(nStatus == Archiving::NotFound, "Archive1 missing key");
+
+		delete pArchive1;
+	}
+
+	[Test]
+	void Test_StreamingXMLWriter()
+	{
+		Archiving::StreamingXMLWriter *pArchive1 = new Archiving::StreamingXMLWriter();
+		pArchive1->setInt(12, "test");
+		pArchive1->setString("<a & b>", "text");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		Archiving::XMLArchive *pArchive2 = new Archiving::XMLArchive();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		Assert::IsTrue(pArchive2->getInt("test") == 12, "Archive2 getInt");
+		Assert::IsTrue(pArchive2->getString("text") == "<a & b>", "Archive2 getString");
+
+		// Loading does not touch the file, openOutput() replaces it
+		Archiving::StreamingXMLWriter *pArchive3 = new Archiving::StreamingXMLWriter();
+		Assert::IsTrue(pArchive2->save("test_stream.xml"), "Archive2 save");
+		Assert::IsTrue(!pArchive3->loadFromFile("test_stream.xml") && pArchive2->loadFromFile("test_stream.xml"), "Archive3 loadFromFile");
+		Assert::IsTrue(pArchive3->openOutput("test_stream.xml"), "Archive3 openOutput");
+		pArchive3->setInt(13, "test");
+		Assert::IsTrue(pArchive3->save(), "Archive3 save");
+		Assert::IsTrue(pArchive2->loadFromFile("test_stream.xml") && pArchive2->getInt("test") == 13, "Archive2 streamed file");
+		delete pArchive3;
+
+		// Control characters can not be written to XML 1.0
+		Archiving::StreamingXMLWriter *pArchive4 = new Archiving::StreamingXMLWriter();
+		pArchive4->setString("a\001b", "text");
+		Assert::IsTrue(pArchive4->getErrorCount() == 1 && !pArchive4->save("test_stream.xml"), "Archive4 control character");
+		delete pArchive4;
+
+		delete pArchive2;
+	}
+
+	[Test]
+	void Test_SymbolTable()
+	{
+		Archiving::SymbolTable aSymbols;
+		Assert::IsTrue(aSymbols.intern("int") == Archiving::SymbolTable::kInt, "predefined type symbol");
+		Assert::IsTrue(aSymbols.find("class Rect") == Archiving::SymbolTable::kNone, "find does not add");
+
+		Archiving::Symbol ulRect = aSymbols.intern("class Rect");
+		Assert::IsTrue(aSymbols.intern(std::string("class Rect")) == ulRect, "equal strings, equal symbols");
+		Assert::IsTrue(aSymbols.getString(ulRect) == "class Rect", "string of symbol");
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setInt(12, "test");
+
+		Archiving::ArchivingResult nStatus;
+		pArchive1->getString("test", &nStatus);
+		Assert::IsTrue(nStatus == Archiving::NotFound, "Archive1 type mismatch");
+		Assert::IsTrue(pArchive1->getInt("test", &nStatus) == 12 && nStatus == Archiving::Found, "Archive1 getInt");
+
+		delete pArchive1;
+	}
+
+	[Test]
+	void Test_NodeArena()
+	{
+		// The index grows past a load of 3/4 and keeps all entries
+		Archiving::NodeArena aArena;
+		Archiving::SymbolIndex aIndex;
+		int aValues[100];
+		Assert::IsTrue(aIndex.find(1) == NULL, "empty index");
+		for (Archiving::Symbol i = 1; i <= 100; ++i)
+			aIndex.insert(aArena, i * 16, &aValues[i - 1]);
+		Assert::IsTrue(aIndex.size() == 100, "index size after growth");
+		bool bAll = true;
+		for (Archiving::Symbol i = 1; i <= 100; ++i)
+			bAll = bAll && aIndex.find(i * 16) == &aValues[i - 1];
+		Assert::IsTrue(bAll, "index entries after growth");
+
+		// A key inserted again replaces its value, a miss changes nothing
+		aIndex.insert(aArena, 32, &aValues[50]);
+		Assert::IsTrue(aIndex.find(32) == &aValues[50] && aIndex.size() == 100, "index replace");
+		Assert::IsTrue(aIndex.find(17) == NULL && aIndex.size() == 100, "index miss");
+		Assert::IsTrue(aIndex.find(16) == &aValues[0], "index after miss");
+
+		Archiving::ChildIndex aChildren;
+		aChildren.insert(aArena, 5, (Archiving::INode *)&aValues[0]);
+		aChildren.insert(aArena, 5, (Archiving::INode *)&aValues[1]);
+		Assert::IsTrue(aChildren.find(5) == (Archiving::INode *)&aValues[1] && aChildren.size() == 1, "child index replace");
+
+		// release() keeps the largest block: a large allocation fits into it again
+		Archiving::NodeArena aBlocks;
+		aBlocks.allocate(100);
+		void *pLarge = aBlocks.allocate(1024 * 1024);
+		aBlocks.allocate(100);
+		aBlocks.release();
+		Assert::IsTrue(aBlocks.getAllocatedSize() == 0, "arena release");
+		Assert::IsTrue(aBlocks.allocate(1024 * 1024) == pLarge, "arena keeps largest block");
+
+		// adopt() takes the blocks over, the allocations of the other arena stay valid
+		Archiving::NodeArena aTarget;
+		const char *pFirst = aTarget.copyString("first", 5);
+		size_t nTarget = aTarget.getAllocatedSize();
+		const char *pAdopted;
+		{
+			Archiving::NodeArena aSource;
+			pAdopted = aSource.copyString("adopted", 7);
+			size_t nSource = aSource.getAllocatedSize();
+			aTarget.adopt(aSource);
+			Assert::IsTrue(aSource.getAllocatedSize() == 0 && aTarget.getAllocatedSize() == nTarget + nSource, "arena adopt sizes");
+		}
+		Assert::IsTrue(std::string(pAdopted) == "adopted" && std::string(pFirst) == "first", "arena adopted strings");
+		const char *pNext = aTarget.copyString("next", 4);
+		Assert::IsTrue(pNext == pFirst + 8, "arena allocates from its own block after adopt");
+	}
+
+	[Test]
+	void Test_NumericCodec()
+	{
+		char aBuffer[Archiving::NumericCodec::kBufferSize];
+		Archiving::NumericCodec::format(0.1, aBuffer);
+		Assert::IsTrue(std::string(aBuffer) == "0.1", "shortest double");
+		Archiving::NumericCodec::format(0.1f, aBuffer);
+		Assert::IsTrue(std::string(aBuffer) == "0.1", "shortest float");
+		Archiving::NumericCodec::format(-2147483647l - 1, aBuffer);
+		Assert::IsTrue(std::string(aBuffer) == "-2147483648", "minimal long");
+
+		double dValue = 0.0;
+		Assert::IsTrue(Archiving::NumericCodec::parse("1.7976931348623157e308", dValue) && dValue == 1.7976931348623157e308, "parse max double");
+		short nValue = 0;
+		Assert::IsTrue(!Archiving::NumericCodec::parse("32768", nValue) && nValue == 0, "short overflow");
+		Assert::IsTrue(!Archiving::NumericCodec::parse("1 ", dValue), "trailing space");
+		Assert::IsTrue(!Archiving::NumericCodec::parse("1e400", dValue), "double overflow");
+		Assert::IsTrue(!Archiving::NumericCodec::parse("1e-400", dValue), "double underflow");
+		float fValue = 0.0f;
+		Assert::IsTrue(Archiving::NumericCodec::parse("3.4028235e38", fValue) && fValue == FLT_MAX, "parse max float");
+		Assert::IsTrue(!Archiving::NumericCodec::parse("3.5e38", fValue), "float overflow");
+		Assert::IsTrue(!Archiving::NumericCodec::parse("-1e39", fValue), "negative float overflow");
+
+		// Neither formatting nor parsing may follow a decimal comma of the global locale
+		std::string sLocale = setlocale(LC_ALL, NULL);
+		Assert::IsTrue(setlocale(LC_ALL, "German_Germany.1252") != NULL, "German locale");
+		Archiving::NumericCodec::format(1.5, aBuffer);
+		bool bFormatted = std::string(aBuffer) == "1.5";
+		bool bParsed = Archiving::NumericCodec::parse("1.2345678901234567e-100", dValue) && dValue == 1.2345678901234567e-100;
+		setlocale(LC_ALL, sLocale.c_str());
+		Assert::IsTrue(bFormatted, "format in German locale");
+		Assert::IsTrue(bParsed, "parse in German locale");
+
+		Archiving::ArrayItemKey aKey;
+		Assert::IsTrue(aKey.get(12) == "item12" && aKey.get(0) == "item0", "array item keys");
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setDouble(0.3, "double");
+		pArchive1->setFloat(3.4028235e38f, "float");
+		pArchive1->setBool(true, "bool");
+		Assert::IsTrue(pArchive1->getDouble("double") == 0.3, "Archive1 getDouble");
+		Assert::IsTrue(pArchive1->getFloat("float") == 3.4028235e38f, "Archive1 getFloat");
+		Assert::IsTrue(pArchive1->getBool("bool"), "Archive1 getBool");
+
+		delete pArchive1;
+	}
+
+	[Test]
+	void Test_PackedArrays()
+	{
+		std::vector<double> lsDoubles;
+		lsDoubles.push_back(0.1);
+		lsDoubles.push_back(-2.5e300);
+		lsDoubles.push_back(3.0);
+		int aInts[] = {-2147483647 - 1, 0, 7};
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setDoubleArray(lsDoubles, "doubles");
+		pArchive1->setIntArray(aInts, 3, "ints");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		Archiving::MappedBinaryArchive *pArchive2 = new Archiving::MappedBinaryArchive();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		std::vector<double> lsRead;
+		Assert::IsTrue(pArchive2->getDoubleArray("doubles", lsRead, NULL) && lsRead == lsDoubles, "Archive2 getDoubleArray");
+		int aRead[3] = {0, 0, 0};
+		Assert::IsTrue(pArchive2->getIntArray("ints", aRead, 2) == 3 && aRead[0] == 0, "Archive2 getIntArray too small");
+		Assert::IsTrue(pArchive2->getIntArray("ints", aRead, 3) == 3 && aRead[0] == aInts[0] && aRead[2] == 7, "Archive2 getIntArray");
+		delete pArchive2;
+
+		Archiving::XMLArchive *pArchive3 = new Archiving::XMLArchive();
+		pArchive3->loadFromString(XML_TEST_HEADER "<archive><test type=\"float[]\" count=\"3\">1 2.5\n-3</test></archive>");
+		std::vector<float> lsFloats;
+		Assert::IsTrue(pArchive3->getFloatArray("test", lsFloats, NULL) && lsFloats.size() == 3 && lsFloats[1] == 2.5f, "Archive3 getFloatArray");
+
+		Archiving::ArchivingResult nStatus;
+		pArchive3->getDoubleArray("test", lsRead, &nStatus);
+		Assert::IsTrue(nStatus == Archiving::NotFound, "Archive3 element type mismatch");
+		delete pArchive3;
+	}
+
+	[Test]
+	void Test_ParallelArray()
+	{
+		std::list<Archiving::IArchivableObject*> lsItems;
+		for (int i = 0; i < 100; ++i)
+		{
+			TestItem *pItem = new TestItem();
+			pItem->id = i;
+			pItem->name = "item";
+			lsItems.push_back(pItem);
+		}
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setArray(lsItems, "items");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		Archiving::ArchiveExecutor aExecutor(4);
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+
+		Archiving::ArchivingResult nStatus = Archiving::Undefined;
+		std::list<TestItem*> *pItems = pArchive2->getArrayParallel<TestItem>("items", &nStatus, aExecutor);
+		Assert::IsTrue(pItems && pItems->size() == 100 && nStatus == Archiving::Found, "Archive2 getArrayParallel");
+
+		int iExpected = 0;
+		for (std::list<TestItem*>::iterator it = pItems->begin(); it != pItems->end(); ++it)
+		{
+			Assert::IsTrue((*it)->id == iExpected++ && (*it)->name == "item", "Archive2 item order");
+			delete *it;
+		}
+		delete pItems;
+
+		pArchive2->getArrayParallel<TestItem>("missing", &nStatus, aExecutor);
+		Assert::IsTrue(nStatus == Archiving::NotFound, "Archive2 missing key");
+		delete pArchive2;
+
+		for (std::list<Archiving::IArchivableObject*>::iterator it = lsItems.begin(); it != lsItems.end(); ++it)
+			delete *it;
+	}
+
+	[Test]
+	void Test_NestedParallelArrays()
+	{
+		Archiving::ArchiveExecutor aExecutor(4);
+		TestGroup::s_pExecutor = &aExecutor;
+
+		std::list<Archiving::IArchivableObject*> lsGroups;
+		for (int i = 0; i < 20; ++i)
+		{
+			TestGroup *pGroup = new TestGroup();
+			for (int j = 0; j < 10; ++j)
+			{
+				TestItem *pItem = new TestItem();
+				pItem->id = i * 10 + j;
+				pGroup->items.push_back(pItem);
+			}
+			lsGroups.push_back(pGroup);
+		}
+
+		// The items of the groups are batches of the executor that runs the groups
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setArrayParallel(lsGroups, "groups", aExecutor);
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		std::list<TestGroup*> *pGroups = pArchive2->getArrayParallel<TestGroup>("groups", NULL, aExecutor);
+		Assert::IsTrue(pGroups && pGroups->size() == 20, "Archive2 groups");
+
+		int iExpected = 0;
+		for (std::list<TestGroup*>::iterator it = pGroups->begin(); it != pGroups->end(); ++it)
+		{
+			Assert::IsTrue((*it)->items.size() == 10, "Archive2 group items");
+			for (std::list<TestItem*>::iterator itItem = (*it)->items.begin(); itItem != (*it)->items.end(); ++itItem)
+				Assert::IsTrue((*itItem)->id == iExpected++, "Archive2 item order");
+			delete *it;
+		}
+		delete pGroups;
+		delete pArchive2;
+
+		for (std::list<Archiving::IArchivableObject*>::iterator it = lsGroups.begin(); it != lsGroups.end(); ++it)
+			delete *it;
+		TestGroup::s_pExecutor = NULL;
+	}
+
+	[Test]
+	void Test_ParallelSave()
+	{
+		std::list<Archiving::IArchivableObject*> lsItems;
+		for (int i = 0; i < 100; ++i)
+		{
+			TestItem *pItem = new TestItem();
+			pItem->id = i;
+			pItem->name = "item";
+			lsItems.push_back(pItem);
+		}
+
+		Archiving::ArchiveExecutor aExecutor(4);
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setInt(1, "before");
+		pArchive1->setArray(lsItems, "items");
+		pArchive1->setInt(2, "after");
+
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		pArchive2->setInt(1, "before");
+		pArchive2->setArrayParallel(lsItems, "items", aExecutor);
+		pArchive2->setInt(2, "after");
+		Assert::IsTrue(pArchive1->getArchiveString() == pArchive2->getArchiveString(), "Binary output equal");
+
+		// The appended items can be read back without saving
+		Archiving::ArchivingResult nStatus = Archiving::Undefined;
+		std::list<TestItem*> *pItems = pArchive2->getArray<TestItem>("items", &nStatus);
+		Assert::IsTrue(pItems && pItems->size() == 100 && nStatus == Archiving::Found, "Archive2 getArray");
+		for (std::list<TestItem*>::iterator it = pItems->begin(); it != pItems->end(); ++it)
+			delete *it;
+		delete pItems;
+		delete pArchive1;
+		delete pArchive2;
+
+		Archiving::StreamingXMLWriter *pWriter1 = new Archiving::StreamingXMLWriter();
+		pWriter1->setArray(lsItems, "items");
+		pWriter1->setInt(2, "after");
+
+		Archiving::StreamingXMLWriter *pWriter2 = new Archiving::StreamingXMLWriter();
+		pWriter2->setArrayParallel(lsItems, "items", aExecutor);
+		pWriter2->setInt(2, "after");
+		Assert::IsTrue(pWriter1->getArchiveString() == pWriter2->getArchiveString(), "Streamed output equal");
+		delete pWriter1;
+		delete pWriter2;
+
+		for (std::list<Archiving::IArchivableObject*>::iterator it = lsItems.begin(); it != lsItems.end(); ++it)
+			delete *it;
+	}
+
+	[Test]
+	void Test_InstanceMetrics()
+	{
+		unsigned long ulNodes = IInstanceCounter<Archiving::Binary::Node>::getInstanceCount();
+		unsigned long ulXercesNodes = IInstanceCounter<Archiving::Xerces::Node>::getInstanceCount();
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setInt(1, "a");
+		pArchive1->setInt(2, "b");
+		Assert::IsTrue(IInstanceCounter<Archiving::Binary::Node>::getInstanceCount() == ulNodes + 3, "Archive1 live nodes");
+		delete pArchive1;
+		Assert::IsTrue(IInstanceCounter<Archiving::Binary::Node>::getInstanceCount() == ulNodes, "Archive1 nodes released");
+
+		Archiving::InstanceMetrics::Snapshot aNodes = IInstanceCounter<Archiving::Binary::Node>::getInstanceMetrics();
+		Assert::IsTrue(aNodes.ullPeak >= 3 && aNodes.ullTotal >= aNodes.ullPeak, "Binary node peak and total");
+		Assert::IsTrue(aNodes.ullTotalBytes == aNodes.ullTotal * sizeof(Archiving::Binary::Node), "Binary node bytes");
+
+		// Loading again drops the wrappers of the previous document
+		Archiving::XMLArchive *pArchive2 = new Archiving::XMLArchive();
+		for (int i = 0; i < 3; ++i)
+		{
+			pArchive2->loadFromString(XML_TEST_HEADER "<archive><test type=\"int\">12</test></archive>");
+			Assert::IsTrue(pArchive2->getInt("test") == 12, "Archive2 getInt");
+		}
+		Assert::IsTrue(IInstanceCounter<Archiving::Xerces::Node>::getInstanceCount() == ulXercesNodes + 2, "Archive2 live nodes");
+		delete pArchive2;
+		Assert::IsTrue(IInstanceCounter<Archiving::Xerces::Node>::getInstanceCount() == ulXercesNodes, "Archive2 nodes released");
+
+		// Archivable subclasses that opt in are counted at their own size
+		unsigned long ulObjects = IInstanceCounter<Archiving::IArchivableObject>::getInstanceCount();
+		unsigned long ulCounted = IInstanceCounter<TestCountedItem>::getInstanceCount();
+		TestCountedItem *pItem = new TestCountedItem();
+		Assert::IsTrue(IInstanceCounter<TestCountedItem>::getInstanceCount() == ulCounted + 1, "Counted item live");
+		Assert::IsTrue(IInstanceCounter<Archiving::IArchivableObject>::getInstanceCount() == ulObjects + 1, "Archivable objects live");
+		Archiving::InstanceMetrics::Snapshot aItems = IInstanceCounter<TestCountedItem>::getInstanceMetrics();
+		Assert::IsTrue(aItems.ullBytes == aItems.ullLive * sizeof(TestCountedItem), "Counted item bytes");
+		delete pItem;
+		Assert::IsTrue(IInstanceCounter<TestCountedItem>::getInstanceCount() == ulCounted, "Counted item released");
+
+		std::vector<Archiving::InstanceMetrics::Snapshot> lsSnapshot = Archiving::InstanceMetrics::getSnapshot();
+		Assert::IsTrue(!lsSnapshot.empty() && Archiving::InstanceMetrics::getReport().find(typeid(Archiving::Binary::Node).name()) != std::string::npos, "Snapshot");
+	}
+
+	[Test]
+	void Test_LazyChildNodes()
+	{
+		std::string sData = XML_TEST_HEADER "<archive>";
+		char aKey[32];
+		for (int i = 0; i < 5000; ++i)
+		{
+			sprintf(aKey, "key%d", i);
+			sData += std::string("<") + aKey + " type=\"int\">" + (aKey + 3) + "</" + aKey + ">";
+		}
+		sData += "</archive>";
+
+		unsigned long ulNodes = IInstanceCounter<Archiving::Xerces::Node>::getInstanceCount();
+		Archiving::XMLArchive *pArchive = new Archiving::XMLArchive();
+		Assert::IsTrue(pArchive->loadFromString(sData), "loadFromString");
+		Assert::IsTrue(pArchive->getInt("key4711") == 4711, "getInt");
+
+		// A missing key creates no node, a key of another type only its own
+		Archiving::ArchivingResult nStatus = Archiving::Undefined;
+		pArchive->getInt("missing", &nStatus);
+		Assert::IsTrue(nStatus == Archiving::NotFound, "missing key");
+		pArchive->getString("key42", &nStatus);
+		Assert::IsTrue(nStatus != Archiving::Found, "wrong type");
+		Assert::IsTrue(IInstanceCounter<Archiving::Xerces::Node>::getInstanceCount() == ulNodes + 3, "nodes of the root and the keys read");
+
+		delete pArchive;
+	}
+
+	[Test]
+	void Test_OrderedReads()
+	{
+		std::list<Archiving::IArchivableObject*> lsItems;
+		for (int i = 0; i < 10; ++i)
+		{
+			TestItem *pItem = new TestItem();
+			pItem->id = i;
+			lsItems.push_back(pItem);
+		}
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setArray(lsItems, "items");
+		pArchive1->setInt(1, "key");
+		pArchive1->setString("text", "key");
+		pArchive1->setInt(2, "after");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		// Read in the order of writing, every key is found by the cursor
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		pArchive2->enableStats();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		Archiving::ArchivingResult nStatus = Archiving::Undefined;
+		std::list<TestItem*> *pItems = pArchive2->getArray<TestItem>("items", &nStatus);
+		Assert::IsTrue(pItems && pItems->size() == 10 && pItems->back()->id == 9, "Archive2 getArray");
+		Assert::IsTrue(pArchive2->getStats()->getOrderedHitRate() == 1.0, "Archive2 hit rate");
+		Assert::IsTrue(pArchive2->getStats()->getCounter(Archiving::ArchiveStats::kOrderedHits) == 31, "Archive2 hits");
+
+		// Keys out of order fall back to the keyed lookup. "key" was set again with another type, the index holds the string.
+		Assert::IsTrue(pArchive2->getInt("after") == 2, "Archive2 after");
+		Assert::IsTrue(pArchive2->getString("key") == "text", "Archive2 string key");
+		Assert::IsTrue(pArchive2->getStats()->getCounter(Archiving::ArchiveStats::kOrderedMisses) == 2, "Archive2 misses");
+
+		// The mapped archive passes over the int stored under "key" as well
+		Archiving::MappedBinaryArchive *pArchive3 = new Archiving::MappedBinaryArchive();
+		Assert::IsTrue(pArchive3->loadFromString(sData), "Archive3 loadFromString");
+		Assert::IsTrue(pArchive3->getString("key") == "text" && pArchive3->getInt("after") == 2, "Archive3 string key");
+		delete pArchive3;
+
+		for (std::list<TestItem*>::iterator it = pItems->begin(); it != pItems->end(); ++it)
+			delete *it;
+		delete pItems;
+		delete pArchive2;
+		for (std::list<Archiving::IArchivableObject*>::iterator it = lsItems.begin(); it != lsItems.end(); ++it)
+			delete *it;
+	}
+
+	[Test]
+	void Test_ArchiveStats()
+	{
+		std::list<Archiving::IArchivableObject*> lsItems;
+		for (int i = 0; i < 10; ++i)
+			lsItems.push_back(new TestItem());
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive1->getStats() == NULL, "Archive1 stats disabled");
+		pArchive1->enableStats();
+		pArchive1->setArray(lsItems, "items");
+		std::string sData = pArchive1->getArchiveString();
+
+		Archiving::ArchiveStats *pStats = pArchive1->getStats();
+		Assert::IsTrue(pStats->getCounter(Archiving::ArchiveStats::kNodesCreated) == 31, "Archive1 nodes created");
+		Assert::IsTrue(pStats->getCounter(Archiving::ArchiveStats::kBytesWritten) == sData.size(), "Archive1 bytes written");
+		std::vector<Archiving::ArchiveStats::ClassStats> lsClasses = pStats->getClasses();
+		Assert::IsTrue(lsClasses.size() == 1 && lsClasses[0].ulSerialized == 10, "Archive1 classes");
+		delete pArchive1;
+
+		Archiving::ArchiveExecutor aExecutor(4);
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		pArchive2->enableStats();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		Archiving::ArchivingResult nStatus = Archiving::Undefined;
+		std::list<TestItem*> *pItems = pArchive2->getArrayParallel<TestItem>("items", &nStatus, aExecutor);
+		pArchive2->getInt("missing", &nStatus);
+
+		// The cursors of the parallel read add their stats to the archive
+		pStats = pArchive2->getStats();
+		Assert::IsTrue(pStats->getCounter(Archiving::ArchiveStats::kBytesRead) == sData.size(), "Archive2 bytes read");
+		Assert::IsTrue(pStats->getCounter(Archiving::ArchiveStats::kNotFound) == 1, "Archive2 not found");
+		Assert::IsTrue(pStats->getCounter(Archiving::ArchiveStats::kLookups) >= 21, "Archive2 lookups");
+		lsClasses = pStats->getClasses();
+		Assert::IsTrue(lsClasses.size() == 1 && lsClasses[0].ulDeserialized == 10, "Archive2 classes");
+		Assert::IsTrue(pStats->getReport().find(lsClasses[0].sName) != std::string::npos, "Archive2 report");
+
+		pStats->reset();
+		Assert::IsTrue(pStats->getCounter(Archiving::ArchiveStats::kLookups) == 0 && pStats->getClasses().empty(), "Archive2 reset");
+		pArchive2->enableStats(false);
+		Assert::IsTrue(pArchive2->getStats() == NULL, "Archive2 stats disabled");
+
+		for (std::list<TestItem*>::iterator it = pItems->begin(); it != pItems->end(); ++it)
+			delete *it;
+		delete pItems;
+		delete pArchive2;
+		for (std::list<Archiving::IArchivableObject*>::iterator it = lsItems.begin(); it != lsItems.end(); ++it)
+			delete *it;
+	}
+
+	[Test]
+	void Test_Compression()
+	{
+		Archiving::CompressedBinaryArchive *pArchive1 = new Archiving::CompressedBinaryArchive();
+		pArchive1->setInt(12, "test");
+		pArchive1->setString(std::string(10000, 'x'), "text");
+		Assert::IsTrue(pArchive1->save("test_compressed.kvab"), "Archive1 save");
+		delete pArchive1;
+
+		std::string sFile;
+		Assert::IsTrue(Archiving::CompressionCodec::readFile("test_compressed.kvab", sFile), "Compressed file read");
+		Assert::IsTrue(sFile.compare(0, 4, "KVAZ") == 0 && sFile.size() < 1000, "Compressed file format");
+
+		Archiving::CompressedBinaryArchive *pArchive2 = new Archiving::CompressedBinaryArchive("test_compressed.kvab");
+		Assert::IsTrue(pArchive2->getInt("test") == 12, "Archive2 getInt");
+		Assert::IsTrue(pArchive2->getString("text") == std::string(10000, 'x'), "Archive2 getString");
+
+		// Loaded archives are saved as a whole again and again
+		for (int i = 0; i < 3; ++i)
+		{
+			pArchive2->setInt(i, "round");
+			Assert::IsTrue(pArchive2->saveChanges(), "Archive2 saveChanges");
+		}
+		delete pArchive2;
+
+		pArchive2 = new Archiving::CompressedBinaryArchive("test_compressed.kvab");
+		Assert::IsTrue(pArchive2->getInt("round") == 2 && pArchive2->getInt("test") == 12, "Archive2 rounds");
+		delete pArchive2;
+
+		// Plain archives load unchanged
+		Archiving::BinaryArchive *pArchive3 = new Archiving::BinaryArchive();
+		pArchive3->setInt(13, "test");
+		Assert::IsTrue(pArchive3->save("test_plain.kvab"), "Archive3 save");
+		delete pArchive3;
+
+		Archiving::CompressedBinaryArchive *pArchive4 = new Archiving::CompressedBinaryArchive("test_plain.kvab");
+		Assert::IsTrue(pArchive4->getInt("test") == 13, "Archive4 getInt");
+		Assert::IsTrue(!pArchive4->loadFromString(sFile.substr(0, sFile.size() - 4)), "Archive4 truncated");
+		delete pArchive4;
+
+		// Chunks split across an executor
+		Archiving::ArchiveExecutor aExecutor(4);
+		Archiving::CompressionCodec::setExecutor(&aExecutor);
+		std::string sData, sPacked, sUnpacked;
+		for (int i = 0; i < 100000; ++i)
+			sData += (char)('a' + i * 7 % 13);
+		Archiving::CompressionCodec::compress(sData, sPacked, 1, 4096);
+		Assert::IsTrue(Archiving::CompressionCodec::decompress(sPacked, sUnpacked) && sUnpacked == sData, "Codec roundtrip");
+		Archiving::CompressionCodec::setExecutor(NULL);
+	}
+
+	[Test]
+	void Test_IncrementalSave()
+	{
+		std::list<Archiving::IArchivableObject*> lsItems;
+		for (int i = 0; i < 1000; ++i)
+			lsItems.push_back(new TestItem());
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setArray(lsItems, "items");
+		pArchive1->setInt(1, "version");
+		Assert::IsTrue(pArchive1->save("test_incremental.kvab"), "Archive1 save");
+		delete pArchive1;
+
+		std::string sBase;
+		Archiving::CompressionCodec::readFile("test_incremental.kvab", sBase);
+
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		pArchive2->trackObjects();
+		Assert::IsTrue(pArchive2->loadFromFile("test_incremental.kvab"), "Archive2 loadFromFile");
+		std::list<TestItem*> *pItems = pArchive2->getArray<TestItem>("items", NULL);
+		TestItem *pItem = *(++pItems->begin());
+		pItem->id = 42;
+		pItem->name = "changed";
+		Assert::IsTrue(pArchive2->markDirty(pItem), "Archive2 markDirty");
+		pArchive2->setInt(2, "version");
+		pArchive2->setString("value", "added");
+		Assert::IsTrue(pArchive2->saveChanges(), "Archive2 saveChanges");
+
+		// The changes are appended, the file is unchanged behind the flags of the header
+		std::string sFile;
+		Archiving::CompressionCodec::readFile("test_incremental.kvab", sFile);
+		Assert::IsTrue(sFile.size() > sBase.size() && sFile.size() < sBase.size() + 200, "Changes appended");
+		Assert::IsTrue(sFile.compare(6, sBase.size() - 6, sBase, 6, sBase.size() - 6) == 0, "Base unchanged");
+
+		Archiving::BinaryArchive *pArchive3 = new Archiving::BinaryArchive("test_incremental.kvab");
+		Assert::IsTrue(pArchive3->getArchiveString() == pArchive2->getArchiveString(), "Archive3 same tree");
+		Assert::IsTrue(pArchive3->getInt("version") == 2 && pArchive3->getString("added") == "value", "Archive3 values");
+		delete pArchive3;
+
+		Archiving::MappedBinaryArchive *pArchive4 = new Archiving::MappedBinaryArchive();
+		Assert::IsTrue(!pArchive4->loadFromFile("test_incremental.kvab"), "Archive4 segments");
+		Assert::IsTrue(pArchive2->save(), "Archive2 save");
+		Assert::IsTrue(pArchive4->loadFromFile("test_incremental.kvab"), "Archive4 after save");
+		delete pArchive4;
+
+		// An append that did not complete is ignored, the next saveChanges() writes the file anew
+		pArchive2->setInt(3, "version");
+		Assert::IsTrue(pArchive2->saveChanges(), "Archive2 second saveChanges");
+		std::string sTorn;
+		Archiving::CompressionCodec::readFile("test_incremental.kvab", sTorn);
+		Archiving::CompressionCodec::writeFile("test_incremental.kvab", sTorn.substr(0, sTorn.size() - 5));
+		pArchive3 = new Archiving::BinaryArchive("test_incremental.kvab");
+		Assert::IsTrue(pArchive3->getInt("version") == 2 && pArchive3->getErrorCount() == 1, "Archive3 torn segment");
+		pArchive3->setInt(4, "version");
+		Assert::IsTrue(pArchive3->saveChanges(), "Archive3 saveChanges");
+		delete pArchive3;
+		pArchive3 = new Archiving::BinaryArchive("test_incremental.kvab");
+		Assert::IsTrue(pArchive3->getInt("version") == 4 && pArchive3->getErrorCount() == 0, "Archive3 repaired");
+		delete pArchive3;
+
+		for (std::list<TestItem*>::iterator it = pItems->begin(); it != pItems->end(); ++it)
+			delete *it;
+		delete pItems;
+		delete pArchive2;
+		for (std::list<Archiving::IArchivableObject*>::iterator it = lsItems.begin(); it != lsItems.end(); ++it)
+			delete *it;
+	}
+
+	[Test]
+	void Test_SharedReferences()
+	{
+		TestItem *pItem = new TestItem();
+		pItem->id = 7;
+		TestPair *pPair = new TestPair();
+		pPair->first = pItem;
+		pPair->second = pItem;
+		pPair->next = pPair;
+
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->trackReferences();
+		pArchive1->setObject(pPair, "pair");
+		pArchive1->setObject(pItem, "item");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		// Read the reference before the object it refers to
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		pArchive2->trackReferences();
+		TestItem *pItem2 = pArchive2->getObject<TestItem>("item", NULL);
+		TestPair *pPair2 = pArchive2->getObject<TestPair>("pair", NULL);
+		Assert::IsTrue(pItem2 && pItem2->id == 7, "Archive2 item");
+		Assert::IsTrue(pPair2 && pPair2->first == pItem2 && pPair2->second == pItem2, "Archive2 shared item");
+		Assert::IsTrue(pPair2->next == pPair2, "Archive2 cycle");
+		delete pItem2;
+		delete pPair2;
+		delete pArchive2;
+
+		// Without tracking, the references are read as copies and the cycle is cut
+		Archiving::BinaryArchive *pArchive3 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive3->loadFromString(sData), "Archive3 loadFromString");
+		TestPair *pPair3 = pArchive3->getObject<TestPair>("pair", NULL);
+		Assert::IsTrue(pPair3 && pPair3->second && pPair3->second != pPair3->first && pPair3->second->id == 7, "Archive3 copy");
+		Assert::IsTrue(pPair3->next && pPair3->next->next == NULL, "Archive3 cycle cut");
+		delete pPair3->next->first;
+		delete pPair3->next->second;
+		delete pPair3->next;
+		delete pPair3->first;
+		delete pPair3->second;
+		delete pPair3;
+		delete pArchive3;
+
+		delete pItem;
+		delete pPair;
+	}
+
+	[Test]
+	void Test_ArchivedFields()
+	{
+		TestFieldItem aItem;
+		aItem.id = 3;
+		aItem.name = "fields";
+		aItem.values.assign(4, 0.5);
+		aItem.item = new TestItem();
+		aItem.item->id = 4;
+
+		// The same archive as through serialize()
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setFields(aItem, "item");
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		pArchive2->setObject(&aItem, "item");
+		Assert::IsTrue(pArchive1->getArchiveString() == pArchive2->getArchiveString(), "Archive1 same as setObject()");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+		delete pArchive2;
+
+		Archiving::BinaryArchive *pArchive3 = new Archiving::BinaryArchive();
+		pArchive3->enableStats();
+		Assert::IsTrue(pArchive3->loadFromString(sData), "Archive3 loadFromString");
+		Archiving::ArchivingResult nStatus;
+		TestFieldItem *pItem = pArchive3->getFields<TestFieldItem>("item", &nStatus);
+		Assert::IsTrue(nStatus == Archiving::Found && pItem->id == 3 && pItem->name == "fields", "Archive3 getFields");
+		Assert::IsTrue(pItem->values == aItem.values && pItem->item && pItem->item->id == 4, "Archive3 getFields nested");
+		Assert::IsTrue(pArchive3->getStats()->getCounter(Archiving::ArchiveStats::kOrderedMisses) == 0, "Archive3 vector looked up once");
+		delete pItem->item;
+		delete pItem;
+
+		pItem = pArchive3->getObject<TestFieldItem>("item", NULL);
+		Assert::IsTrue(pItem && pItem->id == 3 && pItem->values == aItem.values, "Archive3 getObject");
+		delete pItem->item;
+		delete pItem;
+
+		pArchive3->getFields<TestFieldItem>("missing", &nStatus);
+		Assert::IsTrue(nStatus == Archiving::NotFound, "Archive3 missing key");
+		delete pArchive3;
+
+		delete aItem.item;
+	}
+
+	[Test]
+	void Test_StaticNodeCalls()
+	{
+		TestFieldItem aItem;
+		aItem.id = 5;
+		aItem.name = "static";
+		aItem.values.assign(3, 1.5);
+		aItem.item = new TestItem();
+		aItem.item->id = 6;
+		int aValues[] = {1, 2, 3};
+
+		// The statically and the virtually called nodes write the same archive
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setObject(&aItem, "item");
+		pArchive1->setIntArray(aValues, 3, "values");
+		Archiving::KeyValueArchive<TestBinaryDriver> *pArchive2 = new Archiving::KeyValueArchive<TestBinaryDriver>();
+		pArchive2->setObject(&aItem, "item");
+		pArchive2->setIntArray(aValues, 3, "values");
+		std::string sData = pArchive1->getArchiveString();
+		Assert::IsTrue(sData == pArchive2->getArchiveString(), "Archive2 same as Archive1");
+		delete pArchive1;
+		delete pArchive2;
+
+		Archiving::MappedBinaryArchive *pArchive3 = new Archiving::MappedBinaryArchive();
+		Assert::IsTrue(pArchive3->loadFromString(sData), "Archive3 loadFromString");
+		TestFieldItem *pItem = pArchive3->getObject<TestFieldItem>("item", NULL);
+		Assert::IsTrue(pItem && pItem->id == 5 && pItem->name == "static" && pItem->values == aItem.values, "Archive3 getObject");
+		Assert::IsTrue(pItem->item && pItem->item->id == 6, "Archive3 getObject nested");
+		int aRead[3] = {0, 0, 0};
+		Assert::IsTrue(pArchive3->getIntArray("values", aRead, 3, NULL) == 3 && aRead[2] == 3, "Archive3 getIntArray");
+		delete pItem->item;
+		delete pItem;
+		delete pArchive3;
+
+		delete aItem.item;
+	}
+
+	[Test]
+	void Test_RegisteredClasses()
+	{
+		TestItem aItem;
+		aItem.id = 1;
+		TestLabeledItem aLabeled;
+		aLabeled.id = 2;
+		aLabeled.label = "labeled";
+
+		std::list<Archiving::IArchivableObject*> lsItems;
+		lsItems.push_back(&aItem);
+		lsItems.push_back(&aLabeled);
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setArray(lsItems, "items");
+		pArchive1->setObject(&aLabeled, "item");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		// The items are created as the classes they were written as
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		std::list<TestItem*> *pItems = pArchive2->getArray<TestItem>("items", NULL);
+		Assert::IsTrue(pItems && pItems->size() == 2, "Archive2 getArray");
+		Assert::IsTrue(pItems->front()->id == 1 && dynamic_cast<TestLabeledItem*>(pItems->front()) == NULL, "Archive2 base item");
+		TestLabeledItem *pLabeled = dynamic_cast<TestLabeledItem*>(pItems->back());
+		Assert::IsTrue(pLabeled && pLabeled->id == 2 && pLabeled->label == "labeled", "Archive2 registered item");
+		delete pItems->front();
+		delete pItems->back();
+		delete pItems;
+
+		Archiving::ArchivingResult nStatus;
+		TestItem *pItem = pArchive2->getObject<TestItem>("item", &nStatus);
+		Assert::IsTrue(nStatus == Archiving::Found && dynamic_cast<TestLabeledItem*>(pItem) != NULL, "Archive2 getObject");
+		delete pItem;
+
+		// A class that is not one of the requested is not found, as before
+		TestPair *pPair = pArchive2->getObject<TestPair>("item", &nStatus);
+		Assert::IsTrue(pPair == NULL && nStatus == Archiving::NotFound, "Archive2 unrelated class");
+		delete pArchive2;
+	}
+
+	[Test]
+	void Test_ObjectPool()
+	{
+		std::list<Archiving::IArchivableObject*> lsItems;
+		TestItem aItems[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			aItems[i].id = i;
+			lsItems.push_back(&aItems[i]);
+		}
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setArray(lsItems, "items");
+		pArchive1->setObject(&aItems[1], "item");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		// The items are constructed in the pool while it is installed, and given back to it
+		Archiving::ObjectPool<TestItem> aPool(2);
+		aPool.install();
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive2->loadFromString(sData), "Archive2 loadFromString");
+		std::vector<TestItem*> lsRead;
+		Assert::IsTrue(pArchive2->getArray<TestItem>("items", lsRead, NULL), "Archive2 getArray");
+		Assert::IsTrue(lsRead.size() == 3 && lsRead[2]->id == 2, "Archive2 items");
+		Assert::IsTrue(aPool.getUsedCount() == 3 && aPool.getSlotCount() == 4, "Archive2 pool slots");
+		for (size_t i = 0; i < lsRead.size(); ++i)
+			aPool.release(lsRead[i]);
+		Assert::IsTrue(aPool.getUsedCount() == 0, "Archive2 release");
+
+		// An object that is not read goes back to the pool
+		Archiving::ArchivingResult nStatus;
+		TestPair *pPair = pArchive2->getObject<TestPair>("item", &nStatus);
+		Assert::IsTrue(pPair == NULL && aPool.getUsedCount() == 0, "Archive2 unrelated class");
+		aPool.uninstall();
+
+		// The archive looks the class up again once the pool is gone
+		TestItem *pItem = pArchive2->getObject<TestItem>("item", &nStatus);
+		Assert::IsTrue(pItem && pItem->id == 1 && aPool.getUsedCount() == 0, "Archive2 after uninstall");
+		delete pItem;
+
+		// In-place reads leave the storage to the caller
+		TestItem aItem;
+		Assert::IsTrue(pArchive2->getObjectInto("item", aItem, &nStatus) && aItem.id == 1, "Archive2 getObjectInto");
+		Assert::IsTrue(!pArchive2->getObjectInto("missing", aItem, &nStatus) && nStatus == Archiving::NotFound, "Archive2 getObjectInto missing");
+		delete pArchive2;
+	}
+
+	[Test]
+	void Test_SaveAsync()
+	{
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setInt(1, "version");
+		pArchive1->setString("before", "value");
+		std::string sSaved = pArchive1->getArchiveString();
+
+		// The archive may be changed while the save runs, the file gets the archive as it was
+		Archiving::AsyncSave& aSave = pArchive1->saveAsync("test_async.kvab");
+		pArchive1->setInt(2, "version");
+		pArchive1->setString("after", "value");
+		Assert::IsTrue(aSave.wait() && aSave.isDone(), "Archive1 saveAsync");
+
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive("test_async.kvab");
+		Assert::IsTrue(pArchive2->getArchiveString() == sSaved, "Archive2 snapshot");
+		Assert::IsTrue(pArchive2->getInt("version") == 1, "Archive2 version");
+		delete pArchive2;
+
+		// The next save writes the changes
+		Assert::IsTrue(pArchive1->saveChanges(), "Archive1 saveChanges");
+		Archiving::BinaryArchive *pArchive3 = new Archiving::BinaryArchive("test_async.kvab");
+		Assert::IsTrue(pArchive3->getInt("version") == 2 && pArchive3->getString("value") == "after", "Archive3 changes");
+		delete pArchive3;
+
+		// save() and saveChanges() wait for the save that is still running
+		pArchive1->saveAsync("test_async.kvab");
+		pArchive1->setInt(3, "version");
+		Assert::IsTrue(pArchive1->saveChanges("test_async.kvab"), "Archive1 saveChanges while saving");
+		pArchive3 = new Archiving::BinaryArchive("test_async.kvab");
+		Assert::IsTrue(pArchive3->getInt("version") == 3 && pArchive3->getErrorCount() == 0, "Archive3 after both saves");
+		delete pArchive3;
+
+		// A failed save is reported by wait()
+		pArchive1->saveAsync("missing_directory/test_async.kvab");
+		Assert::IsTrue(!pArchive1->waitForSave(), "Archive1 bad path");
+		delete pArchive1;
+	}
+
+
+	[Test]
+	void Test_LoadAsync()
+	{
+		std::vector<double> lsDoubles(1000, 0.5);
+		char aKey[32];
+		Archiving::BinaryArchive *pArchive1 = new Archiving::BinaryArchive();
+		pArchive1->setInt(1, "first");
+		for (int i = 0; i < 1000; ++i)
+		{
+			sprintf(aKey, "value%d", i);
+			pArchive1->setInt(i, aKey);
+		}
+		pArchive1->setDoubleArray(lsDoubles, "doubles");
+		pArchive1->setInt(2, "last");
+		Assert::IsTrue(pArchive1->save("test_async_load.kvab"), "Archive1 save");
+		std::string sData = pArchive1->getArchiveString();
+		delete pArchive1;
+
+		// The values can be read while the rest of the archive is parsed
+		Archiving::BinaryArchive *pArchive2 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive2->loadFromFileAsync("test_async_load.kvab"), "Archive2 loadFromFileAsync");
+		Assert::IsTrue(pArchive2->getInt("last") == 2, "Archive2 last");
+		std::vector<double> lsRead;
+		Assert::IsTrue(pArchive2->getDoubleArray("doubles", lsRead, NULL) && lsRead == lsDoubles, "Archive2 getDoubleArray");
+		Assert::IsTrue(pArchive2->waitForLoad(), "Archive2 waitForLoad");
+		Assert::IsTrue(pArchive2->getArchiveString() == sData, "Archive2 complete");
+
+		// Changes wait for the parse
+		Archiving::BinaryArchive *pArchive3 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive3->loadFromStringAsync(sData), "Archive3 loadFromStringAsync");
+		pArchive3->setInt(3, "first");
+		Assert::IsTrue(pArchive3->getInt("first") == 3 && pArchive3->getInt("value999") == 999, "Archive3 setInt");
+		delete pArchive3;
+		delete pArchive2;
+
+		// Errors of the parse are reported by waitForLoad()
+		std::string sCorrupted = sData;
+		for (size_t i = sCorrupted.size() / 2; i < sCorrupted.size() / 2 + 64; ++i)
+			sCorrupted[i] = (char)0xee;
+		Archiving::BinaryArchive *pArchive4 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive4->loadFromStringAsync(sCorrupted), "Archive4 loadFromStringAsync");
+		Assert::IsTrue(!pArchive4->waitForLoad() && pArchive4->getErrorCount() == 1, "Archive4 corrupted");
+		delete pArchive4;
+
+		// Of two children with the same key the last is found, as after the load
+		Archiving::BinaryArchive *pArchive5 = new Archiving::BinaryArchive();
+		pArchive5->setInt(1, "first");
+		TestLabeledItem aLabeled;
+		aLabeled.id = 1;
+		pArchive5->setObject(&aLabeled, "item");
+		for (int i = 0; i < 1000; ++i)
+		{
+			sprintf(aKey, "value%d", i);
+			pArchive5->setInt(i, aKey);
+		}
+		TestItem aItem;
+		aItem.id = 2;
+		pArchive5->setObject(&aItem, "item");
+		std::string sDuplicates = pArchive5->getArchiveString();
+		delete pArchive5;
+
+		Archiving::BinaryArchive *pArchive6 = new Archiving::BinaryArchive();
+		Assert::IsTrue(pArchive6->loadFromStringAsync(sDuplicates), "Archive6 loadFromStringAsync");
+		TestItem *pItem = pArchive6->getObject<TestItem>("item", NULL);
+		Assert::IsTrue(pItem && pItem->id == 2 && !dynamic_cast<TestLabeledItem*>(pItem), "Archive6 last duplicate");
+		delete pItem;
+		delete pArchive6;
+	}
+
 };
\ No newline at end of file